@@ -1,5 +1,11 @@
 /** \file clients/lcdexec/lcdexec.c
  * Main file for \c lcdexec, the program starter in the LCDproc suite.
+ *
+ * Commands are started with posix_spawn(). Their termination is noticed
+ * through a pidfd in the poll set (or a SIGCHLD self-pipe where pidfds
+ * are not available), and with \c ShowOutput their stdout and stderr are
+ * read through a pipe and the last lines are shown on the LCD while the
+ * command runs.
  */
 
 /* This file is part of lcdexec, an LCDproc client.
@@ -20,7 +26,15 @@
 #include <signal.h>
 #include <time.h>
 #include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/socket.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#if defined(__linux__)
+# include <sys/syscall.h>
+#endif
 
 #include "getopt.h"
 
@@ -42,6 +56,13 @@
 #define DEFAULT_CONFIGFILE	SYSCONFDIR "/lcdexec.conf"
 #define DEFAULT_PIDFILE		PIDFILEDIR "/lcdexec.pid"
 
+/** Number of output lines of a command kept for display */
+#define OUTPUT_LINES		4
+/** Maximum length of a kept output line */
+#define OUTPUT_LINE_LEN		80
+/** Interval in ms between empty lines sent to check the server connection */
+#define KEEPALIVE_INTERVAL	3000
+
 
 /** information about a process started by lcdexec */
 typedef struct ProcInfo {
@@ -53,6 +74,14 @@ typedef struct ProcInfo {
 	int status;		/**< exit status of the process */
 	int feedback;		/**< what info to show to the user */
 	int shown;		/**< tell if the info has been shown to the user */
+	int pidfd;		/**< pidfd signalling the end of the process; -1 if none */
+	int outfd;		/**< read end of the output pipe; -1 if not captured */
+	char output[OUTPUT_LINES][OUTPUT_LINE_LEN+1];	/**< ring of last output lines */
+	int outline;		/**< index of the line currently being read */
+	int outpos;		/**< length of the line currently being read */
+	int output_dirty;	/**< output changed since last shown */
+	long output_time;	/**< time in ms the output was last shown */
+	int screen;		/**< the live output screen has been created */
 } ProcInfo;
 
 
@@ -87,6 +116,7 @@ char *pidfile = NULL;
 int pidfile_written = FALSE;
 char *displayname = NULL;
 char *default_shell = NULL;
+int output_interval = UNSET_INT;
 
 /* Other global variables */
 MenuEntry *main_menu = NULL;	/**< pointer to the main menu */
@@ -99,16 +129,21 @@ int sock = -1;			/**< socket to connect to server */
 
 int Quit = 0;			/**< indicate end of main loop */
 
+int use_pidfd = FALSE;		/**< pidfds are supported by the system */
+int sigchld_pipe[2] = { -1, -1 };	/**< self-pipe written to on SIGCHLD */
+
 
 /* Function prototypes */
 static void exit_program(int val);
 static void sigchld_handler(int signal);
+static int open_pidfd(pid_t pid);
 static int process_command_line(int argc, char **argv);
 static int process_configfile(char * configfile);
 static int connect_and_setup(void);
 static int process_response(char *str);
 static int exec_command(MenuEntry *cmd);
 static int show_procinfo_msg(ProcInfo *p);
+static void show_output(ProcInfo *p, long now);
 static int main_loop(void);
 
 
@@ -120,6 +155,7 @@ int main(int argc, char **argv)
 {
 	int error = 0;
 	struct sigaction sa;
+	int i;
 
 	CHAIN(error, process_command_line(argc, argv));
 	if (configfile == NULL)
@@ -168,11 +204,27 @@ int main(int argc, char **argv)
 	sigaction(SIGPIPE, &sa, NULL);	// write to closed socket
 	sigaction(SIGKILL, &sa, NULL);	// kill -9 [cannot be trapped; but ...]
 
-	/* setup signal handler for children to avoid zombies */
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
-	sa.sa_handler = sigchld_handler;
-	sigaction(SIGCHLD, &sa, NULL);
+	/* Learn about finished children through pidfds if possible, else let
+	 * the SIGCHLD handler wake up the main loop through a pipe */
+	if ((i = open_pidfd(getpid())) >= 0) {
+		close(i);
+		use_pidfd = TRUE;
+	}
+	else if (pipe(sigchld_pipe) == 0) {
+		fcntl(sigchld_pipe[0], F_SETFD, FD_CLOEXEC);
+		fcntl(sigchld_pipe[1], F_SETFD, FD_CLOEXEC);
+		fcntl(sigchld_pipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(sigchld_pipe[1], F_SETFL, O_NONBLOCK);
+
+		sigemptyset(&sa.sa_mask);
+		sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+		sa.sa_handler = sigchld_handler;
+		sigaction(SIGCHLD, &sa, NULL);
+	}
+	else {
+		report(RPT_WARNING, "Could not create pipe, finished commands are checked every %d ms",
+		       KEEPALIVE_INTERVAL);
+	}
 
 	main_loop();
 
@@ -194,27 +246,121 @@ static void exit_program(int val)
 }
 
 
-/* the grim reaper ;-) */
+/** Wake up the main loop to reap the finished child. */
 static void sigchld_handler(int signal)
 {
-	pid_t pid;
-	int status;
+	int saved_errno = errno;
 
-	/* wait for the child that was signalled as finished */
-	if ((pid = wait(&status)) != -1) {
-		ProcInfo *p;
+	/* if the pipe is full the main loop wakes up anyway */
+	(void) !write(sigchld_pipe[1], "", 1);
+	errno = saved_errno;
+}
+
+
+/**
+ * Get a pidfd for a process that becomes readable when it terminates.
+ * \param pid  Process to watch.
+ * \return  File descriptor or -1 if pidfds are not supported.
+ */
+static int open_pidfd(pid_t pid)
+{
+#if defined(SYS_pidfd_open)
+	/* pidfd_open() always sets close-on-exec */
+	return syscall(SYS_pidfd_open, pid, 0);
+#else
+	return -1;
+#endif
+}
+
+
+/** Current time in milliseconds. */
+static long time_ms(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000L + tv.tv_usec / 1000L;
+}
+
+
+/** Collect the exit status of all finished children. */
+static void reap_children(void)
+{
+	ProcInfo *p;
+
+	for (p = proc_queue; p != NULL; p = p->next) {
+		int status;
+
+		if (p->endtime > 0)
+			continue;
+		if (waitpid(p->pid, &status, WNOHANG) == p->pid) {
+			p->status = status;
+			p->endtime = time(NULL);
+			if (p->pidfd >= 0) {
+				close(p->pidfd);
+				p->pidfd = -1;
+			}
+		}
+	}
+}
+
+
+/**
+ * Read what is available from a command's output pipe into its line ring.
+ * \param p  Process whose output to read.
+ */
+static void read_output(ProcInfo *p)
+{
+	char buf[512];
+	ssize_t len;
 
-		/* fill the procinfo structure with the necessary information */
-		for (p = proc_queue; p != NULL; p = p->next) {
-			if (p->pid == pid) {
-				p->status = status;
-				p->endtime = time(NULL);
+	while ((len = read(p->outfd, buf, sizeof(buf))) > 0) {
+		ssize_t i;
+
+		for (i = 0; i < len; i++) {
+			char *line = p->output[p->outline];
+
+			if (buf[i] == '\n') {
+				p->outline = (p->outline + 1) % OUTPUT_LINES;
+				p->output[p->outline][0] = '\0';
+				p->outpos = 0;
+			}
+			else if (buf[i] == '\r') {
+				/* progress indicators rewrite the line */
+				line[0] = '\0';
+				p->outpos = 0;
+			}
+			else if (p->outpos < OUTPUT_LINE_LEN) {
+				line[p->outpos++] = ((unsigned char) buf[i] < ' ') ? ' ' : buf[i];
+				line[p->outpos] = '\0';
 			}
 		}
+		p->output_dirty = 1;
+	}
+
+	/* end of file or error: all writers are gone */
+	if ((len == 0) || ((errno != EAGAIN) && (errno != EINTR))) {
+		close(p->outfd);
+		p->outfd = -1;
 	}
 }
 
 
+/**
+ * Copy a string, escaping the characters that are special inside a
+ * {...} argument of the LCDproc protocol. \c dst must be twice as large.
+ */
+static void escape_string(char *dst, const char *src)
+{
+	while (*src != '\0') {
+		if ((*src == '\\') || (*src == '{') || (*src == '}') || (*src == '"'))
+			*dst++ = '\\';
+		*dst++ = *src++;
+	}
+	*dst = '\0';
+}
+
+
 static int process_command_line(int argc, char **argv)
 {
 	int c;
@@ -319,6 +465,12 @@ static int process_configfile(char *configfile)
 	if ((tmp = config_get_string(progname, "DisplayName", 0, NULL)) != NULL)
 		displayname = strdup(tmp);
 
+	if (output_interval == UNSET_INT) {
+		output_interval = config_get_int(progname, "OutputInterval", 0, 500);
+		if (output_interval < 0)
+			output_interval = 0;
+	}
+
 	/* try to find a shell that understands the -c COMMAND syntax */
 	if ((tmp = config_get_string(progname, "Shell", 0, NULL)) != NULL)
 		default_shell = strdup(tmp);
@@ -357,6 +509,8 @@ static int connect_and_setup(void)
 	if (sock < 0) {
 		return -1;
 	}
+	/* do not hand the connection to the commands we start */
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
 
 	/* init connection and set client name */
 	sock_send_string(sock, "hello\n");
@@ -519,6 +673,9 @@ static int exec_command(MenuEntry *cmd)
 		const char *argv[4];
 		pid_t pid;
 		ProcInfo *p;
+		posix_spawn_file_actions_t actions;
+		int pipefd[2] = { -1, -1 };
+		int err;
 		char *envp[cmd->numChildren+1];
 		MenuEntry *arg;
 		int i;
@@ -575,35 +732,55 @@ static int exec_command(MenuEntry *cmd)
 
 		debug(RPT_DEBUG, "Executing '%s' via Shell %s", command, default_shell);
 
-		switch (pid = fork()) {
-		  case 0:
-			/* We're the child: execute the command */
-			execve(argv[0], (char **) argv, envp);
-			exit(EXIT_SUCCESS);
-			break;
-		  default:
-			/* We're the parent: setup the ProcInfo structure */
+		/* capture stdout and stderr if the output is to be shown */
+		posix_spawn_file_actions_init(&actions);
+		if (cmd->data.exec.output) {
+			if (pipe(pipefd) == 0) {
+				fcntl(pipefd[0], F_SETFD, FD_CLOEXEC);
+				fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
+				posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+				posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDERR_FILENO);
+				posix_spawn_file_actions_addclose(&actions, pipefd[1]);
+			}
+			else {
+				report(RPT_WARNING, "Could not create pipe for output of '%s'", command);
+			}
+		}
+
+		err = posix_spawn(&pid, argv[0], &actions, NULL, (char **) argv, envp);
+		posix_spawn_file_actions_destroy(&actions);
+		if (pipefd[1] >= 0)
+			close(pipefd[1]);
+
+		if (err != 0) {
+			report(RPT_ERR, "Could not execute '%s': %s", command, strerror(err));
+			if (pipefd[0] >= 0)
+				close(pipefd[0]);
+		}
+		else {
+			/* setup the ProcInfo structure */
 			p = calloc(1, sizeof(ProcInfo));
 			if (p != NULL) {
 				p->cmd = cmd;
 				p->pid = pid;
 				p->starttime = time(NULL);
 				p->feedback = cmd->data.exec.feedback;
-				/* prepend it to existing queue atomically */
+				p->pidfd = (use_pidfd) ? open_pidfd(pid) : -1;
+				p->outfd = pipefd[0];
+				/* prepend it to existing queue */
 				p->next = proc_queue;
 				proc_queue = p;
 			}
-        		break;
-		  case -1:
-			report(RPT_ERR, "Could not fork");
-			return -1;
+			else if (pipefd[0] >= 0) {
+				close(pipefd[0]);
+			}
 		}
 
 		/* free envp's contents */
 		for (i = 0; envp[i] != NULL; i++)
 			free(envp[i]);
 
-		return 0;
+		return (err == 0) ? 0 : -1;
 	}
 	return -1;
 }
@@ -680,57 +857,203 @@ static int show_procinfo_msg(ProcInfo *p)
 }
 
 
+/**
+ * Show the last output lines of a running command on its own screen.
+ * \param p    Process whose output to show.
+ * \param now  Current time in ms.
+ */
+static void show_output(ProcInfo *p, long now)
+{
+	char buf[2*OUTPUT_LINE_LEN+1];
+	int rows = lcd_hgt - 1;
+	int row;
+
+	if ((lcd_wid <= 0) || (lcd_hgt <= 1))
+		return;
+	if (rows > OUTPUT_LINES)
+		rows = OUTPUT_LINES;
+
+	if (!p->screen) {
+		sock_printf(sock, "screen_add [%u]\n", p->pid);
+		sock_printf(sock, "screen_set [%u] -name {lcdexec [%u]}"
+				  " -priority foreground -heartbeat off\n",
+				p->pid, p->pid);
+		if (lcd_hgt > 2) {
+			sock_printf(sock, "widget_add [%u] t title\n", p->pid);
+			sock_printf(sock, "widget_set [%u] t {%s}\n", p->pid, p->cmd->displayname);
+		}
+		else {
+			sock_printf(sock, "widget_add [%u] t string\n", p->pid);
+			sock_printf(sock, "widget_set [%u] t 1 1 {%s}\n", p->pid, p->cmd->displayname);
+		}
+		for (row = 0; row < rows; row++)
+			sock_printf(sock, "widget_add [%u] o%d string\n", p->pid, row);
+		p->screen = 1;
+	}
+
+	/* the last lines, ending with the incomplete one if it is not empty */
+	for (row = 0; row < rows; row++) {
+		int last = (p->outpos > 0) ? p->outline : p->outline + OUTPUT_LINES - 1;
+		int line = (last - (rows - 1 - row) + OUTPUT_LINES) % OUTPUT_LINES;
+
+		escape_string(buf, p->output[line]);
+		sock_printf(sock, "widget_set [%u] o%d 1 %d {%s}\n", p->pid, row, row + 2, buf);
+	}
+
+	p->output_dirty = 0;
+	p->output_time = now;
+}
+
+
+/**
+ * Tell the user that a command has finished. A live output screen stays
+ * for a few seconds, unless a feedback screen replaces it.
+ * \param p    Finished process.
+ * \param now  Current time in ms.
+ * \return  1 if the process is done with, 0 to try again later.
+ */
+static int finish_process(ProcInfo *p, long now)
+{
+	/* get the rest of the output, but do not wait for background
+	 * processes that inherited the pipe */
+	if (p->outfd >= 0) {
+		read_output(p);
+		if (p->outfd >= 0) {
+			close(p->outfd);
+			p->outfd = -1;
+		}
+	}
+
+	if (p->screen) {
+		if (!p->feedback) {
+			if (p->output_dirty)
+				show_output(p, now);
+			sock_printf(sock, "screen_set [%u] -timeout %d\n", p->pid, 6*8);
+			return 1;
+		}
+		sock_printf(sock, "screen_del [%u]\n", p->pid);
+		p->screen = 0;
+	}
+
+	return show_procinfo_msg(p);
+}
+
+
 static int main_loop(void)
 {
-	int num_bytes;
 	char buf[100];
-	int keepalive_delay = 0;
-	int status_delay = 0;
-
-	/* Continuously check if we get a menu event... */
-	while (!Quit && ((num_bytes = sock_recv_string(sock, buf, sizeof(buf)-1)) >= 0)) {
-		if (num_bytes == 0) {
-			ProcInfo *p;
+	long keepalive_time = time_ms() + KEEPALIVE_INTERVAL;
+
+	/* Wait for menu events, finished commands and command output */
+	while (!Quit) {
+		ProcInfo *p, **pp;
+		int nprocs = 0;
+		long now;
+
+		for (p = proc_queue; p != NULL; p = p->next)
+			nprocs++;
+
+		{
+			struct pollfd fds[2 + 2*nprocs];
+			ProcInfo *owner[2 + 2*nprocs];
+			int timeout;
+			int i, n = 0;
+
+			fds[n].fd = sock;
+			fds[n].events = POLLIN;
+			owner[n++] = NULL;
+			if (sigchld_pipe[0] >= 0) {
+				fds[n].fd = sigchld_pipe[0];
+				fds[n].events = POLLIN;
+				owner[n++] = NULL;
+			}
+			for (p = proc_queue; p != NULL; p = p->next) {
+				if (p->pidfd >= 0) {
+					fds[n].fd = p->pidfd;
+					fds[n].events = POLLIN;
+					owner[n++] = p;
+				}
+				if (p->outfd >= 0) {
+					fds[n].fd = p->outfd;
+					fds[n].events = POLLIN;
+					owner[n++] = p;
+				}
+			}
 
-			/* wait for 1/10th of a second */
-			usleep(100000);
+			/* sleep until the next keepalive or pending output update */
+			now = time_ms();
+			timeout = (keepalive_time > now) ? keepalive_time - now : 0;
+			for (p = proc_queue; (p != NULL) && (lcd_hgt > 1); p = p->next) {
+				if (p->output_dirty) {
+					long due = p->output_time + output_interval - now;
 
-			/* send an empty line every 3 seconds to make sure the server still exists */
-			if (keepalive_delay++ >= 30) {
-				keepalive_delay = 0;
-				if (sock_send_string(sock, "\n") < 0) {
-					break; /* Out of while loop */
+					if (due < timeout)
+						timeout = (due > 0) ? due : 0;
 				}
 			}
 
-			/* check for a screen to show and procinfo deletion every second */
-			if (status_delay++ >= 10) {
-				status_delay = 0;
+			if (poll(fds, n, timeout) < 0) {
+				if (errno == EINTR)
+					continue;
+				report(RPT_ERR, "poll failed: %s", strerror(errno));
+				break;
+			}
 
-				/* delete the ProcInfo from the queue */
-				for (p = proc_queue; p != NULL; p = p->next) {
-					ProcInfo *pn = p->next;
+			if (fds[0].revents) {
+				int num_bytes;
+				int received = FALSE;
 
-					if ((pn != NULL) && (pn->shown)) {
-						p->next = pn->next;
-						free(pn);
-					}
-				}
-				/* deleting queue head is special */
-				if ((proc_queue != NULL) && (proc_queue->shown)) {
-					p = proc_queue;
-					proc_queue = proc_queue->next;
-					free(p);
+				while ((num_bytes = sock_recv_string(sock, buf, sizeof(buf)-1)) > 0) {
+					process_response(buf);
+					received = TRUE;
 				}
+				/* readable without data: the server closed the connection */
+				if ((num_bytes < 0) ||
+				    (!received && (recv(sock, buf, 1, MSG_PEEK) == 0)))
+					break; /* Out of while loop */
+			}
 
-				/* look for a process to display, display it & mark it as shown */
-				for (p = proc_queue; p != NULL; p = p->next) {
-					p->shown |= show_procinfo_msg(p);
+			for (i = 1; i < n; i++) {
+				if (fds[i].revents == 0)
+					continue;
+				if (owner[i] == NULL) {
+					/* drain the SIGCHLD pipe */
+					while (read(fds[i].fd, buf, sizeof(buf)) > 0)
+						;
+				}
+				else if (fds[i].fd == owner[i]->outfd) {
+					read_output(owner[i]);
 				}
 			}
 		}
-		else {
-			process_response(buf);
+
+		now = time_ms();
+
+		/* send an empty line every 3 seconds to make sure the server still exists */
+		if (now >= keepalive_time) {
+			keepalive_time = now + KEEPALIVE_INTERVAL;
+			if (sock_send_string(sock, "\n") < 0)
+				break; /* Out of while loop */
+		}
+
+		/* pidfds only wake us up, waitpid() collects the status */
+		reap_children();
+
+		/* show output, report finished processes and drop them */
+		pp = &proc_queue;
+		while ((p = *pp) != NULL) {
+			if (p->endtime > 0)
+				p->shown |= finish_process(p, now);
+			else if (p->output_dirty && (now - p->output_time >= output_interval))
+				show_output(p, now);
+
+			if (p->shown) {
+				*pp = p->next;
+				free(p);
+			}
+			else {
+				pp = &p->next;
+			}
 		}
 	}
 
@@ -93,6 +93,7 @@ MenuEntry *menu_read(MenuEntry *parent, const char *name)
 				return NULL;
 			}
 			me->data.exec.feedback = config_get_bool(name, "Feedback", 0, 0);
+			me->data.exec.output = config_get_bool(name, "ShowOutput", 0, 0);
 
 			// try to read parameters
 			while ((entryname = config_get_string(name, "Parameter", me->numChildren, NULL)) != NULL) {
@@ -562,6 +563,7 @@ void menu_dump(MenuEntry *me)
 			case MT_EXEC:
 				report(RPT_DEBUG, "Exec=\"%s\"", me->data.exec.command);
 				report(RPT_DEBUG, "Feedback=%s", boolValueName[me->data.exec.feedback]);
+				report(RPT_DEBUG, "ShowOutput=%s", boolValueName[me->data.exec.output]);
 
 				// dump entry's parameter referencess
 				for (entry = me->children; entry != NULL; entry = entry->next)
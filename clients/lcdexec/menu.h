@@ -57,6 +57,7 @@ typedef struct menu_entry {
 		struct exec{	// elements necessary for type MT_EXEC
 			char *command;	/**< Command to execute. */
 			int feedback;	/**< Feedback flag. */
+			int output;	/**< Flag: show the command's output live. */
 		} exec;
 		struct slider {	// elements necessary for type MT_ARG_SLIDER
 			int value;	/**< Numeric value of slider. */
@@ -47,6 +47,7 @@
 
 
 static char *tickTime(char *time, int heartbeat);
+static void animate_time(const char *screen, const char *widget, int x, int y, const char *format);
 
 
 /**
@@ -76,6 +77,8 @@ time_screen(int rep, int display, int *flags_ptr)
 	int xoffs;
 	int days, hour, min, sec;
 	static int heartbeat = 0;
+	static int animated = 0;
+	static int idle_x = 1;
 	static const char *timeFormat = NULL;
 	static const char *dateFormat = NULL;
 	time_t thetime;
@@ -105,6 +108,30 @@ time_screen(int rep, int display, int *flags_ptr)
 			/* write title bar: hostname */
 			sock_printf(sock, "widget_set T title {TIME: %s}\n", get_hostname());
 		}
+
+		/* let the server keep date and time up to date */
+		animated = check_protocol_version(0, 5);
+		if (animated) {
+			if (lcd_hgt >= 4) {
+				int len;
+
+				animate_time("T", "two", 0, 3, dateFormat);
+
+				/* time and idle time share the last line */
+				time(&thetime);
+				len = strftime(now, sizeof(now), timeFormat, localtime(&thetime));
+				xoffs = (lcd_wid > len + 10) ? ((lcd_wid - (len + 10)) / 2) + 1 : 1;
+				animate_time("T", "three", xoffs, 4, timeFormat);
+				idle_x = xoffs + len + 1;
+				sock_send_string(sock, "widget_add T idle string\n");
+			}
+			else {
+				char format[80];
+
+				snprintf(format, sizeof(format), "%s %s", dateFormat, timeFormat);
+				animate_time("T", "one", 0, 2, format);
+			}
+		}
 	}
 
 	/* toggle colon display */
@@ -140,6 +167,13 @@ time_screen(int rep, int display, int *flags_ptr)
 		if (display)
 			sock_printf(sock, "widget_set T one %i 2 {%s}\n", xoffs, tmp);
 
+		if (animated) {
+			/* only the idle time is left to the client */
+			if (display)
+				sock_printf(sock, "widget_set T idle %i 4 {%3i%% idle}\n", idle_x, (int) idle);
+			return 0;
+		}
+
 		/* display the date */
 		xoffs = (lcd_wid > strlen(today)) ? ((lcd_wid - strlen(today)) / 2) + 1 : 1;
 		if (display)
@@ -151,7 +185,7 @@ time_screen(int rep, int display, int *flags_ptr)
 		if (display)
 			sock_printf(sock, "widget_set T three %i 4 {%s}\n", xoffs, tmp);
 	}
-	else {			/* 2 line version of the screen */
+	else if (!animated) {	/* 2 line version of the screen */
 		xoffs = (lcd_wid > (strlen(today) + strlen(now) + 1))
 			? ((lcd_wid - ((strlen(today) + strlen(now) + 1))) / 2) + 1 : 1;
 		if (display)
@@ -196,6 +230,7 @@ clock_screen(int rep, int display, int *flags_ptr)
 	int xoffs;
 	static int heartbeat = 0;
 	static int showTitle = 1;
+	static int animated = 0;
 	static const char *timeFormat = NULL;
 	static const char *dateFormat = NULL;
 	time_t thetime;
@@ -236,8 +271,28 @@ clock_screen(int rep, int display, int *flags_ptr)
 				sock_send_string(sock, "widget_add O two string\n");
 			}
 		}
+
+		/* let the server keep date and time up to date */
+		animated = check_protocol_version(0, 5);
+		if (animated) {
+			if (lcd_hgt >= 4) {
+				animate_time("O", "two", 0, 3, dateFormat);
+				animate_time("O", "three", 0, 4, timeFormat);
+			}
+			else if (showTitle) {
+				snprintf(tmp, sizeof(tmp), "%s %s", dateFormat, timeFormat);
+				animate_time("O", "one", 0, 2, tmp);
+			}
+			else {
+				animate_time("O", "one", 0, 1, dateFormat);
+				animate_time("O", "two", 0, 2, timeFormat);
+			}
+		}
 	}
 
+	if (animated)
+		return 0;
+
 	/* toggle colon display */
 	heartbeat ^= 1;
 
@@ -400,6 +455,7 @@ big_clock_screen(int rep, int display, int *flags_ptr)
 	char fulltxt[16];
 	static char old_fulltxt[16];
 	static int heartbeat = 0;
+	static int animated = 0;
 	static int TwentyFourHour = 1;
 	int j = 0;
 	int digits = (lcd_wid >= 20) ? 6 : 4;
@@ -431,6 +487,17 @@ big_clock_screen(int rep, int display, int *flags_ptr)
 			sock_send_string(sock, "widget_add K c1 num\n");
 		}
 
+		/* let the server blink the colons: 10 is a colon, 11 clears it */
+		animated = check_protocol_version(0, 5);
+		if (animated) {
+			sock_printf(sock, "widget_set K c0 %d 10\n", xoffs + 7);
+			sock_send_string(sock, "widget_animate K c0 -sequence 8 10 11\n");
+			if (digits > 4) {
+				sock_printf(sock, "widget_set K c1 %d 10\n", xoffs + 14);
+				sock_send_string(sock, "widget_animate K c1 -sequence 8 10 11\n");
+			}
+		}
+
 		strcpy(old_fulltxt, "      ");
 	}
 
@@ -448,6 +515,9 @@ big_clock_screen(int rep, int display, int *flags_ptr)
 		}
 	}
 
+	if (animated)
+		return 0;
+
 	if (heartbeat) {	/* 10 means: colon */
 		sock_printf(sock, "widget_set K c0 %d 10\n", xoffs + 7);
 		if (digits > 4)
@@ -490,6 +560,7 @@ mini_clock_screen(int rep, int display, int *flags_ptr)
 	struct tm *rtime;
 	static const char *timeFormat = NULL;
 	static int heartbeat = 0;
+	static int animated = 0;
 	int xoffs;
 
 	/* toggle colon display */
@@ -504,8 +575,16 @@ mini_clock_screen(int rep, int display, int *flags_ptr)
 		sock_send_string(sock, "screen_add N\n");
 		sock_send_string(sock, "screen_set N -name {Mini Clock Screen} -heartbeat off\n");
 		sock_send_string(sock, "widget_add N one string\n");
+
+		/* let the server keep the time up to date */
+		animated = check_protocol_version(0, 5);
+		if (animated)
+			animate_time("N", "one", 0, (lcd_hgt / 2), timeFormat);
 	}
 
+	if (animated)
+		return 0;
+
 	time(&thetime);
 	rtime = localtime(&thetime);
 
@@ -520,6 +599,34 @@ mini_clock_screen(int rep, int display, int *flags_ptr)
 }				/* End mini_clock_screen() */
 
 
+/**
+ * Helper function: let the server format the current time into a string
+ * widget, so it need not be sent on every update. Servers that know
+ * \c widget_animate announce protocol version 0.5 or later; the colons
+ * do not blink then.
+ * \param screen  Name of the screen.
+ * \param widget  Name of the string widget.
+ * \param x       Column of the widget; 0 to center the current time.
+ * \param y       Row of the widget.
+ * \param format  strftime() template.
+ */
+static void
+animate_time(const char *screen, const char *widget, int x, int y, const char *format)
+{
+	char now[40];
+	time_t thetime;
+
+	time(&thetime);
+	if (strftime(now, sizeof(now), format, localtime(&thetime)) == 0)
+		*now = '\0';
+	if (x <= 0)
+		x = (lcd_wid > strlen(now)) ? (((lcd_wid - strlen(now)) / 2) + 1) : 1;
+
+	sock_printf(sock, "widget_set %s %s %d %d {%s}\n", screen, widget, x, y, now);
+	sock_printf(sock, "widget_animate %s %s -format {%s}\n", screen, widget, format);
+}
+
+
 /** Helper function: toggle between ':' and ' ' in time strings.
  * \note The time string passed is modified directly!
  * \param time       String containing a formatted time value.
@@ -198,10 +198,9 @@ cpu_graph_screen(int rep, int display, int *flags_ptr)
 #undef CPU_BUF_SIZE
 #define CPU_BUF_SIZE 2
 	static double cpu[CPU_BUF_SIZE];
-	static int cpu_past[LCD_MAX_WIDTH];
 	static int gauge_hgt = 0;
 
-	int i, n = 0;
+	int i;
 	double value;
 	load_type load;
 
@@ -222,11 +221,9 @@ cpu_graph_screen(int rep, int display, int *flags_ptr)
 			sock_printf(sock, "widget_set G title 1 1 {CPU: %s}\n", get_hostname());
 		}
 
-		for (i = 1; i <= lcd_wid; i++) {
-			sock_printf(sock, "widget_add G bar%d vbar\n", i);
-			sock_printf(sock, "widget_set G bar%d %d %d 0\n", i, i, lcd_hgt);
-			cpu_past[i - 1] = 0;
-		};
+		/* The server keeps the history and shifts the graph */
+		sock_send_string(sock, "widget_add G graph graph\n");
+		sock_printf(sock, "widget_set G graph 1 %d %d %d\n", lcd_hgt, lcd_wid, gauge_hgt);
 
 		/* Clear out CPU averaging array */
 		for (i = 0; i < CPU_BUF_SIZE; i++)
@@ -249,24 +246,8 @@ cpu_graph_screen(int rep, int display, int *flags_ptr)
 		value += cpu[i];
 	value /= CPU_BUF_SIZE;
 
-	/* Scale result to available height (leave 1st line free when height > 2) */
-	n = (int) (value * lcd_cellhgt * gauge_hgt);
-
-	/* Shift and update display the graph */
-	for (i = 0; i < lcd_wid - 1; i++) {
-		cpu_past[i] = cpu_past[i + 1];
-
-		if (display) {
-			sock_printf(sock, "widget_set G bar%d %d %d %d\n",
-			              i + 1, i + 1, lcd_hgt, cpu_past[i]);
-		}
-	}
-
-	/* Save the newest entry and display it */
-	cpu_past[lcd_wid - 1] = n;
-	if (display) {
-		sock_printf(sock, "widget_set G bar%d %d %d %d\n", lcd_wid, lcd_wid, lcd_hgt, n);
-	}
+	/* Add the newest entry; also while hidden, so the history stays complete */
+	sock_printf(sock, "widget_push G graph %d\n", (int) (value * 1000));
 
 	return (0);
 }				/* End cpu_graph_screen() */
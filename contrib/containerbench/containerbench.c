@@ -0,0 +1,207 @@
+/*
+ * containerbench - compare the shared/ containers on LCDd's hot paths
+ *
+ * Measures the two widget list operations the renderer and the command
+ * parser do for every frame and command, once with a LinkedList (LL.c)
+ * and once with a Vector (vector.c) and a HashMap (hashmap.c):
+ *
+ *   traverse  walk all widgets of a screen, as render_widgets() does
+ *   find      look a widget up by its id, as screen_find_widget() does;
+ *             the time includes formatting the id, like the parser
+ *             receives it
+ *
+ * Usage: containerbench [count ...]
+ *
+ * The counts are the numbers of widgets per screen (default: 8 32 200).
+ * Times are nanoseconds per operation, the best of several rounds.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "LL.h"
+#include "vector.h"
+#include "hashmap.h"
+
+/* Rounds per measurement; the best one counts */
+#define ROUNDS		5
+/* Minimum duration of a round in ns */
+#define ROUND_NS	50000000.0
+
+/* Stands in for a widget: an id and something the renderer reads */
+typedef struct Item {
+	char id[16];
+	int x, y;
+} Item;
+
+static volatile long sink;
+
+
+static double
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static long
+traverse_ll(LinkedList *list)
+{
+	Item *it;
+	long sum = 0;
+
+	for (it = LL_GetFirst(list); it != NULL; it = LL_GetNext(list))
+		sum += it->x;
+	return sum;
+}
+
+
+static long
+traverse_vector(Vector *v)
+{
+	Item *it;
+	long sum = 0;
+	int i;
+
+	for (i = 0; (it = vector_get(v, i)) != NULL; i++)
+		sum += it->x;
+	return sum;
+}
+
+
+static long
+find_ll(LinkedList *list, int n)
+{
+	char key[16];
+	Item *it;
+
+	snprintf(key, sizeof(key), "w%d", n);
+	for (it = LL_GetFirst(list); it != NULL; it = LL_GetNext(list))
+		if (strcmp(it->id, key) == 0)
+			return it->y;
+	return -1;
+}
+
+
+static long
+find_hashmap(HashMap *m, int n)
+{
+	char key[16];
+	Item *it;
+
+	snprintf(key, sizeof(key), "w%d", n);
+	it = hashmap_get(m, key);
+	return (it != NULL) ? it->y : -1;
+}
+
+
+/* Time one operation: 0 traverse LL, 1 traverse Vector, 2 find LL, 3 find HashMap */
+static double
+measure(int op, int count, LinkedList *list, Vector *v, HashMap *m)
+{
+	double best = -1;
+	long iters = 1000;
+	int round;
+
+	for (round = 0; round < ROUNDS; round++) {
+		double start, elapsed;
+		long i, sum = 0;
+
+		start = now_ns();
+		for (i = 0; i < iters; i++) {
+			switch (op) {
+				case 0: sum += traverse_ll(list); break;
+				case 1: sum += traverse_vector(v); break;
+				case 2: sum += find_ll(list, (int) (i % count)); break;
+				case 3: sum += find_hashmap(m, (int) (i % count)); break;
+			}
+		}
+		elapsed = now_ns() - start;
+		sink += sum;
+
+		if (elapsed < ROUND_NS) {
+			/* too short to be meaningful: scale up and retry */
+			iters = (long) (iters * ROUND_NS / (elapsed + 1)) + 1;
+			round--;
+			continue;
+		}
+		if ((best < 0) || (elapsed / iters < best))
+			best = elapsed / iters;
+	}
+	return best;
+}
+
+
+static void
+bench(int count)
+{
+	LinkedList *list = LL_new();
+	Vector v;
+	HashMap m;
+	void **junk;
+	int i;
+
+	vector_init(&v);
+	hashmap_init(&m);
+
+	/* interleave other allocations, as widgets are not created in a row */
+	junk = calloc(count, sizeof(void *));
+	for (i = 0; i < count; i++) {
+		Item *it = malloc(sizeof(Item));
+
+		junk[i] = malloc(64 + (i % 7) * 16);
+		snprintf(it->id, sizeof(it->id), "w%d", i);
+		it->x = i;
+		it->y = count - i;
+		LL_Push(list, it);
+		vector_push(&v, it);
+		hashmap_put(&m, it->id, it);
+	}
+
+	printf("%5d widgets: traverse LL %8.1f ns, Vector  %8.1f ns\n",
+	       count, measure(0, count, list, &v, &m), measure(1, count, list, &v, &m));
+	printf("%5d widgets: find     LL %8.1f ns, HashMap %7.1f ns\n",
+	       count, measure(2, count, list, &v, &m), measure(3, count, list, &v, &m));
+
+	for (i = 0; i < count; i++) {
+		free(vector_get(&v, i));
+		free(junk[i]);
+	}
+	free(junk);
+	hashmap_clear(&m);
+	vector_clear(&v);
+	LL_Destroy(list);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	static const int defaults[] = { 8, 32, 200 };
+	int i;
+
+	if (argc > 1) {
+		for (i = 1; i < argc; i++) {
+			int count = atoi(argv[i]);
+
+			if (count <= 0) {
+				fprintf(stderr, "Usage: containerbench [count ...]\n");
+				return EXIT_FAILURE;
+			}
+			bench(count);
+		}
+	}
+	else {
+		for (i = 0; i < (int) (sizeof(defaults) / sizeof(defaults[0])); i++)
+			bench(defaults[i]);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,512 @@
+/*
+ * ethlcdemu - emulate an ethlcd device on a local TCP port
+ *
+ * ethlcdemu listens where an ethlcd device would (TCP port 2425) and
+ * answers like one: every command is acknowledged with its command byte,
+ * button queries with the button state, and the HD44780 instructions and
+ * data are interpreted into a virtual screen. Point the hd44780 driver
+ * (ConnectionType=ethlcd) at 127.0.0.1 to run LCDd without the hardware.
+ *
+ * The answers can be delayed (-w) to see whether the driver waits for
+ * them, and the connection can be dropped after a number of commands (-d)
+ * to exercise the driver's reconnect path. Statistics show how many
+ * commands arrived per read, i.e. how well the driver batches them.
+ *
+ * Copyright (C) 2026 The LCDproc Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MAX_WIDTH	40
+#define MAX_HEIGHT	4
+
+/* ethlcd protocol, see server/drivers/hd44780-ethlcd.h */
+#define ETHLCD_PORT			2425
+#define ETHLCD_SEND_INSTR		0x01
+#define ETHLCD_SEND_DATA		0x02
+#define ETHLCD_GET_BUTTONS		0x03
+#define ETHLCD_SET_BACKLIGHT		0x04
+#define ETHLCD_SET_BEEP			0x05
+#define ETHLCD_GET_FIRMWARE_VERSION	0x06
+#define ETHLCD_GET_PROTOCOL_VERSION	0x07
+#define ETHLCD_GET_ENC_REVISION		0x08
+#define ETHLCD_CLOSE_CONN		0x09
+#define ETHLCD_UNRECOGNIZED_COMMAND	0x0A
+
+typedef struct {
+	int fd;				/* connected driver, or -1 */
+	int width, height;
+	unsigned char screen[MAX_HEIGHT][MAX_WIDTH];
+	int x, y;			/* cursor position (0-based) */
+	int ddram;			/* DDRAM address */
+	int cgram;			/* CGRAM write in progress */
+	unsigned char cmd;		/* command waiting for its argument */
+	long done;			/* commands completed since the last drop */
+	unsigned char buttons;		/* pressed buttons, bits 0-5 */
+	int backlight;
+
+	/* answers collected while handling one read */
+	unsigned char answer[8192];
+	int answer_len;
+
+	/* statistics */
+	long frame_reads, frame_cmds;
+	long frames, reads, cmds, errors, connections, drops;
+	long max_frame_cmds, max_read_cmds;
+} Emulator;
+
+static volatile sig_atomic_t got_signal = 0;
+
+
+static void
+sig_handler(int signal)
+{
+	got_signal = signal;
+}
+
+
+static void
+clear_screen(Emulator *emu)
+{
+	memset(emu->screen, ' ', sizeof(emu->screen));
+	emu->x = emu->y = 0;
+}
+
+
+/* HD44780 DDRAM address to screen position; lines 3 and 4 continue 1 and 2 */
+static void
+set_ddram(Emulator *emu, int addr)
+{
+	int line = (addr >= 0x40) ? 1 : 0;
+	int col = addr - line * 0x40;
+
+	if (col >= emu->width) {
+		col -= emu->width;
+		line += 2;
+	}
+	emu->ddram = addr;
+	emu->x = (col < emu->width) ? col : 0;
+	emu->y = (line < emu->height) ? line : 0;
+}
+
+
+static void
+instruction(Emulator *emu, unsigned char c)
+{
+	if (c & 0x80) {
+		emu->cgram = 0;
+		set_ddram(emu, c & 0x7F);
+	}
+	else if (c & 0x40)
+		emu->cgram = 1;
+	else if (c == 0x01)
+		clear_screen(emu);
+	else if ((c & 0xFE) == 0x02)
+		set_ddram(emu, 0);
+}
+
+
+static void
+data(Emulator *emu, unsigned char c)
+{
+	if (emu->cgram)
+		return;
+	emu->screen[emu->y][emu->x] = c;
+	set_ddram(emu, emu->ddram + 1);
+}
+
+
+static void
+answer(Emulator *emu, unsigned char c)
+{
+	if (emu->answer_len < (int) sizeof(emu->answer))
+		emu->answer[emu->answer_len++] = c;
+}
+
+
+/* Handle one byte from the driver; returns 0 if the driver closed the connection */
+static int
+input(Emulator *emu, unsigned char c)
+{
+	if (emu->cmd != 0) {
+		/* the argument of a two-byte command */
+		switch (emu->cmd) {
+			case ETHLCD_SEND_INSTR:
+				instruction(emu, c);
+				break;
+			case ETHLCD_SEND_DATA:
+				data(emu, c);
+				break;
+			case ETHLCD_SET_BACKLIGHT:
+				emu->backlight = c;
+				break;
+		}
+		answer(emu, emu->cmd);
+		emu->cmd = 0;
+		emu->done++;
+		return 1;
+	}
+
+	emu->frame_cmds++;
+	switch (c) {
+		case ETHLCD_SEND_INSTR:
+		case ETHLCD_SEND_DATA:
+		case ETHLCD_SET_BACKLIGHT:
+		case ETHLCD_SET_BEEP:
+			emu->cmd = c;
+			return 1;
+		case ETHLCD_GET_BUTTONS:
+			/* negative logic; a pressed button is reported once */
+			answer(emu, c);
+			answer(emu, ~emu->buttons);
+			emu->buttons = 0;
+			break;
+		case ETHLCD_GET_FIRMWARE_VERSION:
+		case ETHLCD_GET_PROTOCOL_VERSION:
+		case ETHLCD_GET_ENC_REVISION:
+			answer(emu, c);
+			answer(emu, 1);
+			break;
+		case ETHLCD_CLOSE_CONN:
+			return 0;
+		default:
+			answer(emu, ETHLCD_UNRECOGNIZED_COMMAND);
+			emu->errors++;
+			break;
+	}
+	emu->done++;
+	return 1;
+}
+
+
+static void
+disconnect(Emulator *emu)
+{
+	close(emu->fd);
+	emu->fd = -1;
+	emu->cmd = 0;
+	emu->cgram = 0;
+	emu->done = 0;
+}
+
+
+static void
+print_screen(Emulator *emu, FILE *out)
+{
+	int x, y;
+
+	fputc('+', out);
+	for (x = 0; x < emu->width; x++)
+		fputc('-', out);
+	fputs("+\n", out);
+	for (y = 0; y < emu->height; y++) {
+		fputc('|', out);
+		for (x = 0; x < emu->width; x++) {
+			unsigned char c = emu->screen[y][x];
+
+			/* custom characters are shown by their number */
+			if (c < 8)
+				c = '0' + c;
+			else if ((c < 0x20) || (c >= 0x7F))
+				c = '?';
+			fputc(c, out);
+		}
+		fputs("|\n", out);
+	}
+	fputc('+', out);
+	for (x = 0; x < emu->width; x++)
+		fputc('-', out);
+	fputs("+\n", out);
+}
+
+
+static void
+end_frame(Emulator *emu, int verbose)
+{
+	if (emu->frame_reads == 0)
+		return;
+
+	emu->frames++;
+	emu->reads += emu->frame_reads;
+	emu->cmds += emu->frame_cmds;
+	if (emu->frame_cmds > emu->max_frame_cmds)
+		emu->max_frame_cmds = emu->frame_cmds;
+
+	if (verbose) {
+		printf("frame %ld: %ld commands in %ld reads\n",
+		       emu->frames, emu->frame_cmds, emu->frame_reads);
+		if (verbose > 1)
+			print_screen(emu, stdout);
+		fflush(stdout);
+	}
+	emu->frame_reads = emu->frame_cmds = 0;
+}
+
+
+static void
+print_summary(Emulator *emu)
+{
+	printf("connections:     %ld (%ld dropped on purpose)\n", emu->connections, emu->drops);
+	printf("frames:          %ld\n", emu->frames);
+	printf("commands:        %ld (%.1f per frame, max %ld)\n", emu->cmds,
+	       emu->frames ? (double) emu->cmds / emu->frames : 0.0, emu->max_frame_cmds);
+	printf("reads:           %ld (%.1f commands per read, max %ld)\n", emu->reads,
+	       emu->reads ? (double) emu->cmds / emu->reads : 0.0, emu->max_read_cmds);
+	printf("protocol errors: %ld\n", emu->errors);
+	print_screen(emu, stdout);
+}
+
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+		"Usage: ethlcdemu [-a address] [-p port] [-s WxH] [-g gap] [-w delay]\n"
+		"                 [-d commands [-n drops]] [-t seconds] [-o screenfile] [-v]\n"
+		"  -a  address to listen on (default 127.0.0.1)\n"
+		"  -p  port to listen on (default %d)\n"
+		"  -s  display size (default 20x4)\n"
+		"  -g  idle time in ms that ends a frame (default 20)\n"
+		"  -w  delay the answers by the given number of ms\n"
+		"  -d  drop the connection after every given number of commands\n"
+		"  -n  drop it at most the given number of times\n"
+		"  -t  exit after the given number of seconds\n"
+		"  -o  write the final screen to a file\n"
+		"  -v  print frame statistics, twice to also print each frame\n"
+		"Lines read from stdin press a button (A-F) until the next query.\n",
+		ETHLCD_PORT);
+	exit(EXIT_FAILURE);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	Emulator emu;
+	const char *address = "127.0.0.1", *size = "20x4", *screen_file = NULL;
+	int port = ETHLCD_PORT, gap = 20, delay = 0, drop_after = 0, max_drops = 0;
+	int duration = 0, verbose = 0;
+	struct sockaddr_in addr;
+	struct timeval start, now;
+	int listener, c, i;
+	int one = 1;
+	int stdin_open = 1;
+
+	memset(&emu, 0, sizeof(emu));
+	emu.fd = -1;
+
+	while ((c = getopt(argc, argv, "a:p:s:g:w:d:n:t:o:v")) != -1) {
+		switch (c) {
+			case 'a':
+				address = optarg;
+				break;
+			case 'p':
+				port = atoi(optarg);
+				break;
+			case 's':
+				size = optarg;
+				break;
+			case 'g':
+				gap = atoi(optarg);
+				break;
+			case 'w':
+				delay = atoi(optarg);
+				break;
+			case 'd':
+				drop_after = atoi(optarg);
+				break;
+			case 'n':
+				max_drops = atoi(optarg);
+				break;
+			case 't':
+				duration = atoi(optarg);
+				break;
+			case 'o':
+				screen_file = optarg;
+				break;
+			case 'v':
+				verbose++;
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if ((sscanf(size, "%dx%d", &emu.width, &emu.height) != 2)
+	    || (emu.width <= 0) || (emu.width > MAX_WIDTH)
+	    || (emu.height <= 0) || (emu.height > MAX_HEIGHT)) {
+		fprintf(stderr, "ethlcdemu: invalid size %s\n", size);
+		return EXIT_FAILURE;
+	}
+	clear_screen(&emu);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+		fprintf(stderr, "ethlcdemu: invalid address %s\n", address);
+		return EXIT_FAILURE;
+	}
+	listener = socket(PF_INET, SOCK_STREAM, 0);
+	if (listener < 0) {
+		perror("ethlcdemu: socket");
+		return EXIT_FAILURE;
+	}
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (void *) &one, sizeof(one));
+	if ((bind(listener, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+	    || (listen(listener, 1) < 0)) {
+		perror("ethlcdemu: bind");
+		return EXIT_FAILURE;
+	}
+	printf("ethlcd emulator on %s:%d\n", address, port);
+	fflush(stdout);
+
+	signal(SIGINT, sig_handler);
+	signal(SIGTERM, sig_handler);
+	signal(SIGPIPE, SIG_IGN);
+	gettimeofday(&start, NULL);
+
+	while (!got_signal) {
+		struct pollfd fds[3];
+		unsigned char buf[4096];
+		int n;
+
+		fds[0].fd = listener;
+		fds[0].events = POLLIN;
+		fds[1].fd = emu.fd;
+		fds[1].events = POLLIN;
+		fds[2].fd = (stdin_open) ? STDIN_FILENO : -1;
+		fds[2].events = POLLIN;
+
+		n = poll(fds, 3, (emu.frame_reads > 0) ? gap : 100);
+		if (n < 0 && errno != EINTR)
+			break;
+
+		gettimeofday(&now, NULL);
+		if (duration && (now.tv_sec - start.tv_sec >= duration))
+			break;
+
+		if (n == 0) {
+			end_frame(&emu, verbose);
+			continue;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			int fd = accept(listener, NULL, NULL);
+
+			if (fd >= 0) {
+				/* like the device, serve only the newest connection */
+				if (emu.fd >= 0)
+					disconnect(&emu);
+				emu.fd = fd;
+				setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *) &one, sizeof(one));
+				emu.connections++;
+				if (verbose)
+					printf("connection %ld\n", emu.connections);
+			}
+			continue;
+		}
+
+		if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+			long cmds_before = emu.frame_cmds;
+			int open = 1;
+
+			n = read(emu.fd, buf, sizeof(buf));
+			if (n <= 0) {
+				disconnect(&emu);
+				continue;
+			}
+			emu.frame_reads++;
+			emu.answer_len = 0;
+			for (i = 0; (i < n) && open; i++) {
+				open = input(&emu, buf[i]);
+				if (drop_after && (emu.done >= drop_after)
+				    && (!max_drops || (emu.drops < max_drops))) {
+					/* drop in the middle of the driver's batch */
+					emu.done = 0;
+					emu.drops++;
+					open = 0;
+				}
+			}
+			if (emu.frame_cmds - cmds_before > emu.max_read_cmds)
+				emu.max_read_cmds = emu.frame_cmds - cmds_before;
+
+			if (delay > 0)
+				usleep(delay * 1000);
+			if ((emu.answer_len > 0)
+			    && (write(emu.fd, emu.answer, emu.answer_len) != emu.answer_len)) {
+				perror("ethlcdemu: write");
+				open = 0;
+			}
+			if (!open) {
+				if (verbose)
+					printf("connection %ld closed\n", emu.connections);
+				disconnect(&emu);
+			}
+		}
+
+		if (fds[2].revents & (POLLIN | POLLHUP)) {
+			char line[64];
+
+			if (fgets(line, sizeof(line), stdin) == NULL) {
+				stdin_open = 0;
+				continue;
+			}
+			/* bits of the buttons as the driver decodes them */
+			switch (line[0]) {
+				case 'A': case 'a': emu.buttons |= 0x04; break;
+				case 'B': case 'b': emu.buttons |= 0x02; break;
+				case 'C': case 'c': emu.buttons |= 0x01; break;
+				case 'D': case 'd': emu.buttons |= 0x20; break;
+				case 'E': case 'e': emu.buttons |= 0x10; break;
+				case 'F': case 'f': emu.buttons |= 0x08; break;
+			}
+		}
+	}
+
+	end_frame(&emu, verbose);
+	print_summary(&emu);
+
+	if (screen_file != NULL) {
+		FILE *f = fopen(screen_file, "w");
+
+		if (f == NULL) {
+			perror("ethlcdemu: fopen");
+			return EXIT_FAILURE;
+		}
+		print_screen(&emu, f);
+		fclose(f);
+	}
+
+	if (emu.fd >= 0)
+		close(emu.fd);
+	close(listener);
+	return EXIT_SUCCESS;
+}
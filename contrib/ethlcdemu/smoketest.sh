@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+# Smoke test of the hd44780 driver's ethlcd connection against ethlcdemu:
+# run LCDd for a few seconds, once on a steady connection and once with
+# the connection dropped once after a few hundred commands, and check that the
+# emulated display shows LCDd's goodbye screen without protocol errors and
+# that the driver reconnected after the drops.
+#
+# Usage: smoketest.sh [LCDd binary] [driver directory]
+#
+# The defaults are the binaries of an in-tree build. Exits non-zero if any
+# run fails; the emulator and LCDd output of a failed run is printed.
+#
+# This file is released under the GNU General Public License.
+# Refer to the COPYING file distributed with this package.
+
+LCDD=${1:-../../server/LCDd}
+DRIVERPATH=${2:-../../server/drivers}
+RUNTIME=${RUNTIME:-3}
+PORT=${PORT:-13799}
+
+cd "$(dirname "$0")" || exit 1
+
+if [ ! -x "$LCDD" ]; then
+	echo "smoketest: $LCDD not found, build LCDd first" >&2
+	exit 1
+fi
+make -s ethlcdemu || exit 1
+
+TMP=$(mktemp -d /tmp/ethlcdemu.XXXXXX) || exit 1
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+conf="$TMP/LCDd.conf"
+cat > "$conf" << CONF
+[server]
+DriverPath=$DRIVERPATH/
+Driver=hd44780
+Port=$PORT
+ReportToSyslog=no
+[hd44780]
+ConnectionType=ethlcd
+Device=127.0.0.1
+Size=20x4
+CONF
+
+failed=0
+
+# run one test: run <name> <runtime> <minimum connections> [emulator options]...
+run()
+{
+	name=$1
+	runtime=$2
+	connections=$3
+	shift 3
+
+	./ethlcdemu -t $((runtime + 2)) -o "$TMP/$name.screen" "$@" \
+		< /dev/null > "$TMP/$name.emu" 2>&1 &
+	emu=$!
+	sleep 0.5
+
+	"$LCDD" -f -c "$conf" > "$TMP/$name.lcdd" 2>&1 &
+	lcdd=$!
+	sleep "$runtime"
+	kill $lcdd 2> /dev/null
+	wait $lcdd
+	wait $emu
+
+	got=$(sed -n 's/^connections: *\([0-9]*\).*/\1/p' "$TMP/$name.emu")
+	if grep -q "protocol errors: *0$" "$TMP/$name.emu" \
+	   && [ "${got:-0}" -ge "$connections" ] \
+	   && grep -q "Thanks for using" "$TMP/$name.screen" 2> /dev/null; then
+		echo "PASS: $name"
+	else
+		echo "FAIL: $name"
+		cat "$TMP/$name.emu" "$TMP/$name.lcdd"
+		failed=1
+	fi
+}
+
+run steady    "$RUNTIME" 1
+# the driver retries every 5 seconds (ETHLCD_RECONNECT_DELAY)
+run reconnect $((RUNTIME + 6)) 2 -d 300 -n 1
+
+exit $failed
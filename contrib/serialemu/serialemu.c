@@ -0,0 +1,799 @@
+/*
+ * serialemu - emulate serial LCD modules on a pseudo terminal
+ *
+ * serialemu creates a pty and interprets the byte stream a driver writes
+ * to it like the display would: it keeps a virtual screen, answers the
+ * queries and acknowledgements the driver waits for, and records how many
+ * bytes and commands each frame took. Point the driver's Device= setting
+ * at the pty (or at the symlink given with -l) to run LCDd without the
+ * hardware, to compare screen contents after a change, or to measure the
+ * cost of a driver's flush path.
+ *
+ * A frame is a burst of output followed by a pause of at least the
+ * gap time (-g); LCDd renders at 8 frames per second by default.
+ *
+ * Copyright (C) 2026 The LCDproc Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ */
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/time.h>
+
+#define MAX_WIDTH	40
+#define MAX_HEIGHT	4
+#define MAX_PACKET	26	/* CFontzPacket: command, length, 22 data, CRC */
+
+/* Parser state machine shared by the protocols */
+typedef struct {
+	unsigned char buf[MAX_PACKET];	/* bytes of the current command */
+	int len;			/* bytes collected so far */
+	int need;			/* total bytes the command needs */
+} Command;
+
+typedef struct Emulator Emulator;
+
+/* Protocol description */
+typedef struct {
+	const char *name;
+	const char *default_size;
+	void (*input)(Emulator *emu, unsigned char c);
+	void (*key)(Emulator *emu, const char *key);
+} Protocol;
+
+struct Emulator {
+	const Protocol *proto;
+	int fd;				/* pty master */
+	int width, height;
+	unsigned char screen[MAX_HEIGHT][MAX_WIDTH];
+	int x, y;			/* cursor position (0-based) */
+	unsigned char escape;		/* hd44780: instruction escape */
+	int ddram;			/* hd44780: DDRAM address */
+	int cgram;			/* hd44780: CGRAM write in progress */
+	Command cmd;
+
+	/* statistics */
+	long frame_bytes, frame_cmds;
+	long frames, bytes, cmds, errors;
+	long max_frame_bytes, max_frame_cmds;
+	struct timeval first, last;
+};
+
+static volatile sig_atomic_t got_signal = 0;
+
+
+static void
+sig_handler(int signal)
+{
+	got_signal = signal;
+}
+
+
+/* Answer the driver */
+static void
+reply(Emulator *emu, const void *data, int len)
+{
+	if (write(emu->fd, data, len) != len)
+		perror("serialemu: write");
+}
+
+
+static void
+clear_screen(Emulator *emu)
+{
+	memset(emu->screen, ' ', sizeof(emu->screen));
+	emu->x = emu->y = 0;
+}
+
+
+/* Put a character at the cursor and advance it; wraps to the next line */
+static void
+put_char(Emulator *emu, unsigned char c)
+{
+	if ((emu->x < emu->width) && (emu->y < emu->height))
+		emu->screen[emu->y][emu->x] = c;
+	if (++emu->x >= emu->width) {
+		emu->x = 0;
+		emu->y = (emu->y + 1) % emu->height;
+	}
+}
+
+
+static void
+goto_xy(Emulator *emu, int x, int y)
+{
+	emu->x = (x >= 0 && x < emu->width) ? x : 0;
+	emu->y = (y >= 0 && y < emu->height) ? y : 0;
+}
+
+
+/* Start collecting a command of the given total length */
+static void
+begin_command(Emulator *emu, unsigned char c, int need)
+{
+	emu->cmd.buf[0] = c;
+	emu->cmd.len = 1;
+	emu->cmd.need = need;
+	emu->frame_cmds++;
+}
+
+
+/* Add a byte to the current command; returns 1 when it is complete */
+static int
+collect(Emulator *emu, unsigned char c)
+{
+	if (emu->cmd.len < MAX_PACKET)
+		emu->cmd.buf[emu->cmd.len] = c;
+	emu->cmd.len++;
+	return (emu->cmd.len >= emu->cmd.need);
+}
+
+
+/*
+ * Matrix Orbital: commands are 0xFE followed by a letter and a fixed
+ * number of arguments.
+ */
+static int
+mtxorb_args(unsigned char c)
+{
+	switch (c) {
+		case 'G':		return 2;	/* goto column, row */
+		case 'N':		return 9;	/* custom char n, 8 rows */
+		case 'P': case 'Y':
+		case 0x99: case 'B':	return 1;	/* contrast, brightness, backlight */
+		case 'W': case 'V':	return 1;	/* GPO on/off (keypad modules) */
+		default:		return 0;
+	}
+}
+
+
+static void
+mtxorb_input(Emulator *emu, unsigned char c)
+{
+	/* modules without keypad have a single GPO without port number */
+	if ((emu->cmd.need == 3) && ((emu->cmd.buf[1] == 'W') || (emu->cmd.buf[1] == 'V'))
+	    && ((c < 1) || (c > 6)))
+		emu->cmd.need = 0;
+
+	if (emu->cmd.need > 0) {
+		if (!collect(emu, c))
+			return;
+		emu->cmd.need = 0;
+
+		if (emu->cmd.len == 2) {
+			/* the command letter has arrived, now the arguments */
+			int args = mtxorb_args(c);
+
+			if (args > 0) {
+				emu->cmd.need = 2 + args;
+				return;
+			}
+			switch (c) {
+				case 'X':
+					clear_screen(emu);
+					break;
+				case 'H':
+					goto_xy(emu, 0, 0);
+					break;
+				case '7':	/* read module type: LK204-25 */
+					reply(emu, "\x09", 1);
+					break;
+				case '6':	/* read firmware version */
+					reply(emu, "\x10", 1);
+					break;
+				case '5':	/* read serial number */
+					reply(emu, "\x12\x34", 2);
+					break;
+			}
+			return;
+		}
+
+		if (emu->cmd.buf[1] == 'G')
+			goto_xy(emu, emu->cmd.buf[2] - 1, emu->cmd.buf[3] - 1);
+		return;
+	}
+
+	if (c == 0xFE) {
+		begin_command(emu, c, 2);
+		return;
+	}
+	put_char(emu, c);
+}
+
+
+static void
+mtxorb_key(Emulator *emu, const char *key)
+{
+	/* keys are reported as the letters 'A' to 'Y' */
+	reply(emu, key, 1);
+}
+
+
+/*
+ * CrystalFontz 632/634: single byte control codes below 0x20, some of
+ * them with arguments.
+ */
+static int
+cfontz_args(unsigned char c)
+{
+	switch (c) {
+		case 0x0E: case 0x0F:	return 1;	/* backlight, contrast */
+		case 0x11:		return 2;	/* cursor column, row */
+		case 0x12:		return 6;	/* horizontal bar graph */
+		case 0x15:		return 22;	/* marquee line */
+		case 0x16:		return 3;	/* enable marquee */
+		case 0x19:		return 9;	/* custom char n, 8 rows */
+		case 0x1A:		return 1;	/* reboot (0x1A 0x1A) */
+		case 0x1C:		return 2;	/* large number */
+		case 0x1E:		return 2;	/* send data to controller */
+		default:		return 0;
+	}
+}
+
+
+static void
+cfontz_input(Emulator *emu, unsigned char c)
+{
+	if (emu->cmd.need > 0) {
+		if (!collect(emu, c))
+			return;
+		emu->cmd.need = 0;
+
+		switch (emu->cmd.buf[0]) {
+			case 0x11:
+				goto_xy(emu, emu->cmd.buf[1], emu->cmd.buf[2]);
+				break;
+			case 0x1E:
+				/* raw data byte written to the controller */
+				if (emu->cmd.buf[1] == 0x01)
+					put_char(emu, emu->cmd.buf[2]);
+				break;
+			case 0x1A:
+				clear_screen(emu);
+				break;
+		}
+		return;
+	}
+
+	if (c >= 0x20) {
+		/* custom characters live at 0x80 - 0x87 */
+		put_char(emu, ((c >= 0x80) && (c < 0x88)) ? c - 0x80 : c);
+		return;
+	}
+
+	begin_command(emu, c, 1 + cfontz_args(c));
+	if (emu->cmd.need > 1)
+		return;
+	emu->cmd.need = 0;
+
+	switch (c) {
+		case 0x01:
+			goto_xy(emu, 0, 0);
+			break;
+		case 0x0C:
+			clear_screen(emu);
+			break;
+		case 0x0D:
+			emu->x = 0;
+			break;
+		case 0x0A:
+			emu->y = (emu->y + 1) % emu->height;
+			break;
+		case 0x08:
+			if (emu->x > 0)
+				emu->x--;
+			break;
+	}
+}
+
+
+static void
+cfontz_key(Emulator *emu, const char *key)
+{
+	reply(emu, key, 1);
+}
+
+
+/*
+ * CrystalFontz packet protocol (533/631/633/635): command, length, data,
+ * CRC-16 (same parameters as get_crc() in CFontz633io.c). Every packet
+ * is acknowledged with a response of type 0x40.
+ */
+static unsigned int
+cfp_crc(const unsigned char *buf, int len)
+{
+	unsigned int crc = 0xFFFF;
+	int i;
+
+	while (len-- > 0) {
+		crc ^= *buf++;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : (crc >> 1);
+	}
+	return (~crc) & 0xFFFF;
+}
+
+
+static void
+cfp_send(Emulator *emu, unsigned char type, int len, const unsigned char *data)
+{
+	unsigned char out[MAX_PACKET];
+	unsigned int crc;
+
+	out[0] = type;
+	out[1] = len;
+	memcpy(out + 2, data, len);
+	crc = cfp_crc(out, len + 2);
+	out[len + 2] = crc & 0xFF;
+	out[len + 3] = (crc >> 8) & 0xFF;
+	reply(emu, out, len + 4);
+}
+
+
+static void
+cfp_input(Emulator *emu, unsigned char c)
+{
+	unsigned char *pkt = emu->cmd.buf;
+	unsigned int crc;
+	int i, len;
+
+	if (emu->cmd.need == 0) {
+		if ((c & 0x3F) > 35) {
+			emu->errors++;	/* not a command: resync */
+			return;
+		}
+		begin_command(emu, c, 2);
+		return;
+	}
+
+	collect(emu, c);
+	if (emu->cmd.len == 2) {
+		if (c > 22) {
+			emu->errors++;
+			emu->cmd.need = 0;
+			return;
+		}
+		emu->cmd.need = c + 4;
+	}
+	if (emu->cmd.len < emu->cmd.need)
+		return;
+	emu->cmd.need = 0;
+
+	len = pkt[1];
+	crc = pkt[len + 2] | (pkt[len + 3] << 8);
+	if (crc != cfp_crc(pkt, len + 2)) {
+		emu->errors++;
+		return;
+	}
+
+	switch (pkt[0]) {
+		case 6:		/* clear */
+			clear_screen(emu);
+			break;
+		case 7:		/* line one */
+		case 8:		/* line two */
+			goto_xy(emu, 0, pkt[0] - 7);
+			for (i = 0; (i < len) && (i < emu->width); i++)
+				emu->screen[emu->y][i] = pkt[2 + i];
+			break;
+		case 31:	/* send data: column, row, text */
+			if (len < 2)
+				break;
+			goto_xy(emu, pkt[2], pkt[3]);
+			for (i = 4; i < len + 2; i++)
+				put_char(emu, pkt[i]);
+			break;
+	}
+
+	/* ping echoes its data, all other commands are acknowledged empty */
+	cfp_send(emu, 0x40 | pkt[0], (pkt[0] == 0) ? len : 0, pkt + 2);
+}
+
+
+static void
+cfp_key(Emulator *emu, const char *key)
+{
+	/* key activity report: numeric key code, e.g. 1 = up, 5 = enter */
+	unsigned char code = atoi(key);
+
+	cfp_send(emu, 0x80, 1, &code);
+}
+
+
+/*
+ * serialVFD, display type 0 (NEC FIPC8367): cursor addressing by linear
+ * position, tab to skip a character, 7 bytes per user character.
+ */
+static void
+svfd_input(Emulator *emu, unsigned char c)
+{
+	if (emu->cmd.need > 0) {
+		if (!collect(emu, c))
+			return;
+		emu->cmd.need = 0;
+
+		if (emu->cmd.buf[0] == 0x1B) {
+			int pos = emu->cmd.buf[1];
+
+			goto_xy(emu, pos % emu->width, pos / emu->width);
+		}
+		return;
+	}
+
+	switch (c) {
+		case 0x1B:	/* move cursor */
+			begin_command(emu, c, 2);
+			break;
+		case 0x1A:	/* user character: position, 7 bytes */
+			begin_command(emu, c, 9);
+			break;
+		case 0x0C:	/* reset */
+			begin_command(emu, c, 1);
+			emu->cmd.need = 0;
+			clear_screen(emu);
+			break;
+		case 0x0D:	/* pos1 */
+			begin_command(emu, c, 1);
+			emu->cmd.need = 0;
+			goto_xy(emu, 0, 0);
+			break;
+		case 0x09:	/* tab */
+			begin_command(emu, c, 1);
+			emu->cmd.need = 0;
+			put_char(emu, emu->screen[emu->y][emu->x]);
+			break;
+		case 0x01: case 0x02: case 0x03: case 0x04:	/* brightness */
+		case 0x11: case 0x14:				/* init */
+			begin_command(emu, c, 1);
+			emu->cmd.need = 0;
+			break;
+		default:
+			put_char(emu, c);
+			break;
+	}
+}
+
+
+/*
+ * hd44780 serial adapters (lcdserializer, los-panel, vdr-lcd, ...):
+ * an escape byte announces an HD44780 instruction, everything else is
+ * data written to DDRAM/CGRAM.
+ */
+static void
+hd_set_ddram(Emulator *emu, int addr)
+{
+	int line = (addr >= 0x40) ? 1 : 0;
+	int col = addr - line * 0x40;
+
+	/* lines 3 and 4 continue lines 1 and 2 */
+	if (col >= emu->width) {
+		col -= emu->width;
+		line += 2;
+	}
+	emu->ddram = addr;
+	goto_xy(emu, col, line);
+}
+
+
+static void
+hd_input(Emulator *emu, unsigned char c)
+{
+	if (emu->cmd.need > 0) {
+		collect(emu, c);
+		emu->cmd.need = 0;
+
+		if (c & 0x80) {
+			emu->cgram = 0;
+			hd_set_ddram(emu, c & 0x7F);
+		}
+		else if (c & 0x40)
+			emu->cgram = 1;
+		else if (c == 0x01)
+			clear_screen(emu);
+		else if ((c & 0xFE) == 0x02)
+			hd_set_ddram(emu, 0);
+		return;
+	}
+
+	if (c == emu->escape) {
+		begin_command(emu, c, 2);
+		return;
+	}
+
+	if (!emu->cgram) {
+		put_char(emu, c);
+		hd_set_ddram(emu, ++emu->ddram);
+	}
+}
+
+
+static const Protocol protocols[] = {
+	{ "mtxorb",       "20x4", mtxorb_input, mtxorb_key },
+	{ "cfontz",       "20x4", cfontz_input, cfontz_key },
+	{ "cfontzpacket", "20x4", cfp_input,    cfp_key },
+	{ "serialvfd",    "20x2", svfd_input,   NULL },
+	{ "hd44780",      "20x4", hd_input,     NULL },
+	{ NULL, NULL, NULL, NULL }
+};
+
+
+static void
+print_screen(Emulator *emu, FILE *out)
+{
+	int x, y;
+
+	fputc('+', out);
+	for (x = 0; x < emu->width; x++)
+		fputc('-', out);
+	fputs("+\n", out);
+	for (y = 0; y < emu->height; y++) {
+		fputc('|', out);
+		for (x = 0; x < emu->width; x++) {
+			unsigned char c = emu->screen[y][x];
+
+			/* custom characters are shown by their number */
+			if (c < 8)
+				c = '0' + c;
+			else if ((c < 0x20) || (c >= 0x7F))
+				c = '?';
+			fputc(c, out);
+		}
+		fputs("|\n", out);
+	}
+	fputc('+', out);
+	for (x = 0; x < emu->width; x++)
+		fputc('-', out);
+	fputs("+\n", out);
+}
+
+
+static void
+end_frame(Emulator *emu, int verbose)
+{
+	if (emu->frame_bytes == 0)
+		return;
+
+	emu->frames++;
+	emu->bytes += emu->frame_bytes;
+	emu->cmds += emu->frame_cmds;
+	if (emu->frame_bytes > emu->max_frame_bytes)
+		emu->max_frame_bytes = emu->frame_bytes;
+	if (emu->frame_cmds > emu->max_frame_cmds)
+		emu->max_frame_cmds = emu->frame_cmds;
+
+	if (verbose) {
+		printf("frame %ld: %ld bytes, %ld commands\n",
+		       emu->frames, emu->frame_bytes, emu->frame_cmds);
+		if (verbose > 1)
+			print_screen(emu, stdout);
+		fflush(stdout);
+	}
+	emu->frame_bytes = emu->frame_cmds = 0;
+}
+
+
+static void
+print_summary(Emulator *emu)
+{
+	double secs = (emu->last.tv_sec - emu->first.tv_sec)
+		      + (emu->last.tv_usec - emu->first.tv_usec) / 1e6;
+
+	printf("protocol:        %s\n", emu->proto->name);
+	printf("frames:          %ld\n", emu->frames);
+	printf("bytes:           %ld (%.1f per frame, max %ld)\n", emu->bytes,
+	       emu->frames ? (double) emu->bytes / emu->frames : 0.0, emu->max_frame_bytes);
+	printf("commands:        %ld (%.1f per frame, max %ld)\n", emu->cmds,
+	       emu->frames ? (double) emu->cmds / emu->frames : 0.0, emu->max_frame_cmds);
+	printf("protocol errors: %ld\n", emu->errors);
+	if (secs > 0)
+		printf("throughput:      %.0f bytes/s over %.2f s\n", emu->bytes / secs, secs);
+	print_screen(emu, stdout);
+}
+
+
+static void
+usage(void)
+{
+	int i;
+
+	fprintf(stderr,
+		"Usage: serialemu [-p protocol] [-s WxH] [-l link] [-g gap] [-t seconds]\n"
+		"                 [-e escape] [-o screenfile] [-v]\n"
+		"  -p  display protocol:");
+	for (i = 0; protocols[i].name != NULL; i++)
+		fprintf(stderr, " %s", protocols[i].name);
+	fprintf(stderr, "\n"
+		"  -s  display size (default depends on protocol)\n"
+		"  -l  create a symlink to the pty, e.g. /tmp/lcd\n"
+		"  -g  idle time in ms that ends a frame (default 20)\n"
+		"  -t  exit after the given number of seconds\n"
+		"  -e  hd44780 instruction escape byte (default 0xFE)\n"
+		"  -o  write the final screen to a file\n"
+		"  -v  print frame statistics, twice to also print each frame\n"
+		"Lines read from stdin are sent as key presses.\n");
+	exit(EXIT_FAILURE);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	Emulator emu;
+	const char *size = NULL, *link_name = NULL, *screen_file = NULL;
+	int gap = 20, duration = 0, verbose = 0;
+	struct termios portset;
+	struct timeval start, now;
+	int slave, c, i;
+	int stdin_open = 1;
+
+	memset(&emu, 0, sizeof(emu));
+	emu.proto = &protocols[0];
+	emu.escape = 0xFE;
+
+	while ((c = getopt(argc, argv, "p:s:l:g:t:e:o:v")) != -1) {
+		switch (c) {
+			case 'p':
+				for (i = 0; protocols[i].name != NULL; i++)
+					if (strcmp(optarg, protocols[i].name) == 0)
+						break;
+				if (protocols[i].name == NULL)
+					usage();
+				emu.proto = &protocols[i];
+				break;
+			case 's':
+				size = optarg;
+				break;
+			case 'l':
+				link_name = optarg;
+				break;
+			case 'g':
+				gap = atoi(optarg);
+				break;
+			case 't':
+				duration = atoi(optarg);
+				break;
+			case 'e':
+				emu.escape = strtol(optarg, NULL, 0);
+				break;
+			case 'o':
+				screen_file = optarg;
+				break;
+			case 'v':
+				verbose++;
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (size == NULL)
+		size = emu.proto->default_size;
+	if ((sscanf(size, "%dx%d", &emu.width, &emu.height) != 2)
+	    || (emu.width <= 0) || (emu.width > MAX_WIDTH)
+	    || (emu.height <= 0) || (emu.height > MAX_HEIGHT)) {
+		fprintf(stderr, "serialemu: invalid size %s\n", size);
+		return EXIT_FAILURE;
+	}
+	clear_screen(&emu);
+
+	emu.fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((emu.fd < 0) || (grantpt(emu.fd) < 0) || (unlockpt(emu.fd) < 0)) {
+		perror("serialemu: posix_openpt");
+		return EXIT_FAILURE;
+	}
+
+	/* raw mode, and keep the slave open so driver restarts don't hang up */
+	slave = open(ptsname(emu.fd), O_RDWR | O_NOCTTY);
+	if (slave < 0) {
+		perror("serialemu: open slave");
+		return EXIT_FAILURE;
+	}
+	tcgetattr(slave, &portset);
+	cfmakeraw(&portset);
+	tcsetattr(slave, TCSANOW, &portset);
+
+	if (link_name != NULL) {
+		unlink(link_name);
+		if (symlink(ptsname(emu.fd), link_name) < 0) {
+			perror("serialemu: symlink");
+			return EXIT_FAILURE;
+		}
+	}
+	printf("%s emulator on %s\n", emu.proto->name, ptsname(emu.fd));
+	fflush(stdout);
+
+	signal(SIGINT, sig_handler);
+	signal(SIGTERM, sig_handler);
+	gettimeofday(&start, NULL);
+
+	while (!got_signal) {
+		struct pollfd fds[2];
+		unsigned char buf[4096];
+		int n;
+
+		fds[0].fd = emu.fd;
+		fds[0].events = POLLIN;
+		fds[1].fd = (stdin_open) ? STDIN_FILENO : -1;
+		fds[1].events = POLLIN;
+
+		n = poll(fds, 2, (emu.frame_bytes > 0) ? gap : 100);
+		if (n < 0 && errno != EINTR)
+			break;
+
+		gettimeofday(&now, NULL);
+		if (duration && (now.tv_sec - start.tv_sec >= duration))
+			break;
+
+		if (n == 0) {
+			end_frame(&emu, verbose);
+			continue;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			n = read(emu.fd, buf, sizeof(buf));
+			if (n > 0) {
+				if (emu.bytes == 0 && emu.frame_bytes == 0)
+					emu.first = now;
+				emu.last = now;
+				emu.frame_bytes += n;
+				for (i = 0; i < n; i++)
+					emu.proto->input(&emu, buf[i]);
+			}
+		}
+
+		if (fds[1].revents & (POLLIN | POLLHUP)) {
+			char line[64];
+
+			if (fgets(line, sizeof(line), stdin) == NULL) {
+				stdin_open = 0;
+				continue;
+			}
+			line[strcspn(line, "\r\n")] = '\0';
+			if ((line[0] != '\0') && (emu.proto->key != NULL))
+				emu.proto->key(&emu, line);
+		}
+	}
+
+	end_frame(&emu, verbose);
+	print_summary(&emu);
+
+	if (screen_file != NULL) {
+		FILE *f = fopen(screen_file, "w");
+
+		if (f == NULL) {
+			perror("serialemu: fopen");
+			return EXIT_FAILURE;
+		}
+		print_screen(&emu, f);
+		fclose(f);
+	}
+
+	if (link_name != NULL)
+		unlink(link_name);
+	close(slave);
+	close(emu.fd);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+#!/bin/sh
+#
+# Smoke test of the serial drivers against serialemu: for every emulated
+# protocol start the emulator, run LCDd with the matching driver on the pty
+# for a few seconds and check that the emulated display shows LCDd's
+# goodbye screen without protocol errors.
+#
+# Usage: smoketest.sh [LCDd binary] [driver directory]
+#
+# The defaults are the binaries of an in-tree build. Exits non-zero if any
+# protocol fails; the emulator and LCDd output of a failed run is printed.
+#
+# This file is released under the GNU General Public License.
+# Refer to the COPYING file distributed with this package.
+
+LCDD=${1:-../../server/LCDd}
+DRIVERPATH=${2:-../../server/drivers}
+RUNTIME=${RUNTIME:-3}
+PORT=${PORT:-13798}
+
+cd "$(dirname "$0")" || exit 1
+
+if [ ! -x "$LCDD" ]; then
+	echo "smoketest: $LCDD not found, build LCDd first" >&2
+	exit 1
+fi
+make -s serialemu || exit 1
+
+TMP=$(mktemp -d /tmp/serialemu.XXXXXX) || exit 1
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+failed=0
+
+# run one protocol: run <protocol> <driver> [config lines for the driver]...
+run()
+{
+	proto=$1
+	driver=$2
+	shift 2
+
+	conf="$TMP/$proto.conf"
+	{
+		echo "[server]"
+		echo "DriverPath=$DRIVERPATH/"
+		echo "Driver=$driver"
+		echo "Port=$PORT"
+		echo "ReportToSyslog=no"
+		echo "[$driver]"
+		echo "Device=$TMP/lcd"
+		echo "Size=20x4"
+		for line in "$@"; do
+			echo "$line"
+		done
+	} > "$conf"
+
+	./serialemu -p "$proto" -l "$TMP/lcd" -t $((RUNTIME + 3)) \
+		-o "$TMP/$proto.screen" < /dev/null > "$TMP/$proto.emu" 2>&1 &
+	emu=$!
+	i=0
+	while [ ! -e "$TMP/lcd" ] && [ $i -lt 50 ]; do
+		sleep 0.1
+		i=$((i + 1))
+	done
+
+	"$LCDD" -f -c "$conf" > "$TMP/$proto.lcdd" 2>&1 &
+	lcdd=$!
+	sleep "$RUNTIME"
+	kill $lcdd 2> /dev/null
+	wait $lcdd
+	wait $emu
+	rm -f "$TMP/lcd"
+
+	if grep -q "protocol errors: *0$" "$TMP/$proto.emu" \
+	   && grep -q "Thanks for using" "$TMP/$proto.screen" 2> /dev/null; then
+		echo "PASS: $proto ($driver)"
+	else
+		echo "FAIL: $proto ($driver)"
+		cat "$TMP/$proto.emu" "$TMP/$proto.lcdd"
+		failed=1
+	fi
+}
+
+run mtxorb       MtxOrb       "Type=lcd"
+run cfontz       CFontz       "NewFirmware=yes"
+run cfontzpacket CFontzPacket "Model=635"
+run serialvfd    serialVFD    "Type=0"
+run hd44780      hd44780      "ConnectionType=lcdserializer"
+
+exit $failed
@@ -0,0 +1,132 @@
+/** \file server/binproto.c
+ * Handles the frames of the binary protocol variant.
+ *
+ * Clients that update widgets at a high rate can send binary frames
+ * instead of widget_set commands, see shared/binproto.h. A frame refers
+ * to a widget by the numeric handle widget_add returned, carries its
+ * numbers in fixed-width fields and needs neither quoting nor parsing of
+ * text. Everything else, including the setup of screens and widgets,
+ * goes through the text protocol.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "shared/report.h"
+#include "shared/sockets.h"
+#include "shared/binproto.h"
+
+#include "client.h"
+#include "screen.h"
+#include "widget.h"
+#include "binproto.h"
+
+
+/** Move a widget.
+ * \param w  The widget.
+ * \param x  New column.
+ * \param y  New row; ignored for num widgets.
+ * \retval 0   Success.
+ * \retval -1  The widget cannot be moved this way.
+ */
+static int
+binproto_move(Widget *w, int x, int y)
+{
+	switch (w->type) {
+	case WID_NUM:
+		y = w->y;	/* y is the digit */
+		break;
+	case WID_STRING:
+	case WID_HBAR:
+	case WID_VBAR:
+	case WID_PBAR:
+	case WID_ICON:
+	case WID_GRAPH:
+		break;
+	default:
+		return -1;
+	}
+	if ((w->x != x) || (w->y != y)) {
+		w->x = x;
+		w->y = y;
+		widget_touch(w);
+	}
+	return 0;
+}
+
+
+/** Handle one binary frame of a client.
+ * \param frame  The frame, starting with BIN_FRAME_MARK.
+ * \param c      The client.
+ */
+void
+binproto_parse_frame(const char *frame, Client *c)
+{
+	const unsigned char *p = (const unsigned char *) frame + BIN_HEADER_SIZE;
+	int len = binproto_message_size(frame) - BIN_HEADER_SIZE;
+	Widget *w;
+	int i;
+
+	if ((c->state != ACTIVE) || !c->binary) {
+		sock_send_error(c->sock, "Binary frames need \"hello -binary\"\n");
+		return;
+	}
+	if (len < 3) {
+		sock_send_error(c->sock, "Binary frame too short\n");
+		return;
+	}
+
+	w = client_find_handle(c, binproto_get_u16(p + 1));
+	if (w == NULL) {
+		sock_send_error(c->sock, "Invalid widget handle\n");
+		return;
+	}
+
+	switch (p[0]) {
+	case BIN_OP_VALUE:
+		if (len != 7) {
+			sock_send_error(c->sock, "Wrong frame length\n");
+			return;
+		}
+		widget_stop_animation(w);
+		if (widget_set_number(w, binproto_get_s32(p + 3)) < 0)
+			sock_send_error(c->sock, "Invalid value for widget\n");
+		break;
+	case BIN_OP_TEXT:
+		if ((w->type != WID_STRING) && (w->type != WID_TITLE) && (w->type != WID_SCROLLER)) {
+			sock_send_error(c->sock, "Widget has no text\n");
+			return;
+		}
+		widget_stop_animation(w);
+		/* The frame is NUL-terminated by the receiver */
+		if (widget_set_string(w, &w->text, (const char *) p + 3) > 0)
+			widget_touch(w);
+		break;
+	case BIN_OP_MOVE:
+		if (len != 7) {
+			sock_send_error(c->sock, "Wrong frame length\n");
+			return;
+		}
+		if (binproto_move(w, binproto_get_s16(p + 3), binproto_get_s16(p + 5)) < 0)
+			sock_send_error(c->sock, "Widget cannot be moved\n");
+		break;
+	case BIN_OP_PUSH:
+		if ((w->type != WID_GRAPH) || ((len - 3) % 2 != 0)) {
+			sock_send_error(c->sock, "Invalid samples\n");
+			return;
+		}
+		for (i = 3; i < len; i += 2)
+			widget_push_sample(w, binproto_get_s16(p + i));
+		widget_touch(w);
+		break;
+	default:
+		sock_send_error(c->sock, "Unknown binary operation\n");
+		break;
+	}
+}
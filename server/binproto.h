@@ -0,0 +1,21 @@
+/** \file server/binproto.h
+ * Handles the frames of the binary protocol variant.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef BINPROTO_H
+#define BINPROTO_H
+
+#define INC_TYPES_ONLY 1
+#include "client.h"
+#undef INC_TYPES_ONLY
+
+/* Handle one binary frame of a client */
+void binproto_parse_frame(const char *frame, Client *c);
+
+#endif
@@ -0,0 +1,459 @@
+/** \file server/cellbuf.c
+ * Offscreen buffers of display cells.
+ *
+ * Frames are drawn into a buffer the size of their contents, and the part
+ * visible through the frame is then shown on the displays or copied into
+ * the buffer of the enclosing frame. Bars are kept as runs of cells that
+ * remember the whole bar, so a bar cut by the edge of a frame is shown as
+ * a shorter bar with the part that is visible. A big number needs the
+ * whole height of the display; where it cannot have it, its digit is
+ * shown instead.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "shared/report.h"
+#include "shared/defines.h"
+
+#include "drivers.h"
+#include "cellbuf.h"
+
+/** What is outside of a buffer */
+static const Cell blank = { CELL_CHAR, ' ', 0, 0, 0 };
+
+
+/**
+ * Clip a size to what a buffer can hold: at least one cell in each
+ * direction and at most CELLBUF_MAX_CELLS cells, cutting rows at the
+ * bottom. Buffers always have the clipped size, so callers compare
+ * against it to tell whether a buffer needs resizing.
+ * \param width   Number of columns; clipped in place.
+ * \param height  Number of rows; clipped in place.
+ */
+void
+cellbuf_clip_size(int *width, int *height)
+{
+	*width = min(max(*width, 1), CELLBUF_MAX_CELLS);
+	*height = min(max(*height, 1), CELLBUF_MAX_CELLS / *width);
+}
+
+
+/**
+ * Create a buffer filled with blanks.
+ * \param width   Number of columns.
+ * \param height  Number of rows.
+ * \return        The buffer; NULL on error.
+ */
+CellBuf *
+cellbuf_create(int width, int height)
+{
+	CellBuf *cb = calloc(1, sizeof(CellBuf));
+
+	if (cb == NULL)
+		return NULL;
+	if (cellbuf_resize(cb, width, height) < 0) {
+		free(cb);
+		return NULL;
+	}
+	return cb;
+}
+
+
+/**
+ * Destroy a buffer.
+ * \param cb  The buffer; may be NULL.
+ */
+void
+cellbuf_destroy(CellBuf *cb)
+{
+	if (cb == NULL)
+		return;
+	free(cb->cells);
+	free(cb);
+}
+
+
+/**
+ * Change the size of a buffer and fill it with blanks. The size is
+ * clipped with cellbuf_clip_size().
+ * \param cb      The buffer.
+ * \param width   Number of columns.
+ * \param height  Number of rows.
+ * \retval 0      Success.
+ * \retval -1     Error allocating memory; the buffer is unchanged.
+ */
+int
+cellbuf_resize(CellBuf *cb, int width, int height)
+{
+	Cell *cells;
+
+	cellbuf_clip_size(&width, &height);
+
+	if ((cb->cells == NULL) || (width * height != cb->width * cb->height)) {
+		cells = malloc(width * height * sizeof(Cell));
+		if (cells == NULL) {
+			report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+			return -1;
+		}
+		free(cb->cells);
+		cb->cells = cells;
+	}
+	cb->width = width;
+	cb->height = height;
+	cellbuf_clear(cb);
+	return 0;
+}
+
+
+/**
+ * Fill a buffer with blanks.
+ * \param cb  The buffer.
+ */
+void
+cellbuf_clear(CellBuf *cb)
+{
+	int i;
+
+	for (i = 0; i < cb->width * cb->height; i++)
+		cb->cells[i] = blank;
+}
+
+
+/** Get a cell by its 0-based position; NULL if it is outside the buffer. */
+static inline Cell *
+cellbuf_at(const CellBuf *cb, int col, int row)
+{
+	if ((col < 0) || (col >= cb->width) || (row < 0) || (row >= cb->height))
+		return NULL;
+	return &cb->cells[row * cb->width + col];
+}
+
+
+/**
+ * Write a string into a buffer. Characters outside the buffer are dropped.
+ * \param cb      The buffer.
+ * \param x       Column of the first character, starting at 1.
+ * \param y       Row, starting at 1.
+ * \param string  The string.
+ */
+void
+cellbuf_string(CellBuf *cb, int x, int y, const char *string)
+{
+	int i;
+
+	for (i = 0; string[i] != '\0'; i++)
+		cellbuf_chr(cb, x + i, y, string[i]);
+}
+
+
+/**
+ * Write a character into a buffer.
+ * \param cb  The buffer.
+ * \param x   Column, starting at 1.
+ * \param y   Row, starting at 1.
+ * \param c   The character.
+ */
+void
+cellbuf_chr(CellBuf *cb, int x, int y, char c)
+{
+	Cell *cell = cellbuf_at(cb, x - 1, y - 1);
+
+	if (cell != NULL) {
+		*cell = blank;
+		cell->ch = c;
+	}
+}
+
+
+/**
+ * Put an icon into a buffer.
+ * \param cb    The buffer.
+ * \param x     Column, starting at 1.
+ * \param y     Row, starting at 1.
+ * \param icon  One of the ICON_ values.
+ */
+void
+cellbuf_icon(CellBuf *cb, int x, int y, int icon)
+{
+	Cell *cell = cellbuf_at(cb, x - 1, y - 1);
+
+	if (cell != NULL) {
+		cell->type = CELL_ICON;
+		cell->ch = ' ';
+		cell->value = icon;
+	}
+}
+
+
+/** Put the cells of a bar into a buffer, advancing by (dx,dy) from (x,y). */
+static void
+cellbuf_bar(CellBuf *cb, int type, int x, int y, int dx, int dy, int len, int promille)
+{
+	int pos;
+
+	len = min(len, CELLBUF_MAX_BAR);
+	promille = min(max(promille, 0), 1000);
+
+	for (pos = 0; pos < len; pos++) {
+		Cell *cell = cellbuf_at(cb, x - 1 + pos * dx, y - 1 + pos * dy);
+
+		if (cell != NULL) {
+			cell->type = type;
+			cell->ch = ' ';
+			cell->pos = pos;
+			cell->len = len;
+			cell->value = promille;
+		}
+	}
+}
+
+
+/**
+ * Put a horizontal bar into a buffer.
+ * \param cb        The buffer.
+ * \param x         Column of its left end, starting at 1.
+ * \param y         Row, starting at 1.
+ * \param len       Length in cells at 100%.
+ * \param promille  Part of the length that is filled.
+ */
+void
+cellbuf_hbar(CellBuf *cb, int x, int y, int len, int promille)
+{
+	cellbuf_bar(cb, CELL_HBAR, x, y, 1, 0, len, promille);
+}
+
+
+/**
+ * Put a vertical bar into a buffer.
+ * \param cb        The buffer.
+ * \param x         Column, starting at 1.
+ * \param y         Row of its bottom end, starting at 1.
+ * \param len       Length in cells at 100%.
+ * \param promille  Part of the length that is filled.
+ */
+void
+cellbuf_vbar(CellBuf *cb, int x, int y, int len, int promille)
+{
+	cellbuf_bar(cb, CELL_VBAR, x, y, 0, -1, len, promille);
+}
+
+
+/**
+ * Put a percentage bar with its labels into a buffer. It is laid out like
+ * driver_pbar() does, and shown as a horizontal bar.
+ * \param cb           The buffer.
+ * \param x            Column of its left end, starting at 1.
+ * \param y            Row, starting at 1.
+ * \param width        Width including the labels.
+ * \param promille     Part of the bar that is filled.
+ * \param begin_label  Text in front of the bar; or NULL.
+ * \param end_label    Text after the bar; or NULL.
+ */
+void
+cellbuf_pbar(CellBuf *cb, int x, int y, int width, int promille, const char *begin_label, const char *end_label)
+{
+	int begin_length = (begin_label != NULL) ? strlen(begin_label) : 0;
+	int end_length = (end_label != NULL) ? strlen(end_label) : 0;
+	int len;
+
+	/* We want at least 2 chars for the bar itself */
+	if ((begin_length + end_length + 2) > width)
+		begin_length = end_length = 0;
+
+	len = width - begin_length - end_length;
+
+	if (begin_length) {
+		cellbuf_string(cb, x, y, begin_label);
+		x += begin_length;
+	}
+	cellbuf_hbar(cb, x, y, len, promille);
+	x += len;
+	if (end_length)
+		cellbuf_string(cb, x, y, end_label);
+}
+
+
+/**
+ * Put a big number into a buffer.
+ * \param cb   The buffer.
+ * \param x    Column, starting at 1.
+ * \param num  Digit to show; 10 is a colon.
+ */
+void
+cellbuf_num(CellBuf *cb, int x, int num)
+{
+	Cell *cell = cellbuf_at(cb, x - 1, 0);
+
+	if (cell != NULL) {
+		cell->type = CELL_NUM;
+		cell->ch = (num == 10) ? ':' : '0' + num;
+		cell->value = num;
+	}
+}
+
+
+/**
+ * Copy a part of a buffer into another one.
+ * \param dst     Buffer to copy to.
+ * \param x       Column of \c dst to copy to, starting at 1.
+ * \param y       Row of \c dst to copy to, starting at 1.
+ * \param src     Buffer to copy from; cells outside of it are blank.
+ * \param sx      First column of \c src to copy, starting at 0.
+ * \param sy      First row of \c src to copy, starting at 0.
+ * \param width   Number of columns to copy.
+ * \param height  Number of rows to copy.
+ */
+void
+cellbuf_blit(CellBuf *dst, int x, int y, const CellBuf *src, int sx, int sy, int width, int height)
+{
+	int row, col;
+
+	for (row = 0; row < height; row++) {
+		for (col = 0; col < width; col++) {
+			Cell *d = cellbuf_at(dst, x - 1 + col, y - 1 + row);
+			const Cell *s = cellbuf_at(src, sx + col, sy + row);
+
+			if (d != NULL)
+				*d = (s != NULL) ? *s : blank;
+		}
+	}
+}
+
+
+/** Whether cell \c b follows cell \c a in the same bar. */
+static inline int
+cellbuf_same_bar(const Cell *a, const Cell *b)
+{
+	return (a != NULL) && (b != NULL) && (a->type == b->type)
+	       && (a->len == b->len) && (a->value == b->value)
+	       && (a->pos + 1 == b->pos);
+}
+
+
+/** Promille of the part of a bar made of \c count cells from cell \c first. */
+static int
+cellbuf_bar_part(const Cell *cell, int first, int count)
+{
+	long fill = (long) cell->len * cell->value - (long) first * 1000;
+
+	fill = min(max(fill, 0), (long) count * 1000);
+	return fill / count;
+}
+
+
+/** Show the characters collected in \c str, if any. */
+static void
+cellbuf_show_string(char *str, int *len, int x, int y)
+{
+	if (*len > 0) {
+		str[*len] = '\0';
+		drivers_string(x, y, str);
+		*len = 0;
+	}
+}
+
+
+/**
+ * Show a part of a buffer on the displays. Blank cells are shown too, so
+ * the part covers what was drawn there before.
+ * \param src     Buffer to show; cells outside of it are blank.
+ * \param sx      First column of \c src to show, starting at 0.
+ * \param sy      First row of \c src to show, starting at 0.
+ * \param width   Number of columns to show.
+ * \param height  Number of rows to show.
+ * \param x       Column of the displays to show it at, starting at 1.
+ * \param y       Row of the displays to show it at, starting at 1.
+ */
+void
+cellbuf_show(const CellBuf *src, int sx, int sy, int width, int height, int x, int y)
+{
+	char str[CELLBUF_MAX_BAR + 1];
+	int row, col, n, len, start;
+
+	/* Clip to the displays */
+	if (x < 1) {
+		sx += 1 - x;
+		width -= 1 - x;
+		x = 1;
+	}
+	if (y < 1) {
+		sy += 1 - y;
+		height -= 1 - y;
+		y = 1;
+	}
+	width = min(width, display_props->width - x + 1);
+	height = min(height, display_props->height - y + 1);
+
+	for (row = 0; row < height; row++) {
+		len = 0;
+		start = 0;
+		for (col = 0; col < width; col++) {
+			const Cell *cell = cellbuf_at(src, sx + col, sy + row);
+
+			if (cell == NULL)
+				cell = &blank;
+
+			/* Collect characters into strings */
+			if (cell->type == CELL_CHAR) {
+				if (len == 0)
+					start = col;
+				str[len++] = cell->ch;
+				if (len == sizeof(str) - 1)
+					cellbuf_show_string(str, &len, x + start, y + row);
+				continue;
+			}
+			cellbuf_show_string(str, &len, x + start, y + row);
+
+			switch (cell->type) {
+			case CELL_ICON:
+				drivers_icon(x + col, y + row, cell->value);
+				break;
+			case CELL_HBAR:
+				if ((col > 0) && cellbuf_same_bar(cellbuf_at(src, sx + col - 1, sy + row), cell))
+					break;	/* shown with the start of the run */
+				for (n = 1; (col + n < width)
+					    && cellbuf_same_bar(cellbuf_at(src, sx + col + n - 1, sy + row),
+								cellbuf_at(src, sx + col + n, sy + row)); n++)
+					;
+				if ((cell->pos == 0) || (cellbuf_bar_part(cell, cell->pos, n) > 0))
+					drivers_hbar(x + col, y + row, n, cellbuf_bar_part(cell, cell->pos, n),
+						     BAR_PATTERN_FILLED);
+				break;
+			case CELL_VBAR:
+				if ((row < height - 1) && cellbuf_same_bar(cellbuf_at(src, sx + col, sy + row + 1), cell))
+					break;	/* shown with the bottom of the run */
+				for (n = 1; (row - n >= 0)
+					    && cellbuf_same_bar(cellbuf_at(src, sx + col, sy + row - n + 1),
+								cellbuf_at(src, sx + col, sy + row - n)); n++)
+					;
+				if ((cell->pos == 0) || (cellbuf_bar_part(cell, cell->pos, n) > 0))
+					drivers_vbar(x + col, y + row, n, cellbuf_bar_part(cell, cell->pos, n),
+						     BAR_PATTERN_FILLED);
+				break;
+			case CELL_NUM:
+				/* Big numbers span the whole display; see below */
+				if ((sy + row != 0) || (y != 1) || (height < display_props->height))
+					drivers_chr(x + col, y + row, cell->ch);
+				break;
+			}
+		}
+		cellbuf_show_string(str, &len, x + start, y + row);
+	}
+
+	/* Big numbers last, so the blanks around them do not cover them */
+	if ((sy == 0) && (y == 1) && (height >= display_props->height)) {
+		for (col = 0; col < width; col++) {
+			const Cell *cell = cellbuf_at(src, sx + col, 0);
+
+			if ((cell != NULL) && (cell->type == CELL_NUM))
+				drivers_num(x + col, cell->value);
+		}
+	}
+}
@@ -0,0 +1,73 @@
+/** \file server/cellbuf.h
+ * Offscreen buffers of display cells.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef CELLBUF_H
+#define CELLBUF_H
+
+/** Most cells of a buffer; larger ones are cut at the bottom */
+#define CELLBUF_MAX_CELLS	65536
+/** Longest bar kept in a buffer */
+#define CELLBUF_MAX_BAR		255
+
+/** Cell types */
+#define CELL_CHAR	0	/**< character \c ch */
+#define CELL_ICON	1	/**< icon \c value */
+#define CELL_HBAR	2	/**< cell \c pos of a bar to the right */
+#define CELL_VBAR	3	/**< cell \c pos of a bar upwards */
+#define CELL_NUM	4	/**< big number \c value, the digit \c ch if it cannot be shown */
+
+/** One cell of a buffer */
+typedef struct Cell {
+	unsigned char type;		/**< one of the CELL_ types */
+	unsigned char ch;		/**< character */
+	unsigned char pos;		/**< index of the cell in its bar */
+	unsigned char len;		/**< length of the bar */
+	short value;			/**< icon, number, or promille of the bar */
+} Cell;
+
+/** Buffer of cells, drawn like a display and shown in parts */
+typedef struct CellBuf {
+	int width, height;		/**< size in cells */
+	Cell *cells;			/**< the cells, row by row */
+	unsigned int generation;	/**< generation of what was drawn; kept by the user */
+	long expires;			/**< tick the contents get stale; kept by the user */
+} CellBuf;
+
+/* Clip a size to what a buffer can hold */
+void cellbuf_clip_size(int *width, int *height);
+
+/* Create a buffer */
+CellBuf *cellbuf_create(int width, int height);
+
+/* Destroy a buffer */
+void cellbuf_destroy(CellBuf *cb);
+
+/* Change the size of a buffer; the contents are cleared */
+int cellbuf_resize(CellBuf *cb, int width, int height);
+
+/* Fill a buffer with blanks */
+void cellbuf_clear(CellBuf *cb);
+
+/* Drawing, with the arguments of the drivers_ functions */
+void cellbuf_string(CellBuf *cb, int x, int y, const char *string);
+void cellbuf_chr(CellBuf *cb, int x, int y, char c);
+void cellbuf_icon(CellBuf *cb, int x, int y, int icon);
+void cellbuf_hbar(CellBuf *cb, int x, int y, int len, int promille);
+void cellbuf_vbar(CellBuf *cb, int x, int y, int len, int promille);
+void cellbuf_pbar(CellBuf *cb, int x, int y, int width, int promille, const char *begin_label, const char *end_label);
+void cellbuf_num(CellBuf *cb, int x, int num);
+
+/* Copy a part of a buffer into another one */
+void cellbuf_blit(CellBuf *dst, int x, int y, const CellBuf *src, int sx, int sy, int width, int height);
+
+/* Show a part of a buffer on the displays */
+void cellbuf_show(const CellBuf *src, int sx, int sy, int width, int height, int x, int y);
+
+#endif
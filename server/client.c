@@ -20,13 +20,17 @@
 #endif
 
 #include "client.h"
+#include "clients.h"
 #include "screen.h"
 #include "screenlist.h"
 #include "render.h"
 #include "input.h"
 #include "menuscreens.h"
+#include "pool.h"
+#include "widget.h"
 #include "shared/report.h"
 #include "shared/LL.h"
+#include "shared/binproto.h"
 
 Client *client_create(int sock)
 {
@@ -42,25 +46,31 @@ Client *client_create(int sock)
 	}
 	/* Init struct members*/
 	c->sock = sock;
-	c->messages = NULL;
 	c->backlight = BACKLIGHT_OPEN;
 	c->heartbeat = HEARTBEAT_OPEN;
+	c->keycount = 0;
 
-	/*Set up message list...*/
-	c->messages = LL_new();
-	if (!c->messages) {
-		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
-		free(c);
-		return NULL;
-	}
+	/*Set up message queue...*/
+	queue_init(&c->messages);
 
 	c->state = NEW;
 	c->name = NULL;
 	c->menu = NULL;
 
+	c->widgetcount = 0;
+	c->queued = 0;
+	c->deficit = 0;
+	c->tokens = client_limits.burst;
+	gettimeofday(&c->refill, NULL);
+
+	c->binary = 0;
+	c->handles = NULL;
+	c->handlecount = 0;
+
 	c->screenlist = LL_new();
+	c->pool = pool_create();
 
-	if (!c->screenlist) {
+	if (!c->screenlist || !c->pool) {
 		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
 		return NULL;
 	}
@@ -83,7 +93,7 @@ client_destroy(Client *c)
 	while ((str = client_get_message(c))) {
 		free(str);
 	}
-	LL_Destroy(c->messages);
+	queue_clear(&c->messages);
 
 	/* Clean up the screenlist...*/
 	debug(RPT_DEBUG, "%s: Cleaning screenlist", __FUNCTION__);
@@ -109,8 +119,7 @@ client_destroy(Client *c)
 	/* Forget client's key reservations */
 	input_release_client_keys(c);
 
-	/* Close the socket */
-	close(c->sock);
+	/* The socket is closed by the I/O thread, see sock_destroy_client_socket() */
 
 	/* Free client's other data */
 	c->state = GONE;
@@ -119,6 +128,10 @@ client_destroy(Client *c)
 	if (c->name)
 		free(c->name);
 
+	/* Release the memory of the screens and widgets in one go */
+	pool_destroy(c->pool);
+	free(c->handles);
+
 	/* Remove structure */
 	free(c);
 
@@ -137,10 +150,12 @@ client_add_message(Client *c, char *message)
 	if (!message)
 		return -1;
 
-	if (strlen(message) > 0) {
+	if (binproto_message_size(message) > 0) {
 		debug(RPT_DEBUG, "%s(c=[%d], message=\"%s\")", __FUNCTION__,
 			c->sock, message);
-		err = LL_Enqueue(c->messages, (void *) message);
+		err = queue_put(&c->messages, (void *) message);
+		if (err == 0)
+			c->queued += binproto_message_size(message);
 	}
 
 	return err;
@@ -157,12 +172,61 @@ client_get_message(Client *c)
 	if (!c)
 		return NULL;
 
-	str = (char *) LL_Dequeue(c->messages);
+	str = (char *) queue_get(&c->messages);
+	if (str != NULL)
+		c->queued -= binproto_message_size(str);
 
 	return str;
 }
 
 
+/** Get the length of the next message in the client's queue.
+ * \param c    The client.
+ * \return     Length of the message; 0 if the queue is empty.
+ */
+int
+client_next_message_size(Client *c)
+{
+	char *str = (char *) queue_peek(&c->messages);
+
+	return (str != NULL) ? binproto_message_size(str) : 0;
+}
+
+
+/** Take a token for one command from the client's token bucket. The
+ * bucket is refilled with ClientCommandRate tokens per second and holds
+ * at most ClientCommandBurst tokens.
+ * \param c    The client.
+ * \param now  Current time.
+ * \retval 1   The client may run a command.
+ * \retval 0   The client is throttled.
+ */
+int
+client_take_token(Client *c, const struct timeval *now)
+{
+	double elapsed;
+
+	if (client_limits.rate <= 0)
+		return 1;
+
+	elapsed = (now->tv_sec - c->refill.tv_sec)
+		  + (now->tv_usec - c->refill.tv_usec) / 1e6;
+	c->refill = *now;
+	/* A clock jump backwards must not be taken as credit */
+	if (elapsed > 0) {
+		c->tokens += elapsed * client_limits.rate;
+		if (c->tokens > client_limits.burst)
+			c->tokens = client_limits.burst;
+	}
+
+	if (c->tokens < 1)
+		return 0;
+
+	c->tokens -= 1;
+	return 1;
+}
+
+
 Screen *
 client_find_screen(Client *c, char *id)
 {
@@ -228,3 +292,66 @@ int client_screen_count(Client *c)
 {
 	return LL_Length(c->screenlist);
 }
+
+
+/** Give a widget of the client a handle, by which binary protocol frames
+ * refer to it. The widget keeps the handle until it is destroyed.
+ * \param c    The client.
+ * \param w    The widget.
+ * \return     The handle; 0 if no handle is left.
+ */
+int
+client_add_handle(Client *c, Widget *w)
+{
+	int h;
+
+	/* Handle 0 means "none", so the table starts at 1 */
+	for (h = 1; h < c->handlecount; h++) {
+		if (c->handles[h] == NULL)
+			break;
+	}
+	if (h >= c->handlecount) {
+		int size = (c->handlecount > 0) ? 2 * c->handlecount : 16;
+		Widget **handles;
+
+		if (size > CLIENT_MAX_HANDLES + 1)
+			size = CLIENT_MAX_HANDLES + 1;
+		if (size <= c->handlecount)
+			return 0;
+		handles = realloc(c->handles, size * sizeof(Widget *));
+		if (handles == NULL)
+			return 0;
+		memset(handles + c->handlecount, 0, (size - c->handlecount) * sizeof(Widget *));
+		c->handles = handles;
+		c->handlecount = size;
+	}
+	c->handles[h] = w;
+	w->handle = h;
+	return h;
+}
+
+
+/** Find the widget with a handle.
+ * \param c       The client.
+ * \param handle  The handle.
+ * \return        The widget; NULL if the handle is not in use.
+ */
+Widget *
+client_find_handle(Client *c, int handle)
+{
+	if ((handle <= 0) || (handle >= c->handlecount))
+		return NULL;
+	return c->handles[handle];
+}
+
+
+/** Release a handle of a widget that is destroyed.
+ * \param c       The client.
+ * \param handle  The handle.
+ */
+void
+client_drop_handle(Client *c, int handle)
+{
+	if ((handle > 0) && (handle < c->handlecount))
+		c->handles[handle] = NULL;
+}
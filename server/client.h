@@ -24,7 +24,9 @@
 #ifndef CLIENT_H_TYPES
 #define CLIENT_H_TYPES
 
+#include <sys/time.h>
 #include "shared/LL.h"
+#include "shared/vector.h"
 
 #define CLIENT_NAME_SIZE 256
 
@@ -43,11 +45,23 @@ typedef struct Client {
 	int sock;
 	int backlight;
 	int heartbeat;
+	int keycount;			/**< Send repeated keys as one message with a count */
 
-	LinkedList *messages;		/**< Messages that the client sent. */
+	Queue messages;			/**< Messages that the client sent. */
 	LinkedList *screenlist;		/**< List of client's screens. */
 
 	void* menu;			/**< Menu hierarchy, if any */
+	struct Pool *pool;		/**< Memory for the client's screens and widgets */
+
+	int widgetcount;		/**< Number of widgets on the client's screens */
+	int queued;			/**< Bytes of messages waiting to be parsed */
+	int deficit;			/**< Bytes the client may have parsed this round */
+	double tokens;			/**< Commands the client may send right now */
+	struct timeval refill;		/**< Time the tokens were last refilled */
+
+	int binary;			/**< Client negotiated the binary protocol */
+	struct Widget **handles;	/**< Widgets by binary protocol handle */
+	int handlecount;		/**< Size of the handle table */
 } Client;
 
 #endif
@@ -75,6 +89,12 @@ int client_add_message(Client *c, char *message);
 /* Get message from queue */
 char *client_get_message(Client *c);
 
+/* Get the length of the next message in the queue */
+int client_next_message_size(Client *c);
+
+/* Take a token for one command; returns 0 if the client is throttled */
+int client_take_token(Client *c, const struct timeval *now);
+
 /* Find a named screen for the client */
 Screen *client_find_screen(Client *c, char *id);
 
@@ -84,5 +104,17 @@ int client_remove_screen(Client *c, Screen *s);
 
 int client_screen_count(Client *c);
 
+/** Most handles a client can have; they are 16 bit numbers */
+#define CLIENT_MAX_HANDLES	65535
+
+/* Give a widget a handle for the binary protocol */
+int client_add_handle(Client *c, struct Widget *w);
+
+/* Find the widget with a binary protocol handle */
+struct Widget *client_find_handle(Client *c, int handle);
+
+/* Release a binary protocol handle */
+void client_drop_handle(Client *c, int handle);
+
 #endif
 #endif
@@ -20,12 +20,28 @@
 #include <string.h>
 
 #include "shared/report.h"
-#include "shared/LL.h"
+#include "shared/vector.h"
+#include "shared/configfile.h"
 #include "client.h"
 #include "clients.h"
 #include "render.h"
 
-LinkedList *clientlist = NULL;
+/** Default for ClientMaxQueue: bytes of unparsed messages per client */
+#define DEFAULT_CLIENT_MAX_QUEUE	65536
+
+static Vector clientlist;
+static int clients_ready = 0;
+
+ClientLimits client_limits;
+
+/* Read a limit from the config file; negative values mean unlimited */
+static int
+clients_get_limit(const char *key, int default_value)
+{
+	int value = config_get_int("Server", key, 0, default_value);
+
+	return (value > 0) ? value : 0;
+}
 
 /* Initialize and kill client list...*/
 int
@@ -33,11 +49,26 @@ clients_init(void)
 {
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	clientlist = LL_new();
-	if (!clientlist) {
-		report(RPT_ERR, "%s: Unable to create client list", __FUNCTION__);
-		return -1;
-	}
+	vector_init(&clientlist);
+	clients_ready = 1;
+
+	/* Read the limits that keep a single client from hogging the server */
+	client_limits.clients = clients_get_limit("MaxClients", 0);
+	client_limits.screens = clients_get_limit("ClientMaxScreens", 0);
+	client_limits.widgets = clients_get_limit("ClientMaxWidgets", 0);
+	client_limits.menuitems = clients_get_limit("ClientMaxMenuItems", 0);
+	client_limits.keys = clients_get_limit("ClientMaxKeys", 0);
+	client_limits.queue = clients_get_limit("ClientMaxQueue", DEFAULT_CLIENT_MAX_QUEUE);
+	client_limits.rate = config_get_float("Server", "ClientCommandRate", 0, 0);
+	if (client_limits.rate < 0)
+		client_limits.rate = 0;
+	client_limits.burst = config_get_float("Server", "ClientCommandBurst", 0, client_limits.rate);
+	if (client_limits.burst < 1)
+		client_limits.burst = 1;
+
+	if (client_limits.rate > 0)
+		report(RPT_INFO, "Clients are limited to %g commands per second (burst %g)",
+		       client_limits.rate, client_limits.burst);
 
 	return 0;
 }
@@ -46,16 +77,17 @@ int
 clients_shutdown(void)
 {
 	Client *c;
+	int i;
 
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	if (!clientlist) {
+	if (!clients_ready) {
 		/* Program shutdown before completed startup */
 		return -1;
 	}
 
 	/* Free all client structures... */
-	for (c = LL_GetFirst(clientlist); c; c = LL_GetNext(clientlist)) {
+	for (i = 0; (c = vector_get(&clientlist, i)) != NULL; i++) {
 		debug(RPT_DEBUG, "%s: ...", __FUNCTION__);
 		if (c) {
 			debug(RPT_DEBUG, "%s: ... %i ...", __FUNCTION__, c->sock);
@@ -70,7 +102,8 @@ clients_shutdown(void)
 	}
 
 	/* Then, free the list...*/
-	LL_Destroy(clientlist);
+	vector_clear(&clientlist);
+	clients_ready = 0;
 
 	debug(RPT_DEBUG, "%s: done", __FUNCTION__);
 
@@ -81,37 +114,30 @@ clients_shutdown(void)
 Client *
 clients_add_client(Client *c)
 {
-	if (LL_Push(clientlist, c) == 0)
+	if (vector_push(&clientlist, c) == 0)
 		return c;
 
 	return NULL;
 }
 
-/* Remove the client from the clients list... */
-Client *
-clients_remove_client(Client *c, Direction whereto)
-{
-	Client *client = LL_Remove(clientlist, c, whereto);
-
-	return client;
-}
-
+/* Remove the client from the clients list; the clients after it move
+ * up by one index */
 Client *
-clients_getfirst(void)
+clients_remove_client(Client *c)
 {
-	return (Client *) LL_GetFirst(clientlist);
+	return (vector_remove(&clientlist, c) >= 0) ? c : NULL;
 }
 
 Client *
-clients_getnext(void)
+clients_get(int index)
 {
-	return (Client *) LL_GetNext(clientlist);
+	return (Client *) vector_get(&clientlist, index);
 }
 
 int
 clients_client_count(void)
 {
-	return LL_Length(clientlist);
+	return vector_count(&clientlist);
 }
 
 
@@ -123,10 +149,11 @@ Client *
 clients_find_client_by_sock(int sock)
 {
 	Client *c;
+	int i;
 
 	debug(RPT_DEBUG, "%s(sock=%i)", __FUNCTION__, sock);
 
-	for (c = LL_GetFirst(clientlist); c; c = LL_GetNext(clientlist)) {
+	for (i = 0; (c = vector_get(&clientlist, i)) != NULL; i++) {
 		if (c->sock == sock) {
 			return c;
 		}
@@ -15,17 +15,30 @@
 
 #include "client.h"
 
+/** Limits on clients and their resources; 0 means unlimited. */
+typedef struct ClientLimits {
+	int clients;		/**< Connected clients */
+	int screens;		/**< Screens per client */
+	int widgets;		/**< Widgets per client, on all its screens */
+	int menuitems;		/**< Menu items per client */
+	int keys;		/**< Key reservations per client */
+	int queue;		/**< Bytes of unparsed messages per client */
+	double rate;		/**< Commands per second per client */
+	double burst;		/**< Commands a client may send at once */
+} ClientLimits;
+
+extern ClientLimits client_limits;
+
 /* Initialize and kill client list...*/
 int clients_init(void);
 int clients_shutdown(void);
 
 /* Add/remove clients (return NULL for error) */
 Client *clients_add_client(Client *c);
-Client *clients_remove_client(Client *c, Direction whereto);
+Client *clients_remove_client(Client *c);
 
-/* List functions */
-Client *clients_getfirst(void);
-Client *clients_getnext(void);
+/* List functions; clients are visited by index */
+Client *clients_get(int index);
 int clients_client_count(void);
 
 /* Search for a client with a particular filedescriptor...*/
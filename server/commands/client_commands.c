@@ -26,9 +26,11 @@
 
 #include "shared/report.h"
 #include "shared/sockets.h"
+#include "shared/binproto.h"
 
 #include "drivers.h"
 #include "client.h"
+#include "clients.h"
 #include "render.h"
 #include "input.h"
 #include "client_commands.h"
@@ -53,9 +55,11 @@ test_func_func(Client *c, int argc, char **argv)
  * The client must say "hello" before doing anything else.
  *
  * It sends back a string of info about the server to the client.
+ * With -binary the client may also send frames of the binary protocol
+ * (see shared/binproto.h) and the reply ends with its version.
  *
  *\verbatim
- * Usage: hello
+ * Usage: hello [-binary]
  *\endverbatim
  *
  * \todo  Give \em real info about the server/lcd
@@ -63,16 +67,31 @@ test_func_func(Client *c, int argc, char **argv)
 int
 hello_func(Client *c, int argc, char **argv)
 {
-	if (argc > 1) {
+	int binary = 0;
+
+	if ((argc == 2) && (strcmp(argv[1], "-binary") == 0)) {
+		binary = 1;
+	}
+	else if (argc > 1) {
 		sock_send_error(c->sock, "extra parameters ignored\n");
 	}
 
 	debug(RPT_INFO, "Hello!");
 
-	sock_printf(c->sock, "connect LCDproc %s protocol %s lcd wid %i hgt %i cellwid %i cellhgt %i\n",
-		VERSION, PROTOCOL_VERSION,
-		display_props->width, display_props->height,
-		display_props->cellwidth, display_props->cellheight);
+	if (binary) {
+		sock_printf(c->sock, "connect LCDproc %s protocol %s lcd wid %i hgt %i cellwid %i cellhgt %i binary %i\n",
+			VERSION, PROTOCOL_VERSION,
+			display_props->width, display_props->height,
+			display_props->cellwidth, display_props->cellheight,
+			BIN_PROTOCOL_VERSION);
+	}
+	else {
+		sock_printf(c->sock, "connect LCDproc %s protocol %s lcd wid %i hgt %i cellwid %i cellhgt %i\n",
+			VERSION, PROTOCOL_VERSION,
+			display_props->width, display_props->height,
+			display_props->cellwidth, display_props->cellheight);
+	}
+	c->binary = binary;
 
 	/* make note that client has sent hello */
 	c->state = ACTIVE;
@@ -105,7 +124,7 @@ bye_func(Client *c, int argc, char **argv)
  * Sets info about the client, such as its name
  *
  *\verbatim
- * Usage: client_set -name <id>
+ * Usage: client_set {-name <id>|-keycount {on|off}}
  *\endverbatim
  */
 int
@@ -117,7 +136,7 @@ client_set_func(Client *c, int argc, char **argv)
 		return 1;
 
 	if (argc != 3) {
-		sock_send_error(c->sock, "Usage: client_set -name <name>\n");
+		sock_send_error(c->sock, "Usage: client_set {-name <name>|-keycount {on|off}}\n");
 		return 0;
 	}
 
@@ -151,6 +170,28 @@ client_set_func(Client *c, int argc, char **argv)
 				i++; /* bypass argument (name string)*/
 			}
 		}
+		/* Handle the "keycount" option */
+		else if (strcmp(p, "keycount") == 0) {
+			i++;
+			if (argv[i] == NULL) {
+				sock_printf_error(c->sock, "internal error: no parameter #%d\n", i);
+				continue;
+			}
+
+			debug(RPT_DEBUG, "client_set: keycount=\"%s\"", argv[i]);
+
+			if (strcmp(argv[i], "on") == 0) {
+				c->keycount = 1;
+				sock_send_string(c->sock, "success\n");
+			}
+			else if (strcmp(argv[i], "off") == 0) {
+				c->keycount = 0;
+				sock_send_string(c->sock, "success\n");
+			}
+			else {
+				sock_send_error(c->sock, "keycount must be on or off\n");
+			}
+		}
 		else {
 			sock_printf_error(c->sock, "invalid parameter (%s)\n", p);
 		}
@@ -195,6 +236,10 @@ client_add_key_func(Client *c, int argc, char **argv)
 		argnr++;
 	}
 	for ( ; argnr < argc; argnr++) {
+		if ((client_limits.keys > 0) && (input_count_client_keys(c) >= client_limits.keys)) {
+			sock_printf_error(c->sock, "Too many keys, could not reserve key \"%s\"\n", argv[argnr]);
+			continue;
+		}
 		if (input_reserve_key(argv[argnr], exclusively, c) < 0) {
 			sock_printf_error(c->sock, "Could not reserve key \"%s\"\n", argv[argnr]);
 		}
@@ -36,6 +36,8 @@ static client_function commands[] = {
 	{ "widget_add",     widget_add_func     },
 	{ "widget_del",     widget_del_func     },
 	{ "widget_set",     widget_set_func     },
+	{ "widget_animate", widget_animate_func },
+	{ "widget_push",    widget_push_func    },
 	{ "menu_add_item",  menu_add_item_func  },
 	{ "menu_del_item",  menu_del_item_func  },
 	{ "menu_set_item",  menu_set_item_func  },
@@ -32,6 +32,7 @@
 #include "shared/sockets.h"
 
 #include "client.h"
+#include "clients.h"
 #include "menuitem.h"
 #include "menu.h"
 #include "menuscreens.h"
@@ -43,6 +44,22 @@ int set_predecessor(MenuItem *item, char *itemid, Client *client);
 int set_successor(MenuItem *item, char *itemid, Client *client);
 
 
+/* Count the items in a menu and its submenus */
+static int
+menu_count_items(Menu *menu)
+{
+	MenuItem *item;
+	int count = 0;
+
+	for (item = menu_getfirst_item(menu); item != NULL; item = menu_getnext_item(menu)) {
+		count++;
+		if (item->type == MENUITEM_MENU)
+			count += menu_count_items(item);
+	}
+	return count;
+}
+
+
 /**
  * Adds an item to a menu.
  *
@@ -125,6 +142,11 @@ menu_add_item_func(Client *c, int argc, char **argv)
 		return 0;
 	}
 
+	if ((client_limits.menuitems > 0) && (menu_count_items(c->menu) >= client_limits.menuitems)) {
+		sock_send_error(c->sock, "Too many menu items\n");
+		return 0;
+	}
+
 	/* Find menuitem type */
 	itemtype = menuitem_typename_to_type(argv[3]);
 	if (itemtype == MENUITEM_INVALID) {
@@ -28,8 +28,12 @@
 #include "shared/sockets.h"
 
 #include "client.h"
+#include "clients.h"
 #include "screen.h"
 #include "render.h"
+#include "pool.h"
+#include "shmscreen.h"
+#include "sock.h"
 #include "screen_commands.h"
 
 /**
@@ -61,6 +65,11 @@ screen_add_func(Client *c, int argc, char **argv)
 		return 0;
 	}
 
+	if ((client_limits.screens > 0) && (client_screen_count(c) >= client_limits.screens)) {
+		sock_send_error(c->sock, "Too many screens\n");
+		return 0;
+	}
+
 	s = screen_create(argv[1], c);
 	if (s == NULL) {
 		sock_send_error(c->sock, "failed to create screen\n");
@@ -133,6 +142,7 @@ screen_del_func(Client *c, int argc, char **argv)
  *     [-priority <prio>] [-duration <int>] [-timeout <int>]
  *     [-heartbeat <type>] [-backlight <type>]
  *     [-cursor <type>] [-cursor_x <xpos>] [-cursor_y <ypos>]
+ *     [-shm <name>]
  *\endverbatim
  */
 int
@@ -153,7 +163,8 @@ screen_set_func(Client *c, int argc, char **argv)
 				" [-duration <int>] [-timeout <int>]"
 				" [-heartbeat <type>] [-backlight <type>]"
 				" [-cursor <type>]"
-				" [-cursor_x <xpos>] [-cursor_y <ypos>]\n");
+				" [-cursor_x <xpos>] [-cursor_y <ypos>]"
+				" [-shm <name>]\n");
 		return 0;
 	}
 	else if (argc == 2) {
@@ -182,9 +193,8 @@ screen_set_func(Client *c, int argc, char **argv)
 				debug(RPT_DEBUG, "screen_set: name=\"%s\"", argv[i]);
 
 				/* set the name...*/
-				if (s->name != NULL)
-					free(s->name);
-				s->name = strdup(argv[i]);
+				pool_free(c->pool, s->name);
+				s->name = pool_strdup(c->pool, argv[i]);
 				sock_send_string(c->sock, "success\n");
 			}
 			else {
@@ -408,6 +418,30 @@ screen_set_func(Client *c, int argc, char **argv)
 				sock_send_error(c->sock, "-cursor_y requires a parameter\n");
 			}
 		}
+		/* Handle the "shm" parameter */
+		else if (strcmp(p, "shm") == 0) {
+			if (argc > i + 1) {
+				i++;
+				debug(RPT_DEBUG, "screen_set: shm=\"%s\"", argv[i]);
+
+				if (argv[i][0] == '\0') {
+					shmscreen_detach(s);
+					sock_send_string(c->sock, "success\n");
+				}
+				else if (!sock_client_is_local(c)) {
+					sock_send_error(c->sock, "-shm is only allowed for local clients\n");
+				}
+				else if (shmscreen_attach(s, argv[i]) < 0) {
+					sock_send_error(c->sock, "Cannot attach shared memory\n");
+				}
+				else {
+					sock_send_string(c->sock, "success\n");
+				}
+			}
+			else {
+				sock_send_error(c->sock, "-shm requires a parameter\n");
+			}
+		}
 
 		else sock_send_error(c->sock, "invalid parameter\n");
 	}/* done checking argv*/
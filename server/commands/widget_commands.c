@@ -28,6 +28,7 @@
 #include "shared/sockets.h"
 
 #include "client.h"
+#include "clients.h"
 #include "screen.h"
 #include "widget.h"
 #include "drivers.h"
@@ -35,7 +36,8 @@
 
 
 /**
- * Adds a widget to a screen, but doesn't give it a value
+ * Adds a widget to a screen, but doesn't give it a value.
+ * Clients using the binary protocol get the widget's handle in the reply.
  *
  *\verbatim
  * Usage: widget_add <screenid> <widgetid> <widgettype> [-in <id>]
@@ -105,6 +107,11 @@ widget_add_func(Client *c, int argc, char **argv)
 		}
 	}
 
+	if ((client_limits.widgets > 0) && (c->widgetcount >= client_limits.widgets)) {
+		sock_send_error(c->sock, "Too many widgets\n");
+		return 0;
+	}
+
 	/* Create the widget */
 	w = widget_create(wid, wtype, s);
 	if (w == NULL) {
@@ -114,10 +121,19 @@ widget_add_func(Client *c, int argc, char **argv)
 
 	/* Add the widget to the screen */
 	err = screen_add_widget(s, w);
-	if (err == 0)
-		sock_send_string(c->sock, "success\n");
-	else
+	if (err != 0)
 		sock_send_error(c->sock, "Error adding widget\n");
+	else if (!c->binary)
+		sock_send_string(c->sock, "success\n");
+	else {
+		/* Binary protocol clients get the handle of the widget */
+		int handle = client_add_handle(c, w);
+
+		if (handle > 0)
+			sock_printf(c->sock, "success %d\n", handle);
+		else
+			sock_send_error(c->sock, "No widget handle left\n");
+	}
 
 	return 0;
 }
@@ -164,9 +180,12 @@ widget_del_func(Client *c, int argc, char **argv)
 		return 0;
 	}
 
-	err = screen_remove_widget(s, w);
-	if (err == 0)
+	/* The widget may be in a frame, i.e. on the frame's screen */
+	err = screen_remove_widget(w->screen, w);
+	if (err == 0) {
+		widget_destroy(w);
 		sock_send_string(c->sock, "success\n");
+	}
 	else
 		sock_send_error(c->sock, "Error removing widget\n");
 
@@ -177,6 +196,19 @@ static int not_direction(char c) {
 	return c != 'h' && c != 'v';
 }
 
+/** Compare the numeric attributes of two widgets */
+static int
+widget_geometry_equal(const Widget *a, const Widget *b)
+{
+	return (a->x == b->x) && (a->y == b->y)
+		&& (a->width == b->width) && (a->height == b->height)
+		&& (a->left == b->left) && (a->top == b->top)
+		&& (a->right == b->right) && (a->bottom == b->bottom)
+		&& (a->length == b->length) && (a->speed == b->speed)
+		&& (a->promille == b->promille);
+}
+
+
 /**
  * Configures information about a widget, such as its size, shape,
  * contents, position, speed, etc.
@@ -191,9 +223,11 @@ widget_set_func(Client *c, int argc, char **argv)
 	int i;
 	char *wid;
 	char *sid;
+	int changed = 0;
 
 	Screen *s;
 	Widget *w;
+	Widget old;
 
 	if (c->state != ACTIVE)
 		return 1;
@@ -230,6 +264,8 @@ widget_set_func(Client *c, int argc, char **argv)
 		}
 		return 0;
 	}
+	/* Remember the current state to tell whether anything changes */
+	old = *w;
 	i = 3;
 	switch (w->type) {
 	case WID_STRING:		/* String takes "x y text" */
@@ -246,8 +282,7 @@ widget_set_func(Client *c, int argc, char **argv)
 
 		w->x = atoi(argv[i]);
 		w->y = atoi(argv[i + 1]);
-		free(w->text);
-		w->text = strdup(argv[i + 2]);
+		changed |= (widget_set_string(w, &w->text, argv[i + 2]) > 0);
 		debug(RPT_DEBUG, "Widget %s set to %s", wid, w->text);
 
 		break;
@@ -298,18 +333,12 @@ widget_set_func(Client *c, int argc, char **argv)
 			sock_send_error(c->sock, "Invalid coordinates\n");
 			return 0;
 		}
-		free(w->begin_label);
-		free(w->end_label);
-		w->begin_label = NULL;
-		w->end_label = NULL;
 		w->x = atoi(argv[i]);
 		w->y = atoi(argv[i + 1]);
 		w->width = atoi(argv[i + 2]);
 		w->promille = atoi(argv[i + 3]);
-		if (argc >= i + 5)
-			w->begin_label = strdup(argv[i + 4]);
-		if (argc >= i + 6)
-			w->end_label = strdup(argv[i + 5]);
+		changed |= (widget_set_string(w, &w->begin_label, (argc >= i + 5) ? argv[i + 4] : NULL) > 0);
+		changed |= (widget_set_string(w, &w->end_label, (argc >= i + 6) ? argv[i + 5] : NULL) > 0);
 		debug(RPT_DEBUG, "Widget %s set to %i", wid, w->promille);
 
 		break;
@@ -343,8 +372,7 @@ widget_set_func(Client *c, int argc, char **argv)
 			return 0;
 		}
 
-		free(w->text);
-		w->text = strdup(argv[i]);
+		changed |= (widget_set_string(w, &w->text, argv[i]) > 0);
 		/* Set width too */
 		w->width = display_props->width;
 		debug(RPT_DEBUG, "Widget %s set to %s", wid, w->text);
@@ -376,8 +404,7 @@ widget_set_func(Client *c, int argc, char **argv)
 		w->bottom = atoi(argv[i + 3]);
 		w->length = argv[i + 4][0];
 		w->speed = atoi(argv[i + 5]);
-		free(w->text);
-		w->text = strdup(argv[i + 6]);
+		changed |= (widget_set_string(w, &w->text, argv[i + 6]) > 0);
 		debug(RPT_DEBUG, "Widget %s set to %s", wid, w->text);
 
 		break;
@@ -433,6 +460,33 @@ widget_set_func(Client *c, int argc, char **argv)
 
 		debug(RPT_DEBUG, "Widget %s set to %i", wid, w->y);
 
+		break;
+	case WID_GRAPH:			/* Graph takes "x y width height" */
+		if (argc != i + 4) {
+			sock_send_error(c->sock, "Wrong number of arguments\n");
+			return 0;
+		}
+		if ((!isdigit((unsigned int) argv[i][0])) ||
+		    (!isdigit((unsigned int) argv[i + 1][0]))) {
+			sock_send_error(c->sock, "Invalid coordinates\n");
+			return 0;
+		}
+		if ((atoi(argv[i + 2]) <= 0) || (atoi(argv[i + 3]) <= 0)) {
+			sock_send_error(c->sock, "Invalid size\n");
+			return 0;
+		}
+		if (widget_resize_history(w, atoi(argv[i + 2])) < 0) {
+			sock_send_error(c->sock, "Error allocating graph\n");
+			return 0;
+		}
+
+		w->x = atoi(argv[i]);
+		w->y = atoi(argv[i + 1]);
+		w->width = atoi(argv[i + 2]);
+		w->height = atoi(argv[i + 3]);
+
+		debug(RPT_DEBUG, "Widget %s set to %ix%i", wid, w->width, w->height);
+
 		break;
 	case WID_NONE:
 	default:
@@ -440,7 +494,156 @@ widget_set_func(Client *c, int argc, char **argv)
 		return 0;
 	}
 
+	/* Values set by the client replace a server-side animation */
+	widget_stop_animation(w);
+
+	/*
+	 * Clients tend to resend the same values on every update. Only a
+	 * real change counts, so a static screen keeps its generation.
+	 */
+	if (changed || !widget_geometry_equal(&old, w))
+		widget_touch(w);
+	else
+		debug(RPT_DEBUG, "Widget %s unchanged", wid);
+
 	sock_send_string(c->sock, "success\n");
 	return 0;
 }
 
+
+
+/**
+ * Leaves the updates of a widget to the server. The server either formats
+ * the text of a string, title or scroller widget from a strftime()
+ * template, or steps the widget through a sequence of values, each shown
+ * for a number of rendering ticks (1/8 second). The values have the
+ * meaning of the last widget_set parameter for the widget's type, e.g. the
+ * length of a bar or the name of an icon. The next widget_set stops the
+ * animation.
+ *
+ *\verbatim
+ * widget_animate <screenid> <widgetid> -format <template>
+ * widget_animate <screenid> <widgetid> -sequence <ticks> <value> ...
+ * widget_animate <screenid> <widgetid> -off
+ *\endverbatim
+ */
+int
+widget_animate_func(Client *c, int argc, char **argv)
+{
+	Screen *s;
+	Widget *w;
+
+	if (c->state != ACTIVE)
+		return 1;
+
+	if (argc < 4) {
+		sock_send_error(c->sock, "Usage: widget_animate <screenid> <widgetid> {-format <template>|-sequence <ticks> <value> ...|-off}\n");
+		return 0;
+	}
+
+	s = client_find_screen(c, argv[1]);
+	if (s == NULL) {
+		sock_send_error(c->sock, "Unknown screen id\n");
+		return 0;
+	}
+	w = screen_find_widget(s, argv[2]);
+	if (w == NULL) {
+		sock_send_error(c->sock, "Unknown widget id\n");
+		return 0;
+	}
+
+	if (strcmp(argv[3], "-format") == 0) {
+		if (argc != 5) {
+			sock_send_error(c->sock, "Wrong number of arguments\n");
+			return 0;
+		}
+		if (widget_set_format(w, argv[4]) < 0) {
+			sock_send_error(c->sock, "Widget cannot show a formatted time\n");
+			return 0;
+		}
+	}
+	else if (strcmp(argv[3], "-sequence") == 0) {
+		if (argc < 6) {
+			sock_send_error(c->sock, "Wrong number of arguments\n");
+			return 0;
+		}
+		if (!isdigit((unsigned int) argv[4][0]) || (atoi(argv[4]) <= 0)) {
+			sock_send_error(c->sock, "Invalid interval\n");
+			return 0;
+		}
+		if (widget_set_sequence(w, atoi(argv[4]), argc - 5, argv + 5) < 0) {
+			sock_send_error(c->sock, "Invalid value in sequence\n");
+			return 0;
+		}
+	}
+	else if (strcmp(argv[3], "-off") == 0) {
+		widget_stop_animation(w);
+	}
+	else {
+		sock_send_error(c->sock, "Unknown animation\n");
+		return 0;
+	}
+
+	debug(RPT_DEBUG, "Widget %s animation set (%s)", argv[2], argv[3]);
+	sock_send_string(c->sock, "success\n");
+	return 0;
+}
+
+
+/**
+ * Appends samples to a graph widget. The server keeps the last samples,
+ * one for each column of the graph, and shifts the graph itself, so a
+ * client sends one value per update instead of a whole row of vbars.
+ * Samples are in promille of the graph's height.
+ *
+ *\verbatim
+ * widget_push <screenid> <widgetid> <value> [<value> ...]
+ *\endverbatim
+ */
+int
+widget_push_func(Client *c, int argc, char **argv)
+{
+	Screen *s;
+	Widget *w;
+	int i;
+
+	if (c->state != ACTIVE)
+		return 1;
+
+	if (argc < 4) {
+		sock_send_error(c->sock, "Usage: widget_push <screenid> <widgetid> <value> [<value> ...]\n");
+		return 0;
+	}
+
+	s = client_find_screen(c, argv[1]);
+	if (s == NULL) {
+		sock_send_error(c->sock, "Unknown screen id\n");
+		return 0;
+	}
+	w = screen_find_widget(s, argv[2]);
+	if (w == NULL) {
+		sock_send_error(c->sock, "Unknown widget id\n");
+		return 0;
+	}
+	if (w->type != WID_GRAPH) {
+		sock_send_error(c->sock, "Widget is not a graph\n");
+		return 0;
+	}
+	if (w->history == NULL) {
+		sock_send_error(c->sock, "Graph has no size\n");
+		return 0;
+	}
+
+	for (i = 3; i < argc; i++) {
+		if (!isdigit((unsigned int) argv[i][0])) {
+			sock_send_error(c->sock, "Invalid value\n");
+			return 0;
+		}
+	}
+	for (i = 3; i < argc; i++)
+		widget_push_sample(w, atoi(argv[i]));
+	widget_touch(w);
+
+	sock_send_string(c->sock, "success\n");
+	return 0;
+}
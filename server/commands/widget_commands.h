@@ -15,5 +15,7 @@
 int widget_add_func(Client *c, int argc, char **argv);
 int widget_del_func(Client *c, int argc, char **argv);
 int widget_set_func(Client *c, int argc, char **argv);
+int widget_animate_func(Client *c, int argc, char **argv);
+int widget_push_func(Client *c, int argc, char **argv);
 
 #endif
@@ -358,6 +358,25 @@ drivers_heartbeat(int state)
 }
 
 
+/**
+ * Check whether a driver draws the heartbeat itself. If none does, the
+ * heartbeat icon only depends on the timer (see driver_alt_heartbeat()).
+ * \retval 1  A driver has its own heartbeat() function.
+ * \retval 0  All drivers leave the heartbeat to the server core.
+ */
+int
+drivers_own_heartbeat(void)
+{
+	Driver *drv;
+
+	ForAllDrivers(drv) {
+		if (drv->heartbeat)
+			return 1;
+	}
+	return 0;
+}
+
+
 /**
  * Write icon to all drivers.
  * For drivers that define a icon() function, call it;
@@ -391,6 +410,28 @@ drivers_icon(int x, int y, int icon)
 }
 
 
+/**
+ * Define a custom character on all drivers.
+ * Call set_char() function of all drivers that have a set_char() function
+ * defined and at least \c n + 1 custom characters.
+ * \param n        Number of the custom character.
+ * \param dat      Rows of the character starting from the top, at least
+ *                 as many as the cells of the drivers are high.
+ */
+void
+drivers_set_char(int n, unsigned char *dat)
+{
+	Driver *drv;
+
+	debug(RPT_DEBUG, "%s(n=%d)", __FUNCTION__, n);
+
+	ForAllDrivers(drv) {
+		if (drv->set_char && drv->get_free_chars && (n < drv->get_free_chars(drv)))
+			drv->set_char(drv, n, dat);
+	}
+}
+
+
 /**
  * Set cursor on all loaded drivers.
  * For drivers that define a cursor() function, call it;
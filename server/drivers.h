@@ -58,11 +58,14 @@ drivers_num(int x, int num);
 void
 drivers_heartbeat(int state);
 
+int
+drivers_own_heartbeat(void);
+
 void
 drivers_icon(int x, int y, int icon);
 
 void
-drivers_set_char(char ch, char *dat);
+drivers_set_char(int n, unsigned char *dat);
 
 int
 drivers_get_contrast(void);
@@ -44,6 +44,7 @@
 #include "lcd_lib.h"
 #include "CFontz-charmap.h"
 #include "adv_bignum.h"
+#include "serial_io.h"
 
 
 /* Constants for userdefchar_mode */
@@ -53,7 +54,7 @@
 typedef struct CFontz_private_data {
 	char device[200];
 
-	int fd;
+	SerialPort *port;
 
 	int model;
 	int newfirmware;
@@ -102,7 +103,6 @@ static void CFontz_raw_chr(Driver *drvthis, int x, int y, unsigned char c);
 MODULE_EXPORT int
 CFontz_init(Driver *drvthis)
 {
-	struct termios portset;
 	int tmp, w, h;
 	int reboot = 0;
 	int usb = 0;
@@ -119,7 +119,7 @@ CFontz_init(Driver *drvthis)
 		return -1;
 
 	/* Initialize the PrivateData structure */
-	p->fd = -1;
+	p->port = NULL;
 	p->cellwidth = DEFAULT_CELL_WIDTH;
 	p->cellheight = DEFAULT_CELL_HEIGHT;
 	p->ccmode = standard;
@@ -195,40 +195,11 @@ CFontz_init(Driver *drvthis)
 	usb = drvthis->config_get_bool(drvthis->name, "USB", 0, 0);
 
 	/* Set up io port correctly, and open it... */
-	debug(RPT_DEBUG, "CFontz: Opening device: %s", p->device);
-	p->fd = open(p->device, (usb) ? (O_RDWR | O_NOCTTY) : (O_RDWR | O_NOCTTY | O_NDELAY));
-	if (p->fd == -1) {
-		report(RPT_ERR, "%s: open(%s) failed (%s)",
-				drvthis->name, p->device, strerror(errno));
+	p->port = serial_open(drvthis->name, p->device, speed, (usb) ? 0 : SERIAL_NONBLOCK);
+	if (p->port == NULL)
 		return -1;
-	}
-
-	tcgetattr(p->fd, &portset);
-
-	/* We use RAW mode */
-#ifdef HAVE_CFMAKERAW
-	/* The easy way */
-	cfmakeraw(&portset);
-#else
-	/* The hard way */
-	portset.c_iflag &= ~( IGNBRK | BRKINT | PARMRK | ISTRIP
-				| INLCR | IGNCR | ICRNL | IXON );
-	portset.c_oflag &= ~OPOST;
-	portset.c_lflag &= ~( ECHO | ECHONL | ICANON | ISIG | IEXTEN );
-	portset.c_cflag &= ~( CSIZE | PARENB | CRTSCTS );
-	portset.c_cflag |= CS8 | CREAD | CLOCAL ;
-#endif
-	if (usb) {
-		portset.c_cc[VMIN] = 1;
-		portset.c_cc[VTIME] = 3;
-	}
-
-	/* Set port speed */
-	cfsetospeed(&portset, speed);
-	cfsetispeed(&portset, B0);
-
-	/* Do it... */
-	tcsetattr(p->fd, TCSANOW, &portset);
+	if (usb)
+		serial_set_timeouts(p->port, 1, 3);
 
 	/* make sure the frame buffer is there... */
 	p->framebuf = (unsigned char *) malloc(p->width * p->height);
@@ -268,8 +239,7 @@ CFontz_close(Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 
 	if (p != NULL) {
-		if (p->fd >= 0)
-			close(p->fd);
+		serial_close(p->port);
 
 		if (p->framebuf)
 			free(p->framebuf);
@@ -374,7 +344,7 @@ CFontz_flush(Driver *drvthis)
 				}
 				*ptr++ = c;
 			}
-			write(p->fd, out, (ptr - out));
+			serial_write(p->port, out, (ptr - out));
 		}
 	}
 	else {
@@ -388,9 +358,11 @@ CFontz_flush(Driver *drvthis)
 			/* move cursor to start of (i+1)'th line */
 			CFontz_cursor_goto(drvthis, 1, i+1);
 
-			write(p->fd, p->framebuf + (p->width * i), p->width);
+			serial_write(p->port, p->framebuf + (p->width * i), p->width);
 		}
 	}
+
+	serial_flush(p->port);
 }
 
 
@@ -474,7 +446,7 @@ CFontz_set_contrast(Driver *drvthis, int promille)
 
 	// And do it (converted from [0,1000] - > [0,100])
 	out[1] = (unsigned char) (promille / 10);
-	write(p->fd, out, 2);
+	serial_write(p->port, out, 2);
 }
 
 
@@ -533,7 +505,7 @@ CFontz_backlight(Driver *drvthis, int on)
 
 	/* map range [0, 1000] -> [0, 100] that the hardware understands */
 	out[1] = (unsigned char) (promille / 10);
-	write(p->fd, out, 2);
+	serial_write(p->port, out, 2);
 }
 
 
@@ -549,7 +521,7 @@ CFontz_linewrap(Driver *drvthis, int on)
 	char out[4];
 
 	out[0] = (on) ? CFONTZ_Wrap_On : CFONTZ_Wrap_Off;
-	write(p->fd, out, 1);
+	serial_write(p->port, out, 1);
 }
 
 
@@ -565,7 +537,7 @@ CFontz_autoscroll(Driver *drvthis, int on)
 	char out[4];
 
 	out[0] = (on) ? CFONTZ_Scroll_On : CFONTZ_Scroll_Off;
-	write(p->fd, out, 1);
+	serial_write(p->port, out, 1);
 }
 
 
@@ -579,7 +551,7 @@ CFontz_hidecursor(Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 	char out[4] = { CFONTZ_Hide_Cursor };
 
-	write(p->fd, out, 1);
+	serial_write(p->port, out, 1);
 }
 
 
@@ -593,7 +565,8 @@ CFontz_reboot(Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 	char out[4] = { CFONTZ_Reboot, CFONTZ_Reboot };
 
-	write(p->fd, out, 2);
+	serial_write(p->port, out, 2);
+	serial_flush(p->port);
 	sleep(4);
 }
 
@@ -615,7 +588,7 @@ CFontz_cursor_goto(Driver *drvthis, int x, int y)
 		out[1] = (unsigned char) (x - 1);
 	if ((y > 0) && (y <= p->height))
 		out[2] = (unsigned char) (y - 1);
-	write(p->fd, out, 3);
+	serial_write(p->port, out, 3);
 }
 
 
@@ -774,7 +747,7 @@ CFontz_set_char(Driver *drvthis, int n, unsigned char *dat)
 	for (row = 0; row < p->cellheight; row++) {
 		out[2+row] = dat[row] & mask;
 	}
-	write(p->fd, out, 2 + p->cellheight);
+	serial_write(p->port, out, 2 + p->cellheight);
 }
 
 
@@ -942,7 +915,7 @@ CFontz_cursor(Driver *drvthis, int x, int y, int state)
 			stylecmd[0] = CFONTZ_Show_Block_Cursor;
 			break;
 	}
-	write(p->fd, stylecmd, 1);
+	serial_write(p->port, stylecmd, 1);
 
 	/* set cursor position */
 	CFontz_cursor_goto(drvthis, x, y);
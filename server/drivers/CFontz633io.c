@@ -2,6 +2,17 @@
  * I/O routines for the \c CFontzPacket driver. Currently the CFA-631,
  * CFA-533, CFA-633 and CFA-635 LCDs use this type of protocol.
  *
+ * Packets are not sent in stop-and-wait fashion: up to
+ * \c CFONTZ633_ACK_WINDOW packets may be in flight while their
+ * acknowledgements are matched asynchronously by command type. Key reports
+ * are picked out of the same input stream.
+ *
+ * Output goes through the buffered serial transport (serial_io.c), which
+ * finishes short writes itself. If the port stalls, the transport gives up
+ * on what is still queued; as that may be the rest of a packet already
+ * partly on the line, the next packet is preceded by filler bytes that
+ * make the display discard the torn one.
+ *
  * \todo  Add reporting (shared/report.h) to the send_#_message functions
  *        if send failed (or an error response is received).
  * \todo  Make the content of a response packet available to the driver.
@@ -57,35 +68,40 @@
 # include "config.h"
 #endif
 
-#include <unistd.h>
 #include <stdio.h>
 #include <string.h>
-
-#if defined(HAVE_SYS_SELECT_H)
-# include <sys/select.h>
-#else
-# include <sys/time.h>
-# include <sys/types.h>
-#endif
+#include <errno.h>
+#include <poll.h>
+#include <sys/time.h>
 
 #include "CFontz633io.h"
+#include "shared/report.h"
 
 /* Return values for the check_for_packet() */
 #define TRY_AGAIN 0
 #define GOOD_MSG 1
 #define GIVE_UP 2
 
-/* define CFONTZ633_WRITE_DELAY to use select when waiting for packet acknowledgement */
-#if !defined(CFONTZ633_WRITE_DELAY)
-# define CFONTZ633_WRITE_DELAY 250
-#endif
+/* Time in ms after which a missing acknowledgement is considered lost */
+#define CFONTZ633_ACK_TIMEOUT 250
+
+/*
+ * Filler sent to resynchronize the display: enough to complete the longest
+ * torn packet, which then fails its CRC; the rest are invalid command bytes
+ * the display skips.
+ */
+#define CFONTZ633_RESYNC_FILL	(MAX_DATA_LENGTH + 4)
+#define CFONTZ633_RESYNC_BYTE	0xFF
 
 
 /* static local functions */
-static void send_packet(int fd, COMMAND_PACKET *out, COMMAND_PACKET *in);
+static void send_packet(SerialPort *port, AckWindow *aw, COMMAND_PACKET *out);
+static int  resync_display(SerialPort *port, AckWindow *aw);
 static int  get_crc(unsigned char *buf, int len, int seed);
-static int  test_packet(int fd, unsigned char response, COMMAND_PACKET *in);
-static int  check_for_packet(int fd, COMMAND_PACKET *in, unsigned char expected_length);
+static void process_packets(SerialPort *port, AckWindow *aw);
+static void acknowledge_packet(AckWindow *aw, unsigned char command);
+static void wait_for_window(SerialPort *port, AckWindow *aw, int max_outstanding);
+static int  check_for_packet(SerialPort *port, COMMAND_PACKET *in, unsigned int expected_length);
 #ifdef DEBUG
 static void print_packet(COMMAND_PACKET *packet);
 #endif
@@ -156,91 +172,166 @@ unsigned char GetKeyFromKeyRing(KeyRing *kr)
 
 
 /**
- * Send message with arguments to the given handle.
- * \param fd    File handle to write to.
+ * Forget all packets awaiting their acknowledgement.
+ * \param aw  Pointer to AckWindow.
+ */
+void EmptyAckWindow(AckWindow *aw)
+{
+	aw->count = 0;
+	aw->resync = 0;
+}
+
+
+/**
+ * Send message with arguments to the given port.
+ * \param port  Serial port to write to.
+ * \param aw    Acknowledgement window of the port.
  * \param msg   Command byte to write.
  * \param len   Length (in bytes) of data following.
  * \param data  Pointer to command argument data.
  */
-void send_bytes_message(int fd, unsigned char msg, int len, unsigned char *data)
+void send_bytes_message(SerialPort *port, AckWindow *aw, unsigned char msg, int len, unsigned char *data)
 {
 	COMMAND_PACKET out;
-	COMMAND_PACKET in;
 
 	out.command = msg;
 	out.data_length = (unsigned char) ((len > MAX_DATA_LENGTH) ? MAX_DATA_LENGTH : len);
 	memcpy(out.data, data, out.data_length);
 
 	/* send message & calc CRC */
-	send_packet(fd, &out, &in);
+	send_packet(port, aw, &out);
 }
 
 
 /**
- * Send message with one byte argument to the given handle.
- * \param fd     File handle to write to.
+ * Send message with one byte argument to the given port.
+ * \param port   Serial port to write to.
+ * \param aw     Acknowledgement window of the port.
  * \param msg    Command byte to write.
  * \param value  Command argument.
  */
-void send_onebyte_message(int fd, unsigned char msg, unsigned char value)
+void send_onebyte_message(SerialPort *port, AckWindow *aw, unsigned char msg, unsigned char value)
 {
 	COMMAND_PACKET out;
-	COMMAND_PACKET in;
 
 	out.command = msg;
 	out.data_length = 1;
 	out.data[0] = value;
 
 	/* send message & calc CRC */
-	send_packet(fd, &out, &in);
+	send_packet(port, aw, &out);
 }
 
 
 /**
- * Send message without arguments to the given handle.
- * \param fd    File handle to write to.
+ * Send message without arguments to the given port.
+ * \param port  Serial port to write to.
+ * \param aw    Acknowledgement window of the port.
  * \param msg   Command byte to write.
  */
-void send_zerobyte_message(int fd, unsigned char msg)
+void send_zerobyte_message(SerialPort *port, AckWindow *aw, unsigned char msg)
 {
 	COMMAND_PACKET out;
-	COMMAND_PACKET in;
 
 	out.command = msg;
 	out.data_length = 0;
 
 	/* send message & calc CRC */
-	send_packet(fd, &out, &in);
+	send_packet(port, aw, &out);
 }
 
 
 /**
- * Send out to the given handle; calc & send CRC when doing so.
- * \param fd    File handle to write to.
+ * Wait until all packets sent have been acknowledged (or timed out).
+ * \param port  Serial port to read from.
+ * \param aw    Acknowledgement window of the port.
+ */
+void flush_messages(SerialPort *port, AckWindow *aw)
+{
+	wait_for_window(port, aw, 0);
+}
+
+
+/**
+ * Process the packets that have arrived so far without waiting for more:
+ * record key reports and acknowledgements.
+ * \param port  Serial port to read from.
+ * \param aw    Acknowledgement window of the port.
+ */
+void poll_messages(SerialPort *port, AckWindow *aw)
+{
+	process_packets(port, aw);
+}
+
+
+/**
+ * Send out to the given port; calc & send CRC when doing so.
+ * The packet is handed to the port as a whole and is not waited for;
+ * only when the acknowledgement window is full the oldest packet's
+ * acknowledgement is awaited first. If the port fails to take the packet
+ * it is dropped, and the display is resynchronized before the next one.
+ * \param port  Serial port to write to.
+ * \param aw    Acknowledgement window of the port.
  * \param out   Pointer to COMMAND_PACKET structure to write.
- * \param in    Pointer to COMMAND_PACKET structure to read after write.
  */
 static void
-send_packet(int fd, COMMAND_PACKET *out, COMMAND_PACKET *in)
+send_packet(SerialPort *port, AckWindow *aw, COMMAND_PACKET *out)
 {
-	unsigned char CRC[2];
+	unsigned char buf[MAX_DATA_LENGTH + 4];
+	int len = out->data_length + 4;
 
-	write(fd, &out->command, 1);
-	write(fd, &out->data_length, 1);
-	if (out->data_length > 0)
-		write(fd, out->data, out->data_length);
+	/* make room in the window before adding another packet */
+	wait_for_window(port, aw, CFONTZ633_ACK_WINDOW - 1);
 
-	/* calculate & send the CRC: convert to bytes manually to avoid endianess issues */
+	if (aw->resync && (resync_display(port, aw) < 0))
+		return;
+
+	/* calculate the CRC: convert to bytes manually to avoid endianess issues */
 	out->crc = get_crc((unsigned char *) out, out->data_length + 2, 0xFFFF);
-	CRC[0] = out->crc & 0xFF;
-	CRC[1] = (out->crc >> 8) & 0xFF;
-	write(fd, CRC, 2);
+	buf[0] = out->command;
+	buf[1] = out->data_length;
+	memcpy(&buf[2], out->data, out->data_length);
+	buf[out->data_length + 2] = out->crc & 0xFF;
+	buf[out->data_length + 3] = (out->crc >> 8) & 0xFF;
 
 	/**** TEST STUFF ****/
 	//print_packet(out);
 
-	/* Every time we send a message, we also check for an incoming one. */
-	test_packet(fd, 0x40 | out->command, in);
+	/* the transport either sends all of it or drops what is left */
+	if ((serial_write(port, buf, len) < 0) || (serial_flush(port) < 0)) {
+		aw->resync = 1;
+		return;
+	}
+
+	aw->command[aw->count++] = out->command;
+
+	/* Every time we send a message, we also check for incoming ones. */
+	process_packets(port, aw);
+}
+
+
+/**
+ * Bring the display's packet parser back in step after a packet may have
+ * been cut short: send filler that completes and invalidates any torn
+ * packet. Replies to the packets before are not waited for anymore.
+ * \param port  Serial port to write to.
+ * \param aw    Acknowledgement window of the port.
+ * \retval 0   Success.
+ * \retval <0  The port still does not take any output.
+ */
+static int
+resync_display(SerialPort *port, AckWindow *aw)
+{
+	unsigned char fill[CFONTZ633_RESYNC_FILL];
+
+	memset(fill, CFONTZ633_RESYNC_BYTE, sizeof(fill));
+	if ((serial_write(port, fill, sizeof(fill)) < 0) || (serial_flush(port) < 0))
+		return -1;
+
+	report(RPT_INFO, "CFontzPacket: resynchronized with the display");
+	aw->count = 0;
+	aw->resync = 0;
+	return 0;
 }
 
 
@@ -341,35 +432,24 @@ void EmptyReceiveBuffer(ReceiveBuffer *rb)
 
 
 /**
- * Read given number of bytes from given file handle into receive buffer.
+ * Read given number of bytes from given port into receive buffer.
  * \param rb      Pointer to ReceiveBuffer structure.
- * \param fd      File handle to read from.
- * \param number  Max. number of bytes to read from file handle.
+ * \param port    Serial port to read from.
+ * \param number  Max. number of bytes to read from the port.
  */
-void SyncReceiveBuffer(ReceiveBuffer *rb, int fd, unsigned int number)
+void SyncReceiveBuffer(ReceiveBuffer *rb, SerialPort *port, unsigned int number)
 {
-	unsigned char buffer[MAX_DATA_LENGTH];
+	unsigned char buffer[RECEIVEBUFFERSIZE];
+	unsigned int space = RECEIVEBUFFERSIZE - 1 - BytesAvail(rb);
 	int BytesRead;
 
-#if defined(HAVE_SELECT) && defined(CFONTZ633_WRITE_DELAY) && (CFONTZ633_WRITE_DELAY > 0)
-	fd_set rfds;
-	struct timeval timeout;
-	int retval;
-
-	FD_ZERO(&rfds);
-	FD_SET(fd, &rfds);
-	timeout.tv_sec = 0;
-	timeout.tv_usec = CFONTZ633_WRITE_DELAY;
-	retval = select(fd + 1, &rfds, NULL, NULL, &timeout);
-
-	if (!retval)
+	/* never overwrite bytes that have not been consumed yet */
+	if (number > space)
+		number = space;
+	if (number == 0)
 		return;
-#endif
-
-	if (number > MAX_DATA_LENGTH)
-		number = MAX_DATA_LENGTH;
 
-	BytesRead = read(fd, buffer, number);
+	BytesRead = serial_read(port, buffer, number, 0);
 
 	if (BytesRead > 0) {
 		int i;
@@ -492,54 +572,98 @@ unsigned char PeekByte(ReceiveBuffer *rb)
 
 
 /**
- * Check for a response packet and try to identify it.
- * \param fd        File handle to read from.
- * \param response  Expected response command.
- * \param in        Pointer to COMMAND_PACKET structure to write the response to.
- * \retval 1  Expected response received.
- * \retval 0  Expected response not received.
- *
- * \todo check_for_packet is always called with MAX_DATA_LENGTH. This doesn't
- *       do any harm, but passing that parameter is useless then. Additionally
- *       one complete packet is MAX_DATA_LENGTH + 4 (command, length, CRC).
+ * Read all complete packets available from the input stream and dispatch
+ * them: key reports go to the key ring, responses acknowledge the oldest
+ * outstanding packet with the same command.
+ * \param port  Serial port to read from.
+ * \param aw    Acknowledgement window of the port.
  */
-static int
-test_packet(int fd, unsigned char response, COMMAND_PACKET *in)
+static void
+process_packets(SerialPort *port, AckWindow *aw)
 {
-#if defined(HAVE_SELECT) && defined(CFONTZ633_WRITE_DELAY) && (CFONTZ633_WRITE_DELAY > 0)
-	int response_received = 0;
-	int loop;
-
-	/* wait for answer packet but forever (LCDs should answer within max. 250ms) */
-	for (loop = 250000/CFONTZ633_WRITE_DELAY; !response_received && loop > 0; loop--) {
-		int is_msg = check_for_packet(fd, in, MAX_DATA_LENGTH);
-
-		while (is_msg != GIVE_UP) {
-			if (is_msg == GOOD_MSG) {
-				/* key activity ? */
-				if (in->command == 0x80)
-					AddKeyToKeyRing(&keyring, in->data[0]);
-				else if (in->command == response)
-					response_received = 1;
-			}
-
-			is_msg = check_for_packet(fd, in, MAX_DATA_LENGTH);
+	COMMAND_PACKET in;
+	int is_msg;
+
+	while ((is_msg = check_for_packet(port, &in, RECEIVEBUFFERSIZE)) != GIVE_UP) {
+		if (is_msg != GOOD_MSG)
+			continue;
+
+		switch (in.command & 0xC0) {
+			case 0x80:
+				/* key activity ? (fan and temperature reports are ignored) */
+				if (in.command == 0x80)
+					AddKeyToKeyRing(&keyring, in.data[0]);
+				break;
+			case 0x40:	/* normal response */
+			case 0xC0:	/* error response */
+				acknowledge_packet(aw, in.command & 0x3F);
+				break;
+			default:
+				break;
 		}
 	}
-	return(response_received);
-#else
-	int is_msg = check_for_packet(fd, in, MAX_DATA_LENGTH);
-	while (is_msg != GIVE_UP) {
-		if (is_msg == GOOD_MSG) {
-			if (in->command == 0x80)
-				AddKeyToKeyRing(&keyring, in->data[0]);
-		}
+}
+
 
-		is_msg = check_for_packet(fd, in, MAX_DATA_LENGTH);
+/**
+ * Remove the oldest outstanding packet with the given command from the
+ * acknowledgement window. Older packets that are still outstanding at this
+ * point will never be answered, so they are removed as well.
+ * \param aw       Acknowledgement window.
+ * \param command  Command byte of the response (without type bits).
+ */
+static void
+acknowledge_packet(AckWindow *aw, unsigned char command)
+{
+	int i;
+
+	for (i = 0; i < aw->count; i++) {
+		if (aw->command[i] == command) {
+			aw->count -= i + 1;
+			memmove(aw->command, aw->command + i + 1, aw->count);
+			return;
+		}
 	}
+}
 
-	return 1;
-#endif
+
+/**
+ * Wait until no more than \c max_outstanding packets are waiting for their
+ * acknowledgement. A packet that is not acknowledged within
+ * \c CFONTZ633_ACK_TIMEOUT ms is considered lost.
+ * \param port             Serial port to read from.
+ * \param aw               Acknowledgement window of the port.
+ * \param max_outstanding  Number of packets that may stay unacknowledged.
+ */
+static void
+wait_for_window(SerialPort *port, AckWindow *aw, int max_outstanding)
+{
+	struct timeval start, now;
+
+	process_packets(port, aw);
+	gettimeofday(&start, NULL);
+
+	while (aw->count > max_outstanding) {
+		struct pollfd fds[1];
+		long elapsed;
+
+		gettimeofday(&now, NULL);
+		elapsed = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
+
+		if (elapsed >= CFONTZ633_ACK_TIMEOUT) {
+			/* give up on the oldest packet */
+			aw->count--;
+			memmove(aw->command, aw->command + 1, aw->count);
+			start = now;
+			continue;
+		}
+
+		fds[0].fd = serial_fd(port);
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		if (poll(fds, 1, CFONTZ633_ACK_TIMEOUT - elapsed) > 0)
+			process_packets(port, aw);
+	}
 }
 
 
@@ -548,21 +672,21 @@ test_packet(int fd, unsigned char response, COMMAND_PACKET *in)
  * it will copy it into \c in and return GOOD_MSG. If there is no enough data
  * available for a valid packet it returns GIVE_UP.
  *
- * \param fd        File handle to read from.
+ * \param port      Serial port to read from.
  * \param in        Pointer to COMMAND_PACKET structure to write the response to.
- * \param expected_length  Expected response length.
+ * \param expected_length  Max. number of bytes to read from the port.
  *
  * \retval GIVE_UP    No message and we should not retry until new input.
  * \retval TRY_AGAIN  No message but we should try again immediately.
  * \retval GOOD_MSG   Message correctly identified.
  */
 static int
-check_for_packet(int fd, COMMAND_PACKET *in, unsigned char expected_length)
+check_for_packet(SerialPort *port, COMMAND_PACKET *in, unsigned int expected_length)
 {
 	int i;
 	int testcrc;
 
-	SyncReceiveBuffer(&receivebuffer, fd, expected_length);
+	SyncReceiveBuffer(&receivebuffer, port, expected_length);
 
 	/*
 	 * There must be at least 4 bytes available in the input stream for
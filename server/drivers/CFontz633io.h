@@ -1,5 +1,7 @@
 #ifndef CFONTZ633IO_H
 #define CFONTZ633IO_H
+
+#include "serial_io.h"
 /* ====================================================================
  * 635 WinTest Code.
  * SERIAL.C: Windows 32 packet based example code
@@ -108,16 +110,35 @@ typedef struct {
 } COMMAND_PACKET;
 
 
+/*
+ * define CFONTZ633_ACK_WINDOW to change the number of packets that may be
+ * sent before the first of them has been acknowledged (1 = stop-and-wait)
+ */
+#if !defined(CFONTZ633_ACK_WINDOW)
+# define CFONTZ633_ACK_WINDOW 4
+#endif
+
+/** Commands of the packets sent but not yet acknowledged, oldest first */
+typedef struct {
+	unsigned char command[CFONTZ633_ACK_WINDOW];
+	int count;
+	int resync;	/**< a packet may have been cut short on the line */
+} AckWindow;
+
+
 void          EmptyKeyRing(KeyRing *kr);
 int           AddKeyToKeyRing(KeyRing *kr, unsigned char key);
 unsigned char GetKeyFromKeyRing(KeyRing *kr);
 
-void          send_bytes_message(int fd, unsigned char msg, int len, unsigned char *data);
-void          send_onebyte_message(int fd, unsigned char msg, unsigned char value);
-void          send_zerobyte_message(int fd, unsigned char msg);
+void          EmptyAckWindow(AckWindow *aw);
+void          send_bytes_message(SerialPort *port, AckWindow *aw, unsigned char msg, int len, unsigned char *data);
+void          send_onebyte_message(SerialPort *port, AckWindow *aw, unsigned char msg, unsigned char value);
+void          send_zerobyte_message(SerialPort *port, AckWindow *aw, unsigned char msg);
+void          flush_messages(SerialPort *port, AckWindow *aw);
+void          poll_messages(SerialPort *port, AckWindow *aw);
 
 void          EmptyReceiveBuffer(ReceiveBuffer *rb);
-void          SyncReceiveBuffer(ReceiveBuffer *rb, int fd, unsigned int number);
+void          SyncReceiveBuffer(ReceiveBuffer *rb, SerialPort *port, unsigned int number);
 int           BytesAvail(ReceiveBuffer *rb);
 unsigned char GetByte(ReceiveBuffer *rb);
 int           PeekBytesAvail(ReceiveBuffer *rb);
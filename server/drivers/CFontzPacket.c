@@ -62,7 +62,8 @@
 typedef struct CFontzPacket_private_data {
 	char device[200];
 
-	int fd;
+	SerialPort *port;
+	AckWindow ackwindow;
 
 	int model;
 	int oldfirmware;
@@ -124,7 +125,6 @@ static void CFontzPacket_raw_chr (Driver *drvthis, int x, int y, unsigned char c
 MODULE_EXPORT int
 CFontzPacket_init (Driver *drvthis)
 {
-	struct termios portset;
 	int tmp, w, h, i;
 	int cf_reboot = 0;
 	char size[200] = "";
@@ -139,7 +139,7 @@ CFontzPacket_init (Driver *drvthis)
 		return -1;
 
 	/* Initialize the PrivateData structure */
-	p->fd = -1;
+	p->port = NULL;
 	p->cellheight = DEFAULT_CELL_HEIGHT;
 	p->ccmode = standard;
 	p->LEDstate = 0xFFFF;
@@ -148,6 +148,7 @@ CFontzPacket_init (Driver *drvthis)
 
 	EmptyKeyRing(&keyring);
 	EmptyReceiveBuffer(&receivebuffer);
+	EmptyAckWindow(&p->ackwindow);
 
 	/* Read config file */
 
@@ -242,39 +243,11 @@ CFontzPacket_init (Driver *drvthis)
 		report(RPT_INFO, "%s: USB is indicated (in config)", drvthis->name);
 
 	/* Set up io port correctly, and open it... */
-	debug(RPT_INFO, "%s: Opening device: %s", __FUNCTION__, p->device);
-	p->fd = open(p->device, (p->usb) ? (O_RDWR | O_NOCTTY) : (O_RDWR | O_NOCTTY | O_NDELAY));
-	if (p->fd == -1) {
-		report(RPT_ERR, "%s: open(%s) failed (%s)", drvthis->name, p->device, strerror(errno));
+	p->port = serial_open(drvthis->name, p->device, p->speed, (p->usb) ? 0 : SERIAL_NONBLOCK);
+	if (p->port == NULL)
 		return -1;
-	}
-
-	tcgetattr (p->fd, &portset);
-
-	/* We use RAW mode */
-#ifdef HAVE_CFMAKERAW
-	/* The easy way */
-	cfmakeraw(&portset);
-#else
-	/* The hard way */
-	portset.c_iflag &= ~( IGNBRK | BRKINT | PARMRK | ISTRIP
-				| INLCR | IGNCR | ICRNL | IXON );
-	portset.c_oflag &= ~OPOST;
-	portset.c_lflag &= ~( ECHO | ECHONL | ICANON | ISIG | IEXTEN );
-	portset.c_cflag &= ~( CSIZE | PARENB | CRTSCTS );
-	portset.c_cflag |= CS8 | CREAD | CLOCAL;
-#endif
-	if (p->usb) {
-		portset.c_cc[VMIN] = 0;
-		portset.c_cc[VTIME] = 0;
-	}
-
-	/* Set port speed */
-	cfsetospeed (&portset, p->speed);
-	cfsetispeed (&portset, B0);
-
-	/* Do it... */
-	tcsetattr (p->fd, TCSANOW, &portset);
+	if (p->usb)
+		serial_set_timeouts(p->port, 0, 0);
 
 	/* make sure the frame buffer is there... */
 	p->framebuf = (unsigned char *) malloc(p->width * p->height);
@@ -324,8 +297,10 @@ CFontzPacket_close (Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 
 	if (p != NULL) {
-		if (p->fd >= 0)
-			close(p->fd);
+		if (p->port != NULL) {
+			flush_messages(p->port, &p->ackwindow);
+			serial_close(p->port);
+		}
 
 		if (p->framebuf)
 			free(p->framebuf);
@@ -418,7 +393,7 @@ CFontzPacket_flush (Driver *drvthis)
 
 		for (i = 0; i < p->width; i++) {
 			if (*xp++ != *xq++) {
-				send_bytes_message(p->fd, CF633_Set_LCD_Contents_Line_One, 16, p->framebuf);
+				send_bytes_message(p->port, &p->ackwindow, CF633_Set_LCD_Contents_Line_One, 16, p->framebuf);
 				memcpy(p->backingstore, p->framebuf, p->width);
 				modified++;
 				break;
@@ -430,7 +405,7 @@ CFontzPacket_flush (Driver *drvthis)
 
 		for (i = 0; i < p->width; i++) {
 			if (*xp++ != *xq++) {
-				send_bytes_message(p->fd, CF633_Set_LCD_Contents_Line_Two, 16, p->framebuf + p->width);
+				send_bytes_message(p->port, &p->ackwindow, CF633_Set_LCD_Contents_Line_Two, 16, p->framebuf + p->width);
 				memcpy(p->backingstore + p->width, p->framebuf + p->width, p->width);
 				modified++;
 				break;
@@ -483,7 +458,7 @@ CFontzPacket_flush (Driver *drvthis)
 				      __FUNCTION__, out[0], out[1], length, length, sp);
 
 				memcpy(&out[2], sp, length);
-				send_bytes_message(p->fd, CF633_Send_Data_to_LCD, length + 2, out);
+				send_bytes_message(p->port, &p->ackwindow, CF633_Send_Data_to_LCD, length + 2, out);
 				modified++;
 			}
 		}		/* i < p->height */
@@ -494,7 +469,7 @@ CFontzPacket_flush (Driver *drvthis)
 
 	/* send something to the LCD to allow keys to be received */
 	if (!modified)
-		send_zerobyte_message(p->fd, CF633_Ping_Command);
+		send_zerobyte_message(p->port, &p->ackwindow, CF633_Ping_Command);
 }
 
 
@@ -507,7 +482,12 @@ CFontzPacket_flush (Driver *drvthis)
 MODULE_EXPORT const char *
 CFontzPacket_get_key (Driver *drvthis)
 {
-	unsigned char key = GetKeyFromKeyRing(&keyring);
+	PrivateData *p = drvthis->private_data;
+	unsigned char key;
+
+	/* pick up key reports that arrived after the last packet was sent */
+	poll_messages(p->port, &p->ackwindow);
+	key = GetKeyFromKeyRing(&keyring);
 
 	switch (key) {
 		case CFP_KEY_UL_PRESS:
@@ -643,7 +623,7 @@ CFontzPacket_set_contrast (Driver *drvthis, int promille)
 			    ? (p->contrast / 20)
 			    : ((p->contrast * 255) / 1000);
 
-	send_onebyte_message(p->fd, CF633_Set_LCD_Contrast, hardware_contrast);
+	send_onebyte_message(p->port, &p->ackwindow, CF633_Set_LCD_Contrast, hardware_contrast);
 }
 
 
@@ -702,7 +682,7 @@ CFontzPacket_backlight (Driver *drvthis, int on)
 
 	/* map range [0, 1000] -> [0, 100] that the hardware understands */
 	hardware_value /= 10;
-	send_onebyte_message(p->fd, CF633_Set_LCD_And_Keypad_Backlight, hardware_value);
+	send_onebyte_message(p->port, &p->ackwindow, CF633_Set_LCD_And_Keypad_Backlight, hardware_value);
 }
 
 
@@ -715,7 +695,7 @@ CFontzPacket_hidecursor (Driver *drvthis)
 {
 	PrivateData *p = drvthis->private_data;
 
-	send_onebyte_message(p->fd, CF633_Set_LCD_Cursor_Style, 0);
+	send_onebyte_message(p->port, &p->ackwindow, CF633_Set_LCD_Cursor_Style, 0);
 }
 
 
@@ -735,7 +715,7 @@ CFontzPacket_no_live_report (Driver *drvthis)
 			slots = 4;
 
 		for (out[0] = 0; out[0] < slots; out[0]++)
-			send_bytes_message(p->fd, CF633_Set_Up_Live_Fan_or_Temperature_Display, 2, out);
+			send_bytes_message(p->port, &p->ackwindow, CF633_Set_Up_Live_Fan_or_Temperature_Display, 2, out);
 	}
 }
 
@@ -750,7 +730,7 @@ CFontzPacket_no_fan_report (Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 
 	if (p->model_desc->flags & CFA_HAS_FAN)
-		send_onebyte_message(p->fd, CF633_Set_Up_Fan_Reporting, 0);
+		send_onebyte_message(p->port, &p->ackwindow, CF633_Set_Up_Fan_Reporting, 0);
 }
 
 
@@ -765,7 +745,7 @@ CFontzPacket_no_temp_report (Driver *drvthis)
 	unsigned char out[4] = { 0, 0, 0, 0 };
 
 	if (p->model_desc->flags & CFA_HAS_TEMP)
-		send_bytes_message(p->fd, CF633_Set_Up_Temperature_Reporting, 4, out);
+		send_bytes_message(p->port, &p->ackwindow, CF633_Set_Up_Temperature_Reporting, 4, out);
 }
 
 
@@ -779,7 +759,8 @@ CFontzPacket_reboot (Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 	unsigned char out[3] = { 8, 18, 99 };
 
-	send_bytes_message(p->fd, CF633_Reboot, 3, out);
+	send_bytes_message(p->port, &p->ackwindow, CF633_Reboot, 3, out);
+	flush_messages(p->port, &p->ackwindow);
 	sleep(2);
 }
 
@@ -945,7 +926,7 @@ CFontzPacket_set_char (Driver *drvthis, int n, unsigned char *dat)
 	for (row = 0; row < p->cellheight; row++) {
 		out[row+1] = dat[row] & mask;
 	}
-	send_bytes_message(p->fd, CF633_Set_LCD_Special_Character_Data, 9, out);
+	send_bytes_message(p->port, &p->ackwindow, CF633_Set_LCD_Special_Character_Data, 9, out);
 }
 
 
@@ -1120,19 +1101,19 @@ CFontzPacket_cursor (Driver *drvthis, int x, int y, int state)
 		/* set cursor state */
 		switch (state) {
 			case CURSOR_OFF:	/* no cursor */
-				send_onebyte_message(p->fd, CF633_Set_LCD_Cursor_Style, 0);
+				send_onebyte_message(p->port, &p->ackwindow, CF633_Set_LCD_Cursor_Style, 0);
 				break;
 			case CURSOR_UNDER:	/* underline cursor */
-				send_onebyte_message(p->fd, CF633_Set_LCD_Cursor_Style, 2);
+				send_onebyte_message(p->port, &p->ackwindow, CF633_Set_LCD_Cursor_Style, 2);
 				break;
 			case CURSOR_BLOCK:	/* inverting blinking block */
 				if (p->model == 631 || p->model == 635)
-					send_onebyte_message(p->fd, CF633_Set_LCD_Cursor_Style, 4);
+					send_onebyte_message(p->port, &p->ackwindow, CF633_Set_LCD_Cursor_Style, 4);
 				break;
 			case CURSOR_DEFAULT_ON:	/* blinking block */
 				/* FALLTHROUGH */
 			default:
-				send_onebyte_message(p->fd, CF633_Set_LCD_Cursor_Style, 1);
+				send_onebyte_message(p->port, &p->ackwindow, CF633_Set_LCD_Cursor_Style, 1);
 				break;
 		}
 
@@ -1141,7 +1122,7 @@ CFontzPacket_cursor (Driver *drvthis, int x, int y, int state)
 			cpos[0] = x - 1;
 		if ((y > 0) && (y <= p->height))
 			cpos[1] = y - 1;
-		send_bytes_message(p->fd, CF633_Set_LCD_Cursor_Position, 2, cpos);
+		send_bytes_message(p->port, &p->ackwindow, CF633_Set_LCD_Cursor_Position, 2, cpos);
 	}
 }
 
@@ -1169,7 +1150,7 @@ CFontzPacket_hardware_clear (Driver *drvthis)
 {
 	PrivateData *p = drvthis->private_data;
 
-	send_zerobyte_message(p->fd, CF633_Clear_LCD_Screen);
+	send_zerobyte_message(p->port, &p->ackwindow, CF633_Clear_LCD_Screen);
 }
 
 
@@ -1230,7 +1211,7 @@ CFontzPacket_output(Driver *drvthis, int state)
 		if ((p->LEDstate & mask) != on_off) {
 			out[0] = CFontz635_LEDs[lednum];
 			out[1] = (on_off == 0) ? 0 : 100;
-			send_bytes_message(p->fd, CF633_Set_GPIO_Pin, 2, out);
+			send_bytes_message(p->port, &p->ackwindow, CF633_Set_GPIO_Pin, 2, out);
 		}
 	}
 	p->LEDstate = state;
@@ -63,6 +63,7 @@
 #include "CwLnx.h"
 #include "shared/report.h"
 #include "lcd_lib.h"
+#include "serial_io.h"
 
 /* for the icon definitions & the big numbers */
 #include "adv_bignum.h"
@@ -77,7 +78,7 @@ static char *defaultKeyMap[MaxKeyMap] = { "Up", "Down", "Left", "Right", "Enter"
 
 /** private data for the \c CwLnx driver */
 typedef struct CwLnx_private_data {
-	int fd;
+	SerialPort *port;
 
 	int have_keypad;
 	int keypad_test_mode;
@@ -111,9 +112,9 @@ MODULE_EXPORT int supports_multiple = 1;
 MODULE_EXPORT char *symbol_prefix = "CwLnx_";
 
 
-static void CwLnx_linewrap(int fd, int on);
-static void CwLnx_autoscroll(int fd, int on);
-static void CwLnx_hidecursor(int fd);
+static void CwLnx_linewrap(SerialPort *port, int on);
+static void CwLnx_autoscroll(SerialPort *port, int on);
+static void CwLnx_hidecursor(SerialPort *port);
 
 
 #define LCD_CMD			254
@@ -144,31 +145,15 @@ static void CwLnx_hidecursor(int fd);
 #define LCD_PUT_PIXEL		112
 #define LCD_CLEAR_PIXEL		113
 
-#define DELAY			2000	/* 2 milli sec */
 #define UPDATE_DELAY		20000	/* 20 milliseconds */
 #define SETUP_DELAY		20000	/* 20 milliseconds */
 
 #define MOVE_COST		5	/* # bytes for most move-to ops */
 
-static int Write_LCD(int fd, char *c, int size)
+/* Queue output for the display; it is sent by the next serial_flush() */
+static int Write_LCD(SerialPort *port, char *c, int size)
 {
-    int rc, wrote = 0;
-    int retries = 30;
-
-    do {
-	rc = write(fd, c, size);
-	if (rc > 0) {
-	    c += rc;
-	    size -= rc;
-	    wrote += rc;
-	} else if (rc == 0 || (rc < 0 && errno == EAGAIN)) { /* would have blocked */
-	    usleep(DELAY);
-	} else {
-	    break;
-	}
-    } while (size > 0 && --retries > 0);
-
-    return wrote;
+    return serial_write(port, c, size);
 }
 
 
@@ -179,124 +164,126 @@ static int Write_LCD(int fd, char *c, int size)
 
 
 /* Hardware function */
-static void Enable_Backlight(int fd)
+static void Enable_Backlight(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_LIGHT_ON, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 3);
+    Write_LCD(port, cmd, 3);
 }
 
 
 /* Hardware function */
-static void Disable_Backlight(int fd)
+static void Disable_Backlight(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_LIGHT_OFF, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 3);
+    Write_LCD(port, cmd, 3);
 }
 
 
 /* Hardware function */
-static void Enable_Pixel(int fd, int x, int y)
+static void Enable_Pixel(SerialPort *port, int x, int y)
 {
     char cmd[] = { LCD_CMD, LCD_PUT_PIXEL, 0, 0, LCD_CMD_END };
 
     cmd[2] = (char) x;
     cmd[3] = (char) y;
 
-    Write_LCD(fd, cmd, 5);
+    Write_LCD(port, cmd, 5);
 }
 
 
 /* Hardware function */
-static void Disable_Pixel(int fd, int x, int y)
+static void Disable_Pixel(SerialPort *port, int x, int y)
 {
     char cmd[] = { LCD_CMD, LCD_CLEAR_PIXEL, 0, 0, LCD_CMD_END };
 
     cmd[2] = (char) x;
     cmd[3] = (char) y;
 
-    Write_LCD(fd, cmd, 5);
+    Write_LCD(port, cmd, 5);
 }
 
 
 /* Hardware function */
-static void Backlight_Brightness(int fd, int brightness)
+static void Backlight_Brightness(SerialPort *port, int brightness)
 {
     if (brightness == 1) {
-	Disable_Backlight(fd);
+	Disable_Backlight(port);
     } else if (brightness == 7) {
-	Enable_Backlight(fd);
+	Enable_Backlight(port);
     } else {
 	char cmd[] = { LCD_CMD, LCD_LIGHT_BRIGHTNESS, 0, LCD_CMD_END };
 
 	cmd[2] = (char) brightness;
 
-	Write_LCD(fd, cmd, 4);
+	Write_LCD(port, cmd, 4);
     }
 }
 
 
 /* Hardware function */
-static void Enable_Scroll(int fd)
+static void Enable_Scroll(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_ENABLE_SCROLL, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 3);
+    Write_LCD(port, cmd, 3);
 }
 
 
 /* Hardware function */
-static void Disable_Scroll(int fd)
+static void Disable_Scroll(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_DISABLE_SCROLL, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 3);
+    Write_LCD(port, cmd, 3);
 }
 
 
 /* Hardware function */
-static void Clear_Screen(int fd)
+static void Clear_Screen(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_CLEAR, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 3);
+    Write_LCD(port, cmd, 3);
+    serial_flush(port);
     usleep(UPDATE_DELAY);
 }
 
 
 /* Hardware function */
-static void Enable_Wrap(int fd)
+static void Enable_Wrap(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_ENABLE_WRAP, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 3);
+    Write_LCD(port, cmd, 3);
 }
 
 
 /* Hardware function */
-static void Disable_Wrap(int fd)
+static void Disable_Wrap(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_DISABLE_WRAP, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 3);
+    Write_LCD(port, cmd, 3);
 }
 
 
 /* Hardware function */
-static void Disable_Cursor(int fd)
+static void Disable_Cursor(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_OFF_CURSOR, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 3);
+    Write_LCD(port, cmd, 3);
 }
 
 
 /* Hardware function */
-static void Init_Port(int fd)
+static void Init_Port(SerialPort *port)
 {
     /* Posix - set baudrate to 0 and back */
     struct termios tty, old;
+    int fd = serial_fd(port);
 
     tcgetattr(fd, &tty);
     tcgetattr(fd, &old);
@@ -309,9 +296,10 @@ static void Init_Port(int fd)
 
 
 /* Hardware function */
-static void Setup_Port(int fd, speed_t speed)
+static void Setup_Port(SerialPort *port, speed_t speed)
 {
     struct termios portset;
+    int fd = serial_fd(port);
 
     tcgetattr(fd, &portset);
 
@@ -341,30 +329,30 @@ static void Setup_Port(int fd, speed_t speed)
 
 
 /* Hardware function */
-static void Set_9600(int fd)
+static void Set_9600(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_SET_BAUD, 0x20, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 4);
+    Write_LCD(port, cmd, 4);
 }
 
 
 /* Hardware function */
-static void Set_19200(int fd)
+static void Set_19200(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_SET_BAUD, 0x0F, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 4);
+    Write_LCD(port, cmd, 4);
 }
 
 
 /* Hardware function */
-static void Set_Insert(int fd, int row, int col)
+static void Set_Insert(SerialPort *port, int row, int col)
 {
     if (row == 0 && col == 0) {
         char cmd[] = { LCD_CMD, LCD_INIT_INSERT, LCD_CMD_END };
 
-    	Write_LCD(fd, cmd, 3);
+    	Write_LCD(port, cmd, 3);
     }
     else {
 	char cmd[] = { LCD_CMD, LCD_SET_INSERT, 0, 0, LCD_CMD_END };
@@ -372,7 +360,7 @@ static void Set_Insert(int fd, int row, int col)
 	cmd[2] = (char) col;
 	cmd[3] = (char) row;
 
-	Write_LCD(fd, cmd, 5);
+	Write_LCD(port, cmd, 5);
     }
 }
 
@@ -381,12 +369,12 @@ static void Set_Insert(int fd, int row, int col)
  * Toggle the built-in linewrapping feature
  */
 static void
-CwLnx_linewrap(int fd, int on)
+CwLnx_linewrap(SerialPort *port, int on)
 {
     if (on)
-	    Enable_Wrap(fd);
+	    Enable_Wrap(port);
     else
-	    Disable_Wrap(fd);
+	    Disable_Wrap(port);
 }
 
 
@@ -394,12 +382,12 @@ CwLnx_linewrap(int fd, int on)
  * Toggle the built-in automatic scrolling feature
  */
 static void
-CwLnx_autoscroll(int fd, int on)
+CwLnx_autoscroll(SerialPort *port, int on)
 {
     if (on)
-	    Enable_Scroll(fd);
+	    Enable_Scroll(port);
     else
-	    Disable_Scroll(fd);
+	    Disable_Scroll(port);
 }
 
 
@@ -407,20 +395,21 @@ CwLnx_autoscroll(int fd, int on)
  * Get rid of the blinking curson
  */
 static void
-CwLnx_hidecursor(int fd)
+CwLnx_hidecursor(SerialPort *port)
 {
-    Disable_Cursor(fd);
+    Disable_Cursor(port);
 }
 
 
 /********************************************************************
  * Reset the display bios
  */
-static void CwLnx_reboot(int fd)
+static void CwLnx_reboot(SerialPort *port)
 {
     char cmd[] = { LCD_CMD, LCD_SOFT_RESET, LCD_CMD_END };
 
-    Write_LCD(fd, cmd, 3);
+    Write_LCD(port, cmd, 3);
+    serial_flush(port);
     usleep(SETUP_DELAY);
     return;
 }
@@ -461,7 +450,7 @@ CwLnx_init(Driver *drvthis)
         return -1;
 
     /* Initialise the PrivateData structure */
-    p->fd = -1;
+    p->port = NULL;
     p->cellwidth = DEFAULT_CELL_WIDTH;
     p->cellheight = DEFAULT_CELL_HEIGHT;
 
@@ -602,11 +591,9 @@ CwLnx_init(Driver *drvthis)
 
     /* Set up io port correctly, and open it... */
     debug(RPT_DEBUG, "%s: Opening device: %s", drvthis->name, device);
-    p->fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY);
-    if (p->fd == -1) {
-	report(RPT_ERR, "%s: open(%s) failed (%s)", drvthis->name, device, strerror(errno));
+    p->port = serial_open(drvthis->name, device, speed, SERIAL_NONBLOCK);
+    if (p->port == NULL)
 	return -1;
-    }
     report(RPT_INFO, "%s: opened display on %s", drvthis->name, device);
 
     /*
@@ -616,26 +603,26 @@ CwLnx_init(Driver *drvthis)
        to the speed we want to use, and flush the command.
     */
 
-    Init_Port(p->fd);
+    Init_Port(p->port);
     if (speed == B9600) {
-	Setup_Port(p->fd, B19200);
-    Set_9600(p->fd);
+	Setup_Port(p->port, B19200);
+    Set_9600(p->port);
     } else {
-	Setup_Port(p->fd, B9600);
-	Set_19200(p->fd);
+	Setup_Port(p->port, B9600);
+	Set_19200(p->port);
     }
-    tcdrain(p->fd);
+    serial_wait_idle(p->port);
     usleep(SETUP_DELAY);
-    Init_Port(p->fd);
-    Setup_Port(p->fd, speed);
+    Init_Port(p->port);
+    Setup_Port(p->port, speed);
 
-    CwLnx_hidecursor(p->fd);
-    CwLnx_linewrap(p->fd, 1);
-    CwLnx_autoscroll(p->fd, 0);
+    CwLnx_hidecursor(p->port);
+    CwLnx_linewrap(p->port, 1);
+    CwLnx_autoscroll(p->port, 0);
     CwLnx_backlight(drvthis, 1); /* WHY force the backlight to on ? */
     /* What is the default brightness ? */
 
-    Clear_Screen(p->fd);
+    Clear_Screen(p->port);
     CwLnx_clear(drvthis);
     usleep(SETUP_DELAY);
 
@@ -655,8 +642,7 @@ CwLnx_close(Driver *drvthis)
     PrivateData *p = drvthis->private_data;
 
     if (p != NULL) {
-	if (p->fd >= 0)
-	    close(p->fd);
+	serial_close(p->port);
 
 	if (p->framebuf != NULL)
 	    free(p->framebuf);
@@ -758,8 +744,8 @@ CwLnx_flush(Driver *drvthis)
 	for (j = 0; j < p->width; j++) {
 	    if ((*q == *r) && !((0 < *q) && (*q < 16))) {
 		if (firstUpdate && q - lastUpdate > MOVE_COST) {
-		    Set_Insert(p->fd, iUpdate, jUpdate);
-		    Write_LCD(p->fd, (char *) firstUpdate,
+		    Set_Insert(p->port, iUpdate, jUpdate);
+		    Write_LCD(p->port, (char *) firstUpdate,
 			  lastUpdate - firstUpdate + 1);
 		    firstUpdate = lastUpdate = NULL;
 		}
@@ -776,8 +762,8 @@ CwLnx_flush(Driver *drvthis)
 	}
     }
     if (firstUpdate) {
-	Set_Insert(p->fd, iUpdate, jUpdate);
-	Write_LCD(p->fd, (char *) firstUpdate,
+	Set_Insert(p->port, iUpdate, jUpdate);
+	Write_LCD(p->port, (char *) firstUpdate,
 		lastUpdate - firstUpdate + 1);
     }
 
@@ -786,13 +772,15 @@ CwLnx_flush(Driver *drvthis)
     if (p->backlight != p->saved_backlight ||
 	p->brightness != p->saved_brightness) {
 	if (!p->backlight) {
-	    Backlight_Brightness(p->fd, 1);
+	    Backlight_Brightness(p->port, 1);
 	} else {
-	    Backlight_Brightness(p->fd, 1 + p->brightness * 6 / 900); /* 90% and up is full brightness */
+	    Backlight_Brightness(p->port, 1 + p->brightness * 6 / 900); /* 90% and up is full brightness */
 	}
 	p->saved_backlight = p->backlight;
 	p->saved_brightness = p->brightness;
     }
+
+    serial_flush(p->port);
 }
 
 /**
@@ -1036,11 +1024,11 @@ CwLnx_set_char(Driver *drvthis, int n, unsigned char *dat)
 	return;
 
     c = LCD_CMD;
-    Write_LCD(p->fd, &c, 1);
+    Write_LCD(p->port, &c, 1);
     c = LCD_SETCHAR;
-    Write_LCD(p->fd, &c, 1);
+    Write_LCD(p->port, &c, 1);
     c = (char) n;
-    Write_LCD(p->fd, &c, 1);
+    Write_LCD(p->port, &c, 1);
 
     if (p->model == 1602) {	// the character model
 	unsigned char mask = (1 << p->cellwidth) - 1;
@@ -1048,7 +1036,7 @@ CwLnx_set_char(Driver *drvthis, int n, unsigned char *dat)
 
 	for (row = 0; row < p->cellheight; row++) {
 	    c = dat[row] & mask;
-	    Write_LCD(p->fd, &c, 1);
+	    Write_LCD(p->port, &c, 1);
 	}
     } else if ((p->model == 12232) || (p->model == 12832)) {	// graphical models
 	int col;
@@ -1064,12 +1052,12 @@ CwLnx_set_char(Driver *drvthis, int n, unsigned char *dat)
 
 	    c = letter;
 
-	    Write_LCD(p->fd, &c, 1);
+	    Write_LCD(p->port, &c, 1);
 	}
     }
 
     c = LCD_CMD_END;
-    Write_LCD(p->fd, &c, 1);
+    Write_LCD(p->port, &c, 1);
 }
 
 
@@ -1332,7 +1320,7 @@ CwLnx_get_key(Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 	char key = '\0';
 
-	read(p->fd, &key, 1);
+	serial_read(p->port, &key, 1, 0);
 
 	if (key != '\0') {
 		if ((key >= 'A') && (key <= 'F')) {
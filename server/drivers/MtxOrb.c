@@ -49,7 +49,6 @@
 #include <strings.h>
 #include <errno.h>
 #include <ctype.h>
-#include <poll.h>
 
 #ifdef HAVE_CONFIG_H
 # include "config.h"
@@ -59,6 +58,7 @@
 #include "lcd_lib.h"
 #include "MtxOrb.h"
 #include "adv_bignum.h"
+#include "serial_io.h"
 
 #include "shared/report.h"
 
@@ -107,7 +107,7 @@ typedef enum {
 
 /** private data for the \c MtxOrb driver */
 typedef struct MtxOrb_private_data {
-	int fd;			/**< LCD file descriptor */
+	SerialPort *port;	/**< serial port of the LCD */
 
 	/* dimensions */
 	int width, height;
@@ -217,7 +217,6 @@ static void MtxOrb_cursor_goto(Driver *drvthis, int x, int y);
 MODULE_EXPORT int
 MtxOrb_init (Driver *drvthis)
 {
-	struct termios portset;
 
 	char device[256] = DEFAULT_DEVICE;
 	int speed = DEFAULT_SPEED;
@@ -235,7 +234,7 @@ MtxOrb_init (Driver *drvthis)
 		return -1;
 
 	/* Initialise the PrivateData structure */
-	p->fd = -1;
+	p->port = NULL;
 	p->MtxOrb_type = MTXORB_LKD;  /* Assume it's an LCD w/keypad */
 
 	p->width = LCD_DEFAULT_WIDTH;
@@ -386,43 +385,18 @@ MtxOrb_init (Driver *drvthis)
 	/* End of config file parsing */
 
 	/* Set up io port correctly, and open it... */
-	p->fd = open(device, O_RDWR | O_NOCTTY);
-	if (p->fd == -1) {
-		report(RPT_ERR, "%s: open(%s) failed (%s)", drvthis->name, device, strerror(errno));
+	/* Frames are sent while LCDd goes on; get_key() pushes out the rest */
+	p->port = serial_open(drvthis->name, device, speed, SERIAL_BACKGROUND);
+	if (p->port == NULL) {
 		if (errno == EACCES)
 			report(RPT_ERR, "%s: %s device could not be opened...", drvthis->name, device);
-  		return -1;
+		return -1;
 	}
 	report(RPT_INFO, "%s: opened display on %s", drvthis->name, device);
 
-	tcgetattr(p->fd, &portset);
-
-	/* We use RAW mode */
-#ifdef HAVE_CFMAKERAW
-	/* The easy way */
-	cfmakeraw(&portset);
-#else
-	/* The hard way */
-	portset.c_iflag &= ~( IGNBRK | BRKINT | PARMRK | ISTRIP
-			      | INLCR | IGNCR | ICRNL | IXON );
-	portset.c_oflag &= ~OPOST;
-	portset.c_lflag &= ~( ECHO | ECHONL | ICANON | ISIG | IEXTEN );
-	portset.c_cflag &= ~( CSIZE | PARENB | CRTSCTS );
-	portset.c_cflag |= CS8 | CREAD | CLOCAL;
-#endif
 	/* Set timeouts */
-	portset.c_cc[VMIN] = 1;
-	portset.c_cc[VTIME] = 3;
-
-	/* Set port speed */
-	cfsetospeed(&portset, speed);
-	cfsetispeed(&portset, B0);
-
-	/* Do it... */
-	if (tcsetattr(p->fd, TCSANOW, &portset) == -1) {
-		report(RPT_ERR, "%s: failed to configure port (%s)", drvthis->name, strerror(errno));
+	if (serial_set_timeouts(p->port, 1, 3) < 0)
 		return -1;
-	}
 
 
 	/* Make sure the frame buffer is there... */
@@ -467,8 +441,7 @@ MtxOrb_close (Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 
 	if (p != NULL) {
-		if (p->fd >= 0)
-			close(p->fd);
+		serial_close(p->port);
 
 		if (p->framebuf)
 			free(p->framebuf);
@@ -642,7 +615,7 @@ MtxOrb_flush (Driver *drvthis)
 			      __FUNCTION__, i, j, length, length, sp);
 
 			MtxOrb_cursor_goto(drvthis, j+1, i+1);
-			write(p->fd, out, length);
+			serial_write(p->port, out, length);
 			modified++;
 		}
 	}
@@ -650,6 +623,8 @@ MtxOrb_flush (Driver *drvthis)
 	if (modified)
 		memcpy(p->backingstore, p->framebuf, p->width * p->height);
 
+	serial_flush(p->port);
+
 	debug(RPT_DEBUG, "MtxOrb: frame buffer flushed");
 }
 
@@ -721,7 +696,7 @@ MtxOrb_set_contrast (Driver *drvthis, int promille)
 		unsigned char out[4] = { '\xFE', 'P', 0 };
 
 		out[2] = (unsigned char) real_contrast;
-		write(p->fd, out, 3);
+		serial_write(p->port, out, 3);
 
 		report(RPT_DEBUG, "%s: contrast set to %d",
 				drvthis->name, real_contrast);
@@ -795,7 +770,7 @@ MtxOrb_backlight (Driver *drvthis, int on)
 			/* map range [0, 1000] -> [0, 3] that the hardware understands */
 			out[2] = (unsigned char) ((long) promille * 3 / 1000);
 
-			write(p->fd, out, 3);
+			serial_write(p->port, out, 3);
 		}
 		else {
 			unsigned char out[5] = { '\xFE', '\x99', 0 };
@@ -803,7 +778,7 @@ MtxOrb_backlight (Driver *drvthis, int on)
 			/* map range [0, 1000] -> [0, 255] that the hardware understands */
 			out[2] = (unsigned char) ((long) promille * 255 / 1000);
 
-			write(p->fd, out, 3);
+			serial_write(p->port, out, 3);
 		}
 
 		debug(RPT_DEBUG, "MtxOrb: changed brightness to %d", promille);
@@ -811,11 +786,11 @@ MtxOrb_backlight (Driver *drvthis, int on)
 	else {
 		if (on == BACKLIGHT_ON) {
 			unsigned char out[4] = { '\xFE', 'B', '\0', 0};
-			write(p->fd, out, 3);
+			serial_write(p->port, out, 3);
 		}
 		else {
 			unsigned char out[4] = { '\xFE', 'F', 0};
-			write(p->fd, out, 2);
+			serial_write(p->port, out, 2);
 		}
 	}
 }
@@ -842,7 +817,7 @@ MtxOrb_output (Driver *drvthis, int state)
 	if (IS_LCD_DISPLAY || IS_VFD_DISPLAY) {
 		/* LCD and VFD displays only have one output port */
 		out[1] = (state) ? 'W' : 'V';
-		write(p->fd, out, 2);
+		serial_write(p->port, out, 2);
 	}
 	else {
 		int i;
@@ -854,7 +829,7 @@ MtxOrb_output (Driver *drvthis, int state)
 		for (i = 0; i < 6; i++) {
 			out[1] = (state & (1 << i)) ? 'W' : 'V';
 			out[2] = i+1;
-			write(p->fd, out, 3);
+			serial_write(p->port, out, 3);
 		}
 	}
 }
@@ -869,7 +844,7 @@ MtxOrb_hardware_clear (Driver *drvthis)
 {
 	PrivateData *p = drvthis->private_data;
 
-	write(p->fd, "\xFE" "X", 2);
+	serial_write(p->port, "\xFE" "X", 2);
 
 	debug(RPT_DEBUG, "MtxOrb: cleared LCD");
 }
@@ -887,7 +862,7 @@ MtxOrb_linewrap (Driver *drvthis, int on)
 	unsigned char out[3] = { '\xFE', 0 };
 
 	out[1] = (on) ? 'C' : 'D';
-	write(p->fd, out, 2);
+	serial_write(p->port, out, 2);
 
 	debug(RPT_DEBUG, "MtxOrb: linewrap turned %s", (on) ? "on" : "off");
 }
@@ -905,7 +880,7 @@ MtxOrb_autoscroll (Driver *drvthis, int on)
 	unsigned char out[3] = { '\xFE', 0 };
 
 	out[1] = (on) ? 'Q' : 'R';
-	write(p->fd, out, 2);
+	serial_write(p->port, out, 2);
 
 	debug(RPT_DEBUG, "MtxOrb: autoscroll turned %s", (on) ? "on" : "off");
 }
@@ -925,7 +900,7 @@ MtxOrb_cursorblink (Driver *drvthis, int on)
 	unsigned char out[3] = { '\xFE', 0 };
 
 	out[1] = (on) ? 'S' : 'T';
-	write(p->fd, out, 2);
+	serial_write(p->port, out, 2);
 
 	debug(RPT_DEBUG, "MtxOrb: cursorblink turned %s", (on) ? "on" : "off");
 }
@@ -948,7 +923,7 @@ MtxOrb_cursor_goto(Driver *drvthis, int x, int y)
 		out[2] = (unsigned char) x;
 	if ((y > 0) && (y <= p->height))
 		out[3] = (unsigned char) y;
-	write(p->fd, out, 4);
+	serial_write(p->port, out, 4);
 }
 
 
@@ -964,10 +939,6 @@ MtxOrb_get_info (Driver *drvthis)
 	int model = 0;
 	int i;
 	PrivateData *p = drvthis->private_data;
-
-	fd_set rfds;
-
-	struct timeval tv;
 	int retval;
 
 	debug(RPT_DEBUG, "MtxOrb: get_info");
@@ -975,25 +946,18 @@ MtxOrb_get_info (Driver *drvthis)
 	memset(p->info, '\0', sizeof(p->info));
 	strcat(p->info, "Matrix Orbital, ");
 
-	/* Watch fd to see when it has input. */
-	FD_ZERO(&rfds);
-	FD_SET(p->fd, &rfds);
-
 	/*
 	 * Read type of display
 	 * In query for its type, the display return a single byte value.
 	 */
 	memset(tmp, '\0', sizeof(tmp));
-	write(p->fd, "\x0FE" "7", 2);
+	serial_write(p->port, "\x0FE" "7", 2);
 
 	/* Wait the specified amount of time for the module to return display type */
-	tv.tv_sec = 0;		/* seconds */
-	tv.tv_usec = 40000;	/* microseconds */
-
-	retval = select(p->fd+1, &rfds, NULL, NULL, &tv);
+	retval = serial_read(p->port, tmp, 1, 40);
 
 	if (retval) {
-		if (read(p->fd, &tmp, 1) < 0)
+		if (retval < 0)
 			report(RPT_WARNING, "%s: unable to read data", drvthis->name);
 		else {
 			for (i = 0; modulelist[i].model != 0; i++) {
@@ -1020,16 +984,13 @@ MtxOrb_get_info (Driver *drvthis)
 	 * NOTE: The manual doesn't describe the format of the returned byte
 	 */
 	memset(tmp, '\0', sizeof(tmp));
-	write(p->fd, "\x0FE" "6", 2);
+	serial_write(p->port, "\x0FE" "6", 2);
 
 	/* Wait the specified amount of time for the module return firmware revision number */
-	tv.tv_sec = 0;		/* seconds */
-	tv.tv_usec = 10000;	/* microseconds */
-
-	retval = select(p->fd+1, &rfds, NULL, NULL, &tv);
+	retval = serial_read(p->port, tmp, 1, 10);
 
 	if (retval) {
-		if (read(p->fd, &tmp, 1) < 0)
+		if (retval < 0)
 			report(RPT_WARNING, "%s: unable to read data", drvthis->name);
 
 	}
@@ -1049,16 +1010,13 @@ MtxOrb_get_info (Driver *drvthis)
 	 * have to be supplied, so it is likely the display will return those.
 	 */
 	memset(tmp, '\0', sizeof(tmp));
-	write(p->fd, "\x0FE" "5", 2);
+	serial_write(p->port, "\x0FE" "5", 2);
 
 	/* Wait the specified amount of time. */
-	tv.tv_sec = 0;		/* seconds */
-	tv.tv_usec = 10000;	/* microseconds */
-
-	retval = select(p->fd+1, &rfds, NULL, NULL, &tv);
+	retval = serial_read(p->port, tmp, 2, 10);
 
 	if (retval) {
-		if (read(p->fd, &tmp, 2) < 0)
+		if (retval < 0)
 			report(RPT_WARNING, "%s: unable to read data", drvthis->name);
 	}
 	else
@@ -1221,7 +1179,7 @@ MtxOrb_set_char (Driver *drvthis, int n, unsigned char *dat)
 	for (row = 0; row < p->cellheight; row++) {
 		out[row+3] = dat[row] & mask;
 	}
-	write(p->fd, out, 11);
+	serial_write(p->port, out, 11);
 }
 
 
@@ -1420,13 +1378,13 @@ MtxOrb_cursor (Driver *drvthis, int x, int y, int state)
 	/* set cursor state */
 	switch (state) {
 		case CURSOR_OFF:	/* no cursor */
-			write(p->fd, "\xFE" "K", 2);
+			serial_write(p->port, "\xFE" "K", 2);
 			break;
 		case CURSOR_UNDER:	/* underline cursor */
 		case CURSOR_BLOCK:	/* inverting blinking block */
 		case CURSOR_DEFAULT_ON:	/* blinking block */
 		default:
-			write(p->fd, "\xFE" "J", 2);
+			serial_write(p->port, "\xFE" "J", 2);
 			break;
 	}
 
@@ -1446,21 +1404,17 @@ MtxOrb_get_key (Driver *drvthis)
 {
 	PrivateData *p = drvthis->private_data;
 	char key = 0;
-	struct pollfd fds[1];
+
+	/* continue sending what the last flush left over */
+	serial_poll(p->port);
 
 	/* don't query the keyboard if there are no mapped keys */
 	if ((p->keys == 0) && (!p->keypad_test_mode))
 		return NULL;
 
 	/* poll for data or return */
-	fds[0].fd = p->fd;
-	fds[0].events = POLLIN;
-	fds[0].revents = 0;
-	poll(fds,1,0);
-	if (fds[0].revents == 0)
+	if (serial_read(p->port, &key, 1, 0) <= 0)
 		return NULL;
-
-	(void) read(p->fd, &key, 1);
 	report(RPT_DEBUG, "%s: get_key: key 0x%02X", drvthis->name, key);
 
 	if (key == '\0')
@@ -54,6 +54,7 @@
 #include "lcd_lib.h"
 #include "SureElec.h"
 #include "adv_bignum.h"
+#include "serial_io.h"
 
 #include "shared/report.h"
 
@@ -72,7 +73,7 @@ typedef enum {
 
 /** private data for the \c SureElec driver */
 typedef struct SureElec_private_data {
-	int fd;			/* Serial port file descriptor */
+	SerialPort *port;	/* Serial port of the display */
 
 	int width, height;	/* Screen size */
 	int cellwidth, cellheight;	/* Cell size */
@@ -129,7 +130,7 @@ SureElec_init(Driver * drvthis)
 		return -1;
 
 	/* Initialise the PrivateData structure */
-	p->fd = -1;
+	p->port = NULL;
 	p->edition = SURE_ELEC_EDITION2;	/* Assume an edition 2
 						 * version */
 
@@ -269,8 +270,7 @@ SureElec_close(Driver * drvthis)
 	PrivateData *p = drvthis->private_data;
 
 	if (p != NULL) {
-		if (p->fd >= 0)
-			close(p->fd);
+		serial_close(p->port);
 
 		/* Free allocated framebuffers */
 		if (p->framebuf)
@@ -441,6 +441,7 @@ SureElec_flush(Driver * drvthis)
 		/* If something changed on screen, update the backingstore */
 		memcpy(p->backingstore, p->framebuf, p->width * p->height);
 	}
+	serial_flush(p->port);
 	debug(RPT_DEBUG, "SureElec: frame buffer flushed");
 }
 
@@ -877,50 +878,23 @@ static int
 open_port(Driver * drvthis, const char *device)
 {
 	PrivateData *p = drvthis->private_data;
-	struct termios portset;
 
 	unsigned char cmd[3] = {'\xFE', '\x56', 0};
 	unsigned char init_seq[7] = {'\x54', '\x58', '\x4B', '\x52', '\x44', '\x41', '\x60'};
 	int i;
 
 	/* Set up io port correctly, and open it... */
-	p->fd = open(device, O_RDWR | O_NOCTTY);
-	if (p->fd == -1) {
-		report(RPT_ERR, "%s: open(%s) failed (%s)", drvthis->name, device, strerror(errno));
+	p->port = serial_open(drvthis->name, device, B9600, 0);
+	if (p->port == NULL) {
 		if (errno == EACCES)
 			report(RPT_ERR, "%s: %s device could not be opened", drvthis->name, device);
 		return -1;
 	}
 	report(RPT_INFO, "%s: opened display on %s", drvthis->name, device);
 
-	tcgetattr(p->fd, &portset);
-
-	/* We use RAW mode */
-#ifdef HAVE_CFMAKERAW
-	/* The easy way */
-	cfmakeraw(&portset);
-#else
-	/* The hard way */
-	portset.c_iflag &= ~( IGNBRK | BRKINT | PARMRK | ISTRIP
-			      | INLCR | IGNCR | ICRNL | IXON );
-	portset.c_oflag &= ~OPOST;
-	portset.c_lflag &= ~( ECHO | ECHONL | ICANON | ISIG | IEXTEN );
-	portset.c_cflag &= ~( CSIZE | PARENB | CRTSCTS );
-	portset.c_cflag |= CS8 | CREAD | CLOCAL;
-#endif
 	/* Set timeouts */
-	portset.c_cc[VMIN] = 1;
-	portset.c_cc[VTIME] = 3;
-
-	/* Set port speed */
-	cfsetospeed(&portset, B9600);
-	cfsetispeed(&portset, B0);
-
-	/* Do it... */
-	if (tcsetattr(p->fd, TCSANOW, &portset) == -1) {
-		report(RPT_ERR, "%s: failed to configure port (%s)", drvthis->name, strerror(errno));
+	if (serial_set_timeouts(p->port, 1, 3) < 0)
 		return -1;
-	}
 
 	/* Send initialization sequence */
 	for (i = 1; i <= 8; i++) {
@@ -934,7 +908,7 @@ open_port(Driver * drvthis, const char *device)
 		    || write_(drvthis, &(init_seq[i]), 1) == -1)
 			return -1;
 	}
-	return 0;
+	return (serial_flush(p->port) < 0) ? -1 : 0;
 }
 
 /**
@@ -959,7 +933,8 @@ get_device_screen_size(Driver * drvthis, int *width, int *height)
 }
 
 /**
- * Writes count bytes from a buffer to the device.
+ * Queues count bytes from a buffer for the device. They are sent by the
+ * next serial_flush() or read_().
  * \param drvthis  Pointer to driver structure
  * \param buf      Pointer to the buffer
  * \param count    Number of bytes to write
@@ -968,18 +943,13 @@ get_device_screen_size(Driver * drvthis, int *width, int *height)
 static int
 write_(Driver * drvthis, const unsigned char *buf, size_t count)
 {
-	int write_count = 0, written;
 	PrivateData *p = drvthis->private_data;
 
-	while (write_count < count) {
-		written = write(p->fd, &buf[write_count], count - write_count);
-		if (written == -1) {
-			report(RPT_ERR, "SureElec: cannot write to port");
-			return -1;
-		}
-		write_count += written;
+	if (serial_write(p->port, buf, count) == -1) {
+		report(RPT_ERR, "SureElec: cannot write to port");
+		return -1;
 	}
-	return write_count;
+	return count;
 }
 
 /**
@@ -992,38 +962,21 @@ write_(Driver * drvthis, const unsigned char *buf, size_t count)
 static int
 read_(Driver * drvthis, void *buf, size_t count)
 {
-	fd_set rfds;
-	struct timeval tv;
 	PrivateData *p = drvthis->private_data;
 	int read_count;
 
-	/* Watch fd to see when it has input. */
-	FD_ZERO(&rfds);
-	FD_SET(p->fd, &rfds);
-
 	read_count = 0;
 	while (read_count < count) {
-		int retval;
-
-		/*
-		 * For compatibility, better to reset the timeout delay (may
-		 * be modified in select() call).
-		 */
-		tv.tv_sec = 1;	/* seconds */
-		tv.tv_usec = 0;	/* microseconds */
-
-		retval = select(p->fd + 1, &rfds, NULL, NULL, &tv);
-		if (retval) {
-			int read_result = read(p->fd, ((char *)buf) + read_count, count - read_count);
-			if (read_result < 0) {
-				return -1;
-			} else {
-				read_count += read_result;
-			}
-		} else {
+		/* wait up to a second for each part of the answer */
+		int read_result = serial_read(p->port, ((char *)buf) + read_count,
+					      count - read_count, 1000);
+		if (read_result < 0) {
+			return -1;
+		} else if (read_result == 0) {
 			report(RPT_ERR, "SureElec: No answer from device");
 			return -1;
 		}
+		read_count += read_result;
 	}
 	return read_count;
 }
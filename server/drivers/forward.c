@@ -0,0 +1,914 @@
+/** \file server/drivers/forward.c
+ * LCDd \c forward driver, which streams the rendered frames to other LCDd
+ * instances.
+ *
+ * Every remote LCDd that has a ReceivePort configured shows what this
+ * driver is given, so one set of clients can feed many displays. The
+ * driver connects to each Host of its configuration section, sends the
+ * complete display state once and after that only the cells, custom
+ * characters, backlight and output state that changed since the last
+ * flush. See shared/fwdproto.h for the format.
+ *
+ * Connections are made without blocking. A remote that cannot keep up
+ * (its socket buffer is full) is dropped and connected again later, which
+ * also resends the complete state.
+ */
+
+/* Copyright (C) 1998-2004 The LCDproc Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "lcd.h"
+#include "lcd_lib.h"
+#include "forward.h"
+#include "adv_bignum.h"
+#include "shared/report.h"
+#include "shared/binproto.h"
+#include "shared/fwdproto.h"
+
+
+/** State of the connection to one remote LCDd */
+typedef enum {
+	PEER_DOWN,		/**< Not connected, waiting for the next attempt */
+	PEER_CONNECTING,	/**< Connection in progress */
+	PEER_UP			/**< Connected and in sync */
+} PeerState;
+
+/** A remote LCDd */
+typedef struct forward_peer {
+	char name[128];			/**< host:port, for the log */
+	struct sockaddr_in addr;	/**< Address of the remote */
+	int sock;			/**< Socket; -1 if down */
+	PeerState state;		/**< State of the connection */
+	time_t deadline;		/**< Next attempt or end of the current one */
+} Peer;
+
+/** Growable buffer of outgoing messages */
+typedef struct forward_buffer {
+	unsigned char *data;
+	int len;
+	int size;
+} Buffer;
+
+/** private data for the \c forward driver */
+typedef struct forward_private_data {
+	int width;		/**< display width in characters */
+	int height;		/**< display height in characters */
+	unsigned char *framebuf;	/**< frame buffer */
+	unsigned char *last_framebuf;	/**< frame buffer as the remotes have it */
+
+	CGmode ccmode;		/**< custom character mode of the current frame */
+	CGmode last_ccmode;	/**< custom characters currently defined */
+	unsigned char cc[FWD_NUM_CHARS][FWD_CELLHEIGHT];	/**< custom characters */
+	int cc_defined;		/**< bit mask of defined custom characters */
+	int cc_dirty;		/**< bit mask of custom characters changed since last flush */
+
+	int backlight;		/**< backlight state; -1 if never set */
+	int last_backlight;	/**< backlight state as the remotes have it */
+	int output;		/**< output state */
+	int last_output;	/**< output state as the remotes have it */
+
+	Peer peers[FORWARD_MAX_PEERS];	/**< the remotes */
+	int num_peers;		/**< number of remotes */
+
+	Buffer delta;		/**< changes of the current flush */
+	Buffer sync;		/**< complete state, for new connections */
+
+	char info[255];		/**< info string for get_info */
+} PrivateData;
+
+
+/* Vars for the server core */
+MODULE_EXPORT char *api_version = API_VERSION;
+MODULE_EXPORT int stay_in_foreground = 0;
+MODULE_EXPORT int supports_multiple = 0;
+MODULE_EXPORT char *symbol_prefix = "forward_";
+
+
+/** Append a message to a buffer. */
+static int
+forward_put(Buffer *b, int type, const unsigned char *head, int headlen,
+	    const unsigned char *payload, int len)
+{
+	int need = FWD_HEADER_SIZE + headlen + len;
+
+	if (b->len + need > b->size) {
+		int size = (b->size > 0) ? 2 * b->size : 256;
+		unsigned char *data;
+
+		while (size < b->len + need)
+			size *= 2;
+		data = realloc(b->data, size);
+		if (data == NULL)
+			return -1;
+		b->data = data;
+		b->size = size;
+	}
+
+	b->data[b->len] = type;
+	binproto_put_u16(b->data + b->len + 1, headlen + len);
+	b->len += FWD_HEADER_SIZE;
+	if (headlen > 0)
+		memcpy(b->data + b->len, head, headlen);
+	b->len += headlen;
+	if (len > 0)
+		memcpy(b->data + b->len, payload, len);
+	b->len += len;
+	return 0;
+}
+
+/** Append the cells [start, end) of a frame buffer as TEXT messages. */
+static void
+forward_put_text(Buffer *b, const unsigned char *frame, int start, int end)
+{
+	unsigned char head[2];
+
+	while (start < end) {
+		int len = end - start;
+
+		if (len > FWD_MAX_PAYLOAD - 2)
+			len = FWD_MAX_PAYLOAD - 2;
+		binproto_put_u16(head, start);
+		forward_put(b, FWD_MSG_TEXT, head, 2, frame + start, len);
+		start += len;
+	}
+}
+
+/** Append a custom character. */
+static void
+forward_put_char(Buffer *b, PrivateData *p, int n)
+{
+	unsigned char head = n;
+
+	forward_put(b, FWD_MSG_CHAR, &head, 1, p->cc[n], FWD_CELLHEIGHT);
+}
+
+/** Append backlight and output state. */
+static void
+forward_put_state(Buffer *b, PrivateData *p, int backlight, int output)
+{
+	unsigned char data[4];
+
+	if (backlight) {
+		data[0] = (p->backlight != BACKLIGHT_OFF);
+		forward_put(b, FWD_MSG_BACKLIGHT, NULL, 0, data, 1);
+	}
+	if (output) {
+		binproto_put_s32(data, p->output);
+		forward_put(b, FWD_MSG_OUTPUT, NULL, 0, data, 4);
+	}
+}
+
+/**
+ * Build the messages for what changed since the last flush. Runs of
+ * changed cells separated by less than FORWARD_RUN_GAP unchanged cells are
+ * sent as one, which is shorter than another message header.
+ */
+static void
+forward_build_delta(PrivateData *p)
+{
+	int n = p->width * p->height;
+	int i, j, end;
+
+	p->delta.len = 0;
+
+	for (i = 0; i < n; i = end) {
+		if (p->framebuf[i] == p->last_framebuf[i]) {
+			end = i + 1;
+			continue;
+		}
+		end = i + 1;
+		for (j = end; (j < n) && (j - end < FORWARD_RUN_GAP); j++) {
+			if (p->framebuf[j] != p->last_framebuf[j])
+				end = j + 1;
+		}
+		forward_put_text(&p->delta, p->framebuf, i, end);
+	}
+
+	for (i = 0; i < FWD_NUM_CHARS; i++) {
+		if (p->cc_dirty & (1 << i))
+			forward_put_char(&p->delta, p, i);
+	}
+
+	forward_put_state(&p->delta, p,
+			  (p->backlight != p->last_backlight) && (p->backlight >= 0),
+			  (p->output != p->last_output));
+
+	if (p->delta.len > 0)
+		forward_put(&p->delta, FWD_MSG_FRAME, NULL, 0, NULL, 0);
+}
+
+/** Build the messages a new connection needs to show the current state. */
+static void
+forward_build_sync(PrivateData *p)
+{
+	unsigned char hello[5];
+	int i;
+
+	p->sync.len = 0;
+
+	hello[0] = FWD_PROTOCOL_VERSION;
+	hello[1] = p->width;
+	hello[2] = p->height;
+	hello[3] = LCD_DEFAULT_CELLWIDTH;
+	hello[4] = FWD_CELLHEIGHT;
+	forward_put(&p->sync, FWD_MSG_HELLO, NULL, 0, hello, sizeof(hello));
+
+	forward_put_text(&p->sync, p->last_framebuf, 0, p->width * p->height);
+	for (i = 0; i < FWD_NUM_CHARS; i++) {
+		if (p->cc_defined & (1 << i))
+			forward_put_char(&p->sync, p, i);
+	}
+	forward_put_state(&p->sync, p, (p->last_backlight >= 0), 1);
+	forward_put(&p->sync, FWD_MSG_FRAME, NULL, 0, NULL, 0);
+}
+
+
+/** Close the connection to a remote and schedule the next attempt. */
+static void
+forward_peer_down(Driver *drvthis, Peer *peer, const char *why)
+{
+	if (peer->state == PEER_UP)
+		report(RPT_WARNING, "%s: lost %s: %s", drvthis->name, peer->name, why);
+	else
+		debug(RPT_DEBUG, "%s: cannot connect to %s: %s", drvthis->name, peer->name, why);
+
+	if (peer->sock >= 0)
+		close(peer->sock);
+	peer->sock = -1;
+	peer->state = PEER_DOWN;
+	peer->deadline = time(NULL) + FORWARD_RECONNECT_DELAY;
+}
+
+/**
+ * Send a buffer to a remote. A remote that does not take it all at once
+ * is dropped, as a partial message would corrupt the stream.
+ */
+static void
+forward_peer_send(Driver *drvthis, Peer *peer, Buffer *b)
+{
+	int len;
+
+	if (b->len == 0)
+		return;
+
+	len = write(peer->sock, b->data, b->len);
+	if (len != b->len)
+		forward_peer_down(drvthis, peer, (len < 0) ? strerror(errno) : "cannot keep up");
+}
+
+/** Start connecting to a remote. */
+static void
+forward_peer_connect(Driver *drvthis, Peer *peer)
+{
+	int one = 1;
+
+	peer->sock = socket(PF_INET, SOCK_STREAM, 0);
+	if (peer->sock < 0) {
+		forward_peer_down(drvthis, peer, strerror(errno));
+		return;
+	}
+	fcntl(peer->sock, F_SETFL, fcntl(peer->sock, F_GETFL, 0) | O_NONBLOCK);
+	setsockopt(peer->sock, IPPROTO_TCP, TCP_NODELAY, (void *) &one, sizeof(one));
+
+	peer->state = PEER_CONNECTING;
+	peer->deadline = time(NULL) + FORWARD_CONNECT_TIMEOUT;
+	if ((connect(peer->sock, (struct sockaddr *) &peer->addr, sizeof(peer->addr)) < 0)
+	    && (errno != EINPROGRESS))
+		forward_peer_down(drvthis, peer, strerror(errno));
+}
+
+/**
+ * Advance the connection to a remote that is not up. Returns 1 if it has
+ * just been established.
+ */
+static int
+forward_peer_poll(Driver *drvthis, Peer *peer)
+{
+	struct timeval tv = { 0, 0 };
+	fd_set wfds;
+	int err = 0;
+	socklen_t len = sizeof(err);
+
+	if (peer->state == PEER_DOWN) {
+		if (time(NULL) < peer->deadline)
+			return 0;
+		forward_peer_connect(drvthis, peer);
+		if (peer->state != PEER_CONNECTING)
+			return 0;
+	}
+
+	FD_ZERO(&wfds);
+	FD_SET(peer->sock, &wfds);
+	if (select(peer->sock + 1, NULL, &wfds, NULL, &tv) <= 0) {
+		if (time(NULL) >= peer->deadline)
+			forward_peer_down(drvthis, peer, "timeout");
+		return 0;
+	}
+	if ((getsockopt(peer->sock, SOL_SOCKET, SO_ERROR, &err, &len) < 0) || (err != 0)) {
+		forward_peer_down(drvthis, peer, strerror(err ? err : errno));
+		return 0;
+	}
+
+	report(RPT_INFO, "%s: connected to %s", drvthis->name, peer->name);
+	peer->state = PEER_UP;
+	return 1;
+}
+
+/** Parse a Host= value and set up the remote for it. */
+static int
+forward_add_peer(Driver *drvthis, const char *s)
+{
+	PrivateData *p = drvthis->private_data;
+	Peer *peer = &p->peers[p->num_peers];
+	char host[sizeof(peer->name) - 8];
+	struct hostent *he;
+	char *colon;
+	int port = FWD_DEFAULT_PORT;
+
+	strncpy(host, s, sizeof(host));
+	host[sizeof(host) - 1] = '\0';
+	colon = strrchr(host, ':');
+	if (colon != NULL) {
+		*colon = '\0';
+		port = atoi(colon + 1);
+		if ((port <= 0) || (port > 65535)) {
+			report(RPT_ERR, "%s: invalid port in Host: %s", drvthis->name, s);
+			return -1;
+		}
+	}
+
+	he = gethostbyname(host);
+	if ((he == NULL) || (he->h_addrtype != AF_INET)) {
+		report(RPT_ERR, "%s: unknown host %s", drvthis->name, host);
+		return -1;
+	}
+
+	memset(peer, 0, sizeof(*peer));
+	snprintf(peer->name, sizeof(peer->name), "%s:%d", host, port);
+	peer->addr.sin_family = AF_INET;
+	peer->addr.sin_port = htons(port);
+	memcpy(&peer->addr.sin_addr, he->h_addr_list[0], sizeof(peer->addr.sin_addr));
+	peer->sock = -1;
+	peer->state = PEER_DOWN;
+	peer->deadline = 0;
+
+	p->num_peers++;
+	report(RPT_INFO, "%s: forwarding to %s", drvthis->name, peer->name);
+	return 0;
+}
+
+
+/**
+ * Initialize the driver.
+ * \param drvthis  Pointer to driver structure.
+ * \retval 0       Success.
+ * \retval <0      Error.
+ */
+MODULE_EXPORT int
+forward_init (Driver *drvthis)
+{
+	PrivateData *p;
+	char buf[256];
+	const char *s;
+
+	/* Allocate and store private data */
+	p = (PrivateData *) calloc(1, sizeof(PrivateData));
+	if (p == NULL)
+		return -1;
+	if (drvthis->store_private_ptr(drvthis, p))
+		return -1;
+
+	/* initialize private data */
+	p->ccmode = p->last_ccmode = standard;
+	p->backlight = p->last_backlight = -1;
+
+	// Set display sizes
+	if ((drvthis->request_display_width() > 0)
+	    && (drvthis->request_display_height() > 0)) {
+		// Use size from primary driver
+		p->width = drvthis->request_display_width();
+		p->height = drvthis->request_display_height();
+	}
+	else {
+		/* Use our own size from config file */
+		strncpy(buf, drvthis->config_get_string(drvthis->name, "Size", 0, FORWARD_DEFAULT_SIZE), sizeof(buf));
+		buf[sizeof(buf)-1] = '\0';
+		if ((sscanf(buf , "%dx%d", &p->width, &p->height) != 2)
+		    || (p->width <= 0) || (p->width > LCD_MAX_WIDTH)
+		    || (p->height <= 0) || (p->height > LCD_MAX_HEIGHT)) {
+			report(RPT_WARNING, "%s: cannot read Size: %s; using default %s",
+					drvthis->name, buf, FORWARD_DEFAULT_SIZE);
+			sscanf(FORWARD_DEFAULT_SIZE, "%dx%d", &p->width, &p->height);
+		}
+	}
+	/* HELLO has one byte for each */
+	if ((p->width > 255) || (p->height > 255)) {
+		report(RPT_ERR, "%s: size %dx%d is too large to forward",
+				drvthis->name, p->width, p->height);
+		return -1;
+	}
+
+	/* Remotes */
+	while ((p->num_peers < FORWARD_MAX_PEERS)
+	       && ((s = drvthis->config_get_string(drvthis->name, "Host", p->num_peers, NULL)) != NULL)) {
+		if (forward_add_peer(drvthis, s) < 0)
+			return -1;
+	}
+	if (p->num_peers == 0) {
+		report(RPT_ERR, "%s: no Host configured", drvthis->name);
+		return -1;
+	}
+
+	// Allocate the framebuffers
+	p->framebuf = malloc(p->width * p->height);
+	p->last_framebuf = malloc(p->width * p->height);
+	if ((p->framebuf == NULL) || (p->last_framebuf == NULL)) {
+		report(RPT_ERR, "%s: unable to create framebuffer", drvthis->name);
+		return -1;
+	}
+	memset(p->framebuf, ' ', p->width * p->height);
+	memset(p->last_framebuf, ' ', p->width * p->height);
+
+	report(RPT_DEBUG, "%s: init() done", drvthis->name);
+
+	return 0;
+}
+
+
+/**
+ * Close the driver (do necessary clean-up).
+ * \param drvthis  Pointer to driver structure.
+ */
+MODULE_EXPORT void
+forward_close (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+	int i;
+
+	if (p != NULL) {
+		for (i = 0; i < p->num_peers; i++) {
+			if (p->peers[i].sock >= 0)
+				close(p->peers[i].sock);
+		}
+		free(p->framebuf);
+		free(p->last_framebuf);
+		free(p->delta.data);
+		free(p->sync.data);
+
+		free(p);
+	}
+	drvthis->store_private_ptr(drvthis, NULL);
+}
+
+
+/**
+ * Return the display width in characters.
+ * \param drvthis  Pointer to driver structure.
+ * \return         Number of characters the display is wide.
+ */
+MODULE_EXPORT int
+forward_width (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+
+	return p->width;
+}
+
+
+/**
+ * Return the display height in characters.
+ * \param drvthis  Pointer to driver structure.
+ * \return         Number of characters the display is high.
+ */
+MODULE_EXPORT int
+forward_height (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+
+	return p->height;
+}
+
+
+/**
+ * Return the width of a character in pixels.
+ * \param drvthis  Pointer to driver structure.
+ * \return         Number of pixel columns a character cell is wide.
+ */
+MODULE_EXPORT int
+forward_cellwidth (Driver *drvthis)
+{
+	return LCD_DEFAULT_CELLWIDTH;
+}
+
+
+/**
+ * Return the height of a character in pixels.
+ * \param drvthis  Pointer to driver structure.
+ * \return         Number of pixel lines a character cell is high.
+ */
+MODULE_EXPORT int
+forward_cellheight (Driver *drvthis)
+{
+	return FWD_CELLHEIGHT;
+}
+
+
+/**
+ * Clear the screen.
+ * \param drvthis  Pointer to driver structure.
+ */
+MODULE_EXPORT void
+forward_clear (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+
+	memset(p->framebuf, ' ', p->width * p->height);
+	p->ccmode = standard;
+}
+
+
+/**
+ * Send what changed since the last flush to all remotes, and the complete
+ * state to those that have just been connected.
+ * \param drvthis  Pointer to driver structure.
+ */
+MODULE_EXPORT void
+forward_flush (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+	int i;
+
+	forward_build_delta(p);
+	memcpy(p->last_framebuf, p->framebuf, p->width * p->height);
+	p->cc_dirty = 0;
+	p->last_backlight = p->backlight;
+	p->last_output = p->output;
+	p->sync.len = 0;
+
+	for (i = 0; i < p->num_peers; i++) {
+		Peer *peer = &p->peers[i];
+
+		if (peer->state == PEER_UP) {
+			forward_peer_send(drvthis, peer, &p->delta);
+		}
+		else if (forward_peer_poll(drvthis, peer)) {
+			if (p->sync.len == 0)
+				forward_build_sync(p);
+			forward_peer_send(drvthis, peer, &p->sync);
+		}
+	}
+}
+
+
+/**
+ * Print a string on the screen at position (x,y).
+ * The upper-left corner is (1,1), the lower-right corner is (p->width, p->height).
+ * \param drvthis  Pointer to driver structure.
+ * \param x        Horizontal character position (column).
+ * \param y        Vertical character position (row).
+ * \param string   String that gets written.
+ */
+MODULE_EXPORT void
+forward_string (Driver *drvthis, int x, int y, const char string[])
+{
+	PrivateData *p = drvthis->private_data;
+	int i;
+
+	x--;  // Convert 1-based coords to 0-based
+	y--;
+
+	if ((y < 0) || (y >= p->height))
+		return;
+
+	for (i = 0; (string[i] != '\0') && (x < p->width); i++, x++) {
+		if (x >= 0)	// no write left of left border
+			p->framebuf[(y * p->width) + x] = string[i];
+	}
+}
+
+
+/**
+ * Print a character on the screen at position (x,y).
+ * The upper-left corner is (1,1), the lower-right corner is (p->width, p->height).
+ * \param drvthis  Pointer to driver structure.
+ * \param x        Horizontal character position (column).
+ * \param y        Vertical character position (row).
+ * \param c        Character that gets written.
+ */
+MODULE_EXPORT void
+forward_chr (Driver *drvthis, int x, int y, char c)
+{
+	PrivateData *p = drvthis->private_data;
+
+	x--;
+	y--;
+
+	if ((x >= 0) && (y >= 0) && (x < p->width) && (y < p->height))
+		p->framebuf[(y * p->width) + x] = c;
+}
+
+
+/**
+ * Get total number of custom characters available.
+ * \param drvthis  Pointer to driver structure.
+ * \return         Number of custom characters (always FWD_NUM_CHARS).
+ */
+MODULE_EXPORT int
+forward_get_free_chars (Driver *drvthis)
+{
+	return FWD_NUM_CHARS;
+}
+
+
+/**
+ * Define a custom character. It is sent with the next flush if it changed.
+ * \param drvthis  Pointer to driver structure.
+ * \param n        Custom character to define [0 - (FWD_NUM_CHARS-1)].
+ * \param dat      Array of 8 (= cellheight) bytes, each representing a row
+ *                 starting from the top.
+ */
+MODULE_EXPORT void
+forward_set_char (Driver *drvthis, int n, unsigned char *dat)
+{
+	PrivateData *p = drvthis->private_data;
+	unsigned char mask = (1 << LCD_DEFAULT_CELLWIDTH) - 1;
+	int row;
+
+	if ((n < 0) || (n >= FWD_NUM_CHARS) || (!dat))
+		return;
+
+	for (row = 0; row < FWD_CELLHEIGHT; row++) {
+		unsigned char data = dat[row] & mask;
+
+		if (p->cc[n][row] != data) {
+			p->cc[n][row] = data;
+			p->cc_dirty |= 1 << n;
+		}
+	}
+	if (!(p->cc_defined & (1 << n))) {
+		p->cc_defined |= 1 << n;
+		p->cc_dirty |= 1 << n;
+	}
+}
+
+
+/**
+ * Set up vertical bars.
+ * \param drvthis  Pointer to driver structure.
+ */
+static void
+forward_init_vbar (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+	unsigned char vbar_char[FWD_CELLHEIGHT];
+	int i;
+
+	if (p->last_ccmode == vbar)	/* Work already done */
+		return;
+
+	if (p->ccmode != standard) {
+		/* Not supported (yet) */
+		report(RPT_WARNING, "%s: init_vbar: cannot combine two modes using user-defined characters",
+		       drvthis->name);
+		return;
+	}
+
+	p->ccmode = p->last_ccmode = vbar;
+
+	memset(vbar_char, 0x00, sizeof(vbar_char));
+	for (i = 1; i < FWD_CELLHEIGHT; i++) {
+		/* add pixel line per pixel line ... */
+		vbar_char[FWD_CELLHEIGHT - i] = 0xFF;
+		forward_set_char(drvthis, i, vbar_char);
+	}
+}
+
+
+/**
+ * Set up horizontal bars.
+ * \param drvthis  Pointer to driver structure.
+ */
+static void
+forward_init_hbar (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+	unsigned char hbar_char[FWD_CELLHEIGHT];
+	int i;
+
+	if (p->last_ccmode == hbar)	/* Work already done */
+		return;
+
+	if (p->ccmode != standard) {
+		/* Not supported (yet) */
+		report(RPT_WARNING, "%s: init_hbar: cannot combine two modes using user-defined characters",
+		       drvthis->name);
+		return;
+	}
+
+	p->ccmode = p->last_ccmode = hbar;
+
+	for (i = 1; i <= LCD_DEFAULT_CELLWIDTH; i++) {
+		/* fill pixel columns from left to right. */
+		memset(hbar_char, 0xFF & ~((1 << (LCD_DEFAULT_CELLWIDTH - i)) - 1), sizeof(hbar_char));
+		forward_set_char(drvthis, i, hbar_char);
+	}
+}
+
+
+/**
+ * Draw a vertical bar bottom-up.
+ * \param drvthis  Pointer to driver structure.
+ * \param x        Horizontal character position (column) of the starting point.
+ * \param y        Vertical character position (row) of the starting point.
+ * \param len      Number of characters that the bar is high at 100%
+ * \param promille Current height level of the bar in promille.
+ * \param options  Options (currently unused).
+ */
+MODULE_EXPORT void
+forward_vbar (Driver *drvthis, int x, int y, int len, int promille, int options)
+{
+	forward_init_vbar(drvthis);
+	lib_vbar_static(drvthis, x, y, len, promille, options, FWD_CELLHEIGHT, 0);
+}
+
+
+/**
+ * Draw a horizontal bar to the right.
+ * \param drvthis  Pointer to driver structure.
+ * \param x        Horizontal character position (column) of the starting point.
+ * \param y        Vertical character position (row) of the starting point.
+ * \param len      Number of characters that the bar is long at 100%
+ * \param promille Current length level of the bar in promille.
+ * \param options  Options (currently unused).
+ */
+MODULE_EXPORT void
+forward_hbar (Driver *drvthis, int x, int y, int len, int promille, int options)
+{
+	forward_init_hbar(drvthis);
+	lib_hbar_static(drvthis, x, y, len, promille, options, LCD_DEFAULT_CELLWIDTH, 0);
+}
+
+
+/**
+ * Write a big number to the screen.
+ * \param drvthis  Pointer to driver structure.
+ * \param x        Horizontal character position (column).
+ * \param num      Character to write (0 - 10 with 10 representing ':')
+ */
+MODULE_EXPORT void
+forward_num (Driver *drvthis, int x, int num)
+{
+	PrivateData *p = drvthis->private_data;
+	int do_init = 0;
+
+	if ((num < 0) || (num > 10))
+		return;
+
+	if (p->ccmode != bignum) {
+		if (p->ccmode != standard) {
+			/* Not supported (yet) */
+			report(RPT_WARNING, "%s: num: cannot combine two modes using user-defined characters",
+			       drvthis->name);
+			return;
+		}
+
+		p->ccmode = bignum;
+		do_init = 1;
+	}
+
+	p->last_ccmode = bignum;
+	lib_adv_bignum(drvthis, x, num, 0, do_init);
+}
+
+
+/**
+ * Place an icon on the screen.
+ * \param drvthis  Pointer to driver structure.
+ * \param x        Horizontal character position (column).
+ * \param y        Vertical character position (row).
+ * \param icon     synbolic value representing the icon.
+ * \retval 0       Icon has been successfully defined/written.
+ * \retval <0      Server core shall define/write the icon.
+ */
+MODULE_EXPORT int
+forward_icon (Driver *drvthis, int x, int y, int icon)
+{
+	static unsigned char heart_open[] = {
+		b__XXXXX,
+		b__X_X_X,
+		b_______,
+		b_______,
+		b_______,
+		b__X___X,
+		b__XX_XX,
+		b__XXXXX
+	};
+
+	static unsigned char heart_filled[] = {
+		b__XXXXX,
+		b__X_X_X,
+		b___X_X_,
+		b___XXX_,
+		b___XXX_,
+		b__X_X_X,
+		b__XX_XX,
+		b__XXXXX
+	};
+
+	switch (icon) {
+		case ICON_BLOCK_FILLED:
+			forward_chr(drvthis, x, y, 255);
+			break;
+		case ICON_HEART_FILLED:
+			forward_set_char(drvthis, 0, heart_filled);
+			forward_chr(drvthis, x, y, 0);
+			break;
+		case ICON_HEART_OPEN:
+			forward_set_char(drvthis, 0, heart_open);
+			forward_chr(drvthis, x, y, 0);
+			break;
+		default:
+			return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * Turn the backlight on or off.
+ * \param drvthis  Pointer to driver structure.
+ * \param on       New backlight status.
+ */
+MODULE_EXPORT void
+forward_backlight (Driver *drvthis, int on)
+{
+	PrivateData *p = drvthis->private_data;
+
+	p->backlight = on;
+}
+
+
+/**
+ * Set the output port (LEDs etc.).
+ * \param drvthis  Pointer to driver structure.
+ * \param state    Integer with bits representing port states.
+ */
+MODULE_EXPORT void
+forward_output (Driver *drvthis, int state)
+{
+	PrivateData *p = drvthis->private_data;
+
+	p->output = state;
+}
+
+
+/**
+ * Provide some information about this driver.
+ * \param drvthis  Pointer to driver structure.
+ * \return         Constant string with information.
+ */
+MODULE_EXPORT const char *
+forward_get_info (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+	int i, up = 0;
+
+	for (i = 0; i < p->num_peers; i++) {
+		if (p->peers[i].state == PEER_UP)
+			up++;
+	}
+	snprintf(p->info, sizeof(p->info), "Forwarding to %d of %d LCDd", up, p->num_peers);
+	return p->info;
+}
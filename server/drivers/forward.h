@@ -0,0 +1,32 @@
+#ifndef LCD_FORWARD_H
+#define LCD_FORWARD_H
+
+MODULE_EXPORT int  forward_init (Driver *drvthis);
+MODULE_EXPORT void forward_close (Driver *drvthis);
+MODULE_EXPORT int  forward_width (Driver *drvthis);
+MODULE_EXPORT int  forward_height (Driver *drvthis);
+MODULE_EXPORT int  forward_cellwidth (Driver *drvthis);
+MODULE_EXPORT int  forward_cellheight (Driver *drvthis);
+MODULE_EXPORT void forward_clear (Driver *drvthis);
+MODULE_EXPORT void forward_flush (Driver *drvthis);
+MODULE_EXPORT void forward_string (Driver *drvthis, int x, int y, const char string[]);
+MODULE_EXPORT void forward_chr (Driver *drvthis, int x, int y, char c);
+
+MODULE_EXPORT void forward_vbar (Driver *drvthis, int x, int y, int len, int promille, int options);
+MODULE_EXPORT void forward_hbar (Driver *drvthis, int x, int y, int len, int promille, int options);
+MODULE_EXPORT void forward_num (Driver *drvthis, int x, int num);
+MODULE_EXPORT int  forward_icon (Driver *drvthis, int x, int y, int icon);
+MODULE_EXPORT void forward_set_char (Driver *drvthis, int n, unsigned char *dat);
+MODULE_EXPORT int  forward_get_free_chars (Driver *drvthis);
+
+MODULE_EXPORT void forward_backlight (Driver *drvthis, int on);
+MODULE_EXPORT void forward_output (Driver *drvthis, int state);
+MODULE_EXPORT const char * forward_get_info (Driver *drvthis);
+
+#define FORWARD_DEFAULT_SIZE	"20x4"
+#define FORWARD_MAX_PEERS	16	/**< Most Host= entries used */
+#define FORWARD_CONNECT_TIMEOUT	5	/**< Seconds a connection may take */
+#define FORWARD_RECONNECT_DELAY	5	/**< Seconds between connection attempts */
+#define FORWARD_RUN_GAP		4	/**< Unchanged cells merged into a text run */
+
+#endif
@@ -6,6 +6,13 @@
  * and ENC28J60 ethernet controller. The device is connected via ethernet, has
  * its own IP address and is available via TCP protocol. More info at project
  * homepage: http://manio.skyboo.net/ethlcd/
+ *
+ * The device answers every command with its command byte. Instead of
+ * waiting for that answer after each command, commands are collected and
+ * sent in one write per flush, and the answers are checked as they arrive,
+ * with at most ETHLCD_WINDOW commands outstanding. When the connection
+ * fails the driver keeps running, tries to reconnect every
+ * ETHLCD_RECONNECT_DELAY seconds and redraws the whole display afterwards.
  */
 
 /*-
@@ -18,7 +25,14 @@
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <stdlib.h>
 
 #include "lcd.h"
@@ -27,14 +41,31 @@
 #include "shared/sockets.h"
 #include "shared/report.h"
 
+/** State of the connection to the device */
+typedef struct ethlcd_conn {
+	struct sockaddr_in addr;	/**< Address of the device */
+	time_t next_connect;		/**< Time of the next reconnect attempt */
+	unsigned char tx[2 * ETHLCD_WINDOW];	/**< Commands not sent yet */
+	int txlen;			/**< Number of bytes in \c tx */
+	unsigned char acks[ETHLCD_WINDOW];	/**< Answers expected, in a ring */
+	int ackhead;			/**< Index of the oldest expected answer */
+	int ackcount;			/**< Number of answers expected */
+} ethlcd_conn;
+
 
 void ethlcd_HD44780_senddata(PrivateData *p, unsigned char displayID, unsigned char flags, unsigned char ch);
+void ethlcd_HD44780_flush(PrivateData *p);
 unsigned char ethlcd_HD44780_scankeypad(PrivateData *p);
 void ethlcd_HD44780_backlight(PrivateData *p, unsigned char state);
 void ethlcd_HD44780_close(PrivateData *p);
 
-/* helper function */
-static void ethlcd_send_low(PrivateData *p, unsigned char *data, int length);
+/* helper functions */
+static int ethlcd_connect(PrivateData *p, int timeout);
+static void ethlcd_disconnect(PrivateData *p, const char *what);
+static void ethlcd_reconnect(PrivateData *p);
+static void ethlcd_queue(PrivateData *p, unsigned char cmd, unsigned char arg);
+static int ethlcd_send_queued(PrivateData *p);
+static int ethlcd_read_answers(PrivateData *p, int wait);
 
 /* fake pause function (pausing is handled by ethlcd device itself) */
 void
@@ -52,53 +83,47 @@ int
 hd_init_ethlcd(Driver *drvthis)
 {
 	char hostname[256];
-	unsigned long flags = 0;
-	struct timeval tv;
+	struct hostent *host;
+	ethlcd_conn *c;
 
 	PrivateData *p = (PrivateData *) drvthis->private_data;
 	HD44780_functions *hd44780_functions = p->hd44780_functions;
 
 	hd44780_functions->senddata = ethlcd_HD44780_senddata;
+	hd44780_functions->flush = ethlcd_HD44780_flush;
 	hd44780_functions->backlight = ethlcd_HD44780_backlight;
 	hd44780_functions->scankeypad = ethlcd_HD44780_scankeypad;
 	hd44780_functions->uPause = ethlcd_HD44780_uPause;
 	hd44780_functions->close = ethlcd_HD44780_close;
 
-	/* reading configuration file */
-	strncpy(hostname, drvthis->config_get_string(drvthis->name, "Device", 0, "ethlcd"), sizeof(hostname));
-	hostname[sizeof(hostname) - 1] = '\0';
-
-	p->sock = sock_connect(hostname, DEFAULT_ETHLCD_PORT);
-	if (p->sock < 0) {
-		report(RPT_ERR, "%s[%s]: Connecting to %s:%d failed",
-			drvthis->name, ETHLCD_DRV_NAME, hostname, DEFAULT_ETHLCD_PORT);
+	p->sock = -1;
+	c = calloc(1, sizeof(ethlcd_conn));
+	if (c == NULL) {
+		report(RPT_ERR, "%s[%s]: unable to allocate memory",
+			drvthis->name, ETHLCD_DRV_NAME);
 		return -1;
 	}
+	p->connection_data = c;
 
-	/* we need to have a blocking read back again: */
-	if (fcntl(p->sock, F_GETFL, &flags) < 0) {
-		report(RPT_ERR, "%s[%s]: Cannot obtain current flags: %s",
-			drvthis->name, ETHLCD_DRV_NAME, strerror(errno));
-		return -1;
-	}
-	flags &= ~O_NONBLOCK;
-	if (fcntl(p->sock, F_SETFL, flags) < 0) {
-		report(RPT_ERR, "%s[%s]: Unable to change socket to O_NONBLOCK: %s",
-			drvthis->name, ETHLCD_DRV_NAME, strerror(errno));
-		return -1;
-	}
+	/* reading configuration file */
+	strncpy(hostname, drvthis->config_get_string(drvthis->name, "Device", 0, "ethlcd"), sizeof(hostname));
+	hostname[sizeof(hostname) - 1] = '\0';
 
-	/* setting timeouts */
-	tv.tv_sec = ETHLCD_TIMEOUT;
-	tv.tv_usec = 0;
-	if (setsockopt(p->sock, SOL_SOCKET, SO_RCVTIMEO, (void *)&tv, sizeof(struct timeval)) < 0) {
-		report(RPT_ERR, "%s[%s]: Cannot set receive timeout: %s",
-			drvthis->name, ETHLCD_DRV_NAME, strerror(errno));
+	/* Resolve only once, a reconnect must not wait for a name server */
+	host = gethostbyname(hostname);
+	if (host == NULL || host->h_addrtype != AF_INET) {
+		report(RPT_ERR, "%s[%s]: Unknown host %s",
+			drvthis->name, ETHLCD_DRV_NAME, hostname);
 		return -1;
 	}
-	if (setsockopt(p->sock, SOL_SOCKET, SO_SNDTIMEO, (void *)&tv, sizeof(struct timeval)) < 0) {
-		report(RPT_ERR, "%s[%s]: Cannot set send timeout: %s",
-			drvthis->name, ETHLCD_DRV_NAME, strerror(errno));
+	c->addr.sin_family = AF_INET;
+	c->addr.sin_port = htons(DEFAULT_ETHLCD_PORT);
+	memcpy(&c->addr.sin_addr, host->h_addr_list[0], sizeof(c->addr.sin_addr));
+
+	if (ethlcd_connect(p, ETHLCD_TIMEOUT) < 0) {
+		report(RPT_ERR, "%s[%s]: Connecting to %s:%d failed: %s",
+			drvthis->name, ETHLCD_DRV_NAME, hostname, DEFAULT_ETHLCD_PORT,
+			strerror(errno));
 		return -1;
 	}
 
@@ -126,15 +151,32 @@ hd_init_ethlcd(Driver *drvthis)
 void
 ethlcd_HD44780_senddata(PrivateData *p, unsigned char displayID, unsigned char flags, unsigned char ch)
 {
-	static unsigned char buff[2];
-
 	if (flags == RS_INSTR)
-		buff[0] = ETHLCD_SEND_INSTR;
+		ethlcd_queue(p, ETHLCD_SEND_INSTR, ch);
 	else			/* RS_DATA */
-		buff[0] = ETHLCD_SEND_DATA;
-	buff[1] = ch;
+		ethlcd_queue(p, ETHLCD_SEND_DATA, ch);
+}
+
+
+/**
+ * Send the collected commands to the device. Answers that have already
+ * arrived are checked, but there is no waiting for the others. While the
+ * connection is down this is where it is re-established.
+ * \param p  Pointer to driver's private data structure.
+ */
+void
+ethlcd_HD44780_flush(PrivateData *p)
+{
+	ethlcd_conn *c = (ethlcd_conn *) p->connection_data;
+
+	if (p->sock < 0) {
+		if (time(NULL) >= c->next_connect)
+			ethlcd_reconnect(p);
+		return;
+	}
 
-	ethlcd_send_low(p, buff, 2);
+	if (ethlcd_send_queued(p) == 0)
+		ethlcd_read_answers(p, 0);
 }
 
 
@@ -147,11 +189,35 @@ unsigned char
 ethlcd_HD44780_scankeypad(PrivateData *p)
 {
 	unsigned char readval;
-	static unsigned char buff[2];
+	unsigned char buff[2];
+	int len, got;
 
-	buff[0] = ETHLCD_GET_BUTTONS;
+	if (p->sock < 0)
+		return ('\0');
+
+	/* The answer must not be mixed up with those of pending commands */
+	if ((ethlcd_send_queued(p) < 0) || (ethlcd_read_answers(p, 1) < 0))
+		return ('\0');
 
-	ethlcd_send_low(p, buff, 1);
+	buff[0] = ETHLCD_GET_BUTTONS;
+	if (write(p->sock, buff, 1) != 1) {
+		ethlcd_disconnect(p, "Write to socket");
+		return ('\0');
+	}
+	for (got = 0; got < 2; got += len) {
+		len = read(p->sock, buff + got, 2 - got);
+		if (len <= 0) {
+			if (len == 0)
+				errno = ECONNRESET;
+			ethlcd_disconnect(p, "Read from socket");
+			return ('\0');
+		}
+	}
+	if (buff[0] != ETHLCD_GET_BUTTONS) {
+		errno = EPROTO;
+		ethlcd_disconnect(p, "Reading keys");
+		return ('\0');
+	}
 
 	/* answer should be in second byte on bits 0-6 in negative logic: */
 	readval = buff[1];
@@ -184,20 +250,18 @@ ethlcd_HD44780_scankeypad(PrivateData *p)
 void
 ethlcd_HD44780_backlight(PrivateData *p, unsigned char state)
 {
-	static unsigned char buff[2];
-
-	buff[0] = ETHLCD_SET_BACKLIGHT;
+	unsigned char level;
 
 	if (state == BACKLIGHT_ON) {
 		if (p->brightness >= 500)
-			buff[1] = ETHLCD_BACKLIGHT_ON;
+			level = ETHLCD_BACKLIGHT_ON;
 		else
-			buff[1] = ETHLCD_BACKLIGHT_HALF;
+			level = ETHLCD_BACKLIGHT_HALF;
 	}
 	else
-		buff[1] = ETHLCD_BACKLIGHT_OFF;
+		level = ETHLCD_BACKLIGHT_OFF;
 
-	ethlcd_send_low(p, buff, 2);
+	ethlcd_queue(p, ETHLCD_SET_BACKLIGHT, level);
 }
 
 
@@ -208,52 +272,230 @@ ethlcd_HD44780_backlight(PrivateData *p, unsigned char state)
 void
 ethlcd_HD44780_close(PrivateData *p)
 {
-	sock_close(p->sock);
+	if (p->sock >= 0) {
+		if (ethlcd_send_queued(p) == 0)
+			ethlcd_read_answers(p, 1);
+	}
+	if (p->sock >= 0)
+		sock_close(p->sock);
+	free(p->connection_data);
+	p->connection_data = NULL;
 }
 
 
 /**
- * Send the data to ethlcd device.
- * \param p       Pointer to driver's private data structure.
- * \param data    Pointer to buffer with data to send.
- * \param length  Number of bytes to send.
- *
- * \todo  This functions makes LCDd exit on fatal error without any clean-up.
- *        There is currently no way to make LCDd exit cleanly in those cases.
+ * Open the connection to the device, waiting at most \c timeout seconds.
+ * \param p        Pointer to driver's private data structure.
+ * \param timeout  Seconds to wait for the connection.
+ * \retval 0       Success, \c p->sock is the connected socket.
+ * \retval -1      Error, \c errno tells why.
+ */
+static int
+ethlcd_connect(PrivateData *p, int timeout)
+{
+	ethlcd_conn *c = (ethlcd_conn *) p->connection_data;
+	struct timeval tv;
+	fd_set wfds;
+	int sock, flags, err;
+	socklen_t len = sizeof(err);
+	int one = 1;
+
+	sock = socket(PF_INET, SOCK_STREAM, 0);
+	if (sock < 0)
+		return -1;
+
+	/* Connect without blocking, a dead device must not stall the server */
+	flags = fcntl(sock, F_GETFL, 0);
+	if ((flags < 0) || (fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0))
+		goto fail;
+	if (connect(sock, (struct sockaddr *) &c->addr, sizeof(c->addr)) < 0) {
+		if (errno != EINPROGRESS)
+			goto fail;
+
+		FD_ZERO(&wfds);
+		FD_SET(sock, &wfds);
+		tv.tv_sec = timeout;
+		tv.tv_usec = 0;
+		err = select(sock + 1, NULL, &wfds, NULL, &tv);
+		if (err <= 0) {
+			if (err == 0)
+				errno = ETIMEDOUT;
+			goto fail;
+		}
+		if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+			goto fail;
+		if (err != 0) {
+			errno = err;
+			goto fail;
+		}
+	}
+
+	/* Blocking I/O with timeouts from here on */
+	if (fcntl(sock, F_SETFL, flags & ~O_NONBLOCK) < 0)
+		goto fail;
+	tv.tv_sec = ETHLCD_TIMEOUT;
+	tv.tv_usec = 0;
+	if ((setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (void *) &tv, sizeof(tv)) < 0) ||
+	    (setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (void *) &tv, sizeof(tv)) < 0))
+		goto fail;
+
+	/* Each flush is one write, holding it back only adds latency */
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (void *) &one, sizeof(one));
+
+	p->sock = sock;
+	c->txlen = 0;
+	c->ackhead = 0;
+	c->ackcount = 0;
+	return 0;
+
+fail:
+	err = errno;
+	close(sock);
+	errno = err;
+	return -1;
+}
+
+
+/**
+ * Drop a failed connection and schedule a reconnect.
+ * \param p     Pointer to driver's private data structure.
+ * \param what  Operation that failed, for the log.
  */
 static void
-ethlcd_send_low(PrivateData *p, unsigned char *data, int length)
+ethlcd_disconnect(PrivateData *p, const char *what)
 {
-	int response_len, len;
-	unsigned char cmd;
-
-	/* Send data to device */
-	cmd = data[0];		/* store command byte for verification */
-	len = sock_send(p->sock, data, length);
-	if (len <= 0) {
-		p->hd44780_functions->drv_report(RPT_CRIT, "%s: Write to socket failed: %s. Exiting",
-					  ETHLCD_DRV_NAME, strerror(errno));
-		exit(-1);
+	ethlcd_conn *c = (ethlcd_conn *) p->connection_data;
+
+	p->hd44780_functions->drv_report(RPT_ERR, "%s: %s failed: %s. Reconnecting",
+				  ETHLCD_DRV_NAME, what, strerror(errno));
+	close(p->sock);
+	p->sock = -1;
+	c->txlen = 0;
+	c->ackcount = 0;
+	c->next_connect = time(NULL) + ETHLCD_RECONNECT_DELAY;
+}
+
+
+/**
+ * Try to reconnect to the device. On success the display is initialized
+ * again and completely redrawn on the next flush.
+ * \param p  Pointer to driver's private data structure.
+ */
+static void
+ethlcd_reconnect(PrivateData *p)
+{
+	ethlcd_conn *c = (ethlcd_conn *) p->connection_data;
+	int i;
+
+	if (ethlcd_connect(p, ETHLCD_CONNECT_TIMEOUT) < 0) {
+		p->hd44780_functions->drv_debug(RPT_DEBUG, "%s: Reconnect failed: %s",
+					 ETHLCD_DRV_NAME, strerror(errno));
+		c->next_connect = time(NULL) + ETHLCD_RECONNECT_DELAY;
+		return;
 	}
+	p->hd44780_functions->drv_report(RPT_NOTICE, "%s: Reconnected", ETHLCD_DRV_NAME);
 
-	/* Check if this is a command with reply */
-	if (cmd == ETHLCD_GET_BUTTONS)
-		response_len = 2;
-	else
-		response_len = 1;
-
-	/* Wait for reply */
-	len = sock_recv(p->sock, data, response_len);
-	if (len <= 0) {
-		p->hd44780_functions->drv_report(RPT_CRIT, "%s: Read from socket failed: %s. Exiting",
-					  ETHLCD_DRV_NAME, strerror(errno));
-		exit(-1);
+	p->hd44780_functions->senddata(p, 0, RS_INSTR, FUNCSET | IF_4BIT | TWOLINE | SMALLCHAR);
+	common_init(p, IF_4BIT);
+	if ((p->backlightstate == BACKLIGHT_ON) || (p->backlightstate == BACKLIGHT_OFF))
+		ethlcd_HD44780_backlight(p, p->backlightstate);
+
+	/* The device has forgotten everything */
+	p->forcerefresh = 1;
+	for (i = 0; i < NUM_CCs; i++)
+		p->cc[i].clean = 0;
+}
+
+
+/**
+ * Add a command to the ones to be sent on the next flush. If too many
+ * answers are outstanding, the collected commands are sent and all
+ * answers awaited first. Commands are dropped while disconnected.
+ * \param p    Pointer to driver's private data structure.
+ * \param cmd  Command byte.
+ * \param arg  Argument byte.
+ */
+static void
+ethlcd_queue(PrivateData *p, unsigned char cmd, unsigned char arg)
+{
+	ethlcd_conn *c = (ethlcd_conn *) p->connection_data;
+
+	if (p->sock < 0)
+		return;
+
+	if (c->ackcount == ETHLCD_WINDOW) {
+		if ((ethlcd_send_queued(p) < 0) || (ethlcd_read_answers(p, 1) < 0))
+			return;
 	}
 
-	/* Check reply */
-	if (data[0] != cmd) {
-		p->hd44780_functions->drv_report(RPT_CRIT, "%s: Invalid device response (want 0x%02X, got 0x%02X). Exiting",
-					     ETHLCD_DRV_NAME, cmd, data[0]);
-		exit(-1);
+	c->tx[c->txlen++] = cmd;
+	c->tx[c->txlen++] = arg;
+	c->acks[(c->ackhead + c->ackcount) % ETHLCD_WINDOW] = cmd;
+	c->ackcount++;
+}
+
+
+/**
+ * Send the collected commands in one write.
+ * \param p    Pointer to driver's private data structure.
+ * \retval 0   Success.
+ * \retval -1  Error, the connection has been dropped.
+ */
+static int
+ethlcd_send_queued(PrivateData *p)
+{
+	ethlcd_conn *c = (ethlcd_conn *) p->connection_data;
+	int offset, len;
+
+	for (offset = 0; offset < c->txlen; offset += len) {
+		len = write(p->sock, c->tx + offset, c->txlen - offset);
+		if (len <= 0) {
+			ethlcd_disconnect(p, "Write to socket");
+			return -1;
+		}
 	}
+	c->txlen = 0;
+	return 0;
+}
+
+
+/**
+ * Check the answers of sent commands.
+ * \param p     Pointer to driver's private data structure.
+ * \param wait  If set, wait until all answers have arrived; otherwise only
+ *              check those already received.
+ * \retval 0    Success.
+ * \retval -1   Error, the connection has been dropped.
+ */
+static int
+ethlcd_read_answers(PrivateData *p, int wait)
+{
+	ethlcd_conn *c = (ethlcd_conn *) p->connection_data;
+	unsigned char buff[ETHLCD_WINDOW];
+	int len, i;
+
+	while (c->ackcount > 0) {
+		len = recv(p->sock, buff, c->ackcount, wait ? 0 : MSG_DONTWAIT);
+		if (len < 0 && !wait && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return 0;
+		if (len <= 0) {
+			if (len == 0)
+				errno = ECONNRESET;
+			ethlcd_disconnect(p, "Read from socket");
+			return -1;
+		}
+
+		for (i = 0; i < len; i++) {
+			if (buff[i] != c->acks[c->ackhead]) {
+				p->hd44780_functions->drv_report(RPT_ERR, "%s: Invalid device response (want 0x%02X, got 0x%02X)",
+							  ETHLCD_DRV_NAME, c->acks[c->ackhead], buff[i]);
+				errno = EPROTO;
+				ethlcd_disconnect(p, "Reading answers");
+				return -1;
+			}
+			c->ackhead = (c->ackhead + 1) % ETHLCD_WINDOW;
+			c->ackcount--;
+		}
+	}
+	return 0;
 }
@@ -7,6 +7,9 @@ int hd_init_ethlcd(Driver *drvthis);
 #define ETHLCD_DRV_NAME      "ethlcd"
 #define DEFAULT_ETHLCD_PORT  2425
 #define ETHLCD_TIMEOUT       5
+#define ETHLCD_CONNECT_TIMEOUT  1	/* seconds to wait for a reconnect */
+#define ETHLCD_RECONNECT_DELAY  5	/* seconds between reconnect attempts */
+#define ETHLCD_WINDOW        128	/* commands sent ahead of their replies */
 
 /* ethlcd protocol constants: */
 #define ETHLCD_SEND_INSTR               0x01
@@ -72,6 +72,7 @@ void lcdtime_HD44780_senddata(PrivateData *p, unsigned char displayID, unsigned
 void lcdtime_HD44780_backlight(PrivateData *p, unsigned char state);
 unsigned char lcdtime_HD44780_readkeypad(PrivateData *p, unsigned int YData);
 void lcdtime_HD44780_output(PrivateData *p, int data);
+unsigned char lcdtime_HD44780_readstatus(PrivateData *p, unsigned char displayID);
 
 #define RS	STRB
 #define RW	LF
@@ -101,6 +102,7 @@ hd_init_ext8bit(Driver *drvthis)
 	hd44780_functions->senddata = lcdtime_HD44780_senddata;
 	hd44780_functions->backlight = lcdtime_HD44780_backlight;
 	hd44780_functions->readkeypad = lcdtime_HD44780_readkeypad;
+	hd44780_functions->readstatus = lcdtime_HD44780_readstatus;
 
 	// setup the lcd in 8 bit mode
 	hd44780_functions->senddata(p, 0, RS_INSTR, FUNCSET | IF_8BIT);
@@ -217,3 +219,30 @@ void lcdtime_HD44780_output(PrivateData *p, int data)
 	port_out(p->port + 2, (p->backlight_bit) ^ OUTMASK);
         if (p->delayBus) p->hd44780_functions->uPause(p, 1);
 }
+
+
+/**
+ * Read the status register of the display.
+ * \param p          Pointer to driver's private data structure.
+ * \param displayID  ID of the display to read from (only 1 is supported).
+ * \return           Busy flag and address counter.
+ */
+unsigned char
+lcdtime_HD44780_readstatus(PrivateData *p, unsigned char displayID)
+{
+	unsigned char status;
+
+	// Switch the data port to input and the display to read mode
+	port_out(p->port + 2, (ENBI | RW | p->backlight_bit) ^ OUTMASK);
+	if (p->delayBus) p->hd44780_functions->uPause(p, 1);
+	port_out(p->port + 2, (ENBI | RW | EN1 | p->backlight_bit) ^ OUTMASK);
+	if (p->delayBus) p->hd44780_functions->uPause(p, 1);
+
+	status = port_in(p->port);
+
+	// Set EN low and return to write mode
+	port_out(p->port + 2, (ENBI | RW | p->backlight_bit) ^ OUTMASK);
+	port_out(p->port + 2, p->backlight_bit ^ OUTMASK);
+
+	return status;
+}
@@ -0,0 +1,250 @@
+/** \file server/drivers/hd44780-gpiochip.c
+ * \c gpiochip connection type of \c hd44780 driver for Hitachi HD44780 based
+ * LCD displays.
+ *
+ * The LCD is operated in its 4 bit-mode and connected to lines of one GPIO
+ * chip, which are driven through the Linux GPIO character device
+ * (/dev/gpiochipN). All lines are requested at once, so the data lines, RS
+ * and EN change with a single ioctl per step instead of one sysfs write
+ * per pin. R/W (5) on the LCD MUST be hard wired low or connected to
+ * pin_RW, which is held low.
+ *
+ * Mappings can be set in the config file using the keys:
+ * pin_EN, pin_EN2, pin_RS, pin_D7, pin_D6, pin_D5, pin_D4, pin_BL, pin_RW
+ * in the [hd44780] section. The values are line offsets on the chip given
+ * by Device (default /dev/gpiochip0).
+ */
+
+/*-
+ * This file is released under the GNU General Public License. Refer to the
+ * COPYING file distributed with this package.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#include "hd44780-gpiochip.h"
+#include "hd44780-low.h"
+#include "shared/report.h"
+
+void gpiochip_HD44780_senddata(PrivateData *p, unsigned char displayID,
+			       unsigned char flags, unsigned char ch);
+void gpiochip_HD44780_backlight(PrivateData *p, unsigned char state);
+void gpiochip_HD44780_close(PrivateData *p);
+
+/** Indices of the signals within the line request */
+enum gpiochip_pin {
+	PIN_D4, PIN_D5, PIN_D6, PIN_D7, PIN_RS, PIN_EN, PIN_EN2, PIN_BL, PIN_RW,
+	PIN_COUNT
+};
+
+static const char *pin_names[PIN_COUNT] = {
+	"D4", "D5", "D6", "D7", "RS", "EN", "EN2", "BL", "RW"
+};
+
+/** Connection data of the gpiochip connection type */
+typedef struct gpiochip_data {
+	int fd;				/**< file descriptor of the line request */
+	__u64 bit[PIN_COUNT];		/**< bit of each signal; 0 if unused */
+	__u64 values;			/**< current state of all lines */
+} gpiochip_data;
+
+
+/**
+ * Change some of the lines with a single ioctl.
+ * \param gd     Connection data.
+ * \param mask   Bits of the lines to change.
+ * \param value  New values of these lines.
+ */
+static void
+set_lines(gpiochip_data *gd, __u64 mask, __u64 value)
+{
+	struct gpio_v2_line_values lv;
+
+	gd->values = (gd->values & ~mask) | (value & mask);
+	lv.bits = gd->values;
+	lv.mask = mask;
+	ioctl(gd->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv);
+}
+
+
+/**
+ * Send 4-bit data.
+ * \param p          Pointer to driver's private data structure.
+ * \param rs         Bit of RS if data is sent, 0 for instructions.
+ * \param ch         The value to send (lower nibble must contain the data).
+ * \param displayID  ID of the display (or 0 for all) to send data to.
+ */
+static void
+send_nibble(PrivateData *p, __u64 rs, unsigned char ch, unsigned char displayID)
+{
+	gpiochip_data *gd = (gpiochip_data *) p->connection_data;
+	__u64 data = rs;
+	__u64 en = 0;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		if (ch & (1 << i))
+			data |= gd->bit[PIN_D4 + i];
+	}
+	if (displayID == 1 || displayID == 0)
+		en |= gd->bit[PIN_EN];
+	if (displayID == 2 || (p->numDisplays > 1 && displayID == 0))
+		en |= gd->bit[PIN_EN2];
+
+	/* Set up data and RS, then clock them in on the falling edge of EN */
+	set_lines(gd, gd->bit[PIN_D4] | gd->bit[PIN_D5] | gd->bit[PIN_D6] |
+		  gd->bit[PIN_D7] | gd->bit[PIN_RS], data);
+	set_lines(gd, en, en);
+	if (p->delayBus)
+		p->hd44780_functions->uPause(p, 1);
+	set_lines(gd, en, 0);
+}
+
+
+/**
+ * Initialize the driver.
+ * \param drvthis   Pointer to driver structure.
+ * \return          0 on success; -1 on error.
+ */
+int
+hd_init_gpiochip(Driver *drvthis)
+{
+	PrivateData *p = (PrivateData *) drvthis->private_data;
+	struct gpio_v2_line_request req;
+	gpiochip_data *gd;
+	const char *device;
+	char config_key[8];
+	int chip;
+	int i;
+
+	gd = calloc(1, sizeof(gpiochip_data));
+	if (gd == NULL) {
+		report(RPT_ERR, "hd_init_gpiochip: unable to allocate memory");
+		return -1;
+	}
+	gd->fd = -1;
+	p->connection_data = gd;
+	p->hd44780_functions->close = gpiochip_HD44780_close;
+
+	/* Collect the configured lines */
+	memset(&req, 0, sizeof(req));
+	for (i = 0; i < PIN_COUNT; i++) {
+		int offset;
+
+		if ((i == PIN_EN2) && (p->numDisplays <= 1))
+			continue;
+		if ((i == PIN_BL) && !have_backlight_pin(p))
+			continue;
+
+		snprintf(config_key, sizeof(config_key), "pin_%s", pin_names[i]);
+		offset = drvthis->config_get_int(drvthis->name, config_key, 0, -1);
+		if (offset < 0) {
+			if (i == PIN_BL) {
+				report(RPT_WARNING, "hd_init_gpiochip: no pin_BL - disabling backlight");
+				set_have_backlight_pin(p, 0);
+				continue;
+			}
+			if (i == PIN_RW)
+				continue;
+			report(RPT_ERR, "hd_init_gpiochip: pin_%s must be set", pin_names[i]);
+			return -1;
+		}
+		gd->bit[i] = (__u64) 1 << req.num_lines;
+		req.offsets[req.num_lines++] = offset;
+		report(RPT_INFO, "hd_init_gpiochip: Pin %s mapped to line %d", pin_names[i], offset);
+	}
+
+	device = drvthis->config_get_string(drvthis->name, "Device", 0, "/dev/gpiochip0");
+	chip = open(device, O_RDWR | O_CLOEXEC);
+	if (chip < 0) {
+		report(RPT_ERR, "hd_init_gpiochip: unable to open %s: %s", device, strerror(errno));
+		return -1;
+	}
+
+	/* Request all lines as outputs, initially low */
+	strncpy(req.consumer, "LCDd", sizeof(req.consumer) - 1);
+	req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+	if (ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+		report(RPT_ERR, "hd_init_gpiochip: unable to request lines of %s: %s",
+		       device, strerror(errno));
+		close(chip);
+		return -1;
+	}
+	close(chip);
+	gd->fd = req.fd;
+
+	p->hd44780_functions->senddata = gpiochip_HD44780_senddata;
+	if (have_backlight_pin(p))
+		p->hd44780_functions->backlight = gpiochip_HD44780_backlight;
+
+	send_nibble(p, 0, (FUNCSET | IF_8BIT) >> 4, 0);
+	p->hd44780_functions->uPause(p, 4100);
+	send_nibble(p, 0, (FUNCSET | IF_8BIT) >> 4, 0);
+	p->hd44780_functions->uPause(p, 100);
+	send_nibble(p, 0, (FUNCSET | IF_8BIT) >> 4, 0);
+	p->hd44780_functions->uPause(p, 40);
+	send_nibble(p, 0, (FUNCSET | IF_4BIT) >> 4, 0);
+	p->hd44780_functions->uPause(p, 40);
+
+	common_init(p, IF_4BIT);
+
+	return 0;
+}
+
+
+/**
+ * Send data or commands to the display.
+ * \param p             Pointer to driver's private data structure.
+ * \param displayID     ID of the display (or 0 for all) to send data to.
+ * \param flags         Defines whether to end a command or data.
+ * \param ch            The value to send.
+ */
+void
+gpiochip_HD44780_senddata(PrivateData *p, unsigned char displayID,
+			  unsigned char flags, unsigned char ch)
+{
+	gpiochip_data *gd = (gpiochip_data *) p->connection_data;
+	__u64 rs = (flags == RS_INSTR) ? 0 : gd->bit[PIN_RS];
+
+	send_nibble(p, rs, ch >> 4, displayID);
+	send_nibble(p, rs, ch, displayID);
+}
+
+
+/**
+ * Turn display backlight on or off.
+ * \param p         Pointer to driver's private data structure.
+ * \param state     New backlight status.
+ */
+void
+gpiochip_HD44780_backlight(PrivateData *p, unsigned char state)
+{
+	gpiochip_data *gd = (gpiochip_data *) p->connection_data;
+
+	set_lines(gd, gd->bit[PIN_BL], (state == BACKLIGHT_ON) ? gd->bit[PIN_BL] : 0);
+}
+
+
+/**
+ * Free resources used by this connection type.
+ * \param p     Pointer to driver's PrivateData structure.
+ */
+void
+gpiochip_HD44780_close(PrivateData *p)
+{
+	gpiochip_data *gd = (gpiochip_data *) p->connection_data;
+
+	if (gd != NULL) {
+		if (gd->fd >= 0)
+			close(gd->fd);
+		free(gd);
+		p->connection_data = NULL;
+	}
+}
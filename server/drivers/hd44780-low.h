@@ -30,6 +30,7 @@
 #endif
 
 #include "i2c.h"
+#include "timing.h"
 
 /** \name Symbolic names for connection types
  *@{*/
@@ -62,6 +63,7 @@
 #define HD44780_CT_LCM162		26
 #define HD44780_CT_GPIO			27
 #define HD44780_CT_EZIO			28
+#define HD44780_CT_GPIOCHIP		29
 /**@}*/
 
 /** \name Symbolic names for interface types
@@ -297,6 +299,8 @@ typedef struct hd44780_private_data {
 
 	int delayMult;		/**< Delay multiplier for slow displays */
 	char delayBus;		/**< Delay if data is sent too fast over LPT port */
+	TimingDelay delay;	/**< State of the calibrated delay engine */
+	char busyPoll;		/**< Wait for the busy flag instead of fixed delays */
 
 	/**
 	 * lastline controls the use of the last line, if pixel addressable
@@ -334,6 +338,7 @@ typedef struct hd44780_private_data {
 	 *@{*/
 	time_t nextrefresh;	/**< Time when the next refresh is due. */
 	int refreshdisplay;	/**< Seconds after which a complete display update is forced. */
+	int forcerefresh;	/**< Set by a connection type to force a complete update on the next flush. */
 	/**@}*/
 
 	/** \name Keepalive
@@ -420,6 +425,14 @@ typedef struct hwDependentFns {
 	 */
 	void (*output) (PrivateData *p, int data);
 
+	/** Read the status register of a controller. Only set by connection
+	 * types that can read from the display (RW line connected).
+	 * \param p       pointer to private date structure
+	 * \param dispID  display to read from (1 = first display)
+	 * \return  Busy flag (BUSYFLAG) and address counter.
+	 */
+	unsigned char (*readstatus) (PrivateData *p, unsigned char dispID);
+
 	/** Close the interface on shutdown */
 	void (*close) (PrivateData *p);
 } HD44780_functions;
@@ -538,6 +551,9 @@ static void set_have_backlight_pin(PrivateData *p, int on) {
 /** Set CGRAM address (RE=0) */
 #define SETCHAR		0x40
 
+/** Busy flag in the status register */
+#define BUSYFLAG	0x80
+
 /** Set SEGRAM address (RE=1) */
 #define SETSEG		0x40
 
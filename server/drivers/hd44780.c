@@ -57,6 +57,11 @@
 #define KEYPAD_AUTOREPEAT_DELAY 500
 #define KEYPAD_AUTOREPEAT_FREQ 15
 
+/* Pauses of at least this many microseconds are credited the bus time */
+#define HD44780_CREDIT_MIN	10
+/* Give up polling the busy flag after this multiple of the fixed delay */
+#define HD44780_BUSY_TIMEOUT	4
+
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -108,6 +113,10 @@ MODULE_EXPORT char *symbol_prefix = "HD44780_";
 /* Internal functions */
 void HD44780_position(Driver *drvthis, int x, int y);
 static void uPause(PrivateData *p, int usecs);
+static int wait_busy(PrivateData *p, int timeout);
+
+/** Names of the delay methods, indexed by TIMING_SLEEP etc. */
+static const char *delay_methods[] = { "sleep", "spin", "hybrid", NULL };
 unsigned char HD44780_scankeypad(PrivateData *p);
 static int parse_span_list(int *spanListArray[], int *spLsize, int *dispOffsets[], int *dOffsize, int *dispSizeArray[], const char *spanlist);
 
@@ -480,6 +489,23 @@ HD44780_init(Driver *drvthis)
 		return -1;
 	}
 
+	/*
+	 * Select the delay method. Directly driven interfaces default to
+	 * the hybrid method, the others keep sleeping.
+	 */
+	tmp = ((if_type == IF_TYPE_PARPORT) || (if_type == IF_TYPE_I2C) || (if_type == IF_TYPE_SPI))
+	      ? TIMING_HYBRID : TIMING_SLEEP;
+	s = drvthis->config_get_string(drvthis->name, "DelayMethod", 0, delay_methods[tmp]);
+	for (i = 0; (delay_methods[i] != NULL) && (strcasecmp(s, delay_methods[i]) != 0); i++)
+		;
+	if (delay_methods[i] == NULL)
+		report(RPT_WARNING, "%s: unknown DelayMethod: %s; using %s", drvthis->name, s, delay_methods[tmp]);
+	else
+		tmp = i;
+	timing_delay_init(&p->delay, tmp);
+	report(RPT_INFO, "%s: using DelayMethod %s (nanosleep slack %ld ns)",
+	       drvthis->name, delay_methods[tmp], p->delay.slack);
+
 	/* Allocate framebuffer */
 	p->framebuf = (unsigned char *) calloc(p->width * p->height, sizeof(char));
 	if (p->framebuf == NULL) {
@@ -580,6 +606,7 @@ HD44780_init(Driver *drvthis)
 	p->hd44780_functions->readkeypad = NULL;
 	p->hd44780_functions->scankeypad = NULL;
 	p->hd44780_functions->output = NULL;
+	p->hd44780_functions->readstatus = NULL;
 	p->hd44780_functions->close = NULL;
 	p->hd44780_functions->flush = NULL;
 
@@ -614,6 +641,19 @@ HD44780_init(Driver *drvthis)
 	if (p->hd44780_functions->output == NULL)
 		p->have_output = 0;
 
+	/*
+	 * Poll the busy flag from now on, if configured and possible. Not
+	 * earlier, because the flag cannot be read during the init sequence.
+	 */
+	if (drvthis->config_get_bool(drvthis->name, "BusyFlag", 0, 0)) {
+		if (p->hd44780_functions->readstatus == NULL)
+			report(RPT_WARNING, "%s: BusyFlag not supported by ConnectionType", drvthis->name);
+		else if (p->numDisplays > 1)
+			report(RPT_WARNING, "%s: BusyFlag only supported with one controller", drvthis->name);
+		else
+			p->busyPoll = 1;
+	}
+
 	/* set contrast */
 	HD44780_set_contrast(drvthis, p->contrast);
 
@@ -709,6 +749,31 @@ common_init(PrivateData *p, unsigned char if_bit)
 }
 
 
+/**
+ * Wait for the controller to clear its busy flag.
+ * \param p        Pointer to PrivateData structure.
+ * \param timeout  Microseconds after which to give up.
+ * \retval 0       The controller is ready.
+ * \retval -1      Still busy after \c timeout microseconds.
+ */
+static int
+wait_busy(PrivateData *p, int timeout)
+{
+	long long deadline = timing_now() + (long long) timeout * 1000;
+
+	while (p->hd44780_functions->readstatus(p, 1) & BUSYFLAG) {
+		if (timing_now() > deadline) {
+			/* Wiring or port mode do not allow reading: give up */
+			report(RPT_WARNING, "HD44780: busy flag does not clear; using fixed delays");
+			p->busyPoll = 0;
+			return -1;
+		}
+	}
+	timing_delay_mark(&p->delay);
+	return 0;
+}
+
+
 /**
  * Delay a number of microseconds.
  * \param p  Pointer to PrivateData structure.
@@ -717,7 +782,19 @@ common_init(PrivateData *p, unsigned char if_bit)
 static void
 uPause(PrivateData *p, int usecs)
 {
-	timing_uPause(usecs * p->delayMult);
+	/* Execution pauses end as soon as the controller is ready */
+	if (p->busyPoll && (usecs >= HD44780_CREDIT_MIN)
+	    && (wait_busy(p, usecs * p->delayMult * HD44780_BUSY_TIMEOUT) == 0))
+		return;
+
+	/*
+	 * Short pauses time the signals within one bus write and are waited
+	 * in full. Longer ones wait for the controller to execute the last
+	 * byte; it keeps executing while the next byte is transferred, so
+	 * the time the last write took (and the next will take about as
+	 * well) is credited.
+	 */
+	timing_delay_wait(&p->delay, usecs * p->delayMult, (usecs >= HD44780_CREDIT_MIN));
 }
 
 
@@ -866,6 +943,11 @@ HD44780_flush(Driver *drvthis)
 		refreshNow = 1;
 		p->nextrefresh = now + p->refreshdisplay;
 	}
+	/* connection type lost the display's contents (e.g. reconnected) */
+	if (p->forcerefresh) {
+		refreshNow = 1;
+		p->forcerefresh = 0;
+	}
 	/* keepalive refresh of display */
 	if ((p->keepalivedisplay > 0) && (now > p->nextkeepalive)) {
 		keepaliveNow = 1;
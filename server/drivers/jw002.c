@@ -46,7 +46,6 @@
 #include <errno.h>
 #include <syslog.h>
 #include <ctype.h>
-#include <sys/poll.h>
 
 #ifdef HAVE_CONFIG_H
 # include "config.h"
@@ -56,6 +55,7 @@
 #include "lcd_lib.h"
 #include "jw002.h"
 #include "adv_bignum.h"
+#include "serial_io.h"
 
 #include "shared/report.h"
 
@@ -109,7 +109,7 @@
 
 /** private data for the \c jw002 driver */
 typedef struct jw002_private_data {
-	int fd;			/* The LCD file descriptor */
+	SerialPort *port;	/* The serial port of the LCD */
 	
 	/* dimensions */
 	int width, height;
@@ -181,7 +181,6 @@ jw002_parse_keypad_setting (Driver *drvthis, char *keyname, char default_value)
 MODULE_EXPORT int
 jw002_init (Driver *drvthis)
 {
-	struct termios portset;
 
 	char device[256] = DEFAULT_DEVICE;
 	int speed = DEFAULT_SPEED;
@@ -198,7 +197,7 @@ jw002_init (Driver *drvthis)
 	        return -1;
 
 	/* Initialise the PrivateData structure */
-	p->fd = -1;
+	p->port = NULL;
 
 	p->width      = JW002_DEFAULT_WIDTH;
 	p->height     = JW002_DEFAULT_HEIGHT;
@@ -327,41 +326,16 @@ jw002_init (Driver *drvthis)
 	/* End of config file parsing */
 
 	/* Set up io port correctly, and open it... */
-//	p->fd = open(device, O_RDWR | O_NOCTTY);
-	p->fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY);
-	if (p->fd == -1) {
-		report(RPT_ERR, "%s: open(%s) failed (%s)", drvthis->name, device, strerror(errno));
+	p->port = serial_open(drvthis->name, device, speed, SERIAL_NONBLOCK);
+	if (p->port == NULL) {
 		if (errno == EACCES)
 			report(RPT_ERR, "%s: %s device could not be opened...", drvthis->name, device);
   		return -1;
 	}
 	report(RPT_INFO, "%s: opened display on %s", drvthis->name, device);
 
-	tcgetattr(p->fd, &portset);
-
-	// THIS ALL COMMENTED OUT BECAUSE WE NEED TO SET TIMEOUTS
-	/* We use RAW mode */
-#ifdef HAVE_CFMAKERAW_NOT
-	/* The easy way */
-	cfmakeraw(&portset);
-#else
-	/* The hard way */
-	portset.c_iflag &= ~( IGNBRK | BRKINT | PARMRK | ISTRIP
-	                      | INLCR | IGNCR | ICRNL | IXON );
-	portset.c_oflag &= ~OPOST;
-	portset.c_lflag &= ~( ECHO | ECHONL | ICANON | ISIG | IEXTEN );
-	portset.c_cflag &= ~( CSIZE | PARENB | CRTSCTS );
-	portset.c_cflag |= CS8 | CREAD | CLOCAL;
-	portset.c_cc[VMIN] = 1;
-	portset.c_cc[VTIME] = 3;
-#endif
-
-	/* Set port speed */
-	cfsetospeed(&portset, speed);
-	cfsetispeed(&portset, B0);
-
-	/* Do it... */
-	tcsetattr(p->fd, TCSANOW, &portset);
+	/* Set timeouts */
+	serial_set_timeouts(p->port, 1, 3);
 
 	/* Make sure the frame buffer is there... */
 	p->framebuf = (unsigned char *) calloc(p->width * p->height, 1);
@@ -383,6 +357,7 @@ jw002_init (Driver *drvthis)
 	jw002_init_keys(drvthis);
 	jw002_hardware_clear(drvthis);  // clear screen and set font from p->font
 	jw002_linewrap(drvthis, 0);  // turn off linewrap _and_ autoscroll
+	serial_flush(p->port);
 
 	report(RPT_DEBUG, "%s: init() done", drvthis->name);
 
@@ -400,8 +375,7 @@ jw002_close (Driver *drvthis)
         PrivateData *p = drvthis->private_data;
 
 	if (p != NULL) {
-		if (p->fd >= 0)
-			close(p->fd);
+		serial_close(p->port);
 
 		if (p->framebuf)
 			free(p->framebuf);
@@ -609,13 +583,14 @@ jw002_flush (Driver *drvthis)
 			jw002_cursor_goto(drvthis, j+1, i+1);
 
 			length = safep - safeout;  // new length is however many chars we wrote to our OOB buffer
-			write(p->fd, safeout, length);
+			serial_write(p->port, safeout, length);
 			modified++;
 		}      
 	}	// i < p->height
 
 	if (modified)
 		memcpy(p->backingstore, p->framebuf, p->width * p->height);
+	serial_flush(p->port);
 
 	debug(RPT_DEBUG, "jw002: frame buffer flushed");
 }
@@ -686,7 +661,7 @@ jw002_output (Driver *drvthis, int state)
 
 		// send command to jw002 and log that we did it
         	debug(RPT_DEBUG, "jw002: setting LED to %d", state & 1);
-		// //write(p->fd, out, 4);
+		// //serial_write(p->port, out, 4);
 
 
 	} else {
@@ -709,7 +684,7 @@ jw002_hardware_clear (Driver *drvthis)
 
 	out[2] = p->font + 32;  // font numbers must be shifted to printable chars
 
-	write(p->fd, out, 4); // clear and select font 0
+	serial_write(p->port, out, 4); // clear and select font 0
 
 	debug(RPT_DEBUG, "jw002: cleared LCD and switched to font %d", p->font);
 }
@@ -727,7 +702,7 @@ jw002_linewrap (Driver *drvthis, int on)
 	unsigned char out[4] = { '\\', 'A', 0, 0 };
 
 	out[2] = (on) ? '3' : '0';  // wrap _and_ scroll on or off
-	write(p->fd, out, 3);
+	serial_write(p->port, out, 3);
 
 	debug(RPT_DEBUG, "jw002: linewrap turned %s", (on) ? "on" : "off");
 }
@@ -745,7 +720,7 @@ jw002_autoscroll (Driver *drvthis, int on)
 	unsigned char out[4] = { '\\', 'A', 0, 0 };
 
 	out[2] = (on) ? '3' : '0';  // wrap _and_ scroll on or off
-	write(p->fd, out, 3);
+	serial_write(p->port, out, 3);
 
 	debug(RPT_DEBUG, "jw002: autoscroll turned %s", (on) ? "on" : "off");
 }
@@ -770,7 +745,7 @@ jw002_cursor_goto(Driver *drvthis, int x, int y)
 		out[2] = (unsigned char) x + p->xoff + 0x20;  // shift values above cntrl chars
 	if ((y >= 0) && (y < p->height))
 		out[3] = (unsigned char) y + p->yoff + 0x20;  // shift values above cntrl chars
-	write(p->fd, out, 4);
+	serial_write(p->port, out, 4);
 }
 
 
@@ -1045,7 +1020,7 @@ jw002_set_char (Driver *drvthis, int n, unsigned char *dat)
 #ifdef DEBUG_CHARS
 	debug(RPT_DEBUG, "Chardef: '%.*s'", 13, out);
 #endif
-	write(p->fd, out, 13);
+	serial_write(p->port, out, 13);
 
 }
 
@@ -1301,17 +1276,17 @@ jw002_init_keys (Driver *drvthis)
 		// 'down' first
 		out[2] = key + KEYDOWN_STR;
 		out[3] = key + 'A'; // return 'A' through 'L'
-		write(p->fd, out, 15);
+		serial_write(p->port, out, 15);
 
 		// 'repeat' next
 		out[2] = key + KEYRPT_STR;
 		out[3] = key + 'A'; // return 'A' through 'L'
-		write(p->fd, out, 15);
+		serial_write(p->port, out, 15);
 
 		// 'up' last
 		out[2] = key + KEYUP_STR;
 		out[3] = ' ' ; // return nothing
-		write(p->fd, out, 15);
+		serial_write(p->port, out, 15);
 	}
 
         debug(RPT_DEBUG, "jw002: initialized keypad return strings");
@@ -1328,21 +1303,15 @@ jw002_get_key (Driver *drvthis)
 {
 	PrivateData *p = drvthis->private_data;
 	char key = 0;
-	struct pollfd fds[1];
 
 	/* don't query the keyboard if there are no mapped keys; see \todo above */
 	if ((p->keys == 0) && (!p->keypad_test_mode))
 		return NULL;
 
 	/* poll for data or return */
-	fds[0].fd = p->fd;
-	fds[0].events = POLLIN;
-	fds[0].revents = 0;
-	poll(fds,1,0);
-	if (fds[0].revents == 0)
+	if (serial_read(p->port, &key, 1, 0) <= 0)
 		return NULL;
 
-	(void) read(p->fd, &key, 1);
 	report(RPT_DEBUG, "%s: get_key: key 0x%02X", drvthis->name, key);
 
 	if (key == '\0')
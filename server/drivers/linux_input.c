@@ -1,6 +1,11 @@
 /** \file server/drivers/linux_input.c
  * LCDd \c linux event device driver for inputting data from the input
  * subsystem of the linux kernel..
+ *
+ * Several devices can be used at the same time (multiple \c Device
+ * entries); their descriptors are multiplexed through one epoll set.
+ * Devices that go away are re-acquired when inotify reports a new node
+ * in \c /dev/input, so a disconnected device costs nothing while polling.
  */
 
 #include <dirent.h>
@@ -11,9 +16,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <fcntl.h>
 #include <linux/input.h>
 
@@ -27,6 +35,8 @@
 #include "shared/LL.h"
 
 #define LINUXINPUT_DEFAULT_DEVICE	"/dev/input/event0"
+#define LINUXINPUT_INPUT_DIR		"/dev/input"
+#define LINUXINPUT_MAX_DEVICES		16
 
 /** describe the button of a keycode */
 struct keycode {
@@ -67,11 +77,21 @@ keycode_create(const char *configvalue)
 	return ret;
 }
 
+/** one input device from the config file */
+struct input_device {
+	int fd;			/**< file descriptor; -1 while the device is gone */
+	char *path;		/**< device node, if given as absolute path */
+	char *name;		/**< device name, if given by name */
+};
+
 /** private data for the linux event device driver */
 typedef struct linuxInput_private_data {
-	int fd;
-	/* For re-acquiring the device on connection loss when openen by name */
-	const char *name;
+	struct input_device devices[LINUXINPUT_MAX_DEVICES];
+	int num_devices;
+	int lost;		/**< number of devices currently not open */
+	int epfd;		/**< epoll set of all open devices and inotify */
+	int inotify_fd;		/**< watches LINUXINPUT_INPUT_DIR; -1 if unavailable */
+	time_t last_scan;	/**< time of last rescan without inotify */
 	LinkedList *buttonmap;
 } PrivateData;
 
@@ -137,6 +157,124 @@ static int linuxInput_search_by_name(const char *name)
 	return fd;
 }
 
+/**
+ * Add an opened device to the epoll set.
+ * \param p    Pointer to driver linuxInput PrivateData structure
+ * \param dev  Device whose fd has just been opened
+ */
+static void
+linuxInput_watch_device(PrivateData *p, struct input_device *dev)
+{
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = dev;
+	if (epoll_ctl(p->epfd, EPOLL_CTL_ADD, dev->fd, &ev) == -1)
+		report(RPT_WARNING, "linux_input: epoll_ctl failed (%s)", strerror(errno));
+}
+
+/**
+ * Try to open a device that is currently not available.
+ * \param p        Pointer to driver linuxInput PrivateData structure
+ * \param dev      Device to open
+ * \param devname  Node to try for devices given by name; NULL to scan
+ *                 all of LINUXINPUT_INPUT_DIR
+ * \retval 0   Device opened.
+ * \retval -1  Device not available.
+ */
+static int
+linuxInput_open_device(PrivateData *p, struct input_device *dev, const char *devname)
+{
+	if (dev->path != NULL)
+		dev->fd = open(dev->path, O_RDONLY | O_NONBLOCK);
+	else if (devname != NULL)
+		dev->fd = linuxInput_open_with_name(devname, dev->name);
+	else
+		dev->fd = linuxInput_search_by_name(dev->name);
+
+	if (dev->fd == -1)
+		return -1;
+
+	linuxInput_watch_device(p, dev);
+	return 0;
+}
+
+/**
+ * A device reported an error: stop watching it until it comes back.
+ * \param p    Pointer to driver linuxInput PrivateData structure
+ * \param dev  Device that was lost
+ */
+static void
+linuxInput_lose_device(PrivateData *p, struct input_device *dev)
+{
+	report(RPT_WARNING, "Lost input device connection to '%s'",
+	       (dev->name != NULL) ? dev->name : dev->path);
+	epoll_ctl(p->epfd, EPOLL_CTL_DEL, dev->fd, NULL);
+	close(dev->fd);
+	dev->fd = -1;
+	p->lost++;
+}
+
+/**
+ * Try to re-acquire lost devices.
+ *
+ * We may temporary loose access to the device. Possible causes are e.g.:
+ * 1. A temporary connection loss (Bluetooth); or
+ * 2. The device dropping of the bus to re-appear with another prod-id
+ *    (the G510 keyboard does this when (un)plugging the headphones).
+ *
+ * \param p        Pointer to driver linuxInput PrivateData structure
+ * \param devname  Node that just appeared; NULL to scan everything
+ */
+static void
+linuxInput_reacquire(PrivateData *p, const char *devname)
+{
+	int i;
+
+	for (i = 0; (i < p->num_devices) && (p->lost > 0); i++) {
+		struct input_device *dev = &p->devices[i];
+
+		if (dev->fd != -1)
+			continue;
+		if (linuxInput_open_device(p, dev, devname) == 0) {
+			report(RPT_WARNING, "Successfully re-opened input device '%s'",
+			       (dev->name != NULL) ? dev->name : dev->path);
+			p->lost--;
+		}
+	}
+}
+
+/**
+ * Process pending inotify events of LINUXINPUT_INPUT_DIR. New or changed
+ * event nodes are checked against the lost devices; udev may create the
+ * node before setting its permissions, hence IN_ATTRIB is watched too.
+ * \param p    Pointer to driver linuxInput PrivateData structure
+ */
+static void
+linuxInput_handle_inotify(PrivateData *p)
+{
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+
+	while ((len = read(p->inotify_fd, buf, sizeof(buf))) > 0) {
+		char *ptr;
+
+		for (ptr = buf; ptr < buf + len;
+		     ptr += sizeof(struct inotify_event) + ((struct inotify_event *) ptr)->len) {
+			struct inotify_event *event = (struct inotify_event *) ptr;
+			char devname[PATH_MAX];
+
+			if ((p->lost == 0) || (event->len == 0) ||
+			    strncmp(event->name, "event", 5))
+				continue;
+
+			snprintf(devname, sizeof(devname), "%s/%s",
+				 LINUXINPUT_INPUT_DIR, event->name);
+			linuxInput_reacquire(p, devname);
+		}
+	}
+}
+
 /**
  * Initialize the driver.
  * \param drvthis  Pointer to driver structure.
@@ -159,34 +297,71 @@ linuxInput_init (Driver *drvthis)
 		return -1;
 
 	/* initialize private data */
-	p->fd = -1;
+	p->epfd = -1;
+	p->inotify_fd = -1;
 	if ((p->buttonmap = LL_new()) == NULL) {
 		report(RPT_ERR, "%s: cannot allocate memory for buttons", drvthis->name);
 		return -1;
 	}
 
-	/* Read config file */
+	if ((p->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		report(RPT_ERR, "%s: epoll_create1 failed (%s)", drvthis->name, strerror(errno));
+		return -1;
+	}
 
-	/* What device should be used */
-	s = drvthis->config_get_string(drvthis->name, "Device", 0,
-						   LINUXINPUT_DEFAULT_DEVICE);
-	report(RPT_INFO, "%s: using Device %s", drvthis->name, s);
+	/* Read config file */
 
+	/* What devices should be used */
+	for (i = 0; i < LINUXINPUT_MAX_DEVICES; i++) {
+		struct input_device *dev = &p->devices[i];
 
-	/* Open the device, eiher by path or by name */
-	if (s[0] == '/') {
-		if ((p->fd = open(s, O_RDONLY | O_NONBLOCK)) == -1) {
-			report(RPT_ERR, "%s: open(%s) failed (%s)",
-					drvthis->name, s, strerror(errno));
+		s = drvthis->config_get_string(drvthis->name, "Device", i,
+					       (i == 0) ? LINUXINPUT_DEFAULT_DEVICE : NULL);
+		if (s == NULL)
+			break;
+		report(RPT_INFO, "%s: using Device %s", drvthis->name, s);
+
+		dev->fd = -1;
+		if (s[0] == '/')
+			dev->path = strdup(s);
+		else
+			dev->name = strdup(s);
+		if ((dev->path == NULL) && (dev->name == NULL)) {
+			report(RPT_ERR, "%s: cannot allocate memory for devices", drvthis->name);
 			return -1;
 		}
-	} else {
-		if ((p->fd = linuxInput_search_by_name(s)) == -1) {
-			report(RPT_ERR, "%s: could not find '%s' input-device",
+		p->num_devices++;
+
+		/* Open the device, eiher by path or by name */
+		if (linuxInput_open_device(p, dev, NULL) == -1) {
+			if (dev->path != NULL) {
+				report(RPT_ERR, "%s: open(%s) failed (%s)",
+						drvthis->name, s, strerror(errno));
+				return -1;
+			}
+			/* devices given by name may be plugged in later */
+			report(RPT_WARNING, "%s: could not find '%s' input-device, waiting for it",
 					drvthis->name, s);
-			return -1;
+			p->lost++;
 		}
-		p->name = s;
+	}
+
+	/* Get notified when input devices (re)appear */
+	p->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if ((p->inotify_fd == -1) ||
+	    (inotify_add_watch(p->inotify_fd, LINUXINPUT_INPUT_DIR, IN_CREATE | IN_ATTRIB) == -1)) {
+		report(RPT_WARNING, "%s: cannot watch %s (%s); lost devices are rescanned once per second",
+				drvthis->name, LINUXINPUT_INPUT_DIR, strerror(errno));
+		if (p->inotify_fd != -1)
+			close(p->inotify_fd);
+		p->inotify_fd = -1;
+	}
+	else {
+		struct epoll_event ev;
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = NULL;
+		epoll_ctl(p->epfd, EPOLL_CTL_ADD, p->inotify_fd, &ev);
 	}
 
 	for (i = 0; (s = drvthis->config_get_string(drvthis->name, "key", i, NULL)) != NULL; i++) {
@@ -215,8 +390,18 @@ linuxInput_close (Driver *drvthis)
 	struct keycode *k;
 
 	if (p != NULL) {
-		if (p->fd >= 0)
-			close(p->fd);
+		int i;
+
+		for (i = 0; i < p->num_devices; i++) {
+			if (p->devices[i].fd >= 0)
+				close(p->devices[i].fd);
+			free(p->devices[i].path);
+			free(p->devices[i].name);
+		}
+		if (p->inotify_fd >= 0)
+			close(p->inotify_fd);
+		if (p->epfd >= 0)
+			close(p->epfd);
 
 		if (p->buttonmap != NULL) {
 			while ((k = LL_Pop(p->buttonmap)) != NULL) {
@@ -249,7 +434,7 @@ compare_with_keycode (void *data, void *codep)
 }
 
 /**
- * Helper function to read a key code from the linux input device.
+ * Helper function to read a key code from the linux input devices.
  * \param p      Pointer to driver linuxInput PrivateData structure
  * \retval > 0   Linux KEY_ key-code
  * \retval 0     Non key-press event read
@@ -258,40 +443,46 @@ compare_with_keycode (void *data, void *codep)
 static int
 linuxInput_get_key_code (PrivateData *p)
 {
+	struct epoll_event ev[LINUXINPUT_MAX_DEVICES + 1];
 	struct input_event event;
-	int result = -1;
+	int n, i;
+
+	/* Without inotify, look for lost devices once per second */
+	if ((p->lost > 0) && (p->inotify_fd == -1) && (time(NULL) != p->last_scan)) {
+		p->last_scan = time(NULL);
+		linuxInput_reacquire(p, NULL);
+	}
+
+	n = epoll_wait(p->epfd, ev, LINUXINPUT_MAX_DEVICES + 1, 0);
+
+	for (i = 0; i < n; i++) {
+		struct input_device *dev = ev[i].data.ptr;
+		int result;
+
+		if (dev == NULL) {
+			linuxInput_handle_inotify(p);
+			continue;
+		}
+		if (dev->fd == -1)
+			continue;
 
-	if (p->fd != -1) {
-		result = read(p->fd, &event, sizeof(event));
+		/*
+		 * Read one event only; other ready devices stay ready and
+		 * are served by the next call.
+		 */
+		result = read(dev->fd, &event, sizeof(event));
 		/* Device unplugged / lost connection ? */
 		if (result == -1 && errno == ENODEV) {
-			report(RPT_WARNING, "Lost input device connection");
-			close(p->fd);
-			p->fd = -1;
+			linuxInput_lose_device(p, dev);
+			continue;
 		}
-	}
-
-	/*
-	 * We may temporary loose access to the device. Possible causes are e.g.:
-	 * 1. A temporary connection loss (Bluetooth); or
-	 * 2. The device dropping of the bus to re-appear with another prod-id
-	 *    (the G510 keyboard does this when (un)plugging the headphones).
-	 * If the device was opened by name, we try to re-acquire the device
-	 * here to deal with these kinda temporary device losses.
-	 */
-	if (p->fd == -1 && p->name) {
-		p->fd = linuxInput_search_by_name(p->name);
-		if (p->fd != -1) {
-			report(RPT_WARNING, "Successfully re-opened input device '%s'", p->name);
-			result = read(p->fd, &event, sizeof(event));
+		if (result == sizeof(event)) {
+			/* Ignore release events and not-key events */
+			return (event.type == EV_KEY && event.value) ? event.code : 0;
 		}
 	}
 
-	if (result != sizeof(event))
-		return -1;
-
-	/* Ignore release events and not-key events */
-	return (event.type == EV_KEY && event.value) ? event.code : 0;
+	return -1;
 }
 
 /**
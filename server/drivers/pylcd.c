@@ -31,7 +31,6 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/select.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -61,7 +60,7 @@
 #define True 1
 #define False 0
 
-#define MICROTIMEOUT 50000	/* Timeout for select() */
+#define MICROTIMEOUT 50000	/* Timeout for the bytes of a telegram */
 #define NOKEY "00000"
 
 
@@ -72,26 +71,28 @@ MODULE_EXPORT int supports_multiple = 0;
 MODULE_EXPORT char *symbol_prefix = "pyramid_";
 
 /* Prototypes: */
-static int data_ready(PrivateData *p);
+static int read_byte(PrivateData *p, char *c, int wait);
 static int read_tele(PrivateData *p, char *buffer);
 static int real_send_tele(PrivateData *p, char *buffer, int len);
 static int send_tele(PrivateData *p, char *buffer);
 static int send_ACK(PrivateData *p);
 static unsigned long long timestamp(void);
-static int initTTY(Driver *drvthis, int FD);
 
 /* local functions for pylcd.c */
 
 /**
- * Performs an select on the device used. Returns if no data is available at
- * the moment. Used to keep reading-operations from blocking the driver.
+ * Read one byte from the device.
+ * \param p     Pointer to driver's private data
+ * \param c     Where to store the byte
+ * \param wait  If set, wait up to MICROTIMEOUT for the byte; otherwise only
+ *              take one that has already arrived, so polling for keys does
+ *              not block the driver.
+ * \return  True (1) if a byte was read, False (0) otherwise.
  */
 static int
-data_ready(PrivateData *p)
+read_byte(PrivateData *p, char *c, int wait)
 {
-    FD_ZERO(&p->rdfs);
-    FD_SET(p->FD, &p->rdfs);
-    return select(p->FD + 1, &p->rdfs, NULL, NULL, &p->timeout) > 0;
+    return serial_read(p->port, c, 1, (wait) ? MICROTIMEOUT / 1000 : 0) > 0;
 }
 
 
@@ -112,8 +113,7 @@ read_tele(PrivateData *p, char *buffer)
     char cc = 0x00;
 
     /* Try to find STX within first 10 chars */
-    while (data_ready(p)
-	   && (read(p->FD, &zeichen, 1) > 0)
+    while (read_byte(p, &zeichen, False)
 	   && (zeichen != 0x02)
 	   && (len < MAXCOUNT))
 	len++;
@@ -128,8 +128,7 @@ read_tele(PrivateData *p, char *buffer)
     cc ^= zeichen;
     len = 0;
 
-    while (data_ready(p)
-	   && (read(p->FD, &zeichen, 1) > 0)
+    while (read_byte(p, &zeichen, True)
 	   && (len < MAXCOUNT)) {
 	buffer[len] = zeichen;
 	cc ^= zeichen;
@@ -144,8 +143,7 @@ read_tele(PrivateData *p, char *buffer)
      * return the resulting string. Otherwise clear buffer (throw away all
      * read data) and return.
      */
-    if (data_ready(p)
-	&& (read(p->FD, &zeichen, 1) > 0)
+    if (read_byte(p, &zeichen, True)
 	&& (buffer[len] == 0x03)
 	&& (zeichen == cc)) {
 	buffer[len] = 0x00;
@@ -205,7 +203,8 @@ real_send_tele(PrivateData *p, char *buffer, int len)
 
     buffer2[len++] = cc;
 
-    write(p->FD, buffer2, len);
+    serial_write(p->port, buffer2, len);
+    serial_flush(p->port);
 
     /* Take a little nap. This works as a pacemaker */
     usleep(50);
@@ -248,41 +247,6 @@ timestamp(void)
 }
 
 
-/**
- * Sets the serial device, used for communication with the LCD, into raw mode.
- * \param drvthis  Pointer to driver
- * \param FD       File descriptor of serial device to configure.
- * \return  -1 on error, 0 otherwise
- */
-static int
-initTTY(Driver *drvthis, int FD)
-{
-    struct termios tty_mode;
-
-    if (tcgetattr(FD, &tty_mode) == 0) {
-	cfmakeraw(&tty_mode);
-#ifdef CBAUDEX			/* CBAUDEX not defined in FreeBSD */
-	tty_mode.c_cflag |= CBAUDEX;
-#endif
-	cfsetospeed(&tty_mode, B115200);
-	cfsetispeed(&tty_mode, 0);
-	tty_mode.c_cc[VMIN] = 1;
-	tty_mode.c_cc[VTIME] = 1;
-
-	if (tcsetattr(FD, TCSANOW, &tty_mode) != 0) {
-	    report(RPT_ERR, "%s: setting TTY failed: %s", drvthis->name, strerror(errno));
-	    return -1;
-	}
-    }
-    else {
-	report(RPT_ERR, "%s: reading TTY failed: %s", drvthis->name, strerror(errno));
-	return -1;
-    }
-
-    return 0;
-}
-
-
 /**
  * Initialize the driver.
  * \param drvthis  Pointer to driver structure.
@@ -316,8 +280,7 @@ pyramid_init(Driver *drvthis)
     strcpy(p->last_key_pressed, NOKEY);
     p->last_key_time = timestamp();
 
-    p->timeout.tv_sec = 0;
-    p->timeout.tv_usec = MICROTIMEOUT;
+    p->port = NULL;
 
     /*
      * read config file, fill configuration dependent elements of private
@@ -332,21 +295,17 @@ pyramid_init(Driver *drvthis)
     /* Initialize connection to the LCD  */
 
     /* open and initialize serial device */
-    p->FD = open(p->device, O_RDWR);
-
-    if (p->FD == -1) {
-	report(RPT_ERR, "%s: open(%s) failed: %s", drvthis->name, p->device, strerror(errno));
+    p->port = serial_open(drvthis->name, p->device, B115200, 0);
+    if (p->port == NULL)
 	return -1;
-    }
-
-    if (initTTY(drvthis, p->FD) != 0)
+    if (serial_set_timeouts(p->port, 1, 1) < 0)
 	return -1;
 
     /*
      * Acknowledge all telegramms, the device may yet be sending.
      * (Reset doesn't clear telegramms, darn protocol ... )
      */
-    tcflush(p->FD, TCIFLUSH);	/* clear port buffer */
+    tcflush(serial_fd(p->port), TCIFLUSH);	/* clear port buffer */
     while (1) {
 	i = read_tele(p, buffer);
 	if (i == True)
@@ -393,9 +352,9 @@ pyramid_close(Driver *drvthis)
 {
     PrivateData *p = (PrivateData *) drvthis->private_data;
 
-    if (p->FD) {
-	tcflush(p->FD, TCIFLUSH);
-	close(p->FD);
+    if (p->port != NULL) {
+	tcflush(serial_fd(p->port), TCIFLUSH);
+	serial_close(p->port);
     }
 
 }
@@ -25,6 +25,8 @@
 #ifndef PYLCD_H
 #define PYLCD_H
 
+#include "serial_io.h"
+
 #define MAXCOUNT 10		/* Size of read buffer including NUL */
 
 /* Display properties */
@@ -38,10 +40,8 @@
 /** private data for the \c pyramid driver */
 typedef struct pyramid_private_data {
     /* device io */
-    int FD;
+    SerialPort *port;
     char device[255];
-    fd_set rdfs;
-    struct timeval timeout;
 
     /* device description */
     int width;
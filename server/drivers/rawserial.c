@@ -47,6 +47,7 @@
 
 #include "lcd.h"
 #include "rawserial.h"
+#include "serial_io.h"
 #include "shared/report.h"
 
 
@@ -55,7 +56,7 @@ typedef struct rawserial_private_data {
 	int width;		/**< display width in characters */
 	int height;		/**< display height in characters */
 	char *framebuf;		/**< frame buffer */
-	int fd;		/**< handle to the device */
+	SerialPort *port;	/**< serial port of the display */
 
 	/** \name Event loop timing. refresh_time and refresh_delta form the
 	 * event loop timing mechanism for configurable update rates.
@@ -93,8 +94,6 @@ rawserial_init(Driver *drvthis)
 	int tmp;
 	double tmpf;
 
-	struct termios portset;
-
 	/* Allocate and store private data */
 	p = (PrivateData *) calloc(1, sizeof(PrivateData));
 	if (p == NULL)
@@ -180,39 +179,17 @@ rawserial_init(Driver *drvthis)
 	memset(p->framebuf, ' ', p->width * p->height);
 
 	/* Set up I/O port correctly, and open it... */
-	p->fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY);
-	if (p->fd == -1) {
-		report(RPT_ERR, "%s: open(%s) failed (%s)", drvthis->name, device, strerror(errno));
+	p->port = serial_open(drvthis->name, device, speed, SERIAL_NONBLOCK);
+	if (p->port == NULL) {
 		if (errno == EACCES)
 			report(RPT_ERR, "%s: device %s could not be opened", drvthis->name, device);
 		goto err_out;
 	}
 	report(RPT_INFO, "%s: opened display on %s", drvthis->name, device);
 
-	tcgetattr(p->fd, &portset);
-
-	/* We use RAW mode */
-#ifdef HAVE_CFMAKERAW
-	/* The easy way */
-	cfmakeraw(&portset);
-#else
-	/* The hard way */
-	portset.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
-	portset.c_oflag &= ~OPOST;
-	portset.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
-	portset.c_cflag &= ~(CSIZE | PARENB | CRTSCTS);
-	portset.c_cflag |= CS8 | CREAD | CLOCAL;
-#endif
 	/* Set timeouts */
-	portset.c_cc[VMIN] = 1;
-	portset.c_cc[VTIME] = 3;
-
-	/* Set port speed */
-	cfsetospeed(&portset, speed);
-	cfsetispeed(&portset, B0);
-
-	/* Do it... */
-	tcsetattr(p->fd, TCSANOW, &portset);
+	if (serial_set_timeouts(p->port, 1, 3) < 0)
+		goto err_out;
 
 	report(RPT_DEBUG, "%s: init() done", drvthis->name);
 	return 0;
@@ -233,8 +210,7 @@ rawserial_close(Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 
 	if (p != NULL) {
-		if (p->fd >= 0)
-			close(p->fd);
+		serial_close(p->port);
 		if (p->framebuf != NULL)
 			free(p->framebuf);
 
@@ -325,8 +301,9 @@ rawserial_flush(Driver *drvthis)
 		 * There is no processing and no control chars are emitted,
 		 * just a plain-old newline at the end of the record. */
 		memcpy(out, p->framebuf, dataEnd);
-		write(p->fd, out, dataEnd);
-		write(p->fd, "\n", 1);
+		serial_write(p->port, out, dataEnd);
+		serial_write(p->port, "\n", 1);
+		serial_flush(p->port);
 
 		report(RPT_DEBUG,
 		       "%s: flush exec time: %u, refresh delta: %u, current clock: %u, rendering loop overshoot: %d ms",
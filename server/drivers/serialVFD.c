@@ -239,6 +239,7 @@ serialVFD_init (Driver *drvthis)
 	Port_Function[p->use_parallel].write_fkt(drvthis, &p->hw_cmd[reset][1],p->hw_cmd[reset][0]);
 	Port_Function[p->use_parallel].write_fkt(drvthis, &p->hw_cmd[init_cmds][1],p->hw_cmd[init_cmds][0]);
 	serialVFD_backlight(drvthis, 1);
+	Port_Function[p->use_parallel].flush_fkt(drvthis);
 
 	report(RPT_DEBUG, "%s: init() done", drvthis->name);
 	return 0;
@@ -332,7 +333,7 @@ serialVFD_clear (Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 
 	memset(p->framebuf, ' ', p->width * p->height);
-
+	p->ccmode = standard;
 }
 
 
@@ -450,6 +451,8 @@ serialVFD_flush (Driver *drvthis)
 		memcpy(p->backingstore, p->framebuf, p->height * p->width);
 		debug(RPT_DEBUG, "%s: memcpy", __FUNCTION__);
 	}
+
+	Port_Function[p->use_parallel].flush_fkt(drvthis);
 }
 
 
@@ -26,6 +26,8 @@
 #ifndef SERIALVFD_H
 #define SERIALVFD_H
 
+#include "serial_io.h"
+
 #define DEFAULT_CELL_WIDTH	5
 #define DEFAULT_CELL_HEIGHT	7
 #define DEFAULT_DEVICE		"/dev/lcd"
@@ -69,7 +71,7 @@ typedef struct serialVFD_private_data {
 	int use_parallel;	/**< use parallel port? */
 	unsigned short port;	/**< port in parallel mode */
 	char device[200];	/**> device in serial mode */
-	int fd;			/**< file descriptor in serial mode */
+	SerialPort *serial;	/**< serial port in serial mode */
 	int speed;		/**< Speed in serial mode */
 	/* dimensions */
 	int width, height;
@@ -34,8 +34,6 @@
 #endif
 
 #include <unistd.h>
-#include <termios.h>
-#include <fcntl.h>
 #include <string.h>
 #include <errno.h>
 
@@ -56,7 +54,7 @@
 #define MAXBUSY 300
 
 /**
- * Write bytes to the serial port.
+ * Queue bytes for the serial port. They are sent by serialVFD_flush_serial().
  * \param drvthis  Pointer to driver
  * \param dat      Pointer to array storing the data
  * \param length   Number of bytes to write
@@ -69,7 +67,19 @@ serialVFD_write_serial (Driver *drvthis, unsigned char *dat, size_t length)
 	if (length <= 0)
 		return;
 
-	write(p->fd,dat,length);
+	serial_write(p->serial, dat, length);
+}
+
+/**
+ * Send the bytes queued for the serial port.
+ * \param drvthis  Pointer to driver
+ */
+void
+serialVFD_flush_serial (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+
+	serial_flush(p->serial);
 }
 
 /**
@@ -134,6 +144,15 @@ serialVFD_write_parallel (Driver *drvthis, unsigned char *dat, size_t length)
 #endif
 }
 
+/**
+ * Nothing to do: parallel port writes are not buffered.
+ * \param drvthis  Pointer to driver
+ */
+void
+serialVFD_flush_parallel (Driver *drvthis)
+{
+}
+
 /**
  * Open a serial port according to the settings in \c serialVFD_private_data.
  * \param  drvthis  Pointer to driver
@@ -143,39 +162,12 @@ int
 serialVFD_init_serial (Driver *drvthis)
 {
 	PrivateData *p = drvthis->private_data;
-	struct termios portset;
 
 	/* Set up io port correctly, and open it...*/
-	debug( RPT_DEBUG, "%s: Opening device: %s", __FUNCTION__, p->device);
-	p->fd = open(p->device, O_RDWR | O_NOCTTY | O_NDELAY);
-
-	if (p->fd == -1) {
-		report(RPT_ERR, "%s: open() of %s failed (%s)", __FUNCTION__, p->device, strerror(errno));
+	p->serial = serial_open(drvthis->name, p->device, p->speed, SERIAL_NONBLOCK);
+	if (p->serial == NULL)
 		return -1;
-	}
 
-	tcgetattr(p->fd, &portset);
-
-	/* We use RAW mode */
-#ifdef HAVE_CFMAKERAW
-	/* The easy way */
-	cfmakeraw( &portset );
-#else
-	/* The hard way */
-	portset.c_iflag &= ~( IGNBRK | BRKINT | PARMRK | ISTRIP
-   	                   | INLCR | IGNCR | ICRNL | IXON );
-	portset.c_oflag &= ~OPOST;
-	portset.c_lflag &= ~( ECHO | ECHONL | ICANON | ISIG | IEXTEN );
-	portset.c_cflag &= ~( CSIZE | PARENB | CRTSCTS );
-	portset.c_cflag |= CS8 | CREAD | CLOCAL ;
-#endif
-
-	/* Set port speed */
-	cfsetospeed(&portset, p->speed);
-	cfsetispeed(&portset, B0);
-
-	/* Do it... */
-	tcsetattr(p->fd, TCSANOW, &portset);
 	return 0;
 }
 
@@ -209,8 +201,9 @@ void
 serialVFD_close_serial (Driver *drvthis)
 {
 	PrivateData *p = drvthis->private_data;
-	if (p->fd >= 0)
-		close(p->fd);
+
+	serial_close(p->serial);
+	p->serial = NULL;
 }
 
 /**
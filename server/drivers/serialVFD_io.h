@@ -30,12 +30,15 @@ int serialVFD_init_serial (Driver *drvthis);
 int serialVFD_init_parallel (Driver *drvthis);
 void serialVFD_write_serial (Driver *drvthis, unsigned char *dat, size_t length);
 void serialVFD_write_parallel (Driver *drvthis, unsigned char *dat, size_t length);
+void serialVFD_flush_serial (Driver *drvthis);
+void serialVFD_flush_parallel (Driver *drvthis);
 void serialVFD_close_serial (Driver *drvthis);
 void serialVFD_close_parallel (Driver *drvthis);
 
 /** Function list for low-level I/O routines */
 typedef struct Port_fkt {
 	void (*write_fkt) (Driver *drvthis, unsigned char *dat, size_t length);
+	void (*flush_fkt) (Driver *drvthis);
 	int (*init_fkt) (Driver *drvthis);
 	void (*close_fkt) (Driver *drvthis);
 } Port_fkt;
@@ -46,8 +49,8 @@ typedef struct Port_fkt {
  * for parallel ports.
  */
 static const Port_fkt Port_Function[] = {
-	{serialVFD_write_serial, serialVFD_init_serial, serialVFD_close_serial},
-	{serialVFD_write_parallel, serialVFD_init_parallel, serialVFD_close_parallel}
+	{serialVFD_write_serial, serialVFD_flush_serial, serialVFD_init_serial, serialVFD_close_serial},
+	{serialVFD_write_parallel, serialVFD_flush_parallel, serialVFD_init_parallel, serialVFD_close_parallel}
 };
 
 #endif
@@ -0,0 +1,560 @@
+/** \file server/drivers/serial_io.c
+ * Buffered serial transport shared by the serial-attached drivers.
+ *
+ * Drivers queue their commands with serial_write() and hand them to the
+ * kernel with serial_flush(), usually once at the end of their flush()
+ * function. The output is kept in a ring buffer, so a flush costs a single
+ * writev() in the common case. Short writes and \c EAGAIN are handled by
+ * waiting for the port to become writable again instead of silently
+ * dropping bytes.
+ *
+ * The transport also keeps track of when the UART will have shifted out
+ * the last byte, based on the configured baud rate. serial_wait_idle()
+ * uses this to pace devices that need the line to be quiet (e.g. before
+ * reading a reply), and the write timeout is derived from it as well.
+ */
+
+/*-
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "serial_io.h"
+#include "shared/report.h"
+
+/** Bits on the wire per byte: start bit, 8 data bits, stop bit */
+#define SERIAL_BITS_PER_BYTE	10
+/** Slack in milliseconds added to the computed transmit time of a flush */
+#define SERIAL_WRITE_SLACK	500
+
+/** State of one serial port */
+struct serial_port {
+	const char *name;	/**< Driver name used in messages */
+	int fd;			/**< Port file descriptor */
+	int flags;		/**< SERIAL_* flags given to serial_open() */
+	long bps;		/**< Line speed in bits per second */
+
+	unsigned char *buf;	/**< Output ring buffer */
+	size_t size;		/**< Capacity of \c buf */
+	size_t head;		/**< Index of the first pending byte */
+	size_t len;		/**< Number of pending bytes */
+
+	struct timeval idle_at;	/**< Time the UART will have sent everything */
+};
+
+
+/**
+ * Translate a termios speed constant to bits per second.
+ * \param speed  One of the \c Bxxx constants.
+ * \return  Speed in bits per second, 9600 if unknown.
+ */
+static long
+serial_speed_to_bps(speed_t speed)
+{
+	switch (speed) {
+		case B1200:	return 1200;
+		case B2400:	return 2400;
+		case B4800:	return 4800;
+		case B9600:	return 9600;
+		case B19200:	return 19200;
+		case B38400:	return 38400;
+#ifdef B57600
+		case B57600:	return 57600;
+#endif
+#ifdef B115200
+		case B115200:	return 115200;
+#endif
+#ifdef B230400
+		case B230400:	return 230400;
+#endif
+#ifdef B460800
+		case B460800:	return 460800;
+#endif
+#ifdef B921600
+		case B921600:	return 921600;
+#endif
+		default:	return 9600;
+	}
+}
+
+
+/**
+ * Milliseconds the UART needs to send \c length bytes.
+ */
+static int
+serial_transmit_time(SerialPort *sp, size_t length)
+{
+	return (int) (((long long) length * SERIAL_BITS_PER_BYTE * 1000 + sp->bps - 1) / sp->bps);
+}
+
+
+/**
+ * Advance the expected idle time of the UART by \c length bytes.
+ */
+static void
+serial_account(SerialPort *sp, size_t length)
+{
+	struct timeval now;
+	long long usecs;
+
+	gettimeofday(&now, NULL);
+	if (timercmp(&sp->idle_at, &now, <))
+		sp->idle_at = now;
+
+	usecs = (long long) length * SERIAL_BITS_PER_BYTE * 1000000 / sp->bps;
+	sp->idle_at.tv_sec += usecs / 1000000;
+	sp->idle_at.tv_usec += usecs % 1000000;
+	if (sp->idle_at.tv_usec >= 1000000) {
+		sp->idle_at.tv_sec++;
+		sp->idle_at.tv_usec -= 1000000;
+	}
+}
+
+
+/**
+ * Open a serial port in raw mode.
+ * \param name    Name of the driver (used in messages).
+ * \param device  Device file to open.
+ * \param speed   Line speed as termios \c Bxxx constant.
+ * \param flags   Combination of \c SERIAL_NONBLOCK and \c SERIAL_BACKGROUND.
+ * \return  Pointer to the new port, or NULL on error.
+ */
+SerialPort *
+serial_open(const char *name, const char *device, speed_t speed, int flags)
+{
+	SerialPort *sp;
+	struct termios portset;
+	int oflags = O_RDWR | O_NOCTTY;
+
+	if (flags & SERIAL_BACKGROUND)
+		flags |= SERIAL_NONBLOCK;
+	if (flags & SERIAL_NONBLOCK)
+		oflags |= O_NDELAY;
+
+	sp = (SerialPort *) calloc(1, sizeof(SerialPort));
+	if (sp == NULL) {
+		report(RPT_ERR, "%s: unable to allocate serial port", name);
+		return NULL;
+	}
+	sp->name = name;
+	sp->flags = flags;
+	sp->bps = serial_speed_to_bps(speed);
+	sp->size = SERIAL_BUFFER_SIZE;
+	sp->buf = (unsigned char *) malloc(sp->size);
+	if (sp->buf == NULL) {
+		report(RPT_ERR, "%s: unable to allocate serial output buffer", name);
+		free(sp);
+		return NULL;
+	}
+
+	debug(RPT_DEBUG, "%s: Opening device: %s", name, device);
+	sp->fd = open(device, oflags);
+	if (sp->fd == -1) {
+		int err = errno;
+
+		report(RPT_ERR, "%s: open(%s) failed (%s)", name, device, strerror(err));
+		free(sp->buf);
+		free(sp);
+		/* callers may want to give hints based on the reason */
+		errno = err;
+		return NULL;
+	}
+
+	tcgetattr(sp->fd, &portset);
+
+	/* We use RAW mode */
+#ifdef HAVE_CFMAKERAW
+	/* The easy way */
+	cfmakeraw(&portset);
+#else
+	/* The hard way */
+	portset.c_iflag &= ~( IGNBRK | BRKINT | PARMRK | ISTRIP
+			      | INLCR | IGNCR | ICRNL | IXON );
+	portset.c_oflag &= ~OPOST;
+	portset.c_lflag &= ~( ECHO | ECHONL | ICANON | ISIG | IEXTEN );
+	portset.c_cflag &= ~( CSIZE | PARENB | CRTSCTS );
+	portset.c_cflag |= CS8 | CREAD | CLOCAL;
+#endif
+
+	/* Set port speed */
+	cfsetospeed(&portset, speed);
+	cfsetispeed(&portset, B0);
+
+	/* Do it... */
+	if (tcsetattr(sp->fd, TCSANOW, &portset) == -1) {
+		report(RPT_ERR, "%s: failed to configure port (%s)", name, strerror(errno));
+		close(sp->fd);
+		free(sp->buf);
+		free(sp);
+		return NULL;
+	}
+
+	return sp;
+}
+
+
+/**
+ * Send all pending output and close the port.
+ * \param sp  Pointer to the port, may be NULL.
+ */
+void
+serial_close(SerialPort *sp)
+{
+	if (sp == NULL)
+		return;
+
+	/* a final flush must not be left in the background */
+	sp->flags &= ~SERIAL_BACKGROUND;
+	serial_flush(sp);
+
+	close(sp->fd);
+	free(sp->buf);
+	free(sp);
+}
+
+
+/**
+ * Return the file descriptor of the port, e.g. for select() on input.
+ */
+int
+serial_fd(SerialPort *sp)
+{
+	return sp->fd;
+}
+
+
+/**
+ * Change the \c VMIN and \c VTIME settings of the port.
+ * \param sp     Pointer to the port.
+ * \param vmin   Minimum number of characters for a read.
+ * \param vtime  Read timeout in tenths of a second.
+ * \retval 0   Success.
+ * \retval <0  Error.
+ */
+int
+serial_set_timeouts(SerialPort *sp, int vmin, int vtime)
+{
+	struct termios portset;
+
+	if (tcgetattr(sp->fd, &portset) == -1)
+		return -1;
+
+	portset.c_cc[VMIN] = vmin;
+	portset.c_cc[VTIME] = vtime;
+
+	if (tcsetattr(sp->fd, TCSANOW, &portset) == -1) {
+		report(RPT_ERR, "%s: failed to configure port (%s)", sp->name, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * Hand as much pending output to the kernel as it accepts without waiting.
+ * \param sp  Pointer to the port.
+ * \retval 0   Progress was made or nothing to do.
+ * \retval 1   The kernel did not accept anything (\c EAGAIN).
+ * \retval <0  Write error; the pending output has been discarded.
+ */
+static int
+serial_write_some(SerialPort *sp)
+{
+	while (sp->len > 0) {
+		struct iovec iov[2];
+		int iovcnt = 1;
+		size_t first = sp->size - sp->head;
+		ssize_t n;
+
+		iov[0].iov_base = sp->buf + sp->head;
+		iov[0].iov_len = (sp->len < first) ? sp->len : first;
+		if (sp->len > first) {
+			iov[1].iov_base = sp->buf;
+			iov[1].iov_len = sp->len - first;
+			iovcnt = 2;
+		}
+
+		n = writev(sp->fd, iov, iovcnt);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 1;
+			report(RPT_ERR, "%s: write failed (%s)", sp->name, strerror(errno));
+			sp->head = sp->len = 0;
+			return -1;
+		}
+
+		serial_account(sp, n);
+		sp->head = (sp->head + n) % sp->size;
+		sp->len -= n;
+	}
+	sp->head = 0;
+	return 0;
+}
+
+
+/**
+ * Write pending output, waiting for the port to become writable when the
+ * kernel buffer is full.
+ * \param sp       Pointer to the port.
+ * \param keep     Return as soon as at most \c keep bytes are pending.
+ * \retval 0   Success.
+ * \retval <0  Error or timeout; the pending output has been discarded.
+ */
+static int
+serial_drain(SerialPort *sp, size_t keep)
+{
+	int timeout = serial_transmit_time(sp, sp->len) * 2 + SERIAL_WRITE_SLACK;
+
+	while (sp->len > keep) {
+		struct pollfd fds[1];
+		int ret = serial_write_some(sp);
+
+		if (ret <= 0)
+			return ret;
+
+		fds[0].fd = sp->fd;
+		fds[0].events = POLLOUT;
+		fds[0].revents = 0;
+		ret = poll(fds, 1, timeout);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			report(RPT_WARNING, "%s: write timed out, %lu bytes dropped",
+			       sp->name, (unsigned long) sp->len);
+			sp->head = sp->len = 0;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * Enlarge the output buffer to at least \c want bytes, up to
+ * \c SERIAL_BUFFER_MAX. The pending bytes are moved to the start.
+ * \param sp    Pointer to the port.
+ * \param want  Desired capacity.
+ */
+static void
+serial_grow(SerialPort *sp, size_t want)
+{
+	size_t newsize = sp->size;
+	size_t part = sp->size - sp->head;
+	unsigned char *newbuf;
+
+	while ((newsize < want) && (newsize < SERIAL_BUFFER_MAX))
+		newsize *= 2;
+	if (newsize == sp->size)
+		return;
+
+	newbuf = (unsigned char *) malloc(newsize);
+	if (newbuf == NULL)
+		return;
+
+	if (sp->len <= part) {
+		memcpy(newbuf, sp->buf + sp->head, sp->len);
+	}
+	else {
+		memcpy(newbuf, sp->buf + sp->head, part);
+		memcpy(newbuf + part, sp->buf, sp->len - part);
+	}
+	free(sp->buf);
+	sp->buf = newbuf;
+	sp->size = newsize;
+	sp->head = 0;
+}
+
+
+/**
+ * Queue data for output. Nothing is sent before the next serial_flush()
+ * unless the output buffer runs full.
+ * \param sp      Pointer to the port.
+ * \param data    Bytes to send.
+ * \param length  Number of bytes.
+ * \retval 0   Success.
+ * \retval <0  Error.
+ */
+int
+serial_write(SerialPort *sp, const void *data, size_t length)
+{
+	const unsigned char *src = data;
+	size_t tail, first;
+
+	if (sp->size - sp->len < length)
+		serial_grow(sp, sp->len + length);
+
+	if (sp->size - sp->len < length) {
+		/* buffer can't grow any further: make room on the line */
+		if (length <= sp->size)
+			return (serial_drain(sp, sp->size - length) < 0)
+				? -1 : serial_write(sp, data, length);
+
+		/* more than fits at all: send it in buffer-sized pieces */
+		while (length > 0) {
+			size_t chunk = (length < sp->size) ? length : sp->size;
+
+			if (serial_drain(sp, 0) < 0)
+				return -1;
+			memcpy(sp->buf, src, chunk);
+			sp->head = 0;
+			sp->len = chunk;
+			src += chunk;
+			length -= chunk;
+		}
+		return 0;
+	}
+
+	tail = (sp->head + sp->len) % sp->size;
+	first = sp->size - tail;
+	if (length <= first) {
+		memcpy(sp->buf + tail, src, length);
+	}
+	else {
+		memcpy(sp->buf + tail, src, first);
+		memcpy(sp->buf, src + first, length - first);
+	}
+	sp->len += length;
+
+	return 0;
+}
+
+
+/**
+ * Send the queued output.
+ *
+ * Normally this returns once everything has been handed to the kernel.
+ * With \c SERIAL_BACKGROUND it writes what the port accepts right now and
+ * leaves the rest for later calls.
+ * \param sp  Pointer to the port.
+ * \return  Number of bytes still pending, or -1 on error.
+ */
+int
+serial_flush(SerialPort *sp)
+{
+	if (sp->flags & SERIAL_BACKGROUND) {
+		if (serial_write_some(sp) < 0)
+			return -1;
+	}
+	else if (serial_drain(sp, 0) < 0) {
+		return -1;
+	}
+	return (int) sp->len;
+}
+
+
+/**
+ * Continue sending output left over by a background serial_flush().
+ * Drivers call this from places that run often, like get_key().
+ * \param sp  Pointer to the port.
+ * \return  Number of bytes still pending, or -1 on error.
+ */
+int
+serial_poll(SerialPort *sp)
+{
+	if (sp->len == 0)
+		return 0;
+	if (serial_write_some(sp) < 0)
+		return -1;
+	return (int) sp->len;
+}
+
+
+/**
+ * Return the number of queued bytes not yet handed to the kernel.
+ */
+size_t
+serial_pending(SerialPort *sp)
+{
+	return sp->len;
+}
+
+
+/**
+ * Send all queued output and wait until the UART should have shifted out
+ * the last byte, based on the line speed.
+ * \param sp  Pointer to the port.
+ */
+void
+serial_wait_idle(SerialPort *sp)
+{
+	struct timeval now, diff;
+
+	serial_drain(sp, 0);
+
+	gettimeofday(&now, NULL);
+	if (timercmp(&sp->idle_at, &now, >)) {
+		timersub(&sp->idle_at, &now, &diff);
+		usleep(diff.tv_sec * 1000000 + diff.tv_usec);
+	}
+}
+
+
+/**
+ * Read from the port. Queued output is sent first, as callers usually
+ * wait for the reply to a command. When a \c SERIAL_BACKGROUND port is
+ * only polled (\c timeout 0) just what the kernel accepts right away is
+ * sent, so polling for keys does not wait for a frame to drain.
+ * \param sp       Pointer to the port.
+ * \param data     Buffer for the bytes read.
+ * \param length   Size of the buffer.
+ * \param timeout  Time to wait for input in milliseconds; 0 to poll,
+ *                 negative to wait forever.
+ * \return  Number of bytes read, 0 on timeout, -1 on error.
+ */
+int
+serial_read(SerialPort *sp, void *data, size_t length, int timeout)
+{
+	struct pollfd fds[1];
+	ssize_t n;
+	int ret;
+
+	if (sp->len > 0) {
+		if ((sp->flags & SERIAL_BACKGROUND) && (timeout == 0))
+			ret = serial_write_some(sp);
+		else
+			ret = serial_drain(sp, 0);
+		if (ret < 0)
+			return -1;
+	}
+
+	fds[0].fd = sp->fd;
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+	do {
+		ret = poll(fds, 1, timeout);
+	} while (ret < 0 && errno == EINTR);
+	if (ret <= 0)
+		return ret;
+
+	n = read(sp->fd, data, length);
+	if (n < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+	return (int) n;
+}
@@ -0,0 +1,60 @@
+/** \file server/drivers/serial_io.h
+ * Buffered serial transport shared by the serial-attached drivers.
+ */
+
+/*-
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ */
+
+#ifndef SERIAL_IO_H
+#define SERIAL_IO_H
+
+#include <stddef.h>
+#include <termios.h>
+
+/** \name Flags for serial_open()
+ * @{
+ */
+/** Open the device with \c O_NDELAY; reads return immediately. */
+#define SERIAL_NONBLOCK		0x01
+/**
+ * Do not wait for the output to drain in serial_flush(). Bytes the
+ * kernel does not accept right away stay queued and are sent by the
+ * next serial_flush() or serial_poll(). Implies \c SERIAL_NONBLOCK.
+ */
+#define SERIAL_BACKGROUND	0x02
+/** @} */
+
+/** Initial size of the output buffer */
+#define SERIAL_BUFFER_SIZE	1024
+/** The output buffer never grows beyond this size; writers block instead */
+#define SERIAL_BUFFER_MAX	65536
+
+typedef struct serial_port SerialPort;
+
+SerialPort *serial_open(const char *name, const char *device, speed_t speed, int flags);
+void serial_close(SerialPort *sp);
+int serial_fd(SerialPort *sp);
+int serial_set_timeouts(SerialPort *sp, int vmin, int vtime);
+
+int serial_write(SerialPort *sp, const void *data, size_t length);
+int serial_flush(SerialPort *sp);
+int serial_poll(SerialPort *sp);
+size_t serial_pending(SerialPort *sp);
+void serial_wait_idle(SerialPort *sp);
+
+int serial_read(SerialPort *sp, void *data, size_t length, int timeout);
+
+#endif
@@ -191,4 +191,138 @@ timing_uPause(int usecs)
 }
 
 
+/** \name Calibrated delay engine
+ * timing_uPause() always sleeps for the full time, and nanosleep()
+ * overshoots short delays considerably. The delay engine below instead
+ * waits for a deadline on the monotonic clock. It can credit the time
+ * spent since the previous wait (e.g. the bus transfer of the last write)
+ * against the delay, and it uses nanosleep() only for the part of a delay
+ * that is longer than the measured oversleep, spinning for the rest.
+ *@{*/
+
+/** Sleep for the remaining time with nanosleep() */
+#define TIMING_SLEEP	0
+/** Busy-wait on the clock for the remaining time */
+#define TIMING_SPIN	1
+/** nanosleep() for long waits, busy-wait for short ones and the rest */
+#define TIMING_HYBRID	2
+
+/** Number of nanosleep() calls used to measure the oversleep */
+#define TIMING_CALIBRATE_ROUNDS	8
+
+/** State of the delay engine */
+typedef struct timing_delay {
+	int method;		/**< TIMING_SLEEP, TIMING_SPIN or TIMING_HYBRID */
+	long slack;		/**< measured oversleep of nanosleep() in ns */
+	struct timespec mark;	/**< end of the previous wait */
+} TimingDelay;
+
+
+/**
+ * Read the monotonic clock in nanoseconds.
+ * \return  Current time in nanoseconds.
+ */
+static inline long long
+timing_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/**
+ * Sleep for some nanoseconds, continuing after signals.
+ * \param nsecs  Time to sleep.
+ */
+static inline void
+timing_nsleep(long long nsecs)
+{
+	struct timespec delay_time, remaining;
+
+	delay_time.tv_sec = nsecs / 1000000000LL;
+	delay_time.tv_nsec = nsecs % 1000000000LL;
+	while (nanosleep(&delay_time, &remaining) == -1 && errno == EINTR)
+		delay_time = remaining;
+}
+
+
+/**
+ * Set up the delay engine. For TIMING_HYBRID the oversleep of nanosleep()
+ * is measured, so that only delays clearly longer than that are slept.
+ * \param td      Delay engine state.
+ * \param method  TIMING_SLEEP, TIMING_SPIN or TIMING_HYBRID.
+ */
+static inline void
+timing_delay_init(TimingDelay *td, int method)
+{
+	long long start, total = 0;
+	int i;
+
+	td->method = method;
+	td->slack = 0;
+
+	if (method == TIMING_HYBRID) {
+		for (i = 0; i < TIMING_CALIBRATE_ROUNDS; i++) {
+			start = timing_now();
+			timing_nsleep(1000);
+			total += timing_now() - start - 1000;
+		}
+		td->slack = (long) (total / TIMING_CALIBRATE_ROUNDS);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &td->mark);
+}
+
+
+/**
+ * Restart the time counted by timing_delay_wait(), e.g. after waiting for
+ * the device by other means.
+ * \param td      Delay engine state.
+ */
+static inline void
+timing_delay_mark(TimingDelay *td)
+{
+	clock_gettime(CLOCK_MONOTONIC, &td->mark);
+}
+
+
+/**
+ * Wait until \c usecs microseconds have passed. With \c credit set the
+ * time is counted from the end of the previous wait, so the time taken
+ * in between (the transfer of the data the delay is for) is not waited
+ * again.
+ * \param td      Delay engine state.
+ * \param usecs   Microseconds to wait.
+ * \param credit  Count from the end of the previous wait instead of now.
+ */
+static inline void
+timing_delay_wait(TimingDelay *td, int usecs, int credit)
+{
+	long long now = timing_now();
+	long long start = (credit)
+		? (long long) td->mark.tv_sec * 1000000000LL + td->mark.tv_nsec
+		: now;
+	long long deadline = start + (long long) usecs * 1000;
+
+	if (now < deadline) {
+		switch (td->method) {
+		case TIMING_SLEEP:
+			timing_nsleep(deadline - now);
+			break;
+		case TIMING_HYBRID:
+			if (deadline - now > 2 * td->slack)
+				timing_nsleep(deadline - now - td->slack);
+			/* FALLTHROUGH */
+		default:
+			while (timing_now() < deadline)
+				;
+			break;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &td->mark);
+}
+/**@}*/
+
+
 #endif /* _TIMING_H */
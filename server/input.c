@@ -1,5 +1,11 @@
 /** \file server/input.c
  * Handles keypad (and other?) input from the user.
+ *
+ * Keys read from the drivers during one pass of the main loop are queued
+ * first. Consecutive presses of the same key are coalesced into a single
+ * event carrying a repeat count, repeats arriving faster than
+ * KeyRepeatInterval are held back and merged into the next event, and
+ * all key messages for one client are sent with a single write.
  */
 
 /* This file is part of LCDd, the lcdproc server.
@@ -14,6 +20,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "shared/sockets.h"
 #include "shared/report.h"
@@ -32,6 +39,40 @@
 #include "render.h" /* For server_msg* */
 
 
+/** Maximum number of distinct key events handled per main loop pass */
+#define KEY_QUEUE_SIZE	32
+/** Maximum length of a key name (including terminating NUL) */
+#define KEY_NAME_SIZE	64
+/** Size of the per-client buffer for key messages */
+#define KEY_BATCH_SIZE	1024
+
+/** A key press, possibly repeated \c count times */
+typedef struct KeyEvent {
+	char key[KEY_NAME_SIZE];
+	int count;
+} KeyEvent;
+
+/** Key messages collected for one client */
+typedef struct KeyBatch {
+	Client *client;
+	size_t len;
+	char buf[KEY_BATCH_SIZE];
+} KeyBatch;
+
+static KeyEvent key_queue[KEY_QUEUE_SIZE];
+static int key_queue_len = 0;
+
+static KeyBatch key_batch[KEY_QUEUE_SIZE];
+static int key_batch_len = 0;
+
+/** Repeats of the last delivered key held back by rate limiting */
+static KeyEvent held_key;
+static char last_key[KEY_NAME_SIZE];
+static struct timeval last_key_time;
+
+static int key_repeat_interval = 0;	/**< in ms; 0 disables rate limiting */
+static int key_repeat_max = 0;		/**< max. steps per event; 0 is unlimited */
+
 LinkedList *keylist;
 char *toggle_rotate_key;
 char *prev_screen_key;
@@ -57,6 +98,18 @@ int input_init(void)
 	scroll_up_key = strdup(config_get_string("server", "ScrollUpKey", 0, "Up"));
 	scroll_down_key = strdup(config_get_string("server", "ScrollDownKey", 0, "Down"));
 
+	/* Get key rate limits from config file */
+	key_repeat_interval = config_get_int("server", "KeyRepeatInterval", 0, 0);
+	if (key_repeat_interval < 0) {
+		report(RPT_WARNING, "KeyRepeatInterval must be >= 0; using 0");
+		key_repeat_interval = 0;
+	}
+	key_repeat_max = config_get_int("server", "KeyRepeatMax", 0, 0);
+	if (key_repeat_max < 0) {
+		report(RPT_WARNING, "KeyRepeatMax must be >= 0; using 0");
+		key_repeat_max = 0;
+	}
+
 	return 0;
 }
 
@@ -79,12 +132,135 @@ void input_shutdown()
 
 
 
+/**
+ * Add a key read from the drivers to the queue. A key equal to the one
+ * queued last only increases that event's repeat count.
+ * \param key  Key name as returned by the driver.
+ */
+static void
+input_queue_key(const char *key)
+{
+	KeyEvent *ev;
+
+	if ((key_queue_len > 0) && (strcmp(key_queue[key_queue_len - 1].key, key) == 0)) {
+		key_queue[key_queue_len - 1].count++;
+		return;
+	}
+
+	ev = &key_queue[key_queue_len++];
+	strncpy(ev->key, key, KEY_NAME_SIZE - 1);
+	ev->key[KEY_NAME_SIZE - 1] = '\0';
+	ev->count = 1;
+}
+
+
+/**
+ * Send the collected key messages of all clients.
+ */
+static void
+input_flush_batches(void)
+{
+	int i;
+
+	for (i = 0; i < key_batch_len; i++) {
+		if (key_batch[i].len > 0)
+			sock_send_string(key_batch[i].client->sock, key_batch[i].buf);
+	}
+	key_batch_len = 0;
+}
+
+
+/**
+ * Append a key message for a client to its batch.
+ * \param client  Client the key was reserved by.
+ * \param ev      Key event to send.
+ */
+static void
+input_batch_key(Client *client, const KeyEvent *ev)
+{
+	KeyBatch *batch = NULL;
+	char line[KEY_NAME_SIZE + 20];
+	size_t len;
+	int i, lines;
+
+	for (i = 0; i < key_batch_len; i++) {
+		if (key_batch[i].client == client) {
+			batch = &key_batch[i];
+			break;
+		}
+	}
+	if (batch == NULL) {
+		/* Held back repeats may go to yet another client: make room */
+		if (key_batch_len >= KEY_QUEUE_SIZE)
+			input_flush_batches();
+		batch = &key_batch[key_batch_len++];
+		batch->client = client;
+		batch->len = 0;
+		batch->buf[0] = '\0';
+	}
+
+	/* Clients that asked for it get the repeat count in one message */
+	if (client->keycount && (ev->count > 1)) {
+		len = snprintf(line, sizeof(line), "key %s %d\n", ev->key, ev->count);
+		lines = 1;
+	}
+	else {
+		len = snprintf(line, sizeof(line), "key %s\n", ev->key);
+		lines = ev->count;
+	}
+
+	while (lines-- > 0) {
+		if (batch->len + len >= KEY_BATCH_SIZE) {
+			sock_send_string(client->sock, batch->buf);
+			batch->len = 0;
+		}
+		memcpy(batch->buf + batch->len, line, len + 1);
+		batch->len += len;
+	}
+}
+
+
+/**
+ * Deliver a key event to the client that reserved the key, or to the
+ * server itself.
+ * \param ev              Key event to deliver.
+ * \param current_client  Client owning the current screen, or NULL.
+ * \param now             Current time.
+ */
+static void
+input_deliver_key(KeyEvent *ev, Client *current_client, struct timeval *now)
+{
+	KeyReservation *kr;
+	int i;
+
+	if ((key_repeat_max > 0) && (ev->count > key_repeat_max))
+		ev->count = key_repeat_max;
+
+	strcpy(last_key, ev->key);
+	last_key_time = *now;
+
+	/* Find what client wants the key */
+	kr = input_find_key(ev->key, current_client);
+	if (kr && kr->client) {
+		/* A hit ! */
+		debug(RPT_DEBUG, "%s: reserved key: \"%.40s\" (%d)", __FUNCTION__, ev->key, ev->count);
+		input_batch_key(kr->client, ev);
+	} else {
+		debug(RPT_DEBUG, "%s: left over key: \"%.40s\" (%d)", __FUNCTION__, ev->key, ev->count);
+		for (i = 0; i < ev->count; i++)
+			input_internal_key(ev->key);
+	}
+}
+
+
 void handle_input(void)
 {
 	const char *key;
 	Screen *current_screen;
 	Client *current_client;
-	KeyReservation *kr;
+	struct timeval now, elapsed;
+	long since_last;
+	int i;
 
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
@@ -94,20 +270,47 @@ void handle_input(void)
 	else
 		current_client = NULL;
 
-	/* Handle all keypresses */
-	while ((key = drivers_get_key()) != NULL) {
-
-		/* Find what client wants the key */
-		kr = input_find_key(key, current_client);
-		if (kr && kr->client) {
-			/* A hit ! */
-			debug(RPT_DEBUG, "%s: reserved key: \"%.40s\"", __FUNCTION__, key);
-			sock_printf(kr->client->sock, "key %s\n", key);
-		} else {
-			debug(RPT_DEBUG, "%s: left over key: \"%.40s\"", __FUNCTION__, key);
-			input_internal_key(key);
+	/* Collect all keypresses, leaving the rest for the next pass if the
+	 * queue is full */
+	key_queue_len = 0;
+	while ((key_queue_len < KEY_QUEUE_SIZE) && ((key = drivers_get_key()) != NULL))
+		input_queue_key(key);
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &last_key_time, &elapsed);
+	since_last = elapsed.tv_sec * 1000 + elapsed.tv_usec / 1000;
+	if (since_last < 0)	/* clock was set back */
+		since_last = key_repeat_interval;
+
+	/* Held back repeats are due */
+	if ((held_key.count > 0) && (since_last >= key_repeat_interval)) {
+		input_deliver_key(&held_key, current_client, &now);
+		held_key.count = 0;
+		since_last = 0;
+	}
+
+	for (i = 0; i < key_queue_len; i++) {
+		KeyEvent *ev = &key_queue[i];
+
+		if (strcmp(ev->key, last_key) == 0) {
+			/* Repeat of the last key: too fast ? */
+			if (since_last < key_repeat_interval) {
+				strcpy(held_key.key, ev->key);
+				held_key.count += ev->count;
+				continue;
+			}
 		}
+		else if (held_key.count > 0) {
+			/* Keep order: held repeats go out before the new key */
+			input_deliver_key(&held_key, current_client, &now);
+			held_key.count = 0;
+		}
+
+		input_deliver_key(ev, current_client, &now);
+		since_last = 0;
 	}
+
+	input_flush_batches();
 }
 
 
@@ -210,6 +413,18 @@ void input_release_client_keys(Client *client)
 	}
 }
 
+int input_count_client_keys(Client *client)
+{
+	KeyReservation *kr;
+	int count = 0;
+
+	for (kr = LL_GetFirst(keylist); kr != NULL; kr = LL_GetNext(keylist)) {
+		if (kr->client == client)
+			count++;
+	}
+	return count;
+}
+
 KeyReservation *input_find_key(const char *key, Client *client)
 {
 	KeyReservation *kr;
@@ -47,6 +47,9 @@ void input_release_key(const char *key, Client *client);
 void input_release_client_keys(Client *client);
 	/* Releases all key reservations for a given client */
 
+int input_count_client_keys(Client *client);
+	/* Counts the key reservations of a given client */
+
 KeyReservation *input_find_key(const char *key, Client *client);
 	/* Finds if a key reservation causes a 'hit'.
 	 * If the key was reserved exclusively, the client will be ignored.
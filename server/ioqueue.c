@@ -0,0 +1,116 @@
+/** \file server/ioqueue.c
+ * Lock-free queue passing events between the I/O thread and the main thread.
+ *
+ * The queue is a ring of a power of two slots with free running head and
+ * tail counters. Only the producer writes the tail and only the consumer
+ * the head, so no lock is needed: the release store of a counter makes
+ * the slot contents visible to the other thread, which loads the counter
+ * with acquire semantics.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+
+#include "ioqueue.h"
+
+
+/** Create a queue.
+ * \param size  Minimum number of events the queue can hold; rounded up
+ *              to a power of two.
+ * \return      The new queue; NULL on error.
+ */
+IOQueue *
+ioqueue_create(unsigned int size)
+{
+	IOQueue *q;
+	unsigned int slots = 1;
+
+	while (slots < size)
+		slots <<= 1;
+
+	q = calloc(1, sizeof(IOQueue));
+	if (q == NULL)
+		return NULL;
+	q->slots = calloc(slots, sizeof(IOEvent));
+	if (q->slots == NULL) {
+		free(q);
+		return NULL;
+	}
+	q->mask = slots - 1;
+	return q;
+}
+
+
+/** Destroy a queue. Both threads must be done with it.
+ * \param q  The queue.
+ */
+void
+ioqueue_destroy(IOQueue *q)
+{
+	IOEvent ev;
+
+	if (q == NULL)
+		return;
+
+	while (ioqueue_get(q, &ev) == 0)
+		free(ev.message);
+	free(q->slots);
+	free(q);
+}
+
+
+/** Append an event. To be called by the producer only.
+ * \param q   The queue.
+ * \param ev  Event to copy into the queue.
+ * \retval 0  Success.
+ * \retval -1 The queue is full.
+ */
+int
+ioqueue_put(IOQueue *q, const IOEvent *ev)
+{
+	unsigned int tail = q->tail;
+
+	if (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) > q->mask)
+		return -1;
+
+	q->slots[tail & q->mask] = *ev;
+	__atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+
+/** Get the number of free slots. To be called by the producer only; the
+ * consumer may free more slots concurrently.
+ * \param q   The queue.
+ * \return    Number of events that can be appended.
+ */
+unsigned int
+ioqueue_space(IOQueue *q)
+{
+	return q->mask + 1 - (q->tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE));
+}
+
+
+/** Take the oldest event. To be called by the consumer only.
+ * \param q   The queue.
+ * \param ev  Where to copy the event to.
+ * \retval 0  Success.
+ * \retval -1 The queue is empty.
+ */
+int
+ioqueue_get(IOQueue *q, IOEvent *ev)
+{
+	unsigned int head = q->head;
+
+	if (head == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE))
+		return -1;
+
+	*ev = q->slots[head & q->mask];
+	__atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
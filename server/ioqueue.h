@@ -0,0 +1,52 @@
+/** \file server/ioqueue.h
+ * Lock-free queue passing events between the I/O thread and the main thread.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef IOQUEUE_H
+#define IOQUEUE_H
+
+/** Kinds of events */
+typedef enum IOEventType {
+	IOEV_CONNECT,		/**< A client connected */
+	IOEV_MESSAGE,		/**< A client sent a message */
+	IOEV_DISCONNECT,	/**< A client closed its connection */
+	IOEV_CLOSE		/**< The server is done with a connection */
+} IOEventType;
+
+/** An event on a client connection */
+typedef struct IOEvent {
+	IOEventType type;	/**< Kind of event */
+	int sock;		/**< Socket of the connection */
+	char *message;		/**< IOEV_MESSAGE: the message; owned by the receiver */
+} IOEvent;
+
+/** Queue with one producer and one consumer thread */
+typedef struct IOQueue {
+	IOEvent *slots;		/**< Ring of events */
+	unsigned int mask;	/**< Number of slots - 1 */
+	unsigned int head;	/**< Next slot to get; only written by the consumer */
+	unsigned int tail;	/**< Next slot to put; only written by the producer */
+} IOQueue;
+
+/* Create a queue with room for at least size events */
+IOQueue *ioqueue_create(unsigned int size);
+
+/* Destroy a queue and the messages still in it */
+void ioqueue_destroy(IOQueue *q);
+
+/* Append an event; producer only */
+int ioqueue_put(IOQueue *q, const IOEvent *ev);
+
+/* Number of events that can be appended; producer only */
+unsigned int ioqueue_space(IOQueue *q);
+
+/* Take the oldest event; consumer only */
+int ioqueue_get(IOQueue *q, IOEvent *ev);
+
+#endif
@@ -64,6 +64,7 @@
 #include "serverscreens.h"
 #include "menuscreens.h"
 #include "input.h"
+#include "receiver.h"
 #include "shared/configfile.h"
 #include "drivers.h"
 #include "main.h"
@@ -241,6 +242,7 @@ main(int argc, char **argv)
 	CHAIN(e, input_init());
 	CHAIN(e, menuscreens_init());
 	CHAIN(e, server_screen_init());
+	CHAIN(e, receiver_init(bind_addr, config_get_int("Server", "ReceivePort", 0, 0)));
 	CHAIN_END(e, "Critical error while initializing, abort.");
 	if (!foreground_mode) {
 		/* Tell to parent that startup went OK. */
@@ -740,6 +742,7 @@ do_reload(void)
 
 	/* And restart the drivers */
 	CHAIN(e, init_drivers());
+	render_invalidate();
 	CHAIN_END(e, "Critical error while reloading, abort.");
 }
 
@@ -779,6 +782,7 @@ do_mainloop(void)
 			sock_poll_clients();		/* poll clients for input*/
 			parse_all_client_messages();	/* analyze input from network clients*/
 			handle_input();		/* handle key input from devices*/
+			receiver_poll();	/* show frames forwarded by another LCDd */
 
 			/* We've done the job... */
 			process_lag = 0 - (1e6/PROCESS_FREQ);
@@ -798,7 +802,10 @@ do_mainloop(void)
 			if (s == server_screen) {
 				update_server_screen();
 			}
-			render_screen(s, timer);
+			if (!receiver_active())
+				render_screen(s, timer);
+			else
+				render_invalidate();
 
 			/* We've done the job... */
 			if (render_lag > frame_interval * MAX_RENDER_LAG_FRAMES) {
@@ -866,6 +873,7 @@ exit_program(int val)
 	screenlist_shutdown();		/* shutdown screens (must come after client_shutdown) */
 	input_shutdown();		/* shutdown key input part */
         sock_shutdown();                /* shutdown the sockets server */
+	receiver_shutdown();		/* stop receiving forwarded frames */
 
 	report(RPT_INFO, "Exiting.");
 	_exit(EXIT_SUCCESS);
@@ -318,6 +318,10 @@ MenuItem *menu_find_item(Menu *menu, char *id, bool recursive)
 	if (strcmp(menu->id, id) == 0)
 		return menu;
 
+	/* A client's menu only contains items of that client: use the index */
+	if (menu->client != NULL)
+		return menuitem_index_find(menu, menu->client, id, recursive);
+
 	for (item = menu_getfirst_item(menu); item != NULL; item = menu_getnext_item(menu)) {
 		if (strcmp(item->id, id) == 0) {
 			return item;
@@ -364,11 +368,80 @@ void menu_reset(Menu *menu)
 }
 
 
+/**
+ * Fill the widgets of one menu row with a subitem: its text (and value)
+ * goes into the string widget, the state of a checkbox into the icon.
+ * \param subitem  Item to show in the row.
+ * \param w        String widget of the row; its text has room for
+ *                 display_props->width characters.
+ * \param icon     Icon widget of the row.
+ */
+static void
+menu_fill_row(MenuItem *subitem, Widget *w, Widget *icon)
+{
+	char buf[LCD_MAX_WIDTH];
+	char *p;
+	int width = display_props->width;
+	int len = width - 1;
+
+	icon->type = WID_NONE;
+
+	switch (subitem->type) {
+	  case MENUITEM_CHECKBOX:
+		/* Limit string length */
+		strncpy(w->text, subitem->text, width - 2);
+		w->text[width-2] = '\0';
+
+		/* Show icon for checkbox */
+		icon->type = WID_ICON;
+		icon->length = ((int[]){ICON_CHECKBOX_OFF,ICON_CHECKBOX_ON,ICON_CHECKBOX_GRAY})[subitem->data.checkbox.value];
+		break;
+	  case MENUITEM_RING:
+		p = LL_GetByIndex(subitem->data.ring.strings, subitem->data.ring.value);
+		fill_labeled_value(w->text, len, subitem->text, p, LV_VALUE_ONLY);
+		break;
+	  case MENUITEM_MENU:
+		/* Limit string length */
+		snprintf(w->text, width + 1, "%s >", subitem->text);
+		if (strlen(subitem->text) >= width-1)
+			w->text[width-1] = '\0';
+		break;
+	  case MENUITEM_ACTION:
+		/* Limit string length */
+		strncpy(w->text, subitem->text, len);
+		w->text[len] = '\0';
+		break;
+	  case MENUITEM_SLIDER:
+		snprintf(buf, width, "%d", subitem->data.slider.value);
+		fill_labeled_value(w->text, len, subitem->text, buf, LV_LABEL_VALU);
+		break;
+	  case MENUITEM_NUMERIC:
+		snprintf(buf, width, "%d", subitem->data.numeric.value);
+		fill_labeled_value(w->text, len, subitem->text, buf, LV_LABEL_VALU);
+		break;
+	  case MENUITEM_ALPHA:
+		fill_labeled_value(w->text, len, subitem->text, subitem->data.alpha.value, LV_LABEL_VALU);
+		break;
+	  case MENUITEM_IP:
+		fill_labeled_value(w->text, len, subitem->text, subitem->data.ip.value, LV_LABEL_ALUE);
+		break;
+	  default:
+		assert(!"unexpected menuitem type");
+	}
+}
+
+
+/*
+ * A menu screen has one string widget ("text<row>") and one icon widget
+ * ("icon<row>") per display line, not per menu entry: only the entries in
+ * view get formatted, however long the menu is. All menus use the same
+ * set of widgets, so menuitem_rebuild_screen() keeps it when switching
+ * from one menu to another and only menu_update_screen() is needed.
+ */
 void menu_build_screen(MenuItem *menu, Screen *s)
 {
 	Widget *w;
-	MenuItem *subitem;
-	int itemnr;
+	int row;
 
 	debug(RPT_DEBUG, "%s(menu=[%s], screen=[%s])", __FUNCTION__,
 			((menu != NULL) ? menu->id : "(null)"),
@@ -386,67 +459,28 @@ void menu_build_screen(MenuItem *menu, Screen *s)
 		screen_add_widget(s, w);
 		w->text = strdup(menu->text);
 		w->x = 1;
-	}	
+	}
 
-	/* Create widgets for each subitem in the menu */
-	for (subitem = LL_GetFirst(menu->data.menu.contents), itemnr = 0;
-	     subitem != NULL;
-	     subitem = LL_GetNext(menu->data.menu.contents), itemnr ++)
-	{
-		char buf[10];
+	/* Create widgets for each line of the display */
+	for (row = 0; row < display_props->height; row++) {
+		char buf[16];
 
-		if (subitem->is_hidden)
-			continue;
-		snprintf(buf, sizeof(buf)-1, "text%d", itemnr);
-		buf[sizeof(buf)-1] = '\0';
-		w = widget_create(buf, WID_STRING, s);
+		snprintf(buf, sizeof(buf), "text%d", row);
+		w = widget_create(buf, WID_NONE, s);
 					/* (buf will be copied) */
 		if (w != NULL) {
 			screen_add_widget(s, w);
 			w->x = 2;
+			w->y = row + 1;
+			w->text = calloc(display_props->width + 1, 1);
+		}
 
-			switch (subitem->type) {
-			  case MENUITEM_CHECKBOX:
-
-				/* Limit string length */
-				w->text = strdup(subitem->text);
-				if (strlen(subitem->text) >= display_props->width-2)
-					w->text[display_props->width-2] = '\0';
-
-				/* Add icon for checkbox */
-				snprintf(buf, sizeof(buf)-1, "icon%d", itemnr);
-				buf[sizeof(buf)-1] = '\0';
-				w = widget_create(buf, WID_ICON, s);
-						/* (buf will be copied) */
-				screen_add_widget(s, w);
-				w->x = display_props->width - 1;
-				w->length = ICON_CHECKBOX_OFF;
-				break;
-			  case MENUITEM_RING:
-				/* Create string for text + ringtext */
-				w->text = malloc(display_props->width);
-				break;
-			  case MENUITEM_MENU:
-				/* Limit string length */
-				w->text = malloc(strlen(subitem->text) + 4);
-				strcpy(w->text, subitem->text);
-				strcat(w->text, " >");
-				if (strlen(subitem->text) >= display_props->width-1)
-					w->text[display_props->width-1] = '\0';
-				break;
-			  case MENUITEM_ACTION:
-			  case MENUITEM_SLIDER:
-			  case MENUITEM_NUMERIC:
-			  case MENUITEM_ALPHA:
-			  case MENUITEM_IP:
-				/* Limit string length */
-				w->text = malloc(display_props->width);
-				strncpy(w->text, subitem->text, display_props->width);
-				w->text[display_props->width-1] = '\0';
-				break;
-			 default:
-				assert(!"unexpected menuitem type");
-			}
+		snprintf(buf, sizeof(buf), "icon%d", row);
+		w = widget_create(buf, WID_NONE, s);
+		if (w != NULL) {
+			screen_add_widget(s, w);
+			w->x = display_props->width - 1;
+			w->y = row + 1;
 		}
 	}
 
@@ -484,7 +518,7 @@ void menu_update_screen(MenuItem *menu, Screen *s)
 	Widget *w;
 	MenuItem *subitem;
 	int itemnr;
-	int hidden_count = 0;
+	int row;
 
 	debug(RPT_DEBUG, "%s(menu=[%s], screen=[%s])", __FUNCTION__,
 			((menu != NULL) ? menu->id : "(null)"),
@@ -493,84 +527,53 @@ void menu_update_screen(MenuItem *menu, Screen *s)
 	if ((menu == NULL) || (s == NULL))
 		return;
 
-	/* Update widgets for the title */
+	/* Update widgets for the title: it is the first line of the menu */
 	w = screen_find_widget(s, "title");
-	if (w == NULL)
+	if (w == NULL) {
 		report(RPT_ERR, "%s: could not find widget: %s", __FUNCTION__, "title");
-	w->y = 1 - menu->data.menu.scroll;
+		return;
+	}
+	w->y = 1;
+	w->type = (menu->data.menu.scroll == 0) ? WID_TITLE : WID_NONE;
+	if ((w->text == NULL) || (strcmp(w->text, menu->text) != 0)) {
+		free(w->text);
+		w->text = strdup(menu->text);
+	}
 
-	/* TODO: remove next 3 limes when rendering is safe */
-	w->type = ((w->y > 0) && (w->y <= display_props->height))
-		  ? WID_TITLE
-		  : WID_NONE;	/* make invisible */
+	/* Fill the display lines with the visible subitems in view:
+	 * subitem #itemnr goes to line 2 + itemnr - scroll */
+	subitem = LL_GetFirst(menu->data.menu.contents);
+	itemnr = 0;
+	for (row = 0; row < display_props->height; row++) {
+		Widget *icon;
+		char buf[16];
+		int index = row - 1 + menu->data.menu.scroll;
 
-	/* Update widgets for each subitem in the menu */
-	for (subitem = LL_GetFirst(menu->data.menu.contents), itemnr = 0;
-	     subitem != NULL;
-	     subitem = LL_GetNext(menu->data.menu.contents), itemnr ++)
-	{
-		char buf[LCD_MAX_WIDTH];	// long enough for "icon%d" and such
-		char *p;
-		int len = display_props->width - 1;
-
-		if (subitem->is_hidden) {
-			debug(RPT_DEBUG, "%s: menu %s has hidden menu: %s",
-			      __FUNCTION__, menu->id, subitem->id);
-			hidden_count++;
-			continue;
-		}
-		snprintf(buf, sizeof(buf)-1, "text%d", itemnr);
-		buf[sizeof(buf)-1] = '\0';
+		snprintf(buf, sizeof(buf), "text%d", row);
 		w = screen_find_widget(s, buf);
-		if (w == NULL)
-			report(RPT_ERR, "%s: could not find widget: %s", __FUNCTION__, buf);
-		w->y = 2 + itemnr - hidden_count - menu->data.menu.scroll;
-
-		/* TODO: remove next 3 lines when rendering is safe */
-		w->type = ((w->y > 0) && (w->y <= display_props->height))
-			  ? WID_STRING
-			  : WID_NONE;	/* make invisible */
+		snprintf(buf, sizeof(buf), "icon%d", row);
+		icon = screen_find_widget(s, buf);
+		if ((w == NULL) || (icon == NULL)) {
+			report(RPT_ERR, "%s: could not find widgets for line %d", __FUNCTION__, row + 1);
+			return;
+		}
 
-		switch (subitem->type) {
-		  case MENUITEM_CHECKBOX:
-			/* Update icon value for checkbox */
-			snprintf(buf, sizeof(buf)-1, "icon%d", itemnr);
-			buf[sizeof(buf)-1] = '\0';
-			w = screen_find_widget(s, buf);
-			if (w == NULL)
-				report(RPT_ERR, "%s: could not find widget: %s", __FUNCTION__, buf);
-			w->y = 2 + itemnr - menu->data.menu.scroll;
-			w->length = ((int[]){ICON_CHECKBOX_OFF,ICON_CHECKBOX_ON,ICON_CHECKBOX_GRAY})[subitem->data.checkbox.value];
-
-			/* TODO: remove next 3 lines when rendering is safe */
-			w->type = ((w->y > 0) && (w->y <= display_props->height))
-				  ? WID_ICON
-				  : WID_NONE;	/* make invisible */
-			break;
-		  case MENUITEM_RING:
-			p = LL_GetByIndex(subitem->data.ring.strings, subitem->data.ring.value);
-			fill_labeled_value(w->text, len, subitem->text, p, LV_VALUE_ONLY);
+		/* advance to the visible subitem #index */
+		while ((subitem != NULL) && ((itemnr < index) || subitem->is_hidden)) {
+			if (!subitem->is_hidden)
+				itemnr++;
+			subitem = LL_GetNext(menu->data.menu.contents);
+		}
 
-			break;
-		    case MENUITEM_SLIDER:
-			snprintf(buf, display_props->width, "%d", subitem->data.slider.value);
-			buf[display_props->width-1] = '\0';
-			fill_labeled_value(w->text, len, subitem->text, buf, LV_LABEL_VALU);
-		    	break;
-		    case MENUITEM_NUMERIC:
-			snprintf(buf, display_props->width, "%d", subitem->data.numeric.value);
-			buf[display_props->width-1] = '\0';
-			fill_labeled_value(w->text, len, subitem->text, buf, LV_LABEL_VALU);
-		    	break;
-		    case MENUITEM_ALPHA:
-			fill_labeled_value(w->text, len, subitem->text, subitem->data.alpha.value, LV_LABEL_VALU);
-		    	break;
-		    case MENUITEM_IP:
-			fill_labeled_value(w->text, len, subitem->text, subitem->data.ip.value, LV_LABEL_ALUE);
-		    	break;
-		  default:
-                      break;
+		if ((index < 0) || (subitem == NULL)) {
+			/* title line or below the last entry */
+			w->type = WID_NONE;
+			icon->type = WID_NONE;
+			continue;
 		}
+
+		w->type = WID_STRING;
+		menu_fill_row(subitem, w, icon);
 	}
 
 	/* Update selector position */
@@ -33,6 +33,9 @@
 
 #define MAX_NUMERIC_LEN 40
 
+/** Initial number of buckets of the item index; must be a power of 2 */
+#define MENUITEM_INDEX_MIN 64
+
 extern Menu *main_menu;		/* Access to the main menu */
 
 bool menu_permissive_goto;	/* Flag from configuration file */
@@ -41,6 +44,15 @@ char *error_strs[] = {"", "Out of range", "Too long", "Too short", "Invalid Addr
 char *menuitemtypenames[] = {"menu", "action", "checkbox", "ring", "slider", "numeric", "alpha", "ip"};
 char *menueventtypenames[] = {"select", "update", "plus", "minus", "enter", "leave"};
 
+/*
+ * Index of all menuitems, hashed by owning client and id. Ids are unique
+ * per client (menu_add_item_func checks this), so finding an item of a
+ * client menu is a bucket lookup plus a walk up the item's parents.
+ */
+static MenuItem **menuitem_index = NULL;
+static unsigned int menuitem_index_size = 0;	/**< number of buckets */
+static unsigned int menuitem_index_count = 0;	/**< number of items */
+
 void menuitem_destroy_action(MenuItem *item);
 void menuitem_destroy_checkbox(MenuItem *item);
 void menuitem_destroy_ring(MenuItem *item);
@@ -135,6 +147,106 @@ MenuItem *menuitem_search(char *menu_id, Client *client)
 	return menu_find_item(top, menu_id, true);
 }
 
+/******** ITEM INDEX ********/
+
+static unsigned int menuitem_index_hash(const void *client, const char *id)
+{
+	unsigned int hash = 2166136261U ^ (unsigned int) ((size_t) client >> 4);
+
+	/* FNV-1a */
+	while (*id != '\0')
+		hash = (hash ^ (unsigned char) *id++) * 16777619U;
+	return hash;
+}
+
+/** Doubles the number of buckets once there are more items than buckets. */
+static void menuitem_index_grow(void)
+{
+	unsigned int size = (menuitem_index_size > 0) ? 2 * menuitem_index_size : MENUITEM_INDEX_MIN;
+	MenuItem **index = calloc(size, sizeof(MenuItem *));
+	unsigned int i;
+
+	if (index == NULL)
+		return;		/* keep using the smaller index */
+
+	for (i = 0; i < menuitem_index_size; i++) {
+		MenuItem *item = menuitem_index[i];
+
+		while (item != NULL) {
+			MenuItem *next = item->index_next;
+			unsigned int bucket = menuitem_index_hash(item->client, item->id) & (size - 1);
+
+			item->index_next = index[bucket];
+			index[bucket] = item;
+			item = next;
+		}
+	}
+	free(menuitem_index);
+	menuitem_index = index;
+	menuitem_index_size = size;
+}
+
+static void menuitem_index_add(MenuItem *item)
+{
+	unsigned int bucket;
+
+	if (menuitem_index_count >= menuitem_index_size)
+		menuitem_index_grow();
+	if (menuitem_index == NULL) {
+		item->index_next = NULL;
+		return;
+	}
+
+	bucket = menuitem_index_hash(item->client, item->id) & (menuitem_index_size - 1);
+	item->index_next = menuitem_index[bucket];
+	menuitem_index[bucket] = item;
+	menuitem_index_count++;
+}
+
+static void menuitem_index_remove(MenuItem *item)
+{
+	MenuItem **link;
+
+	if (menuitem_index == NULL)
+		return;
+
+	link = &menuitem_index[menuitem_index_hash(item->client, item->id) & (menuitem_index_size - 1)];
+	for (; *link != NULL; link = &(*link)->index_next) {
+		if (*link == item) {
+			*link = item->index_next;
+			menuitem_index_count--;
+			return;
+		}
+	}
+}
+
+MenuItem *menuitem_index_find(MenuItem *menu, Client *client, const char *id, bool recursive)
+{
+	MenuItem *item;
+
+	if ((menuitem_index == NULL) || (menu == NULL) || (id == NULL))
+		return NULL;
+
+	item = menuitem_index[menuitem_index_hash(client, id) & (menuitem_index_size - 1)];
+	for (; item != NULL; item = item->index_next) {
+		MenuItem *ancestor;
+
+		if ((item->client != client) || (strcmp(item->id, id) != 0))
+			continue;
+		if (item == menu)
+			return item;
+
+		/* Is it in the searched part of the menu tree ? */
+		for (ancestor = item->parent; ancestor != NULL; ancestor = ancestor->parent) {
+			if (ancestor == menu)
+				return item;
+			if (!recursive)
+				break;
+		}
+	}
+	return NULL;
+}
+
 /******** FUNCTION TABLES ********/
 /*-
  * Tables with functions to call for all different item types. The order is:
@@ -243,6 +355,8 @@ MenuItem *menuitem_create(MenuItemType type, char *id, MenuEventFunc(*event_func
 	/* Clear the type specific data part */
 	memset(&(new_item->data), '\0', sizeof(new_item->data));
 
+	menuitem_index_add(new_item);
+
 	return new_item;
 }
 
@@ -475,6 +589,8 @@ void menuitem_destroy(MenuItem *item)
 		if (destructor)
 			destructor(item);
 
+		menuitem_index_remove(item);
+
 		/* Following strings should always be allocated */
 		free(item->text);
 		free(item->id);
@@ -648,8 +764,16 @@ void menuitem_rebuild_screen(MenuItem *item, Screen *s)
 	}
 
 	if (s != NULL) {
+		/* All menus share the same widgets (see menu_build_screen):
+		 * switching between menus only needs an update */
+		if ((item != NULL) && (item->type == MENUITEM_MENU)
+		    && (screen_find_widget(s, "selector") != NULL)) {
+			menuitem_update_screen(item, s);
+			return;
+		}
+
 		/* First remove all widgets from the screen */
-		while ((w = screen_getfirst_widget(s)) != NULL) {
+		while ((w = screen_get_widget(s, 0)) != NULL) {
 			/* We know these widgets don't have subwidgets, so we can
 			 * easily remove them
 			 */
@@ -854,6 +978,8 @@ void menuitem_update_screen(MenuItem *item, Screen *s)
 	update_screen = update_screen_table [item->type];
 	if (update_screen) {
 		update_screen(item, s);
+		/* The widgets were written directly; mark the screen changed */
+		s->generation++;
 	} else {
 		report(RPT_ERR, "%s: given menuitem cannot be active", __FUNCTION__);
 		return;
@@ -131,6 +131,7 @@ typedef struct MenuItem {
 	char *text;	/**< Visible name of the item */
 	void* client;	/**< The owner of this menuitem. */
 	bool is_hidden; /**< If the item currently should not appear in a menu. */
+	struct MenuItem *index_next; /**< Next item in the same bucket of the id index */
 	union data {
 		struct menu {
 			int selector_pos;	/**< At what menuitem is the
@@ -209,6 +210,11 @@ MenuResult menuitem_successor2menuresult(char *successor_id, MenuResult default_
 
 MenuItem *menuitem_search(char *menu_id, Client *client);
 
+/** Looks up an item of the given client by id in the item index and
+ * returns it if it is \c menu itself, or (with \c recursive) lies
+ * anywhere below it or (without) is a direct child of it. */
+MenuItem *menuitem_index_find(MenuItem *menu, Client *client, const char *id, bool recursive);
+
 /** YOU SHOULD NOT CALL THIS FUNCTION BUT THE TYPE SPECIFIC ONE INSTEAD */
 MenuItem *menuitem_create(MenuItemType type, char *id,
 		MenuEventFunc(*event_func), char *text, Client *client);
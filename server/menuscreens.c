@@ -227,9 +227,13 @@ menuscreen_inform_item_modified(MenuItem * item)
 		return;
 
 	/* Are we currently in the item or the parent of the item ? */
-	if (active_menuitem == item || active_menuitem == item->parent) {
+	if (active_menuitem == item) {
 		menuitem_rebuild_screen(active_menuitem, menuscreen);
 	}
+	else if (active_menuitem == item->parent) {
+		/* only the item's line in the menu changed */
+		menuitem_update_screen(active_menuitem, menuscreen);
+	}
 }
 
 bool
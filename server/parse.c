@@ -18,17 +18,25 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "shared/LL.h"
 #include "shared/sockets.h"
 #include "shared/report.h"
+#include "shared/binproto.h"
 #include "clients.h"
 #include "commands/command_list.h"
 #include "parse.h"
 #include "sock.h"
+#include "binproto.h"
 
 #define MAX_ARGUMENTS 40
 
+/** Bytes of messages a client may have parsed per round */
+#define PARSE_QUANTUM		256
+/** Bytes of messages parsed per process stroke over all clients */
+#define PARSE_STROKE_BUDGET	16384
+
 
 static inline int is_whitespace(char x)	{
 	return ((x == ' ') || (x == '\t') || (x == '\r'));
@@ -196,27 +204,74 @@ static void parse_message(const char *str, Client *c)
 }
 
 
+/*
+ * Deficit round robin: in each round every client with queued messages
+ * earns PARSE_QUANTUM bytes of credit and has its messages parsed as long
+ * as they fit in the credit. Rounds are repeated until the queues are
+ * empty or PARSE_STROKE_BUDGET bytes were parsed; the rest waits for the
+ * next process stroke. A client flooding the server so delays the others
+ * by at most one round, no matter how much it has queued.
+ */
 void
 parse_all_client_messages(void)
 {
 	Client *c;
+	struct timeval now;
+	int budget = PARSE_STROKE_BUDGET;
+	int busy;
+	int i;
 
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	for (c = clients_getfirst(); c != NULL; c = clients_getnext()) {
-		char *str;
+	gettimeofday(&now, NULL);
 
-		/* And parse all its messages...*/
-		for (str = client_get_message(c); str != NULL; str = client_get_message(c)) {
-			parse_message(str, c);
-			free(str);
+	do {
+		busy = 0;
 
-			if (c->state == GONE) {
-				sock_destroy_client_socket(c);
-				break;
+		for (i = 0; (c = clients_get(i)) != NULL; i++) {
+			int gone = 0;
+			int throttled = 0;
+			int size;
+
+			if (c->queued == 0) {
+				/* Credit is not saved up while idle */
+				c->deficit = 0;
+				continue;
 			}
-		}
-	}
-}
 
+			c->deficit += PARSE_QUANTUM;
+			while (((size = client_next_message_size(c)) > 0) && (size <= c->deficit)) {
+				char *str;
 
+				/* Messages of a throttled client wait in its queue */
+				if (!client_take_token(c, &now)) {
+					c->deficit = 0;
+					throttled = 1;
+					break;
+				}
+
+				str = client_get_message(c);
+				sock_message_done(c, size);
+				c->deficit -= size;
+				budget -= size;
+				if (binproto_is_frame(str))
+					binproto_parse_frame(str, c);
+				else
+					parse_message(str, c);
+				free(str);
+
+				if (c->state == GONE) {
+					/* The next client moves up to this index */
+					sock_destroy_client_socket(c);
+					gone = 1;
+					i--;
+					break;
+				}
+			}
+
+			/* Another round if there is something left it may parse */
+			if (!gone && !throttled && (c->queued > 0))
+				busy = 1;
+		}
+	} while (busy && (budget > 0));
+}
@@ -0,0 +1,229 @@
+/** \file server/pool.c
+ * Per-client memory pool for screens, widgets and their strings.
+ *
+ * Small allocations are rounded up to a power of two between 16 and
+ * 2048 bytes and carved from blocks of POOL_BLOCK_SIZE bytes. Freed
+ * memory goes to a free list per size class, so the frequent widget
+ * updates of a client reuse the same memory instead of going through
+ * malloc() and free() each time. Larger allocations use malloc() but are
+ * tracked too. When the client disconnects, pool_destroy() returns all
+ * blocks at once.
+ *
+ * All functions accept a NULL pool and then fall back to the C library,
+ * so code handling screens of both clients and the server (which have no
+ * pool) can use one set of calls.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+#define POOL_MIN_SHIFT	4	/**< smallest size class: 16 bytes */
+#define POOL_CLASSES	8	/**< size classes 16 ... 2048 bytes */
+#define POOL_LARGE	POOL_CLASSES	/**< class of malloc()ed allocations */
+
+/** Header in front of every allocation; keeps the user part aligned */
+typedef union PoolHeader {
+	unsigned int cls;	/**< size class, or POOL_LARGE */
+	void *align_p;
+	double align_d;
+	long long align_ll;
+} PoolHeader;
+
+/** Allocation too large for the size classes */
+typedef struct PoolLarge {
+	struct PoolLarge *prev, *next;
+	size_t size;
+	PoolHeader hdr;		/**< must be last: directly precedes the data */
+} PoolLarge;
+
+/** A block small allocations are carved from */
+typedef struct PoolBlock {
+	struct PoolBlock *next;
+	PoolHeader align;
+} PoolBlock;
+
+/** Free list entry, stored in the freed memory itself */
+typedef struct PoolFree {
+	struct PoolFree *next;
+} PoolFree;
+
+struct Pool {
+	PoolBlock *blocks;		/**< all blocks of this pool */
+	char *cur;			/**< unused part of the newest block */
+	size_t left;			/**< bytes left at \c cur */
+	PoolFree *free[POOL_CLASSES];	/**< freed allocations per class */
+	PoolLarge *large;		/**< list of large allocations */
+};
+
+
+/** Size class for a request, or POOL_LARGE */
+static unsigned int
+pool_class(size_t size)
+{
+	unsigned int cls = 0;
+
+	while ((cls < POOL_CLASSES) && (size > ((size_t) 1 << (cls + POOL_MIN_SHIFT))))
+		cls++;
+	return cls;
+}
+
+
+Pool *
+pool_create(void)
+{
+	return calloc(1, sizeof(Pool));
+}
+
+
+void
+pool_destroy(Pool *pool)
+{
+	if (pool == NULL)
+		return;
+
+	while (pool->blocks != NULL) {
+		PoolBlock *b = pool->blocks;
+
+		pool->blocks = b->next;
+		free(b);
+	}
+	while (pool->large != NULL) {
+		PoolLarge *l = pool->large;
+
+		pool->large = l->next;
+		free(l);
+	}
+	free(pool);
+}
+
+
+void *
+pool_alloc(Pool *pool, size_t size)
+{
+	unsigned int cls;
+	size_t chunk;
+	PoolHeader *hdr;
+
+	if (pool == NULL)
+		return malloc(size);
+
+	cls = pool_class(size);
+	if (cls == POOL_LARGE) {
+		PoolLarge *l = malloc(sizeof(PoolLarge) + size);
+
+		if (l == NULL)
+			return NULL;
+		l->size = size;
+		l->hdr.cls = POOL_LARGE;
+		l->prev = NULL;
+		l->next = pool->large;
+		if (pool->large != NULL)
+			pool->large->prev = l;
+		pool->large = l;
+		return &l->hdr + 1;
+	}
+
+	/* Reuse freed memory of the same class */
+	if (pool->free[cls] != NULL) {
+		PoolFree *f = pool->free[cls];
+
+		pool->free[cls] = f->next;
+		return f;
+	}
+
+	chunk = sizeof(PoolHeader) + ((size_t) 1 << (cls + POOL_MIN_SHIFT));
+	if (pool->left < chunk) {
+		/* Start a new block; the rest of the old one is lost */
+		PoolBlock *b = malloc(sizeof(PoolBlock) + POOL_BLOCK_SIZE);
+
+		if (b == NULL)
+			return NULL;
+		b->next = pool->blocks;
+		pool->blocks = b;
+		pool->cur = (char *) (b + 1);
+		pool->left = POOL_BLOCK_SIZE;
+	}
+
+	hdr = (PoolHeader *) pool->cur;
+	hdr->cls = cls;
+	pool->cur += chunk;
+	pool->left -= chunk;
+	return hdr + 1;
+}
+
+
+void *
+pool_calloc(Pool *pool, size_t size)
+{
+	void *ptr = pool_alloc(pool, size);
+
+	if (ptr != NULL)
+		memset(ptr, 0, size);
+	return ptr;
+}
+
+
+char *
+pool_strdup(Pool *pool, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *copy = pool_alloc(pool, len);
+
+	if (copy != NULL)
+		memcpy(copy, str, len);
+	return copy;
+}
+
+
+void
+pool_free(Pool *pool, void *ptr)
+{
+	PoolHeader *hdr;
+
+	if ((pool == NULL) || (ptr == NULL)) {
+		free(ptr);
+		return;
+	}
+
+	hdr = (PoolHeader *) ptr - 1;
+	if (hdr->cls == POOL_LARGE) {
+		PoolLarge *l = (PoolLarge *) ((char *) hdr - offsetof(PoolLarge, hdr));
+
+		if (l->prev != NULL)
+			l->prev->next = l->next;
+		else
+			pool->large = l->next;
+		if (l->next != NULL)
+			l->next->prev = l->prev;
+		free(l);
+	}
+	else {
+		PoolFree *f = ptr;
+
+		f->next = pool->free[hdr->cls];
+		pool->free[hdr->cls] = f;
+	}
+}
+
+
+size_t
+pool_capacity(Pool *pool, const void *ptr)
+{
+	const PoolHeader *hdr;
+
+	if ((pool == NULL) || (ptr == NULL))
+		return 0;
+
+	hdr = (const PoolHeader *) ptr - 1;
+	if (hdr->cls == POOL_LARGE)
+		return ((const PoolLarge *) ((const char *) hdr - offsetof(PoolLarge, hdr)))->size;
+	return (size_t) 1 << (hdr->cls + POOL_MIN_SHIFT);
+}
@@ -0,0 +1,42 @@
+/** \file server/pool.h
+ * Per-client memory pool for screens, widgets and their strings.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/** Size of the blocks small allocations are carved from */
+#define POOL_BLOCK_SIZE		16384
+
+typedef struct Pool Pool;
+
+/* Create an empty pool */
+Pool *pool_create(void);
+
+/* Release everything allocated from the pool at once */
+void pool_destroy(Pool *pool);
+
+/* Allocate from the pool; a NULL pool uses malloc() */
+void *pool_alloc(Pool *pool, size_t size);
+
+/* Allocate zero-filled memory from the pool */
+void *pool_calloc(Pool *pool, size_t size);
+
+/* Duplicate a string into the pool */
+char *pool_strdup(Pool *pool, const char *str);
+
+/* Return memory to the pool it was allocated from */
+void pool_free(Pool *pool, void *ptr);
+
+/* Usable size of an allocation; 0 if not known (NULL pool) */
+size_t pool_capacity(Pool *pool, const void *ptr);
+
+#endif
@@ -0,0 +1,381 @@
+/** \file server/receiver.c
+ * Receiving frames forwarded by the \c forward driver of another LCDd.
+ *
+ * With a ReceivePort configured LCDd accepts one sender on that port.
+ * While a sender is connected the frames it sends are shown on the local
+ * displays instead of the local screens; clients, menus and keys keep
+ * working in the background and take over again when the sender leaves.
+ * The format of the stream is described in shared/fwdproto.h.
+ *
+ * Anyone who can connect to the port takes over the displays, so senders
+ * can be restricted to the ReceiveFrom addresses. Other senders are
+ * rejected while one is connected; a sender that does not introduce
+ * itself in time, or whose host stops answering, is dropped.
+ *
+ * The custom characters a sender defines overwrite those of the local
+ * screens. Drivers reset their custom character mode in clear(), which
+ * the renderer calls every frame, so bars and big numbers define their
+ * characters again once the sender has left.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "shared/report.h"
+#include "shared/configfile.h"
+#include "shared/binproto.h"
+#include "shared/fwdproto.h"
+
+#include "drivers.h"
+#include "receiver.h"
+
+/** Most reads from the sender per poll, so a flood cannot stall LCDd */
+#define RECEIVER_MAX_READS	16
+/** Most ReceiveFrom addresses */
+#define RECEIVER_MAX_ALLOWED	16
+/** Seconds a new sender has to introduce itself */
+#define RECEIVER_HELLO_TIMEOUT	5
+/** Seconds of silence before the sender's host is probed, and between probes */
+#define RECEIVER_KEEPALIVE	10
+/** Unanswered probes after which the sender is dropped */
+#define RECEIVER_KEEPALIVE_PROBES	3
+
+static int listen_fd = -1;	/**< Listening socket; -1 if disabled */
+static int sender_fd = -1;	/**< Connection to the sender; -1 if none */
+static int have_hello = 0;	/**< Whether the sender has introduced itself */
+static time_t hello_deadline;	/**< When a sender without hello is dropped */
+static char sender_name[INET_ADDRSTRLEN + 6];	/**< Address and port of the sender */
+
+static struct in_addr allowed[RECEIVER_MAX_ALLOWED];	/**< ReceiveFrom addresses */
+static int num_allowed = 0;	/**< Number of ReceiveFrom addresses; 0 allows all */
+
+static unsigned char inbuf[FWD_HEADER_SIZE + FWD_MAX_PAYLOAD];	/**< Partial message */
+static int inlen = 0;		/**< Bytes in \c inbuf */
+
+static int width, height;	/**< Size of the sender's display */
+static unsigned char *frame = NULL;	/**< The sender's display contents */
+static unsigned char chars[FWD_NUM_CHARS][FWD_CELLHEIGHT];	/**< Custom characters */
+static int chars_dirty = 0;	/**< Bit mask of custom characters not yet defined locally */
+static int backlight = -1;	/**< Backlight state; -1 if not sent */
+static int output = 0;		/**< Output state */
+static int output_set = 0;	/**< Whether the output state was sent */
+
+
+/**
+ * Start listening for a sender.
+ * \param addr  Address to bind to.
+ * \param port  Port to listen on; 0 disables the receiver.
+ * \retval 0    Success.
+ * \retval -1   Error.
+ */
+int
+receiver_init(const char *addr, int port)
+{
+	struct sockaddr_in name;
+	const char *s;
+	int sockopt = 1;
+
+	if (port <= 0)
+		return 0;
+
+	while ((num_allowed < RECEIVER_MAX_ALLOWED)
+	       && ((s = config_get_string("Server", "ReceiveFrom", num_allowed, NULL)) != NULL)) {
+		if (inet_aton(s, &allowed[num_allowed]) == 0) {
+			report(RPT_ERR, "%s: invalid ReceiveFrom address %s", __FUNCTION__, s);
+			return -1;
+		}
+		num_allowed++;
+	}
+
+	listen_fd = socket(PF_INET, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		report(RPT_ERR, "%s: cannot create socket - %s", __FUNCTION__, strerror(errno));
+		return -1;
+	}
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, (void *) &sockopt, sizeof(sockopt));
+
+	memset(&name, 0, sizeof(name));
+	name.sin_family = AF_INET;
+	name.sin_port = htons(port);
+	inet_aton(addr, &name.sin_addr);
+
+	if ((bind(listen_fd, (struct sockaddr *) &name, sizeof(name)) < 0)
+	    || (listen(listen_fd, 1) < 0)) {
+		report(RPT_ERR, "%s: cannot listen on port %d at address %s - %s",
+		       __FUNCTION__, port, addr, strerror(errno));
+		close(listen_fd);
+		listen_fd = -1;
+		return -1;
+	}
+	fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL, 0) | O_NONBLOCK);
+
+	report(RPT_NOTICE, "Listening for forwarded frames on %s:%d", addr, port);
+	if (num_allowed == 0)
+		report(RPT_WARNING, "%s: accepting forwarded frames from any host, set ReceiveFrom to restrict",
+		       __FUNCTION__);
+	return 0;
+}
+
+
+/** Close the connection to the sender. */
+static void
+receiver_drop(const char *why)
+{
+	if (sender_fd < 0)
+		return;
+
+	report(RPT_NOTICE, "%s: sender %s left: %s", __FUNCTION__, sender_name, why);
+	close(sender_fd);
+	sender_fd = -1;
+	have_hello = 0;
+	inlen = 0;
+}
+
+
+/**
+ * Close the listening socket and the connection to the sender.
+ */
+void
+receiver_shutdown(void)
+{
+	receiver_drop("shutdown");
+	if (listen_fd >= 0)
+		close(listen_fd);
+	listen_fd = -1;
+	free(frame);
+	frame = NULL;
+}
+
+
+/** Show the sender's display contents on the local displays. */
+static void
+receiver_show(void)
+{
+	int cellheight = display_props->cellheight;
+	unsigned char *rows;
+	int x, y, n;
+
+	/* Drivers read as many rows as their cells are high */
+	rows = calloc((cellheight > FWD_CELLHEIGHT) ? cellheight : FWD_CELLHEIGHT, 1);
+	if (rows != NULL) {
+		for (n = 0; n < FWD_NUM_CHARS; n++) {
+			if (chars_dirty & (1 << n)) {
+				memcpy(rows, chars[n], FWD_CELLHEIGHT);
+				drivers_set_char(n, rows);
+			}
+		}
+		chars_dirty = 0;
+		free(rows);
+	}
+
+	drivers_clear();
+	for (y = 0; (y < height) && (y < display_props->height); y++) {
+		for (x = 0; (x < width) && (x < display_props->width); x++)
+			drivers_chr(x + 1, y + 1, frame[y * width + x]);
+	}
+	if (backlight >= 0)
+		drivers_backlight(backlight);
+	if (output_set)
+		drivers_output(output);
+	drivers_flush();
+}
+
+
+/**
+ * Handle one message of the sender.
+ * \retval 0    Success.
+ * \retval -1   Invalid message.
+ */
+static int
+receiver_message(int type, const unsigned char *data, int size)
+{
+	int offset;
+
+	if ((type != FWD_MSG_HELLO) && !have_hello)
+		return -1;
+
+	switch (type) {
+		case FWD_MSG_HELLO:
+			if ((size < 5) || (data[0] != FWD_PROTOCOL_VERSION)
+			    || (data[1] == 0) || (data[2] == 0))
+				return -1;
+			free(frame);
+			width = data[1];
+			height = data[2];
+			frame = malloc(width * height);
+			if (frame == NULL)
+				return -1;
+			memset(frame, ' ', width * height);
+			chars_dirty = 0;
+			backlight = -1;
+			output_set = 0;
+			have_hello = 1;
+			report(RPT_INFO, "%s: sender display is %dx%d", __FUNCTION__, width, height);
+			break;
+		case FWD_MSG_TEXT:
+			if (size < 2)
+				return -1;
+			offset = binproto_get_u16(data);
+			if (offset + size - 2 > width * height)
+				return -1;
+			memcpy(frame + offset, data + 2, size - 2);
+			break;
+		case FWD_MSG_CHAR:
+			if ((size < 1 + FWD_CELLHEIGHT) || (data[0] >= FWD_NUM_CHARS))
+				return -1;
+			memcpy(chars[data[0]], data + 1, FWD_CELLHEIGHT);
+			chars_dirty |= 1 << data[0];
+			break;
+		case FWD_MSG_BACKLIGHT:
+			if (size < 1)
+				return -1;
+			backlight = (data[0]) ? BACKLIGHT_ON : BACKLIGHT_OFF;
+			break;
+		case FWD_MSG_OUTPUT:
+			if (size < 4)
+				return -1;
+			output = binproto_get_s32(data);
+			output_set = 1;
+			break;
+		case FWD_MSG_FRAME:
+			receiver_show();
+			break;
+		default:
+			/* Ignore what later versions may add */
+			break;
+	}
+	return 0;
+}
+
+
+/**
+ * Accept a new connection if it comes from an allowed sender and no other
+ * sender is connected; close it otherwise.
+ */
+static void
+receiver_accept(void)
+{
+	struct sockaddr_in name;
+	socklen_t len = sizeof(name);
+	char addr[INET_ADDRSTRLEN], buf[sizeof(sender_name)];
+	int fd, i, sockopt = 1;
+
+	fd = accept(listen_fd, (struct sockaddr *) &name, &len);
+	if (fd < 0)
+		return;
+	inet_ntop(AF_INET, &name.sin_addr, addr, sizeof(addr));
+	snprintf(buf, sizeof(buf), "%s:%d", addr, ntohs(name.sin_port));
+
+	for (i = 0; i < num_allowed; i++) {
+		if (allowed[i].s_addr == name.sin_addr.s_addr)
+			break;
+	}
+	if ((num_allowed > 0) && (i == num_allowed)) {
+		report(RPT_WARNING, "%s: rejected sender %s: not in ReceiveFrom", __FUNCTION__, buf);
+		close(fd);
+		return;
+	}
+	if (sender_fd >= 0) {
+		report(RPT_NOTICE, "%s: rejected sender %s: receiving from %s",
+		       __FUNCTION__, buf, sender_name);
+		close(fd);
+		return;
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+	/* Notice a sender whose host went away without closing the connection */
+	setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, (void *) &sockopt, sizeof(sockopt));
+#ifdef TCP_KEEPIDLE
+	sockopt = RECEIVER_KEEPALIVE;
+	setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, (void *) &sockopt, sizeof(sockopt));
+	setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, (void *) &sockopt, sizeof(sockopt));
+	sockopt = RECEIVER_KEEPALIVE_PROBES;
+	setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, (void *) &sockopt, sizeof(sockopt));
+#endif
+	sender_fd = fd;
+	hello_deadline = time(NULL) + RECEIVER_HELLO_TIMEOUT;
+	strcpy(sender_name, buf);
+	report(RPT_NOTICE, "%s: sender %s connected", __FUNCTION__, sender_name);
+}
+
+
+/**
+ * Accept a sender, read its messages and show the frames completed by
+ * them. Reads are non-blocking and at most RECEIVER_MAX_READS per call.
+ * Called from the main loop.
+ */
+void
+receiver_poll(void)
+{
+	int i;
+
+	if (listen_fd < 0)
+		return;
+
+	receiver_accept();
+	if (sender_fd < 0)
+		return;
+	if (!have_hello && (time(NULL) >= hello_deadline)) {
+		receiver_drop("no hello");
+		return;
+	}
+
+	for (i = 0; i < RECEIVER_MAX_READS; i++) {
+		int len, pos;
+
+		len = read(sender_fd, inbuf + inlen, sizeof(inbuf) - inlen);
+		if ((len < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+			return;
+		if (len <= 0) {
+			receiver_drop((len == 0) ? "connection closed" : strerror(errno));
+			return;
+		}
+		inlen += len;
+
+		for (pos = 0; inlen - pos >= FWD_HEADER_SIZE; ) {
+			int size = binproto_get_u16(inbuf + pos + 1);
+
+			if (size > FWD_MAX_PAYLOAD) {
+				receiver_drop("message too long");
+				return;
+			}
+			if (inlen - pos < FWD_HEADER_SIZE + size)
+				break;
+			if (receiver_message(inbuf[pos], inbuf + pos + FWD_HEADER_SIZE, size) < 0) {
+				receiver_drop("invalid message");
+				return;
+			}
+			pos += FWD_HEADER_SIZE + size;
+		}
+		memmove(inbuf, inbuf + pos, inlen - pos);
+		inlen -= pos;
+	}
+}
+
+
+/**
+ * Check whether a sender is connected. Local screens are not rendered
+ * meanwhile.
+ * \return  1 if frames of a sender are shown; 0 otherwise.
+ */
+int
+receiver_active(void)
+{
+	return (sender_fd >= 0) && have_hello;
+}
@@ -0,0 +1,26 @@
+/** \file server/receiver.h
+ * Receiving frames forwarded by the \c forward driver of another LCDd.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef RECEIVER_H
+#define RECEIVER_H
+
+/* Start listening for a sender; port 0 disables the receiver */
+int receiver_init(const char *addr, int port);
+
+/* Close the listening socket and the connection to the sender */
+void receiver_shutdown(void);
+
+/* Accept a sender, read its messages and show complete frames */
+void receiver_poll(void);
+
+/* Whether a sender is connected; local rendering pauses meanwhile */
+int receiver_active(void);
+
+#endif
@@ -1,8 +1,14 @@
 /** \file server/render.c
  * This file contains code that actually generates the full screen data to
  * send to the LCD. render_screen() takes a screen definition and calls
- * render_frame() which in turn builds the screen according to the definition.
- * It may recursively call itself (for nested frames).
+ * render_widgets() which in turn builds the screen according to the definition.
+ *
+ * Frames are drawn into an offscreen buffer of cells (see cellbuf.c) as
+ * large as their contents, by the same functions that draw a screen on the
+ * displays. The part of it visible through the frame is then shown on the
+ * displays, or copied into the buffer of the enclosing frame. The buffer
+ * is kept until a widget in the frame changes or a part of it moves, so
+ * a frame that scrolls a long list only copies cells as it moves.
  *
  * This needs to be greatly expanded and redone for greater flexibility.
  * For example, it should support multiple screen sizes, more flexible
@@ -16,6 +22,14 @@
  * screens?  Horrors of horrors... next thing you know it'll be making coffee...
  * Better believe it'll take a while to do...
  *
+ * A frame is not rendered again when it would look like the one before:
+ * the same client screen with no widget changed, the same backlight,
+ * heartbeat and output state, and no scroller, title, frame, cursor or
+ * message that moved since. The timing of scrollers and frames is kept by
+ * scroll.c, which knows the tick each of them moves next. Screens
+ * of the server are changed in place and are rendered every time, and
+ * every RENDER_MAX_SKIP ticks a frame is rendered anyway.
+ *
  * \todo Review render_string for correctness.
  */
 
@@ -36,6 +50,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #include "shared/report.h"
 #include "shared/LL.h"
@@ -46,8 +61,12 @@
 #include "screenlist.h"
 #include "widget.h"
 #include "render.h"
+#include "shmscreen.h"
+#include "scroll.h"
+#include "cellbuf.h"
 
 #define BUFSIZE 1024	/* larger than display width => large enough */
+#define RENDER_MAX_SKIP 8	/* most frames skipped in a row */
 
 int heartbeat = HEARTBEAT_OPEN;
 static int heartbeat_fallback = HEARTBEAT_ON; /* If no heartbeat setting has been set at all */
@@ -61,20 +80,43 @@ int output_state = 0;
 char *server_msg_text;
 int server_msg_expire = 0;
 
-
-static void render_frame(LinkedList *list, int left, int top, int right, int bottom, int fwid, int fhgt, char fscroll, int fspeed, long timer);
-static void render_string(Widget *w, int left, int top, int right, int bottom, int fy);
-static void render_hbar(Widget *w, int left, int top, int right, int bottom, int fy);
+/** What the last rendered frame showed, to tell whether the next one differs */
+static struct {
+	Screen *screen;			/**< screen rendered; NULL forces rendering */
+	unsigned int generation;	/**< generation of the screen */
+	int width, height, duration;	/**< geometry of the screen */
+	int backlight;			/**< backlight state sent */
+	int heartbeat;			/**< heartbeat state, or icon if it beats */
+	int output;			/**< output state sent */
+	long next;			/**< tick a part of it moves next */
+	long rendered;			/**< tick it was rendered at */
+} last_frame;
+
+/** Earliest tick a part of what is being rendered moves */
+static long render_next = LONG_MAX;
+
+/** Buffer widgets are drawn into; NULL to draw on the displays */
+static CellBuf *target = NULL;
+
+
+static void render_animate(Vector *list, long timer);
+static void render_widgets(Screen *s, int width, int height, long timer);
+static int render_offscreen(Screen *s, int width, int height, long timer);
+static void render_frame(Widget *w, long timer);
+static void render_string(Widget *w, int left, int top, int right, int bottom);
+static void render_hbar(Widget *w, int left, int top, int right, int bottom);
 static void render_vbar(Widget *w, int left, int top, int right, int bottom);
 static void render_pbar(Widget *w, int left, int top, int right, int bottom);
 static void render_title(Widget *w, int left, int top, int right, int bottom, long timer);
 static void render_scroller(Widget *w, int left, int top, int right, int bottom, long timer);
 static void render_num(Widget *w, int left, int top, int right, int bottom);
+static void render_graph(Widget *w, int left, int top, int right, int bottom);
 
 
 /**
  * Renders a screen. The following actions are taken in order:
  *
+ * \li  Update the widgets and skip the frame if it would look like the last one.
  * \li  Clear the screen.
  * \li  Set the backlight.
  * \li  Set out-of-band data (output).
@@ -92,18 +134,24 @@ int
 render_screen(Screen *s, long timer)
 {
 	int tmp_state = 0;
+	int backlight_state, heartbeat_state;
+	long next = LONG_MAX;
 
 	debug(RPT_DEBUG, "%s(screen=[%.40s], timer=%ld)  ==== START RENDERING ====", __FUNCTION__, s->id, timer);
 
 	if (s == NULL)
 		return -1;
 
-	/* 1. Clear the LCD screen... */
-	drivers_clear();
+	/*
+	 * 0. Bring the widgets up to date and skip the frame if it would
+	 * look like the last one.
+	 */
+	shmscreen_update(s);
+	render_animate(&s->widgets, timer);
+	scroll_sched_update(s, timer);
 
-	/* 2. Set up the backlight */
 	/*-
-	 * 2.1:
+	 * 0.1:
 	 * First we find out who has set the backlight:
 	 *   a) the screen,
 	 *   b) the client, or
@@ -125,57 +173,117 @@ render_screen(Screen *s, long timer)
 	}
 
 	/*-
-	 * 2.2:
 	 * If one of the backlight options (FLASH or BLINK) has been set turn
 	 * it on/off based on a timed algorithm.
 	 */
 	/* NOTE: dirty stripping of other options... */
 	/* Backlight flash: check timer and flip backlight as appropriate */
 	if (tmp_state & BACKLIGHT_FLASH) {
-		drivers_backlight(
-			(
+		backlight_state = (
 				(tmp_state & BACKLIGHT_ON)
 				^ ((timer & 7) == 7)
-			) ? BACKLIGHT_ON : BACKLIGHT_OFF);
+			) ? BACKLIGHT_ON : BACKLIGHT_OFF;
+		next = timer + 1;
 	}
 	/* Backlight blink: check timer and flip backlight as appropriate */
 	else if (tmp_state & BACKLIGHT_BLINK) {
-		drivers_backlight(
-			(
+		backlight_state = (
 				(tmp_state & BACKLIGHT_ON)
 				^ ((timer & 14) == 14)
-			) ? BACKLIGHT_ON : BACKLIGHT_OFF);
+			) ? BACKLIGHT_ON : BACKLIGHT_OFF;
+		next = timer + 1;
 	}
 	else {
 		/* Simple: Only send lowest bit then... */
-		drivers_backlight(tmp_state & BACKLIGHT_ON);
+		backlight_state = tmp_state & BACKLIGHT_ON;
 	}
 
-	/* 3. Output ports from LCD - outputs depend on the current screen */
-	drivers_output(output_state);
-
-	/* 4. Draw a frame... */
-	render_frame(s->widgetlist, 0, 0,
-			display_props->width, display_props->height,
-			s->width, s->height, 'v', max(s->duration / s->height, 1), timer);
-
-	/* 5. Set the cursor */
-	drivers_cursor(s->cursor_x, s->cursor_y, s->cursor);
-
-	/* 6. Set the heartbeat */
+	/*-
+	 * 0.2:
+	 * The heartbeat is found like the backlight. The icon the server core
+	 * draws for it changes with the timer; a frame only looks the same
+	 * while it shows the same icon.
+	 */
 	if (heartbeat != HEARTBEAT_OPEN) {
-		tmp_state = heartbeat;
+		heartbeat_state = heartbeat;
 	}
 	else if ((s->client != NULL) && (s->client->heartbeat != HEARTBEAT_OPEN)) {
-		tmp_state = s->client->heartbeat;
+		heartbeat_state = s->client->heartbeat;
 	}
 	else if (s->heartbeat != HEARTBEAT_OPEN) {
-		tmp_state = s->heartbeat;
+		heartbeat_state = s->heartbeat;
+	}
+	else {
+		heartbeat_state = heartbeat_fallback;
+	}
+	tmp_state = heartbeat_state;
+	if (heartbeat_state != HEARTBEAT_OFF) {
+		if (drivers_own_heartbeat())
+			next = timer + 1;
+		else
+			tmp_state = (timer & 5) ? ICON_HEART_FILLED : ICON_HEART_OPEN;
+	}
+
+	/*-
+	 * 0.3:
+	 * Compare with the last frame. Widgets of client screens are only
+	 * changed through widget_touch(), which increments the generation.
+	 */
+	if ((s == last_frame.screen) && (s->client != NULL)
+	    && (timer < last_frame.next)
+	    && (s->generation == last_frame.generation)
+	    && (s->width == last_frame.width)
+	    && (s->height == last_frame.height)
+	    && (s->duration == last_frame.duration)
+	    && (backlight_state == last_frame.backlight)
+	    && (tmp_state == last_frame.heartbeat)
+	    && (output_state == last_frame.output)
+	    && (s->cursor == CURSOR_OFF)
+	    && (server_msg_expire <= 0)
+	    && (timer - last_frame.rendered < RENDER_MAX_SKIP)) {
+		debug(RPT_DEBUG, "==== FRAME UNCHANGED ====");
+		return 0;
+	}
+	last_frame.screen = s;
+	last_frame.generation = s->generation;
+	last_frame.width = s->width;
+	last_frame.height = s->height;
+	last_frame.duration = s->duration;
+	last_frame.backlight = backlight_state;
+	last_frame.heartbeat = tmp_state;
+	last_frame.output = output_state;
+	last_frame.rendered = timer;
+
+	/* 1. Clear the LCD screen... */
+	drivers_clear();
+
+	/* 2. Set up the backlight, as found in 0.1 */
+	drivers_backlight(backlight_state);
+
+	/* 3. Output ports from LCD - outputs depend on the current screen */
+	drivers_output(output_state);
+
+	/* 4. Draw the widgets, with the values from shared memory applied... */
+	render_next = next;
+	target = NULL;
+	if (s->height > display_props->height) {
+		/* Too high: scroll through it like through a frame */
+		int speed = max(s->duration / s->height, 1);
+		int fy = (timer / speed) % (s->height - display_props->height + 1);
+
+		if (render_offscreen(s, display_props->width, s->height, timer) == 0)
+			cellbuf_show(s->cells, 0, fy, display_props->width, display_props->height, 1, 1);
+		render_next = min(render_next, timer - (timer % speed) + speed);
 	}
 	else {
-		tmp_state = heartbeat_fallback;
+		render_widgets(s, display_props->width, display_props->height, timer);
 	}
-	drivers_heartbeat(tmp_state);
+
+	/* 5. Set the cursor */
+	drivers_cursor(s->cursor_x, s->cursor_y, s->cursor);
+
+	/* 6. Set the heartbeat, as found in 0.2 */
+	drivers_heartbeat(heartbeat_state);
 
 	/* 7. If there is an server message that is not expired, display it */
 	if (server_msg_expire > 0) {
@@ -185,7 +293,11 @@ render_screen(Screen *s, long timer)
 		if (server_msg_expire == 0) {
 			free(server_msg_text);
 		}
+		render_next = timer + 1;
 	}
+	if (s->cursor != CURSOR_OFF)
+		render_next = timer + 1;
+	last_frame.next = render_next;
 
 	/* 8. Flush display out, frame and all... */
 	drivers_flush();
@@ -195,123 +307,242 @@ render_screen(Screen *s, long timer)
 
 }
 
-/* The following function is positively ghastly (as was mentioned above!) */
-/* Best thing to do is to remove support for frames... but anyway... */
-/* */
+/* Drawing on the displays, or into the buffer of a frame */
 static void
-render_frame(LinkedList *list,
-		int left,	/* left edge of frame */
-		int top,	/* top edge of frame */
-		int right,	/* right edge of frame */
-		int bottom,	/* bottom edge of frame */
-		int fwid,	/* frame width? */
-		int fhgt,	/* frame height? */
-		char fscroll,	/* direction of scrolling */
-		int fspeed,	/* speed of scrolling... */
-		long timer)	/* current timer tick */
+out_string(int x, int y, const char *string)
 {
-	int fy = 0;		/* Scrolling offset for the frame... */
+	if (target != NULL)
+		cellbuf_string(target, x, y, string);
+	else
+		drivers_string(x, y, string);
+}
 
-	debug(RPT_DEBUG, "%s(list=%p, left=%d, top=%d, "
-			  "right=%d, bottom=%d, fwid=%d, fhgt=%d, "
-			  "fscroll='%c', fspeed=%d, timer=%ld)",
-			  __FUNCTION__, list, left, top, right, bottom,
-			  fwid, fhgt, fscroll, fspeed, timer);
+static void
+out_icon(int x, int y, int icon)
+{
+	if (target != NULL)
+		cellbuf_icon(target, x, y, icon);
+	else
+		drivers_icon(x, y, icon);
+}
 
-	/* return on no data or illegal height */
-	if ((list == NULL) || (fhgt <= 0))
-		return;
+static void
+out_hbar(int x, int y, int len, int promille, int pattern)
+{
+	if (target != NULL)
+		cellbuf_hbar(target, x, y, len, promille);
+	else
+		drivers_hbar(x, y, len, promille, pattern);
+}
 
-	if (fscroll == 'v') {		/* vertical scrolling */
-		// only set offset !=0 when fspeed is != 0 and there is something to scroll
-		if ((fspeed != 0) && (fhgt > bottom - top)) {
-			int fy_max = fhgt - (bottom - top) + 1;
+static void
+out_vbar(int x, int y, int len, int promille, int pattern)
+{
+	if (target != NULL)
+		cellbuf_vbar(target, x, y, len, promille);
+	else
+		drivers_vbar(x, y, len, promille, pattern);
+}
 
-			fy = (fspeed > 0)
-			     ? (timer / fspeed) % fy_max
-			     : (-fspeed * timer) % fy_max;
+static void
+out_pbar(int x, int y, int width, int promille, char *begin_label, char *end_label)
+{
+	if (target != NULL)
+		cellbuf_pbar(target, x, y, width, promille, begin_label, end_label);
+	else
+		drivers_pbar(x, y, width, promille, begin_label, end_label);
+}
 
-			fy = max(fy, 0);	// safeguard against negative values
+static void
+out_num(int x, int num)
+{
+	if (target != NULL)
+		cellbuf_num(target, x, num);
+	else
+		drivers_num(x, num);
+}
 
-			debug(RPT_DEBUG, "%s: fy=%d", __FUNCTION__, fy);
-		}
-	}
-	else if (fscroll == 'h') {	/* horizontal scrolling */
-		/* TODO:  Frames don't scroll horizontally yet! */
+
+/**
+ * Forget a screen that is destroyed.
+ * \param s  The screen.
+ */
+void
+render_forget(Screen *s)
+{
+	scroll_sched_free(s);
+	cellbuf_destroy(s->cells);
+	s->cells = NULL;
+	if (last_frame.screen == s)
+		last_frame.screen = NULL;
+}
+
+
+/**
+ * Render the next frame even if it looks like the last one, e.g. because
+ * something else drew on the displays.
+ */
+void
+render_invalidate(void)
+{
+	last_frame.screen = NULL;
+}
+
+
+/* Advance the animations the client left to the server, in frames too */
+static void
+render_animate(Vector *list, long timer)
+{
+	Widget *w;
+	int i;
+
+	for (i = 0; (w = vector_get(list, i)) != NULL; i++) {
+		if (w->anim != NULL)
+			widget_animate(w, timer);
+		if ((w->type == WID_FRAME) && (w->frame_screen != NULL))
+			render_animate(&w->frame_screen->widgets, timer);
 	}
+}
 
-	/* reset widget list */
-	LL_Rewind(list);
 
-	/* loop over all widgets */
-	do {
-		Widget *w = (Widget *) LL_Get(list);
+/* Draw the widgets of a screen or frame, which is width x height cells */
+static void
+render_widgets(Screen *s, int width, int height, long timer)
+{
+	Widget *w;
+	int i;
 
-		if (w == NULL)
-			return;
+	debug(RPT_DEBUG, "%s(s=[%.40s], width=%d, height=%d, timer=%ld)",
+			  __FUNCTION__, s->id, width, height, timer);
 
-		/* TODO:  Make this cleaner and more flexible! */
+	for (i = 0; (w = vector_get(&s->widgets, i)) != NULL; i++) {
 		switch (w->type) {
 		case WID_STRING:
-			render_string(w, left, top - fy, right, bottom, fy);
+			render_string(w, 0, 0, width, height);
 			break;
 		case WID_HBAR:
-			render_hbar(w, left, top - fy, right, bottom, fy);
+			render_hbar(w, 0, 0, width, height);
 			break;
-		case WID_VBAR:	  /* FIXME:  Vbars don't work in frames! */
-			render_vbar(w, left, top, right, bottom);
+		case WID_VBAR:
+			render_vbar(w, 0, 0, width, height);
 			break;
 		case WID_PBAR:
-			render_pbar(w, left, top - fy, right, bottom);
+			render_pbar(w, 0, 0, width, height);
 			break;
-		case WID_ICON:	  /* FIXME:  Icons don't work in frames! */
-			drivers_icon(w->x, w->y, w->length);
+		case WID_ICON:
+			out_icon(w->x, w->y, w->length);
 			break;
-		case WID_TITLE:	  /* FIXME:  Doesn't work quite right in frames... */
-			render_title(w, left, top, right, bottom, timer);
+		case WID_TITLE:
+			render_title(w, 0, 0, width, height, timer);
 			break;
-		case WID_SCROLLER: /* FIXME: doesn't work in frames... */
-			render_scroller(w, left, top, right, bottom, timer);
+		case WID_SCROLLER:
+			render_scroller(w, 0, 0, width, height, timer);
 			break;
 		case WID_FRAME:
-			{
-				/* FIXME: doesn't handle nested frames quite right!
-				 * doesn't handle scrolling in nested frames at all...
-				 */
-				int new_left = left + w->left - 1;
-				int new_top = top + w->top - 1;
-				int new_right = min(left + w->right, right);
-				int new_bottom = min(top + w->bottom, bottom);
-
-				if ((new_left < right) && (new_top < bottom))	/* Render only if it's visible... */
-					render_frame(w->frame_screen->widgetlist, new_left, new_top,
-							new_right, new_bottom, w->width, w->height,
-							w->length, w->speed, timer);
-			}
+			render_frame(w, timer);
 			break;
-		case WID_NUM:	  /* FIXME: doesn't work in frames... */
-			/* NOTE: y=10 means COLON (:) */
-			if ((w->x > 0) && (w->y >= 0) && (w->y <= 10)) {
-				drivers_num(w->x + left, w->y);
-			}
+		case WID_NUM:
+			render_num(w, 0, 0, width, height);
+			break;
+		case WID_GRAPH:
+			render_graph(w, 0, 0, width, height);
 			break;
 		case WID_NONE:
 			/* FALLTHROUGH */
 		default:
 			break;
 		}
-	} while (LL_Next(list) == 0);
+	}
+}
+
+
+/*
+ * Bring the offscreen buffer of a screen up to date. It is drawn again
+ * when a widget in it changed or a part of it moved since, and kept
+ * otherwise. Contents larger than a buffer can hold are cut once, at
+ * the size the buffer keeps.
+ */
+static int
+render_offscreen(Screen *s, int width, int height, long timer)
+{
+	CellBuf *saved_target = target;
+	long saved_next = render_next;
+	CellBuf *cb = s->cells;
+
+	cellbuf_clip_size(&width, &height);
+	if (cb == NULL) {
+		cb = s->cells = cellbuf_create(width, height);
+		if (cb == NULL)
+			return -1;
+		cb->expires = timer;
+	}
+	else if ((cb->width != width) || (cb->height != height)) {
+		if (cellbuf_resize(cb, width, height) < 0)
+			return -1;
+		cb->expires = timer;
+	}
+	scroll_sched_update(s, timer);
+
+	/* Screens of the server are changed in place */
+	if ((s->client != NULL) && (cb->generation == s->generation) && (timer < cb->expires)) {
+		render_next = min(render_next, cb->expires);
+		return 0;
+	}
+
+	target = cb;
+	render_next = LONG_MAX;
+	cellbuf_clear(cb);
+	render_widgets(s, cb->width, cb->height, timer);
+	cb->generation = s->generation;
+	cb->expires = render_next;
+	target = saved_target;
+	render_next = min(saved_next, cb->expires);
+	return 0;
+}
+
+
+/*
+ * Draw a frame: its screen is drawn offscreen, in a buffer as large as its
+ * contents, and the part visible at the frame's scroll offset is shown.
+ */
+static void
+render_frame(Widget *w, long timer)
+{
+	int width = w->right - w->left + 1;
+	int height = w->bottom - w->top + 1;
+	int offset, fx = 0, fy = 0;
+
+	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d, timer=%ld)",
+			  __FUNCTION__, w, w->left, w->top, w->right, w->bottom, timer);
+
+	if ((w->frame_screen == NULL) || (width <= 0) || (height <= 0))
+		return;
+
+	if (render_offscreen(w->frame_screen, max(w->width, width), max(w->height, height), timer) < 0)
+		return;
+
+	offset = scroll_offset(w, timer);
+	render_next = min(render_next, w->scroll.next);
+	if (w->length == 'h')
+		fx = offset;
+	else
+		fy = offset;
+
+	if (target != NULL)
+		cellbuf_blit(target, w->left, w->top, w->frame_screen->cells, fx, fy, width, height);
+	else
+		cellbuf_show(w->frame_screen->cells, fx, fy, width, height, w->left, w->top);
 }
 
 
 static void
-render_string(Widget *w, int left, int top, int right, int bottom, int fy)
+render_string(Widget *w, int left, int top, int right, int bottom)
 {
-	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d, fy=%d)",
-			  __FUNCTION__, w, left, top, right, bottom, fy);
+	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d)",
+			  __FUNCTION__, w, left, top, right, bottom);
 
 	if ((w->text != NULL) &&
-	    (w->x > 0) && (w->y > 0) && (w->y > fy) && (w->y <= bottom - top)) {
+	    (w->x > 0) && (w->y > 0) && (w->y <= bottom - top)) {
 		/*
 		 * FIXME: Could be a bug here? w->x is recalculated (On first
 		 * call only? Is it preserved between calls?) and first
@@ -319,22 +550,22 @@ render_string(Widget *w, int left, int top, int right, int bottom, int fy)
 		 * strings totally off-screen. Is this on purpose? (M. Dolze)
 		 */
 		w->x = min(w->x, right - left);
-		drivers_string(w->x + left, w->y + top, w->text);
+		out_string(w->x + left, w->y + top, w->text);
 	}
 }
 
 
 static void
-render_hbar(Widget *w, int left, int top, int right, int bottom, int fy)
+render_hbar(Widget *w, int left, int top, int right, int bottom)
 {
-	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d, fy=%d)",
-			  __FUNCTION__, w, left, top, right, bottom, fy);
+	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d)",
+			  __FUNCTION__, w, left, top, right, bottom);
 
-	if (!((w->x > 0) && (w->y > 0) && (w->y > fy) && (w->y <= bottom - top)))
+	if (!((w->x > 0) && (w->y > 0) && (w->y <= bottom - top)))
 		return;
 
 	if (w->length > 0) {
-		int len = display_props->width - w->x - left + 1;
+		int len = right - left - w->x + 1;
 		int promille = 1000;
 
 		if ((w->length / display_props->cellwidth) < right - left - w->x + 1) {
@@ -344,7 +575,7 @@ render_hbar(Widget *w, int left, int top, int right, int bottom, int fy)
 				   (display_props->cellwidth * len);
 		}
 
-		drivers_hbar(w->x + left, w->y + top, len, promille, BAR_PATTERN_FILLED);
+		out_hbar(w->x + left, w->y + top, len, promille, BAR_PATTERN_FILLED);
 	}
 	else if (w->length < 0) {
 		/* TODO:  Rearrange stuff to get left-extending
@@ -366,10 +597,10 @@ render_vbar(Widget *w, int left, int top, int right, int bottom)
 		return;
 
 	if (w->length > 0) {
-		int full_len = display_props->height;
+		int full_len = bottom - top;
 		int promille = (long) 1000 * w->length / (display_props->cellheight * full_len);
 
-		drivers_vbar(w->x + left, w->y + top, full_len, promille, BAR_PATTERN_FILLED);
+		out_vbar(w->x + left, w->y + top, full_len, promille, BAR_PATTERN_FILLED);
 	}
 	else if (w->length < 0) {
 		/* TODO:  Rearrange stuff to get down-extending
@@ -389,7 +620,7 @@ render_pbar(Widget *w, int left, int top, int right, int bottom)
 	if (!((w->x > 0) && (w->y > 0) && (w->width > 0)))
 		return;
 
-        drivers_pbar(w->x + left, w->y + top, w->width, w->promille,
+        out_pbar(w->x + left, w->y + top, w->width, w->promille,
        		     w->begin_label, w->end_label);
 }
 
@@ -414,8 +645,8 @@ render_title(Widget *w, int left, int top, int right, int bottom, long timer)
 		: max(TITLESPEED_MIN, TITLESPEED_MAX - titlespeed);
 
 	/* display leading fillers */
-	drivers_icon(w->x + left, w->y + top, ICON_BLOCK_FILLED);
-	drivers_icon(w->x + left + 1, w->y + top, ICON_BLOCK_FILLED);
+	out_icon(w->x + left, w->y + top, ICON_BLOCK_FILLED);
+	out_icon(w->x + left + 1, w->y + top, ICON_BLOCK_FILLED);
 
 	length = min(length, sizeof(str)-1);
 	if ((length <= width) || (delay == 0)) {
@@ -432,6 +663,8 @@ render_title(Widget *w, int left, int top, int right, int bottom, long timer)
 		int offset = timer;
 		int reverse;
 
+		render_next = timer + 1;
+
 		/* if the delay is "too large" increase cycle length */
 		if ((delay != 0) && (delay < length / (length - width)))
 			offset /= delay;
@@ -464,11 +697,11 @@ render_title(Widget *w, int left, int top, int right, int bottom, long timer)
 	}
 
 	/* display text */
-	drivers_string(w->x + 3 + left, w->y + top, str);
+	out_string(w->x + 3 + left, w->y + top, str);
 
 	/* display trailing fillers */
 	for ( ; x < vis_width; x++) {
-		drivers_icon(w->x + x + left, w->y + top, ICON_BLOCK_FILLED);
+		out_icon(w->x + x + left, w->y + top, ICON_BLOCK_FILLED);
 	}
 }
 
@@ -480,7 +713,6 @@ render_scroller(Widget *w, int left, int top, int right, int bottom, long timer)
 	int length;
 	int offset, gap;
 	int screen_width;
-	int necessaryTimeUnits = 0;
 
 	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d, timer=%ld)",
 			  __FUNCTION__, w, left, top, right, bottom, timer);
@@ -488,32 +720,22 @@ render_scroller(Widget *w, int left, int top, int right, int bottom, long timer)
 	if ((w->text == NULL) || (w->right < w->left))
 		return;
 
-	screen_width = abs(w->right - w->left + 1);
-	screen_width = min(screen_width, sizeof(str)-1);
+	screen_width = scroll_width(w);
+	offset = scroll_offset(w, timer);
+	render_next = min(render_next, w->scroll.next);
 
 	switch (w->length) {	/* actually, direction... */
 	case 'm': // Marquee
 		length = strlen(w->text);
 		if (length <= screen_width) {
 			/* it fits within the box, just render it */
-			drivers_string(w->left, w->top, w->text);
+			out_string(w->left, w->top, w->text);
 			break;
 		}
 
 		gap = screen_width / 2;
 		length += gap; /* Allow gap between end and beginning */
 
-		if (w->speed > 0) {
-			necessaryTimeUnits = length * w->speed;
-			offset = (timer % necessaryTimeUnits) / w->speed;
-		}
-		else if (w->speed < 0) {
-			necessaryTimeUnits = length / (w->speed * -1);
-			offset = (timer % necessaryTimeUnits) * w->speed * -1;
-		}
-		else {
-			offset = 0;
-		}
 		if (offset <= length) {
 			if (gap > offset) {
 				memset(str, ' ', gap - offset);
@@ -531,51 +753,21 @@ render_scroller(Widget *w, int left, int top, int right, int bottom, long timer)
 				}
 			}
 			str[screen_width] = '\0';
-			drivers_string(w->left, w->top, str);
+			out_string(w->left, w->top, str);
 		}
 		break;
 	case 'h':
 		length = strlen(w->text) + 1;
 		if (length <= screen_width) {
 			/* it fits within the box, just render it */
-			drivers_string(w->left, w->top, w->text);
+			out_string(w->left, w->top, w->text);
 		}
 		else {
-			int effLength = length - screen_width;
-
-			if (w->speed > 0) {
-				necessaryTimeUnits = effLength * w->speed;
-				if (((timer / necessaryTimeUnits) % 2) == 0) {
-					/* wiggle one way */
-					offset = (timer % (effLength*w->speed))
-						 / w->speed;
-				}
-				else {
-					/* wiggle the other */
-					offset = (((timer % (effLength * w->speed))
-						  - (effLength * w->speed) + 1)
-						 / w->speed) * -1;
-				}
-			}
-			else if (w->speed < 0) {
-				necessaryTimeUnits = effLength / (w->speed * -1);
-				if (((timer / necessaryTimeUnits) % 2) == 0) {
-					offset = (timer % (effLength / (w->speed * -1)))
-						 * w->speed * -1;
-				}
-				else {
-					offset = (((timer % (effLength / (w->speed * -1)))
-						  * w->speed * -1)
-						  - effLength + 1) * -1;
-				}
-			}
-			else {
-				offset = 0;
-			}
+			/* wiggle one way, then the other */
 			if (offset <= length) {
 				strncpy(str, &((w->text)[offset]), screen_width);
 				str[screen_width] = '\0';
-				drivers_string(w->left, w->top, str);
+				out_string(w->left, w->top, str);
 				/*debug(RPT_DEBUG, "scroller %s : %d", str, length-offset); */
 			}
 		}
@@ -588,7 +780,7 @@ render_scroller(Widget *w, int left, int top, int right, int bottom, long timer)
 		length = strlen(w->text);
 		if (length <= screen_width) {
 			/* no scrolling required... */
-			drivers_string(w->left, w->top, w->text);
+			out_string(w->left, w->top, w->text);
 		}
 		else {
 			int lines_required = (length / screen_width)
@@ -602,51 +794,21 @@ render_scroller(Widget *w, int left, int top, int right, int bottom, long timer)
 				for (i = 0; i < lines_required; i++) {
 					strncpy(str, &((w->text)[i * screen_width]), screen_width);
 					str[screen_width] = '\0';
-					drivers_string(w->left, w->top + i, str);
+					out_string(w->left, w->top + i, str);
 				}
 			}
 			else {
-				int effLines = lines_required - available_lines + 1;
-				int begin = 0;
+				/* scroll up, then down again */
+				int begin = offset;
 				int i = 0;
 
-				/*debug(RPT_DEBUG, "length: %d sw: %d lines req: %d  avail lines: %d  effLines: %d ",length,screen_width,lines_required,available_lines,effLines);*/
-				if (w->speed > 0) {
-					necessaryTimeUnits = effLines * w->speed;
-					if (((timer / necessaryTimeUnits) % 2) == 0) {
-						/*debug(RPT_DEBUG, "up ");*/
-						begin = (timer % (necessaryTimeUnits))
-							 / w->speed;
-					}
-					else {
-						/*debug(RPT_DEBUG, "down ");*/
-						begin = (((timer % necessaryTimeUnits)
-							 - necessaryTimeUnits + 1) / w->speed)
-							 * -1;
-					}
-				}
-				else if (w->speed < 0) {
-					necessaryTimeUnits = effLines / (w->speed * -1);
-					if (((timer / necessaryTimeUnits) % 2) == 0) {
-						begin = (timer % necessaryTimeUnits)
-							 * w->speed * -1;
-					}
-					else {
-						begin = (((timer % necessaryTimeUnits)
-							 * w->speed * -1) - effLines + 1)
-							 * -1;
-					}
-				}
-				else {
-					begin = 0;
-				}
-				/*debug(RPT_DEBUG, "rendering begin: %d  timer: %d effLines: %d",begin,timer,effLines); */
+				/*debug(RPT_DEBUG, "rendering begin: %d  timer: %d",begin,timer); */
 				for (i = begin; i < begin + available_lines; i++) {
 					strncpy(str, &((w->text)[i * (screen_width)]), screen_width);
 					str[screen_width] = '\0';
 					/*debug(RPT_DEBUG, "rendering: '%s' of %s", */
 					/*str,w->text); */
-					drivers_string(w->left, w->top + (i - begin), str);
+					out_string(w->left, w->top + (i - begin), str);
 				}
 			}
 		}
@@ -662,7 +824,33 @@ static void render_num(Widget *w, int left, int top, int right, int bottom)
 
 	/* NOTE: y=10 means COLON (:) */
 	if ((w->x > 0) && (w->y >= 0) && (w->y <= 10)) {
-		drivers_num(w->x + left, w->y);
+		out_num(w->x + left, w->y);
+	}
+}
+
+
+/*
+ * A graph is a row of vbars, one for each sample in the widget's history,
+ * with the newest sample in the rightmost column. If the graph is cut off
+ * at the right, the visible columns show the newest samples.
+ */
+static void
+render_graph(Widget *w, int left, int top, int right, int bottom)
+{
+	int cols, col, value;
+
+	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d)",
+			  __FUNCTION__, w, left, top, right, bottom);
+
+	if (!((w->x > 0) && (w->y > 0) && (w->height > 0)) || (w->history == NULL))
+		return;
+
+	cols = min(w->width, right - left - w->x + 1);
+	for (col = 0; col < cols; col++) {
+		value = widget_get_sample(w, cols - 1 - col);
+		if (value > 0)
+			out_vbar(w->x + left + col, w->y + top, w->height,
+				     value, BAR_PATTERN_FILLED);
 	}
 }
 
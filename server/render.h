@@ -40,6 +40,12 @@ extern int output_state;
 /* Render the given screen. */
 int render_screen(Screen *s, long timer);
 
+/* Forget a screen that is destroyed */
+void render_forget(Screen *s);
+
+/* Render the next frame even if it looks like the last one */
+void render_invalidate(void);
+
 /* Display a short message, which must be shorter than 16 chars, in a corner */
 int server_msg(const char *text, int expire);
 
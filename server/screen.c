@@ -28,6 +28,8 @@
 #include "menuscreens.h"
 #include "main.h"
 #include "render.h"
+#include "pool.h"
+#include "shmscreen.h"
 
 int  default_duration = 0;
 int  default_timeout  = -1;
@@ -52,6 +54,7 @@ Screen *
 screen_create(char *id, Client *client)
 {
 	Screen *s;
+	Pool *pool;
 
 	debug(RPT_DEBUG, "%s(id=\"%.40s\", client=[%d])",
 		 __FUNCTION__, id, (client?client->sock:-1));
@@ -61,17 +64,18 @@ screen_create(char *id, Client *client)
 		return NULL;
 	}
 	/* Client can be NULL for serverscreens and other client-less screens */
+	pool = (client != NULL) ? client->pool : NULL;
 
-	s = malloc(sizeof(Screen));
+	s = pool_alloc(pool, sizeof(Screen));
 	if (s == NULL) {
 		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
 		return NULL;
 	}
 
-	s->id = strdup(id);
+	s->id = pool_strdup(pool, id);
 	if (s->id == NULL) {
 		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
-		free(s);
+		pool_free(pool, s);
 		return NULL;
 	}
 
@@ -83,21 +87,19 @@ screen_create(char *id, Client *client)
 	s->height = display_props->height;
 	s->keys = NULL;
 	s->client = client;
-	s->widgetlist = NULL;
 	s->timeout = default_timeout; 	/*ignored unless greater than 0.*/
 	s->backlight = BACKLIGHT_OPEN;		/*Lets the screen do it's own*/
 						/*or do what the client says.*/
 	s->cursor = CURSOR_OFF;
 	s->cursor_x = 1;
 	s->cursor_y = 1;
-
-	s->widgetlist = LL_new();
-	if (s->widgetlist == NULL) {
-		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
-		free(s->id);
-		free(s);
-		return NULL;
-	}
+	s->generation = 0;
+	s->shm = NULL;
+	s->scroll = NULL;
+	s->parent = NULL;
+	s->cells = NULL;
+	vector_init(&s->widgets);
+	hashmap_init(&s->widgetmap);
 
 	menuscreen_add_screen(s);
 
@@ -114,6 +116,8 @@ int
 screen_destroy(Screen *s)
 {
 	Widget *w;
+	Pool *pool = screen_pool(s);
+	int i;
 
 	debug(RPT_DEBUG, "%s(s=[%.40s])", __FUNCTION__, s->id);
 
@@ -121,29 +125,46 @@ screen_destroy(Screen *s)
 
 	screenlist_remove(s);
 
-	for (w = LL_GetFirst(s->widgetlist); w; w = LL_GetNext(s->widgetlist)) {
+	shmscreen_detach(s);
+
+	render_forget(s);
+
+	for (i = 0; (w = vector_get(&s->widgets, i)) != NULL; i++) {
 		/* Free a widget...*/
 		widget_destroy(w);
 	}
-	LL_Destroy(s->widgetlist);
-	s->widgetlist = NULL;
+	vector_clear(&s->widgets);
+	hashmap_clear(&s->widgetmap);
 
 	if (s->id != NULL) {
-		free(s->id);
+		pool_free(pool, s->id);
 		s->id = NULL;
 	}
 	if (s->name != NULL) {
-		free(s->name);
+		pool_free(pool, s->name);
 		s->name = NULL;
 	}
 
-	free(s);
+	pool_free(pool, s);
 	s = NULL;
 
 	return 0;
 }
 
 
+/** Record that the contents of a screen changed.
+ * Increments the generation of the screen and of the screens of the
+ * frames it is shown in.
+ * \param s  Screen that changed.
+ */
+void
+screen_touch(Screen *s)
+{
+	for ( ; s != NULL; s = (s->parent != NULL) ? s->parent->screen : NULL)
+		s->generation++;
+}
+
+
 /** Add a widget to a screen.
  * \param s  Screen to add the widget \c w to.
  * \param w  Widget to be added to \c s.
@@ -155,7 +176,13 @@ screen_add_widget(Screen *s, Widget *w)
 {
 	debug(RPT_DEBUG, "%s(s=[%.40s], widget=[%.40s])", __FUNCTION__, s->id, w->id);
 
-	LL_Push(s->widgetlist, (void *) w);
+	if (vector_push(&s->widgets, (void *) w) < 0)
+		return -1;
+	if (hashmap_put(&s->widgetmap, w->id, (void *) w) < 0) {
+		vector_remove(&s->widgets, w);
+		return -1;
+	}
+	screen_touch(s);
 
 	return 0;
 }
@@ -172,7 +199,11 @@ screen_remove_widget(Screen *s, Widget *w)
 {
 	debug(RPT_DEBUG, "%s(s=[%.40s], widget=[%.40s])", __FUNCTION__, s->id, w->id);
 
-	LL_Remove(s->widgetlist, (void *) w, NEXT);
+	if (vector_remove(&s->widgets, w) < 0)
+		return -1;
+	if (hashmap_get(&s->widgetmap, w->id) == w)
+		hashmap_remove(&s->widgetmap, w->id);
+	screen_touch(s);
 
 	return 0;
 }
@@ -187,6 +218,7 @@ Widget *
 screen_find_widget(Screen *s, char *id)
 {
 	Widget *w;
+	int i;
 
 	if (!s)
 		return NULL;
@@ -195,16 +227,19 @@ screen_find_widget(Screen *s, char *id)
 
 	debug(RPT_DEBUG, "%s(s=[%.40s], id=\"%.40s\")", __FUNCTION__, s->id, id);
 
-	for (w = LL_GetFirst(s->widgetlist); w != NULL; w = LL_GetNext(s->widgetlist)) {
-		if (0 == strcmp(w->id, id)) {
-			debug(RPT_DEBUG, "%s: Found %s", __FUNCTION__, id);
-			return w;
-		}
-		/* Search subscreens recursively */
+	w = hashmap_get(&s->widgetmap, id);
+	if (w != NULL) {
+		debug(RPT_DEBUG, "%s: Found %s", __FUNCTION__, id);
+		return w;
+	}
+
+	/* Search subscreens recursively */
+	for (i = 0; (w = vector_get(&s->widgets, i)) != NULL; i++) {
 		if (w->type == WID_FRAME) {
-			w = widget_search_subs(w, id);
-			if (w != NULL)
-				return w;
+			Widget *sub = widget_search_subs(w, id);
+
+			if (sub != NULL)
+				return sub;
 		}
 	}
 	debug(RPT_DEBUG, "%s: Not found", __FUNCTION__);
@@ -25,6 +25,8 @@
 #define SCREEN_H_TYPES
 
 #include "shared/LL.h"
+#include "shared/vector.h"
+#include "shared/hashmap.h"
 
 #ifdef INC_TYPES_ONLY
 # include "client.h"
@@ -51,8 +53,14 @@ typedef struct Screen {
 	short int cursor_x;
 	short int cursor_y;
 	char *keys;
-	LinkedList *widgetlist;
+	Vector widgets;			/**< widgets in the order they were added */
+	HashMap widgetmap;		/**< widgets by id */
 	struct Client *client;
+	unsigned int generation;	/**< incremented when a widget is added, removed or changed, here or in a frame */
+	struct ShmScreenMap *shm;	/**< attached shared memory object; or NULL */
+	struct ScrollSched *scroll;	/**< scroller timing; or NULL */
+	struct Widget *parent;		/**< frame widget showing this screen; or NULL */
+	struct CellBuf *cells;		/**< offscreen contents; or NULL */
 } Screen;
 
 extern int  default_duration ;
@@ -74,24 +82,26 @@ Screen *screen_create(char *id, Client *client);
 /* Destroys a screen */
 int screen_destroy(Screen *s);
 
+/* Memory pool of the screen's client; NULL for server screens */
+static inline struct Pool *screen_pool(Screen *s)
+{
+	return ((s != NULL) && (s->client != NULL)) ? s->client->pool : NULL;
+}
+
+/* Record that the contents of a screen changed */
+void screen_touch(Screen *s);
+
 /* Add a widget to a screen */
 int screen_add_widget(Screen *s, Widget *w);
 
 /* Remove a widget from a screen (does not destroy it) */
 int screen_remove_widget(Screen *s, Widget *w);
 
-/* List functions */
-static inline Widget *screen_getfirst_widget(Screen *s)
-{
-	return (Widget *) ((s != NULL)
-			   ? LL_GetFirst(s->widgetlist)
-			   : NULL);
-}
-
-static inline Widget *screen_getnext_widget(Screen *s)
+/* Get the widget at an index; NULL past the last one */
+static inline Widget *screen_get_widget(Screen *s, int index)
 {
 	return (Widget *) ((s != NULL)
-			   ? LL_GetNext(s->widgetlist)
+			   ? vector_get(&s->widgets, index)
 			   : NULL);
 }
 
@@ -0,0 +1,298 @@
+/** \file server/scroll.c
+ * Timing of the scroller and frame widgets of a screen.
+ *
+ * Each scroller used to take its offset from the global timer and its own
+ * length, so scrollers of different lengths drifted apart and turned at
+ * different times. Here the scrollers of a screen that share direction and
+ * speed form a group that moves in step: a cycle of the group is as long
+ * as that of its longest member, and shorter members wait at their ends
+ * (marquees at their start) until the longest one has caught up. A group
+ * starts moving when it is formed, or when its longest member changes.
+ *
+ * Frames that scroll their contents are timed the same way. Like
+ * marquees they wrap around: after the last step they start over.
+ *
+ * The offset of a scroller is only computed again when it changes. Along
+ * with it the tick of the next change is stored in the widget, so the
+ * renderer can tell when a screen will look different.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "shared/report.h"
+#include "shared/defines.h"
+
+#include "screen.h"
+#include "widget.h"
+#include "scroll.h"
+
+static ScrollGroup *spare = NULL;	/**< Groups array reused while regrouping */
+static int spare_size = 0;		/**< Capacity of \c spare */
+
+
+/**
+ * Get the width of the window of a scroller.
+ * \param w  The scroller.
+ * \return   Number of columns shown.
+ */
+int
+scroll_width(Widget *w)
+{
+	return min(abs(w->right - w->left + 1), SCROLL_MAX_WIDTH);
+}
+
+
+/** Whether a widget is timed by the scroll scheduler. */
+static inline int
+scroll_is_member(Widget *w)
+{
+	return (w->type == WID_SCROLLER) || (w->type == WID_FRAME);
+}
+
+
+/** Whether a widget wraps around instead of turning back at its end. */
+static inline int
+scroll_wraps(Widget *w)
+{
+	return (w->type == WID_FRAME) || (w->length == 'm');
+}
+
+
+/**
+ * Count the steps the text of a scroller, or the contents of a frame,
+ * move through in one direction.
+ * \param w  The scroller or frame.
+ * \return   Number of steps; 0 if all of it fits and does not move.
+ */
+static int
+scroll_steps(Widget *w)
+{
+	int width, length, lines, available;
+
+	if (w->type == WID_FRAME) {
+		width = w->right - w->left + 1;
+		available = w->bottom - w->top + 1;
+		if (w->length == 'h')
+			return (w->width > width) ? w->width - width + 1 : 0;
+		return (w->height > available) ? w->height - available + 1 : 0;
+	}
+
+	if ((w->text == NULL) || (w->right < w->left))
+		return 0;
+
+	width = scroll_width(w);
+	length = strlen(w->text);
+
+	switch (w->length) {	/* actually, direction... */
+	case 'm':
+		/* all of the text and a gap of half the width */
+		return (length <= width) ? 0 : length + width / 2;
+	case 'h':
+		/* one blank after the text */
+		return (length + 1 <= width) ? 0 : length + 1 - width;
+	case 'v':
+		if (length <= width)
+			return 0;
+		lines = length / width + ((length % width) ? 1 : 0);
+		available = w->bottom - w->top + 1;
+		return (lines <= available) ? 0 : lines - available + 1;
+	default:
+		return 0;
+	}
+}
+
+
+/**
+ * Map the position of a group to the offset of one of its members.
+ * \param wrap     Whether the group wraps around.
+ * \param steps    Steps of the member.
+ * \param longest  Steps of the longest member.
+ * \param pos      Steps the group moved since it started.
+ * \return         Offset of the member.
+ */
+static int
+scroll_member_offset(int wrap, int steps, int longest, long pos)
+{
+	if (wrap) {
+		/* wrap around; shorter ones wait at their start */
+		pos %= longest;
+		return (pos < steps) ? pos : 0;
+	}
+
+	/* go back and forth; shorter ones wait at either end */
+	pos %= 2 * longest;
+	if (pos < longest)
+		return min(pos, steps - 1);
+	return max(steps - 1 - (pos - longest), 0);
+}
+
+
+/**
+ * Regroup the scrollers of a screen if the screen changed since the last
+ * call. Screens of the server are changed without their generation being
+ * incremented, so their scrollers are regrouped every time. Groups whose
+ * longest member did not change keep moving without a jump.
+ * \param s      The screen.
+ * \param timer  Current tick.
+ */
+void
+scroll_sched_update(Screen *s, long timer)
+{
+	ScrollSched *sched = s->scroll;
+	ScrollGroup *groups;
+	Widget *w;
+	int i, j, size, count = 0;
+
+	if (sched == NULL) {
+		sched = calloc(1, sizeof(ScrollSched));
+		if (sched == NULL) {
+			report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+			return;
+		}
+		s->scroll = sched;
+	}
+	else if ((s->client != NULL) && (sched->generation == s->generation))
+		return;
+	sched->generation = s->generation;
+
+	/* Make room for one group per scroller */
+	for (i = 0; (w = vector_get(&s->widgets, i)) != NULL; i++) {
+		if (scroll_is_member(w))
+			count++;
+	}
+	if (count > spare_size) {
+		groups = realloc(spare, count * sizeof(ScrollGroup));
+		if (groups == NULL) {
+			report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+			return;
+		}
+		spare = groups;
+		spare_size = count;
+	}
+	groups = spare;
+	count = 0;
+
+	for (i = 0; (w = vector_get(&s->widgets, i)) != NULL; i++) {
+		if (!scroll_is_member(w))
+			continue;
+
+		for (j = 0; j < count; j++) {
+			if ((groups[j].direction == w->length) && (groups[j].speed == w->speed)
+			    && (groups[j].wrap == scroll_wraps(w)))
+				break;
+		}
+		if (j == count) {
+			groups[j].direction = w->length;
+			groups[j].speed = w->speed;
+			groups[j].wrap = scroll_wraps(w);
+			groups[j].steps = 0;
+			count++;
+		}
+		w->scroll.group = j;
+		w->scroll.steps = scroll_steps(w);
+		w->scroll.next = timer;		/* compute the offset again */
+		groups[j].steps = max(groups[j].steps, w->scroll.steps);
+	}
+
+	for (j = 0; j < count; j++) {
+		groups[j].epoch = timer;
+		for (i = 0; i < sched->count; i++) {
+			if ((sched->groups[i].direction == groups[j].direction)
+			    && (sched->groups[i].speed == groups[j].speed)
+			    && (sched->groups[i].wrap == groups[j].wrap)
+			    && (sched->groups[i].steps == groups[j].steps)) {
+				groups[j].epoch = sched->groups[i].epoch;
+				break;
+			}
+		}
+	}
+
+	/* The old array becomes the spare one */
+	size = spare_size;
+	spare = sched->groups;
+	spare_size = sched->size;
+	sched->groups = groups;
+	sched->size = size;
+	sched->count = count;
+}
+
+
+/**
+ * Free the scroll scheduler of a screen.
+ * \param s  The screen.
+ */
+void
+scroll_sched_free(Screen *s)
+{
+	if (s->scroll == NULL)
+		return;
+
+	free(s->scroll->groups);
+	free(s->scroll);
+	s->scroll = NULL;
+}
+
+
+/**
+ * Get the offset of the text of a scroller: the first column for
+ * horizontal scrollers and marquees, the first line for vertical ones.
+ * For frames it is the first column or row of the contents shown.
+ * The offset is kept in the widget along with the tick it changes next,
+ * and only computed again from that tick on.
+ * \param w      The scroller.
+ * \param timer  Current tick.
+ * \return       The offset.
+ */
+int
+scroll_offset(Widget *w, long timer)
+{
+	ScrollSched *sched = w->screen->scroll;
+	ScrollGroup *g;
+	long step, cycle, i;
+	int speed;
+
+	if (timer < w->scroll.next)
+		return w->scroll.offset;
+
+	w->scroll.offset = 0;
+	w->scroll.next = LONG_MAX;
+	if ((sched == NULL) || (w->scroll.group < 0) || (w->scroll.group >= sched->count))
+		return 0;
+
+	g = &sched->groups[w->scroll.group];
+	speed = g->speed;
+	if ((speed == 0) || (w->scroll.steps == 0))
+		return 0;
+
+	/* Steps of the group: every speed ticks, or -speed of them every tick */
+	cycle = (g->wrap) ? g->steps : 2 * g->steps;
+	step = (speed > 0) ? (max(timer - g->epoch, 0) / speed) : max(timer - g->epoch, 0);
+	step %= cycle;
+
+#define SCROLL_POS(n)	((speed > 0) ? (n) : ((n) % cycle) * -speed)
+	w->scroll.offset = scroll_member_offset(g->wrap, w->scroll.steps,
+						g->steps, SCROLL_POS(step));
+
+	/* Look ahead for the tick the offset changes */
+	for (i = 1; i <= cycle; i++) {
+		if (scroll_member_offset(g->wrap, w->scroll.steps, g->steps,
+					 SCROLL_POS(step + i)) != w->scroll.offset) {
+			w->scroll.next = (speed > 0)
+					 ? timer - (max(timer - g->epoch, 0) % speed) + i * speed
+					 : timer + i;
+			break;
+		}
+	}
+#undef SCROLL_POS
+
+	return w->scroll.offset;
+}
+
@@ -0,0 +1,51 @@
+/** \file server/scroll.h
+ * Timing of the scroller and frame widgets of a screen.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef SCROLL_H
+#define SCROLL_H
+
+#define INC_TYPES_ONLY 1
+#include "screen.h"
+#undef INC_TYPES_ONLY
+#include "widget.h"
+
+/** Widest scroller window handled; the rest of a wider one stays empty */
+#define SCROLL_MAX_WIDTH	1023
+
+/** Scrollers of a screen that move in step */
+typedef struct ScrollGroup {
+	char direction;			/**< 'm', 'h' or 'v' */
+	int wrap;			/**< whether it wraps around instead of turning back */
+	int speed;			/**< ticks per step; < 0: steps per tick */
+	int steps;			/**< steps of the longest member */
+	long epoch;			/**< tick the group started moving */
+} ScrollGroup;
+
+/** Scroll scheduler of a screen */
+typedef struct ScrollSched {
+	unsigned int generation;	/**< screen generation the groups were built for */
+	int count;			/**< number of groups */
+	int size;			/**< capacity of \c groups */
+	ScrollGroup *groups;		/**< the groups */
+} ScrollSched;
+
+/* Regroup the scrollers of a screen if it changed */
+void scroll_sched_update(Screen *s, long timer);
+
+/* Free the scroll scheduler of a screen */
+void scroll_sched_free(Screen *s);
+
+/* Width of the window of a scroller */
+int scroll_width(Widget *w);
+
+/* Offset of the text of a scroller or the contents of a frame at a tick */
+int scroll_offset(Widget *w, long timer);
+
+#endif
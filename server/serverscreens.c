@@ -146,6 +146,7 @@ update_server_screen(void)
 	Widget *w;
 	int num_clients = 0;
 	int num_screens = 0;
+	int i;
 
 	/* get info on the number of connected clients...*/
 	num_clients = clients_client_count();
@@ -170,7 +171,7 @@ update_server_screen(void)
 	}
 
 	/* ... and screens */
-	for (c = clients_getfirst(); c != NULL; c = clients_getnext()) {
+	for (i = 0; (c = clients_get(i)) != NULL; i++) {
 		num_screens += client_screen_count(c);
 	}
 
@@ -0,0 +1,272 @@
+/** \file server/shmscreen.c
+ * Shared-memory fast path for updating the widgets of a screen.
+ *
+ * A local client that changes widgets at a high rate (level meters,
+ * sensor daemons, ...) can attach a shared memory object to a screen
+ * instead of sending a widget_set for every change. The layout of the
+ * object is described in shared/shmscreen.h. It is mapped read-only and
+ * read by render_screen(), so LCDd only looks at it when the screen is
+ * shown and the client needs no system call to update it.
+ *
+ * The client may change the object at any time. The slots are copied out
+ * under the sequence counter and the copy is checked before it is used.
+ * The client may also shrink the object at any time, and touching a page
+ * beyond its new end raises SIGBUS. Reads of the object are therefore
+ * guarded: a SIGBUS inside the mapping being read jumps back to the reader,
+ * which detaches the object.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_SHM_OPEN
+# include <unistd.h>
+# include <fcntl.h>
+# include <signal.h>
+# include <setjmp.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#include "shared/report.h"
+#include "shared/shmscreen.h"
+
+#include "screen.h"
+#include "widget.h"
+#include "shmscreen.h"
+
+/** Number of attempts to get a consistent copy per update */
+#define SHM_READ_TRIES	3
+
+/** Shared memory object attached to a screen */
+struct ShmScreenMap {
+	int fd;			/**< Descriptor of the object */
+	ShmScreen *mem;		/**< Read-only mapping of the object */
+	uint32_t seq;		/**< Sequence counter of the last applied copy */
+	ShmScreen copy;		/**< Slots copied out of the object */
+};
+
+#ifdef HAVE_SHM_OPEN
+/** Mapping being read; a SIGBUS elsewhere is not caused by a client */
+static const char *volatile shm_reading = NULL;
+/** Where a SIGBUS while reading returns to */
+static sigjmp_buf shm_fault;
+/** SIGBUS action before ours */
+static struct sigaction shm_old_sigbus;
+static int shm_handler_installed = 0;
+
+
+/** Leave a read of a shrunk object. Other faults are handed back to the
+ * previous action, which takes over when the faulting access is retried.
+ */
+static void
+shm_sigbus_handler(int sig, siginfo_t *info, void *context)
+{
+	const char *addr = info->si_addr;
+
+	if ((shm_reading != NULL) && (addr >= shm_reading)
+	    && (addr < shm_reading + sizeof(ShmScreen)))
+		siglongjmp(shm_fault, 1);
+
+	sigaction(SIGBUS, &shm_old_sigbus, NULL);
+	shm_handler_installed = 0;
+}
+
+
+/** Install the SIGBUS handler guarding the reads of shared memory objects.
+ * \retval 0    Success.
+ * \retval -1   Error.
+ */
+static int
+shm_install_handler(void)
+{
+	struct sigaction sa;
+
+	if (shm_handler_installed)
+		return 0;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = shm_sigbus_handler;
+	sa.sa_flags = SA_SIGINFO;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGBUS, &sa, &shm_old_sigbus) < 0) {
+		report(RPT_ERR, "%s: cannot install SIGBUS handler: %s", __FUNCTION__, strerror(errno));
+		return -1;
+	}
+	shm_handler_installed = 1;
+	return 0;
+}
+#endif
+
+
+/** Attach a shared memory object to a screen. An object attached before
+ * is detached.
+ * \param s     The screen.
+ * \param name  Name of the object as passed to shm_open(); it must start
+ *              with a '/' and contain no other.
+ * \retval 0    Success.
+ * \retval -1   Error; the name is invalid or the object cannot be mapped.
+ */
+int
+shmscreen_attach(Screen *s, const char *name)
+{
+#ifdef HAVE_SHM_OPEN
+	struct ShmScreenMap *map;
+	struct stat st;
+	ShmScreen *mem;
+	uint32_t seq;
+	int fd, valid;
+
+	shmscreen_detach(s);
+
+	if ((name[0] != '/') || (strchr(name + 1, '/') != NULL))
+		return -1;
+	if (shm_install_handler() < 0)
+		return -1;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		report(RPT_INFO, "%s: cannot open %s: %s", __FUNCTION__, name, strerror(errno));
+		return -1;
+	}
+	if ((fstat(fd, &st) < 0) || (st.st_size < (off_t) sizeof(ShmScreen))) {
+		close(fd);
+		return -1;
+	}
+	mem = mmap(NULL, sizeof(ShmScreen), PROT_READ, MAP_SHARED, fd, 0);
+	if (mem == MAP_FAILED) {
+		report(RPT_INFO, "%s: cannot map %s: %s", __FUNCTION__, name, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	/* The object may have been shrunk since the fstat() */
+	if (sigsetjmp(shm_fault, 1) != 0) {
+		shm_reading = NULL;
+		munmap(mem, sizeof(ShmScreen));
+		close(fd);
+		return -1;
+	}
+	shm_reading = (const char *) mem;
+	valid = (mem->magic == SHM_SCREEN_MAGIC) && (mem->version == SHM_SCREEN_VERSION);
+	seq = __atomic_load_n(&mem->seq, __ATOMIC_RELAXED);
+	shm_reading = NULL;
+	if (!valid) {
+		munmap(mem, sizeof(ShmScreen));
+		close(fd);
+		return -1;
+	}
+
+	map = malloc(sizeof(struct ShmScreenMap));
+	if (map == NULL) {
+		munmap(mem, sizeof(ShmScreen));
+		close(fd);
+		return -1;
+	}
+	map->fd = fd;
+	map->mem = mem;
+	/* Apply the current contents on the first update */
+	map->seq = seq + 1;
+	s->shm = map;
+
+	debug(RPT_DEBUG, "%s: screen [%s] attached to %s", __FUNCTION__, s->id, name);
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+
+/** Detach the shared memory object of a screen.
+ * \param s  The screen.
+ */
+void
+shmscreen_detach(Screen *s)
+{
+#ifdef HAVE_SHM_OPEN
+	if (s->shm == NULL)
+		return;
+
+	munmap(s->shm->mem, sizeof(ShmScreen));
+	close(s->shm->fd);
+	free(s->shm);
+	s->shm = NULL;
+#endif
+}
+
+
+/** Apply the values in the shared memory object of a screen to its
+ * widgets. Called by the renderer; does nothing if the screen has no
+ * object or the object did not change since the last call.
+ * \param s  The screen.
+ */
+void
+shmscreen_update(Screen *s)
+{
+#ifdef HAVE_SHM_OPEN
+	struct ShmScreenMap *map = s->shm;
+	uint32_t seq = 0;
+	int copied = 0;
+	int count;
+	int i;
+
+	if (map == NULL)
+		return;
+
+	if (sigsetjmp(shm_fault, 1) != 0) {
+		shm_reading = NULL;
+		report(RPT_INFO, "%s: object of screen [%s] was truncated", __FUNCTION__, s->id);
+		shmscreen_detach(s);
+		return;
+	}
+	shm_reading = (const char *) map->mem;
+	for (i = 0; i < SHM_READ_TRIES; i++) {
+		seq = __atomic_load_n(&map->mem->seq, __ATOMIC_ACQUIRE);
+		if ((seq & 1) || (seq == map->seq))
+			break;
+		memcpy(&map->copy, map->mem, sizeof(ShmScreen));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&map->mem->seq, __ATOMIC_RELAXED) == seq) {
+			copied = 1;
+			break;
+		}
+	}
+	shm_reading = NULL;
+
+	/* unchanged, or the writer is busy; try on the next frame */
+	if (!copied)
+		return;
+	map->seq = seq;
+
+	count = map->copy.count;
+	if (count > SHM_SCREEN_SLOTS)
+		count = SHM_SCREEN_SLOTS;
+
+	for (i = 0; i < count; i++) {
+		ShmWidgetSlot *slot = &map->copy.slots[i];
+		Widget *w;
+
+		slot->id[SHM_SCREEN_IDSIZE - 1] = '\0';
+		slot->value[SHM_SCREEN_VALUESIZE - 1] = '\0';
+		if (slot->id[0] == '\0')
+			continue;
+
+		w = screen_find_widget(s, slot->id);
+		if (w == NULL)
+			continue;
+		widget_stop_animation(w);
+		widget_set_value(w, slot->value);
+	}
+#endif
+}
@@ -0,0 +1,27 @@
+/** \file server/shmscreen.h
+ * Shared-memory fast path for updating the widgets of a screen.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef SHMSCREEN_H
+#define SHMSCREEN_H
+
+#define INC_TYPES_ONLY 1
+#include "screen.h"
+#undef INC_TYPES_ONLY
+
+/* Attach a shared memory object to a screen */
+int shmscreen_attach(Screen *s, const char *name);
+
+/* Detach the shared memory object of a screen, if any */
+void shmscreen_detach(Screen *s);
+
+/* Apply the values in the shared memory object of a screen */
+void shmscreen_update(Screen *s);
+
+#endif
@@ -17,6 +17,20 @@
  *               2009, Markus Dolze - input ring buffer
  */
 
+/*
+ * Network I/O runs in a thread of its own, so a burst of client data does
+ * not delay rendering and a slow display does not delay reading from the
+ * sockets. The I/O thread accepts connections, reads from the sockets and
+ * splits the data into messages. It passes them as events through a
+ * lock-free queue to the main thread, which owns clients, screens and
+ * widgets and runs the commands. When the main thread is done with a
+ * connection it asks the I/O thread through a second queue to close it,
+ * so a socket is only ever closed by the thread polling it.
+ *
+ * Replies are written directly by the main thread. If the thread cannot
+ * be started, sock_poll_clients() runs the I/O work itself.
+ */
+
 #ifdef HAVE_CONFIG_H
 # include "config.h"
 #endif
@@ -35,53 +49,76 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <fcntl.h>
-#include <string.h>
+#include <signal.h>
+#include <pthread.h>
 
 #include "shared/report.h"
 #include "shared/sring.h"
 #include "shared/defines.h"
+#include "shared/binproto.h"
+#include "shared/vector.h"
 
 #include "clients.h"
+#include "ioqueue.h"
+#include "main.h"
 #include "sock.h"
 
 
 /****************************************************************************/
+/* Owned by the I/O thread */
 static fd_set active_fd_set, read_fd_set;
 static int listening_fd;
 
-/* For efficiency we maintain a list of open sockets. Nodes in this list
- * are obtained from a pre-allocated pool - this removes heap operations
- * from the polling loop. A list of open sockets is also required under WINSOCK
- * as sockets can be arbitrary values instead of low value integers. */
-static LinkedList* openSocketList = NULL;
-static LinkedList* freeClientSocketList = NULL;
-
-/* ring buffer for incoming messages */
-static sring_buffer *messageRing;
+/* For efficiency we maintain a vector of open sockets, so the polling
+ * loop only visits the sockets in use. A list of open sockets is also
+ * required under WINSOCK as sockets can be arbitrary values instead of
+ * low value integers. */
+static Vector openSockets;
 
-/** Mapping between socket and associated client */
+/** State of a connection in the I/O thread */
 typedef struct _ClientSocketMap
 {
 	int socket;		/**< Socket for the client */
-	Client *client;		/**< Pointer to client representation */
+	sring_buffer *ring;	/**< Data received but not yet split into messages */
+	int eof;		/**< Peer closed; waiting for the main thread to let go */
 } ClientSocketMap;
 
 
-/* The memory referenced from \c openSocketList and \c freeSocketList
- * is obtained from the freeClientSocketPool array. */
-ClientSocketMap *freeClientSocketPool;
+/* The entries referenced from \c openSockets, indexed by socket - this
+ * removes heap operations and searches from the polling loop. */
+static ClientSocketMap *socketMaps;
+
+/* Number of client connections, including those waiting to be closed */
+static int open_clients = 0;
+
+/* Shared between the threads */
+static IOQueue *to_main;	/* events from the I/O thread */
+static IOQueue *to_io;		/* close requests from the main thread */
+static int wake_pipe[2] = { -1, -1 };	/* wakes the I/O thread up */
+static int pending[FD_SETSIZE];	/* bytes queued per socket but not yet parsed */
+static int io_running = 0;	/* cleared to stop the I/O thread */
+static pthread_t io_thread;
+
+/* Owned by the main thread */
+static Client *socketClients[FD_SETSIZE];
+static int io_started = 0;	/* 1: thread running, -1: no thread */
 
 
 /* Length of longest transmission allowed at once...*/
 #define MAXMSG 8192
 
+/* Room for the messages of one full read: the shortest is 1 byte + newline */
+#define IOQUEUE_SIZE	(4 * MAXMSG)
+
 /**** Internal function declarations ****************************************/
 static int sock_read_from_client(ClientSocketMap *clientSocketMap);
-static void sock_destroy_socket(void);
+static void sock_io_poll(struct timeval *timeout);
+static void sock_request_close(int sock);
 
 
 /** Initialize sockets.
  * Prepare server socket, and initialize socket management structures.
+ * The I/O thread is started by the first sock_poll_clients().
  * \param bind_addr       Hostname / IP address to bind to.
  * \param bind_port       Port to bind to.
  * \retval  <0            error
@@ -90,7 +127,7 @@ static void sock_destroy_socket(void);
 int
 sock_init(char* bind_addr, int bind_port)
 {
-	int i;
+	ClientSocketMap *entry;
 
 	debug(RPT_DEBUG, "%s(bind_addr=\"%s\", port=%d)", __FUNCTION__, bind_addr, bind_port);
 
@@ -105,86 +142,77 @@ sock_init(char* bind_addr, int bind_port)
 	/* Create the socket -> Client mapping pool */
 	/* How large can FD_SETSIZE be? Even if it is ~2000 this only uses a
 	   few kilobytes of memory. Let's trade size for speed! */
-	freeClientSocketPool = (ClientSocketMap *)
-				calloc(FD_SETSIZE, sizeof(ClientSocketMap));
-	if (freeClientSocketPool == NULL) {
+	socketMaps = (ClientSocketMap *) calloc(FD_SETSIZE, sizeof(ClientSocketMap));
+	if ((socketMaps == NULL) || (listening_fd >= FD_SETSIZE)) {
 		report(RPT_ERR, "%s: Error allocating client sockets.",
 			__FUNCTION__);
 		return -1;
 	}
 
-	freeClientSocketList = LL_new();
-	if (freeClientSocketList == NULL) {
-		report(RPT_ERR, "%s: error allocating free socket list.",
-			 __FUNCTION__);
-		return -1;
-	}
-	for (i = 0; i < FD_SETSIZE; ++i) {
-		LL_AddNode(freeClientSocketList, (void*) &freeClientSocketPool[i]);
-	}
-
-	/* Create and initialize the open socket list with the server socket */
-	openSocketList = LL_new();
-	if (openSocketList == NULL) {
+	/* Initialize the open socket list with the server socket */
+	vector_init(&openSockets);
+	entry = &socketMaps[listening_fd];
+	entry->socket = listening_fd;
+	entry->ring = NULL;
+	entry->eof = 0;
+	if (vector_push(&openSockets, (void *) entry) < 0) {
 		report(RPT_ERR, "%s: error allocating open socket list.",
 			 __FUNCTION__);
 		return -1;
 	}
-	else {
-		ClientSocketMap *entry;
-
-		entry = (ClientSocketMap*) LL_Pop(freeClientSocketList);
-		entry->socket = listening_fd;
-		entry->client = NULL;
-		LL_AddNode(openSocketList, (void*) entry);
-	}
 
-	if ((messageRing = sring_create(MAXMSG)) == NULL) {
-		report(RPT_ERR, "%s: error allocating receive buffer.",
+	/* Set up the way between the threads */
+	to_main = ioqueue_create(IOQUEUE_SIZE);
+	to_io = ioqueue_create(FD_SETSIZE);
+	if ((to_main == NULL) || (to_io == NULL) || (pipe(wake_pipe) < 0)) {
+		report(RPT_ERR, "%s: error allocating event queues.",
 			 __FUNCTION__);
 		return -1;
 	}
+	fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
 
 	return 0;
 }
 
 
 /** Cleanup socket management structures.
+ * Stops the I/O thread and closes all connections.
  * \retval  <0    error
  * \retval   0    success
  */
 int
 sock_shutdown(void)
 {
-	int retVal = 0;
+	ClientSocketMap *entry;
+	int i;
 
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
-        /*ClientSocketMap* clientIt;*/
-
-        /* delete all clients */
-        /* This should be done by calling clients_shutdown */
-        /*
-          LL_Rewind(openSocketList);
-          for (clientIt = (ClientSocketMap*) LL_Get(openSocketList);
-          clientIt;
-          clientIt = LL_GetNext(openSocketList))
-          {
-          if (clientIt->client)
-          {
-        */
-        /* destroying a client also closes its socket */
-        /*        client_destroy(clientIt->client);
-                  }
-                  }
-                  LL_Destroy(openSocketList);
-        */
-	close(listening_fd);
-	LL_Destroy(freeClientSocketList);
-	free(freeClientSocketPool);
-	sring_destroy(messageRing);
-
-	return retVal;
+	if (io_started > 0) {
+		__atomic_store_n(&io_running, 0, __ATOMIC_RELEASE);
+		if (write(wake_pipe[1], "", 1) < 0)
+			report(RPT_WARNING, "%s: cannot wake I/O thread", __FUNCTION__);
+		pthread_join(io_thread, NULL);
+		io_started = 0;
+	}
+
+	/* Close the listening socket and all client sockets */
+	for (i = 0; (entry = vector_get(&openSockets, i)) != NULL; i++) {
+		close(entry->socket);
+		sring_destroy(entry->ring);
+	}
+	vector_clear(&openSockets);
+	free(socketMaps);
+
+	ioqueue_destroy(to_main);
+	ioqueue_destroy(to_io);
+	if (wake_pipe[0] >= 0) {
+		close(wake_pipe[0]);
+		close(wake_pipe[1]);
+	}
+
+	return 0;
 }
 
 
@@ -247,100 +275,324 @@ sock_create_inet_socket(char *addr, unsigned int port)
 }
 
 
-/** Service all clients with pending input.
+/** Accept a connection on the listening socket and announce it to the
+ * main thread. Connections are refused if MaxClients or the capacity of
+ * select() is reached. Runs in the I/O thread.
+ */
+static void
+sock_accept_client(void)
+{
+	ClientSocketMap *entry;
+	IOEvent ev;
+	int new_sock;
+	struct sockaddr_in clientname;
+	socklen_t size = sizeof(clientname);
+
+	new_sock = accept(listening_fd, (struct sockaddr *) &clientname, &size);
+	if (new_sock < 0) {
+		report(RPT_ERR, "%s: Accept error - %s",
+			__FUNCTION__, sock_geterror());
+		return;
+	}
+	report(RPT_NOTICE, "Connect from host %s:%hu on socket %i",
+		inet_ntoa(clientname.sin_addr), ntohs(clientname.sin_port), new_sock);
+
+	/* Refuse the connection, but keep serving the clients we have, if
+	 * there is no room for it. The queue always has room for the close
+	 * requests of all connections, so it is never full here. */
+	if (((client_limits.clients > 0) && (open_clients >= client_limits.clients))
+	    || (new_sock >= FD_SETSIZE) || (ioqueue_space(to_main) == 0)) {
+		report(RPT_WARNING, "%s: Too many clients, refusing connection on socket %i",
+			__FUNCTION__, new_sock);
+		sock_send_error(new_sock, "Too many clients\n");
+		close(new_sock);
+		return;
+	}
+
+	entry = &socketMaps[new_sock];
+	entry->ring = sring_create(MAXMSG);
+	if ((entry->ring == NULL) || (vector_push(&openSockets, (void *) entry) < 0)) {
+		report(RPT_ERR, "%s: Error allocating receive buffer", __FUNCTION__);
+		sring_destroy(entry->ring);
+		entry->ring = NULL;
+		close(new_sock);
+		return;
+	}
+	entry->socket = new_sock;
+	entry->eof = 0;
+
+	fcntl(new_sock, F_SETFL, O_NONBLOCK);
+	__atomic_store_n(&pending[new_sock], 0, __ATOMIC_RELAXED);
+
+	ev.type = IOEV_CONNECT;
+	ev.sock = new_sock;
+	ev.message = NULL;
+	ioqueue_put(to_main, &ev);
+
+	/* The new socket was appended to openSockets; it is not in the
+	 * read set of this pass and is checked on the next one */
+	FD_SET(new_sock, &active_fd_set);
+	open_clients++;
+}
+
+
+/** Close the connections the main thread is done with. Runs in the I/O
+ * thread.
+ */
+static void
+sock_close_released(void)
+{
+	IOEvent ev;
+	ClientSocketMap *entry;
+
+	while (ioqueue_get(to_io, &ev) == 0) {
+		entry = &socketMaps[ev.sock];
+		if (vector_remove(&openSockets, entry) < 0)
+			continue;
+
+		FD_CLR(entry->socket, &active_fd_set);
+		close(entry->socket);
+		sring_destroy(entry->ring);
+		entry->ring = NULL;
+		open_clients--;
+	}
+}
+
+
+/** Do one round of network I/O: wait for activity up to the timeout,
+ * then accept new connections and read from all sockets with input.
+ * \param timeout  How long to wait; NULL to wait until there is activity.
+ */
+static void
+sock_io_poll(struct timeval *timeout)
+{
+	ClientSocketMap *entry;
+	struct timeval retry;
+	int maxfd = wake_pipe[0];
+	int i;
+
+	sock_close_released();
+
+	/* Leave the data of clients with a full queue in their sockets until
+	 * the main thread catches up, so fast senders are slowed down by TCP
+	 * instead of growing our memory. */
+	read_fd_set = active_fd_set;
+	for (i = 0; (entry = vector_get(&openSockets, i)) != NULL; i++) {
+		if ((entry->socket != listening_fd)
+		    && (((client_limits.queue > 0)
+			 && (__atomic_load_n(&pending[entry->socket], __ATOMIC_RELAXED) >= client_limits.queue))
+			|| (ioqueue_space(to_main) < MAXMSG))) {
+			FD_CLR(entry->socket, &read_fd_set);
+			/* Look again once the main thread had a chance */
+			if (timeout == NULL) {
+				retry.tv_sec = 0;
+				retry.tv_usec = 1e6 / PROCESS_FREQ;
+				timeout = &retry;
+			}
+		}
+		if (entry->socket > maxfd)
+			maxfd = entry->socket;
+	}
+	FD_SET(wake_pipe[0], &read_fd_set);
+
+	if (select(maxfd + 1, &read_fd_set, NULL, NULL, timeout) < 0) {
+		if (errno != EINTR)
+			report(RPT_ERR, "%s: Select error - %s",
+				__FUNCTION__, sock_geterror());
+		return;
+	}
+
+	if (FD_ISSET(wake_pipe[0], &read_fd_set)) {
+		char buf[64];
+
+		while (read(wake_pipe[0], buf, sizeof(buf)) > 0)
+			;
+	}
+
+	/* Service all the sockets with input pending. New connections are
+	 * appended, so the index stays valid. */
+	for (i = 0; (entry = vector_get(&openSockets, i)) != NULL; i++) {
+		if (!FD_ISSET(entry->socket, &read_fd_set))
+			continue;
+
+		if (entry->socket == listening_fd) {
+			/* Connection request on original socket. */
+			sock_accept_client();
+		}
+		else if (sock_read_from_client(entry) < 0) {
+			/* The peer closed the connection. Stop polling, but
+			 * keep the socket until the main thread is done. */
+			IOEvent ev;
+
+			ev.type = IOEV_DISCONNECT;
+			ev.sock = entry->socket;
+			ev.message = NULL;
+			ioqueue_put(to_main, &ev);
+			FD_CLR(entry->socket, &active_fd_set);
+			entry->eof = 1;
+		}
+	}
+}
+
+
+/** Body of the I/O thread. */
+static void *
+sock_io_thread(void *arg)
+{
+	while (__atomic_load_n(&io_running, __ATOMIC_ACQUIRE))
+		sock_io_poll(NULL);
+
+	return NULL;
+}
+
+
+/** Start the I/O thread. Signals are blocked in it, so they keep being
+ * handled by the main thread.
+ * \retval  0    The thread runs.
+ * \retval -1    The thread could not be started.
+ */
+static int
+sock_start_io_thread(void)
+{
+	sigset_t all, old;
+	int err;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	__atomic_store_n(&io_running, 1, __ATOMIC_RELEASE);
+	err = pthread_create(&io_thread, NULL, sock_io_thread, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (err != 0) {
+		report(RPT_WARNING, "%s: cannot start I/O thread - %s; polling sockets in the main loop",
+			__FUNCTION__, strerror(err));
+		__atomic_store_n(&io_running, 0, __ATOMIC_RELEASE);
+		return -1;
+	}
+	return 0;
+}
+
+
+/** Take over the events of the I/O thread: create clients for new
+ * connections, queue their messages and destroy the clients of closed
+ * connections. Called from the main loop.
+ *
+ * The thread is started on the first call, after daemonizing, reading
+ * the client limits and dropping privileges are done.
  * \retval  <0       error
  * \retval   0       success
  */
 int
 sock_poll_clients(void)
 {
-	struct timeval t;
-	ClientSocketMap* clientSocket;
+	IOEvent ev;
+	Client *c;
 
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	t.tv_sec = 0;
-	t.tv_usec = 0;
+	if (io_started == 0)
+		io_started = (sock_start_io_thread() == 0) ? 1 : -1;
 
-	/* Block until input arrives on one or more active sockets. */
-	read_fd_set = active_fd_set;
+	/* Without a thread do the I/O here, without waiting */
+	if (io_started < 0) {
+		struct timeval t = { 0, 0 };
 
-	if (select(FD_SETSIZE, &read_fd_set, NULL, NULL, &t) < 0) {
-		report(RPT_ERR, "%s: Select error - %s",
-			__FUNCTION__, sock_geterror());
-		return -1;
+		sock_io_poll(&t);
 	}
 
-	/* Service all the sockets with input pending. */
-	LL_Rewind(openSocketList);
-	for (clientSocket = (ClientSocketMap *) LL_Get(openSocketList);
-	     clientSocket != NULL;
-	     clientSocket = LL_GetNext(openSocketList)) {
-
-		if (FD_ISSET(clientSocket->socket, &read_fd_set)) {
-			if (clientSocket->socket == listening_fd) {
-				/* Connection request on original socket. */
-				Client *c;
-				int new_sock;
-				struct sockaddr_in clientname;
-				socklen_t size = sizeof(clientname);
-
-				new_sock = accept(listening_fd, (struct sockaddr *) &clientname, &size);
-				if (new_sock < 0) {
-					report(RPT_ERR, "%s: Accept error - %s",
-						__FUNCTION__, sock_geterror());
-					return -1;
-				}
-				report(RPT_NOTICE, "Connect from host %s:%hu on socket %i",
-					inet_ntoa(clientname.sin_addr), ntohs(clientname.sin_port), new_sock);
-				FD_SET(new_sock, &active_fd_set);
-
-				fcntl(new_sock, F_SETFL, O_NONBLOCK);
-
-				/* Create new client */
-				if ((c = client_create(new_sock)) == NULL) {
-					report(RPT_ERR, "%s: Error creating client on socket %i - %s",
-						__FUNCTION__, clientSocket->socket, sock_geterror());
-					return -1;
-				}
-				else {
-					/* add new_sock */
-					ClientSocketMap *newClientSocket;
-					newClientSocket = (ClientSocketMap *) LL_Pop(freeClientSocketList);
-					if (newClientSocket != NULL) {
-						newClientSocket->socket = new_sock;
-						newClientSocket->client = c;
-						LL_InsertNode(openSocketList, (void *) newClientSocket);
-						/* advance past the new node - check it on the next pass */
-						LL_Next(openSocketList);
-					}
-					else {
-						report(RPT_ERR, "%s: Error - free client socket list exhausted - %d clients.",
-							__FUNCTION__, FD_SETSIZE);
-						return -1;
-					}
-				}
-				if (clients_add_client(c) == NULL) {
-					report(RPT_ERR, "%s: Could not add client on socket %i",
-						 __FUNCTION__, clientSocket->socket);
-					return -1;
-				}
+	while (ioqueue_get(to_main, &ev) == 0) {
+		switch (ev.type) {
+		case IOEV_CONNECT:
+			if ((c = client_create(ev.sock)) == NULL) {
+				report(RPT_ERR, "%s: Error creating client on socket %i",
+					__FUNCTION__, ev.sock);
+				sock_request_close(ev.sock);
+			}
+			else if (clients_add_client(c) == NULL) {
+				report(RPT_ERR, "%s: Could not add client on socket %i",
+					 __FUNCTION__, ev.sock);
+				client_destroy(c);
+				sock_request_close(ev.sock);
 			}
-			else {	/* Data arriving on an already-connected socket. */
-				int err = 0;
-				debug(RPT_DEBUG, "%s: reading...", __FUNCTION__);
-				err = sock_read_from_client(clientSocket);
-				debug(RPT_DEBUG, "%s: ...done", __FUNCTION__);
-				if (err < 0)
-					sock_destroy_socket();
+			else
+				socketClients[ev.sock] = c;
+			break;
+		case IOEV_MESSAGE:
+			/* Messages that arrive after the server let go of the
+			 * client are dropped */
+			c = socketClients[ev.sock];
+			if ((c == NULL) || (client_add_message(c, ev.message) != 0))
+				free(ev.message);
+			break;
+		case IOEV_DISCONNECT:
+			c = socketClients[ev.sock];
+			if (c != NULL) {
+				report(RPT_NOTICE, "Client on socket %i disconnected", ev.sock);
+				client_destroy(c);
+				clients_remove_client(c);
+				socketClients[ev.sock] = NULL;
+				sock_request_close(ev.sock);
 			}
+			break;
+		default:
+			break;
 		}
 	}
 	return 0;
 }
 
 
-/** Read from a client's socket and store the messages in the client for further parsing.
+/** Record that the main thread parsed a message of a client, so the I/O
+ * thread may read more from its socket.
+ * \param client  The client.
+ * \param bytes   Length of the message.
+ */
+void
+sock_message_done(Client *client, int bytes)
+{
+	__atomic_sub_fetch(&pending[client->sock], bytes, __ATOMIC_RELAXED);
+}
+
+
+/** Take the next complete message out of a connection's receive buffer:
+ * a line of the text protocol or a frame of the binary protocol. Runs in
+ * the I/O thread.
+ * \param ring  The connection's receive buffer.
+ * \return      The message, NUL-terminated; NULL if none is complete.
+ */
+static char *
+sock_next_message(sring_buffer *ring)
+{
+	unsigned char head[BIN_HEADER_SIZE];
+	char *frame;
+	int size;
+
+	if ((sring_peek(ring, (char *) head, 1) < 1) || (head[0] != BIN_FRAME_MARK))
+		return sring_read_string(ring);
+
+	if (sring_peek(ring, (char *) head, BIN_HEADER_SIZE) < BIN_HEADER_SIZE)
+		return NULL;
+	size = binproto_get_u16(head + 1);
+	if ((size == 0) || (size > BIN_MAX_PAYLOAD)) {
+		/* There is no way to find the next frame; drop the data */
+		report(RPT_WARNING, "%s: Invalid binary frame", __FUNCTION__);
+		sring_clear(ring);
+		return NULL;
+	}
+	size += BIN_HEADER_SIZE;
+	if (sring_getMaxRead(ring) < size)
+		return NULL;
+
+	if ((frame = malloc(size + 1)) == NULL)
+		return NULL;
+	sring_read(ring, frame, size);
+	frame[size] = '\0';
+	return frame;
+}
+
+
+/** Read from a client's socket and pass the messages to the main thread.
+ * Runs in the I/O thread.
  * \retval  <0       error
  * \retval   0       success
  */
@@ -352,58 +604,70 @@ sock_read_from_client(ClientSocketMap *clientSocketMap)
 
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	errno = 0;
-	nbytes = sock_recv(clientSocketMap->socket, buffer, MAXMSG);
-
-	while (nbytes > 0) {		/* Data available */
-		int fr;
+	/* Stop at a full queue; the rest stays in the socket for later */
+	while ((ioqueue_space(to_main) >= MAXMSG)
+	       && ((client_limits.queue == 0)
+		   || (__atomic_load_n(&pending[clientSocketMap->socket], __ATOMIC_RELAXED) < client_limits.queue))) {
 		char *str;
+		int fr = sring_getMaxWrite(clientSocketMap->ring);
 
-		debug(RPT_DEBUG, "%s: received %4d bytes", __FUNCTION__, nbytes);
-
-		/* Append to ring buffer */
-		sring_write(messageRing, buffer, nbytes);
-
-		/* Process all available message in ring buffer */
-		do {
-			str = sring_read_string(messageRing);
-			if (clientSocketMap->client) {
-				client_add_message(clientSocketMap->client, str);
-			} else {
-				report(RPT_DEBUG, "%s: Can't find client %d",
-					__FUNCTION__, clientSocketMap->socket);
-			}
-		} while (str != NULL);
-
-		/* Read again, but only as much as space is left */
-		fr = sring_getMaxWrite(messageRing);
-		if (fr == 0)
+		if (fr == 0) {
+			/* A message longer than the buffer; drop it */
 			report(RPT_WARNING, "%s: Message buffer full", __FUNCTION__);
+			sring_clear(clientSocketMap->ring);
+			fr = sring_getMaxWrite(clientSocketMap->ring);
+		}
 
+		errno = 0;
 		nbytes = sock_recv(clientSocketMap->socket, buffer, min(MAXMSG, fr));
-	}
+		if (nbytes <= 0) {
+			if (nbytes < 0 && errno == EAGAIN)
+				return 0;	/* No data is not an error */
+			return -1;		/* EOF */
+		}
 
-	if (sring_getMaxRead(messageRing) > 0) {
-		report(RPT_WARNING, "%s: left over bytes in message buffer",
-			__FUNCTION__);
-		sring_clear(messageRing);
-	}
+		debug(RPT_DEBUG, "%s: received %4d bytes", __FUNCTION__, nbytes);
 
-	if (nbytes < 0 && errno == EAGAIN)
-		return 0;		/* No data is not an error */
+		/* Append to the connection's ring buffer and pass all complete
+		 * messages on; an incomplete one waits for the next read */
+		sring_write(clientSocketMap->ring, buffer, nbytes);
+		while ((str = sock_next_message(clientSocketMap->ring)) != NULL) {
+			IOEvent ev;
 
-	return -1;			/* EOF */
+			if (str[0] == '\0') {
+				free(str);
+				continue;
+			}
+			ev.type = IOEV_MESSAGE;
+			ev.sock = clientSocketMap->socket;
+			ev.message = str;
+			__atomic_add_fetch(&pending[ev.sock], binproto_message_size(str), __ATOMIC_RELAXED);
+			ioqueue_put(to_main, &ev);
+		}
+	}
+	return 0;
 }
 
 
-/* comparison function to find a ClientsocketMap entry by client */
-int byClient(void *csm, void *client)
+/** Ask the I/O thread to close a socket. Runs in the main thread.
+ * \param sock  The socket.
+ */
+static void
+sock_request_close(int sock)
 {
-	return (((ClientSocketMap *) csm)->client == (Client *) client) ? 0 : -1;
+	IOEvent ev;
+
+	ev.type = IOEV_CLOSE;
+	ev.sock = sock;
+	ev.message = NULL;
+	ioqueue_put(to_io, &ev);
+	if (write(wake_pipe[1], "", 1) < 0 && errno != EAGAIN)
+		report(RPT_WARNING, "%s: cannot wake I/O thread", __FUNCTION__);
 }
 
 
-/** Close an open socket for a given client.
+/** Let go of the connection of a client that is gone: destroy the client
+ * and have the I/O thread close the socket. Runs in the main thread.
  * \param client  Client whose socket shall be closed.
  * \retval <0     error
  * \retval  0     success.
@@ -411,45 +675,43 @@ int byClient(void *csm, void *client)
 int
 sock_destroy_client_socket(Client *client)
 {
-	ClientSocketMap *entry;
+	int sock = client->sock;
 
-	LL_Rewind(openSocketList);
-	entry = LL_Find(openSocketList, byClient, client);
+	if (socketClients[sock] != client)
+		return -1;
 
-	if (entry != NULL) {
-		sock_destroy_socket();
-		return 0;
-	}
-	return -1;
+	report(RPT_NOTICE, "Client on socket %i disconnected", sock);
+	client_destroy(client);
+	clients_remove_client(client);
+	socketClients[sock] = NULL;
+	sock_request_close(sock);
+	return 0;
 }
 
 
-/** Close the socket the openSocketList's \c current pointer points to.
+/** Check whether a client is connected from this host.
+ * \param client  The client.
+ * \retval 1      The peer has a loopback address.
+ * \retval 0      The peer is remote or its address is unknown.
  */
-static void
-sock_destroy_socket(void)
+int
+sock_client_is_local(Client *client)
 {
-	ClientSocketMap *entry = LL_Get(openSocketList);
-
-	if (entry != NULL) {
-		if (entry->client != NULL) {
-			report(RPT_NOTICE, "Client on socket %i disconnected",
-				entry->socket);
-			client_destroy(entry->client);
-			clients_remove_client(entry->client, PREV);
-			entry->client = NULL;
-		}
-		else {
-			report(RPT_ERR, "%s: Can't find client of socket %i",
-				__FUNCTION__, entry->socket);
-		}
-		/* close socket and remove it from select()'s mask of active sockets */
-		FD_CLR(entry->socket, &active_fd_set);
-		close(entry->socket);
+	struct sockaddr_storage addr;
+	socklen_t len = sizeof(addr);
+
+	if (getpeername(client->sock, (struct sockaddr *) &addr, &len) < 0)
+		return 0;
 
-		/* re-add socket to the free socket pool */
-		entry = (ClientSocketMap *) LL_DeleteNode(openSocketList, PREV);
-		LL_Push(freeClientSocketList, (void*) entry);
+	switch (addr.ss_family) {
+	case AF_UNIX:
+		return 1;
+	case AF_INET:
+		return ((ntohl(((struct sockaddr_in *) &addr)->sin_addr.s_addr) >> 24) == 127);
+	case AF_INET6:
+		return IN6_IS_ADDR_LOOPBACK(&((struct sockaddr_in6 *) &addr)->sin6_addr);
+	default:
+		return 0;
 	}
 }
 
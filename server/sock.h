@@ -26,6 +26,8 @@ int sock_shutdown(void);
 int sock_create_inet_socket(char* bind_addr, unsigned int port);
 int sock_poll_clients(void);
 int sock_destroy_client_socket(Client *client);
+void sock_message_done(Client *client, int bytes);
+int sock_client_is_local(Client *client);
 int verify_ipv4(const char *addr);
 int verify_ipv6(const char *addr);
 
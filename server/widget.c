@@ -19,13 +19,16 @@
 #include <stdio.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
 
 #include "shared/sockets.h"
 #include "shared/report.h"
 
+#include "client.h"
 #include "screen.h"
 #include "widget.h"
 #include "render.h"
+#include "pool.h"
 #include "drivers/lcd.h"
 
 char *typenames[] = {
@@ -39,6 +42,7 @@ char *typenames[] = {
 	"scroller",	/* WID_SCROLLER */
 	"frame",	/* WID_FRAME */
 	"num",		/* WID_NUM */
+	"graph",	/* WID_GRAPH */
 	NULL,		/* WID_NONE */
 };
 
@@ -82,13 +86,23 @@ Widget *
 widget_create(char *id, WidgetType type, Screen *screen)
 {
 	Widget *w;
+	Pool *pool = screen_pool(screen);
 
 	debug(RPT_DEBUG, "%s(id=\"%s\", type=%d, screen=[%s])", __FUNCTION__, id, type, screen->id);
 
 	/* Create it */
-	w = calloc(1, sizeof(Widget));
+	w = pool_calloc(pool, sizeof(Widget));
+	if (w == NULL) {
+		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+		return NULL;
+	}
 
-	w->id = strdup(id);
+	w->id = pool_strdup(pool, id);
+	if (w->id == NULL) {
+		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+		pool_free(pool, w);
+		return NULL;
+	}
 	w->type = type;
 	w->screen = screen;
 	w->x = 1;
@@ -97,6 +111,10 @@ widget_create(char *id, WidgetType type, Screen *screen)
 	w->top = 1;
 	w->length = 1;
 	w->speed = 1;
+	w->scroll.group = -1;
+
+	if (screen->client != NULL)
+		screen->client->widgetcount++;
 
 	if (type == WID_FRAME) {
 		/* create a screen for the frame widget */
@@ -106,6 +124,8 @@ widget_create(char *id, WidgetType type, Screen *screen)
 		strcat(frame_name, id);
 
 		w->frame_screen = screen_create(frame_name, screen->client);
+		if (w->frame_screen != NULL)
+			w->frame_screen->parent = w;
 	}
 	return w;
 }
@@ -117,19 +137,92 @@ widget_create(char *id, WidgetType type, Screen *screen)
 void
 widget_destroy(Widget *w)
 {
-	debug(RPT_DEBUG, "%s(w=[%s])", __FUNCTION__, w->id);
+	Pool *pool;
 
 	if (!w)
 		return;
 
-	free(w->id);
-	free(w->text);
+	debug(RPT_DEBUG, "%s(w=[%s])", __FUNCTION__, w->id);
+
+	widget_stop_animation(w);
+	widget_resize_history(w, 0);
+
+	if (w->screen->client != NULL) {
+		w->screen->client->widgetcount--;
+		client_drop_handle(w->screen->client, w->handle);
+	}
+
+	pool = screen_pool(w->screen);
+	pool_free(pool, w->id);
+	pool_free(pool, w->text);
+	pool_free(pool, w->begin_label);
+	pool_free(pool, w->end_label);
 
 	/* Free subscreen of frame widget too */
 	if (w->type == WID_FRAME)
 		screen_destroy(w->frame_screen);
 
-	free(w);
+	pool_free(pool, w);
+}
+
+
+/** Record that the contents of a widget changed.
+ * Increments the generation of the widget and of its screen, so code
+ * that remembers them can tell a static screen from a changed one. The
+ * screens of enclosing frames count as changed too.
+ * \param w    Widget that changed.
+ */
+void
+widget_touch(Widget *w)
+{
+	w->generation++;
+	screen_touch(w->screen);
+}
+
+
+/** Set one of the string fields of a widget.
+ * Nothing is done if the field already holds \c value. Otherwise the
+ * buffer held by the field is reused when the new value fits, or replaced
+ * by one from the pool of the widget's client. The generation of the
+ * widget is not changed; callers use widget_touch() for that.
+ * \param w      Widget the field belongs to.
+ * \param field  Address of the field, e.g. \c &w->text.
+ * \param value  New value; NULL clears the field.
+ * \retval <0    Error allocating memory; the field is unchanged.
+ * \retval  0    The field already had this value.
+ * \retval  1    The field was changed.
+ */
+int
+widget_set_string(Widget *w, char **field, const char *value)
+{
+	Pool *pool = screen_pool(w->screen);
+	char *buf;
+	size_t len;
+
+	if (value == NULL) {
+		if (*field == NULL)
+			return 0;
+		pool_free(pool, *field);
+		*field = NULL;
+		return 1;
+	}
+
+	if ((*field != NULL) && (strcmp(*field, value) == 0))
+		return 0;
+
+	len = strlen(value) + 1;
+	if ((*field != NULL) && (len <= pool_capacity(pool, *field))) {
+		memcpy(*field, value, len);
+		return 1;
+	}
+
+	buf = pool_alloc(pool, len);
+	if (buf == NULL)
+		return -1;
+	memcpy(buf, value, len);
+	pool_free(pool, *field);
+	*field = buf;
+	return 1;
 }
 
 
@@ -212,3 +305,401 @@ int widget_iconname_to_icon(char *iconname)
 	return -1;
 }
 
+
+
+/** Check whether a widget can take a value of a sequence.
+ * \param w      Widget to check for.
+ * \param value  Value as sent by the client.
+ * \retval 0     The value is valid for the widget's type.
+ * \retval -1    The value is invalid.
+ */
+static int
+widget_check_value(Widget *w, const char *value)
+{
+	char *end;
+
+	switch (w->type) {
+	case WID_STRING:
+	case WID_TITLE:
+	case WID_SCROLLER:
+		return 0;
+	case WID_HBAR:
+	case WID_VBAR:
+	case WID_PBAR:
+	case WID_NUM:
+		strtol(value, &end, 10);
+		return ((end != value) && (*end == '\0')) ? 0 : -1;
+	case WID_ICON:
+		return (widget_iconname_to_icon((char *) value) != -1) ? 0 : -1;
+	default:
+		return -1;
+	}
+}
+
+
+/** Find the field holding the numeric value of a widget.
+ * \param w  The widget.
+ * \return   The field; NULL if the widget's type has no numeric value.
+ */
+static int *
+widget_number_field(Widget *w)
+{
+	switch (w->type) {
+	case WID_HBAR:
+	case WID_VBAR:
+	case WID_ICON:
+		return &w->length;
+	case WID_PBAR:
+		return &w->promille;
+	case WID_NUM:
+		return &w->y;
+	default:
+		return NULL;
+	}
+}
+
+
+/** Show one value of a sequence in a widget.
+ * \param w      Widget to change.
+ * \param value  Value, already checked by widget_check_value().
+ * \return       Non-zero if the widget changed.
+ */
+static int
+widget_apply_value(Widget *w, const char *value)
+{
+	int *field;
+	int v;
+
+	switch (w->type) {
+	case WID_STRING:
+	case WID_TITLE:
+	case WID_SCROLLER:
+		return (widget_set_string(w, &w->text, value) > 0);
+	case WID_ICON:
+		v = widget_iconname_to_icon((char *) value);
+		break;
+	default:
+		v = atoi(value);
+		break;
+	}
+	field = widget_number_field(w);
+	if ((field == NULL) || (*field == v))
+		return 0;
+	*field = v;
+	return 1;
+}
+
+
+/** Set the numeric value of a widget: the length of an hbar or vbar, the
+ * promille of a pbar, the digit of a num or the icon of an icon widget.
+ * \param w      Widget to change.
+ * \param value  The value.
+ * \retval 0     Success.
+ * \retval -1    The widget has no numeric value or the icon is unknown.
+ */
+int
+widget_set_number(Widget *w, int value)
+{
+	int *field = widget_number_field(w);
+
+	if (field == NULL)
+		return -1;
+	if ((w->type == WID_ICON) && (widget_icon_to_iconname(value) == NULL))
+		return -1;
+	if (*field != value) {
+		*field = value;
+		widget_touch(w);
+	}
+	return 0;
+}
+
+
+/** Set a widget to a value given as text. The value has the same meaning
+ * as a step of a sequence; it is used by the shared-memory interface.
+ * \param w      Widget to change.
+ * \param value  The value.
+ * \retval 0     Success.
+ * \retval -1    The value is invalid for the widget's type.
+ */
+int
+widget_set_value(Widget *w, const char *value)
+{
+	if (widget_check_value(w, value) < 0)
+		return -1;
+	if (widget_apply_value(w, value))
+		widget_touch(w);
+	return 0;
+}
+
+
+/** Format the text of a widget from its strftime() template.
+ * \param w    Widget with a format animation.
+ * \param now  Time to format.
+ * \return     Non-zero if the text changed.
+ */
+static int
+widget_format_text(Widget *w, time_t now)
+{
+	char buf[256];
+	struct tm tm;
+
+	localtime_r(&now, &tm);
+	if (strftime(buf, sizeof(buf), w->anim->format, &tm) == 0)
+		buf[0] = '\0';
+	w->anim->shown = now;
+
+	return (widget_set_string(w, &w->text, buf) > 0);
+}
+
+
+/** Create an empty animation for a widget, replacing any previous one.
+ * \param w    Widget to animate.
+ * \return     The animation; NULL on error.
+ */
+static WidgetAnim *
+widget_new_animation(Widget *w)
+{
+	WidgetAnim *a;
+
+	widget_stop_animation(w);
+
+	a = pool_calloc(screen_pool(w->screen), sizeof(WidgetAnim));
+	if (a != NULL)
+		a->start = -1;
+	return a;
+}
+
+
+/** Let the server format the text of a widget from a strftime() template.
+ * The text is updated by the renderer whenever the formatted time changes.
+ * \param w       String, title or scroller widget.
+ * \param format  strftime() template, e.g. "%H:%M:%S".
+ * \retval  0     Success.
+ * \retval -1     Wrong widget type or error allocating memory.
+ */
+int
+widget_set_format(Widget *w, const char *format)
+{
+	WidgetAnim *a;
+
+	if ((w->type != WID_STRING) && (w->type != WID_TITLE) && (w->type != WID_SCROLLER))
+		return -1;
+
+	a = widget_new_animation(w);
+	if (a == NULL)
+		return -1;
+	a->format = pool_strdup(screen_pool(w->screen), format);
+	if (a->format == NULL) {
+		pool_free(screen_pool(w->screen), a);
+		return -1;
+	}
+	w->anim = a;
+
+	if (widget_format_text(w, time(NULL)))
+		widget_touch(w);
+	return 0;
+}
+
+
+/** Let the server step a widget through a sequence of values.
+ * The values are interpreted like the value parameter of widget_set for
+ * the widget's type: the text of string, title and scroller widgets, the
+ * length of bars, the promille of pbars, the digit of num widgets and the
+ * icon name of icon widgets. The sequence repeats endlessly.
+ * \param w         Widget to animate.
+ * \param interval  Number of rendering ticks each value is shown.
+ * \param count     Number of values.
+ * \param values    The values.
+ * \retval  0       Success.
+ * \retval -1       Invalid value or error allocating memory.
+ */
+int
+widget_set_sequence(Widget *w, int interval, int count, char **values)
+{
+	Pool *pool = screen_pool(w->screen);
+	WidgetAnim *a;
+	int i;
+
+	if ((interval <= 0) || (count <= 0))
+		return -1;
+	for (i = 0; i < count; i++) {
+		if (widget_check_value(w, values[i]) < 0)
+			return -1;
+	}
+
+	a = widget_new_animation(w);
+	if (a == NULL)
+		return -1;
+	a->values = pool_calloc(pool, count * sizeof(char *));
+	if (a->values == NULL) {
+		pool_free(pool, a);
+		return -1;
+	}
+	w->anim = a;
+	a->interval = interval;
+	for (a->count = 0; a->count < count; a->count++) {
+		a->values[a->count] = pool_strdup(pool, values[a->count]);
+		if (a->values[a->count] == NULL) {
+			widget_stop_animation(w);
+			return -1;
+		}
+	}
+
+	if (widget_apply_value(w, a->values[0]))
+		widget_touch(w);
+	return 0;
+}
+
+
+/** Stop the animation of a widget. The widget keeps showing the current
+ * value.
+ * \param w    Widget to stop.
+ */
+void
+widget_stop_animation(Widget *w)
+{
+	Pool *pool = screen_pool(w->screen);
+	WidgetAnim *a = w->anim;
+	int i;
+
+	if (a == NULL)
+		return;
+
+	pool_free(pool, a->format);
+	if (a->values != NULL) {
+		for (i = 0; i < a->count; i++)
+			pool_free(pool, a->values[i]);
+		pool_free(pool, a->values);
+	}
+	pool_free(pool, a);
+	w->anim = NULL;
+}
+
+
+/** Advance the animation of a widget. Called by the renderer for every
+ * animated widget it draws.
+ * \param w      Widget with an animation.
+ * \param timer  Current rendering tick.
+ */
+void
+widget_animate(Widget *w, long timer)
+{
+	WidgetAnim *a = w->anim;
+	int changed = 0;
+
+	if (a->format != NULL) {
+		time_t now = time(NULL);
+
+		if (now != a->shown)
+			changed = widget_format_text(w, now);
+	}
+	else {
+		int pos;
+
+		if (a->start < 0)
+			a->start = timer;
+		pos = ((timer - a->start) / a->interval) % a->count;
+		if (pos != a->pos) {
+			a->pos = pos;
+			changed = widget_apply_value(w, a->values[pos]);
+		}
+	}
+
+	if (changed)
+		widget_touch(w);
+}
+
+
+/** Resize the sample history of a graph widget. The newest samples that
+ * fit are kept.
+ * \param w     Graph widget.
+ * \param size  Number of samples to keep, normally the graph's width;
+ *              0 frees the history.
+ * \retval  0   Success.
+ * \retval -1   Error allocating memory; the history is unchanged.
+ */
+int
+widget_resize_history(Widget *w, int size)
+{
+	Pool *pool = screen_pool(w->screen);
+	WidgetHistory *h = w->history;
+	int *samples;
+	int count, i;
+
+	if ((h != NULL) && (h->size == size))
+		return 0;
+
+	if (size <= 0) {
+		if (h != NULL) {
+			pool_free(pool, h->samples);
+			pool_free(pool, h);
+			w->history = NULL;
+		}
+		return 0;
+	}
+
+	samples = pool_alloc(pool, size * sizeof(int));
+	if (samples == NULL)
+		return -1;
+
+	if (h == NULL) {
+		h = pool_calloc(pool, sizeof(WidgetHistory));
+		if (h == NULL) {
+			pool_free(pool, samples);
+			return -1;
+		}
+		w->history = h;
+	}
+
+	/* Copy the newest samples, oldest first */
+	count = (h->count < size) ? h->count : size;
+	for (i = 0; i < count; i++)
+		samples[i] = widget_get_sample(w, count - 1 - i);
+
+	pool_free(pool, h->samples);
+	h->samples = samples;
+	h->size = size;
+	h->count = count;
+	h->head = count % size;
+	return 0;
+}
+
+
+/** Append a sample to the history of a graph widget, dropping the oldest
+ * one if the history is full.
+ * \param w      Graph widget with a history.
+ * \param value  Sample in promille of the graph's height; clamped to 0..1000.
+ * \retval  0    Success.
+ * \retval -1    The widget has no history.
+ */
+int
+widget_push_sample(Widget *w, int value)
+{
+	WidgetHistory *h = w->history;
+
+	if (h == NULL)
+		return -1;
+
+	h->samples[h->head] = (value < 0) ? 0 : ((value > 1000) ? 1000 : value);
+	h->head = (h->head + 1) % h->size;
+	if (h->count < h->size)
+		h->count++;
+	return 0;
+}
+
+
+/** Get a sample from the history of a graph widget.
+ * \param w    Graph widget.
+ * \param age  0 for the newest sample, 1 for the one before, ...
+ * \return     The sample; -1 if there is no such sample.
+ */
+int
+widget_get_sample(Widget *w, int age)
+{
+	WidgetHistory *h = w->history;
+
+	if ((h == NULL) || (age < 0) || (age >= h->count))
+		return -1;
+
+	return h->samples[(h->head - 1 - age + h->size) % h->size];
+}
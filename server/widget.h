@@ -13,6 +13,8 @@
 #ifndef WIDGET_H
 #define WIDGET_H
 
+#include <time.h>
+
 #define INC_TYPES_ONLY 1
 #include "screen.h"
 #undef INC_TYPES_ONLY
@@ -28,10 +30,41 @@ typedef enum WidgetType {
 	WID_TITLE,
 	WID_SCROLLER,
 	WID_FRAME,
-	WID_NUM
+	WID_NUM,
+	WID_GRAPH
 } WidgetType;
 
 
+/** Server-side animation of a widget */
+typedef struct WidgetAnim {
+	char *format;			/**< strftime() template for the text; or NULL */
+	time_t shown;			/**< time the text was last formatted for */
+	char **values;			/**< values to step through; or NULL */
+	int count;			/**< number of values */
+	int interval;			/**< ticks each value is shown */
+	long start;			/**< tick the first value was shown; -1 if not yet */
+	int pos;			/**< index of the value shown */
+} WidgetAnim;
+
+
+/** Sample history of a graph widget */
+typedef struct WidgetHistory {
+	int *samples;			/**< ring buffer of samples in promille */
+	int size;			/**< capacity; the graph's width */
+	int count;			/**< number of samples stored */
+	int head;			/**< index the next sample is stored at */
+} WidgetHistory;
+
+
+/** Timing of a scroller, kept by the scroll scheduler of its screen */
+typedef struct WidgetScroll {
+	int group;			/**< index of the scroller's group; -1 if none */
+	int steps;			/**< steps the text moves through; 0 if it fits */
+	int offset;			/**< offset at the last update */
+	long next;			/**< tick the offset changes next */
+} WidgetScroll;
+
+
 /** Widget structure */
 typedef struct Widget {
 	char *id;			/**< the widget's name */
@@ -47,6 +80,11 @@ typedef struct Widget {
 	char *begin_label;		/**< label in front of pbars; or NULL */
 	char *end_label;		/**< label at end of pbars; or NULL */
 	struct Screen *frame_screen;	/**< frame widget get an associated screen */
+	unsigned int generation;	/**< incremented whenever the contents change */
+	WidgetAnim *anim;		/**< animation run by the server; or NULL */
+	WidgetHistory *history;		/**< samples of a graph; or NULL */
+	int handle;			/**< binary protocol handle; 0 if none */
+	WidgetScroll scroll;		/**< scroller timing */
 	//LinkedList *kids;		/* Frames can contain more widgets...*/
 } Widget;
 
@@ -58,6 +96,39 @@ Widget *widget_create(char *id, WidgetType type, Screen *screen);
 /* Destroy a widget */
 void widget_destroy(Widget *w);
 
+/* Record that the widget's contents changed */
+void widget_touch(Widget *w);
+
+/* Set a string field of a widget, reusing its buffer where possible */
+int widget_set_string(Widget *w, char **field, const char *value);
+
+/* Let the server format the widget's text from a strftime() template */
+int widget_set_format(Widget *w, const char *format);
+
+/* Let the server step the widget through a sequence of values */
+int widget_set_sequence(Widget *w, int interval, int count, char **values);
+
+/* Set a widget to a value given as text */
+int widget_set_value(Widget *w, const char *value);
+
+/* Set the numeric value of a widget */
+int widget_set_number(Widget *w, int value);
+
+/* Stop the widget's animation */
+void widget_stop_animation(Widget *w);
+
+/* Advance the widget's animation; called by the renderer */
+void widget_animate(Widget *w, long timer);
+
+/* Resize the sample history of a graph widget */
+int widget_resize_history(Widget *w, int size);
+
+/* Append a sample to the history of a graph widget */
+int widget_push_sample(Widget *w, int value);
+
+/* Get a sample from the history of a graph widget */
+int widget_get_sample(Widget *w, int age);
+
 /* Convert a widget typename to a widget type */
 WidgetType widget_typename_to_type(char *typename);
 
@@ -0,0 +1,99 @@
+/** \file shared/binproto.h
+ * Framing of the binary protocol variant for high-rate clients.
+ *
+ * A client that said "hello -binary" may send binary frames between the
+ * lines of the text protocol. A frame starts with BIN_FRAME_MARK, a byte
+ * that never starts a text command, followed by the length of the payload
+ * as a 16 bit big-endian number and the payload itself. The first byte of
+ * the payload is the operation, the next two the handle of the widget that
+ * "widget_add" returned in binary mode. All numbers are big-endian.
+ *
+ * \verbatim
+ * BIN_OP_VALUE  handle:u16 value:s32       bar length, promille, digit, icon
+ * BIN_OP_TEXT   handle:u16 text:bytes      text of string, title, scroller
+ * BIN_OP_MOVE   handle:u16 x:s16 y:s16     position of the widget
+ * BIN_OP_PUSH   handle:u16 {sample:s16}... samples of a graph
+ * \endverbatim
+ *
+ * Successful operations are not answered; errors are reported with the
+ * usual "huh?" line.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef BINPROTO_LAYOUT_H
+#define BINPROTO_LAYOUT_H
+
+#include <string.h>
+
+#define BIN_PROTOCOL_VERSION	1	/**< Announced in the reply to "hello -binary" */
+#define BIN_FRAME_MARK		0xFF	/**< First byte of a frame */
+#define BIN_HEADER_SIZE		3	/**< Mark and payload length */
+#define BIN_MAX_PAYLOAD		1024	/**< Longest payload accepted */
+
+/** Operations */
+#define BIN_OP_VALUE		0x01
+#define BIN_OP_TEXT		0x02
+#define BIN_OP_MOVE		0x03
+#define BIN_OP_PUSH		0x04
+
+/** Read a 16 bit number. */
+static inline unsigned int
+binproto_get_u16(const unsigned char *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+/** Read a signed 16 bit number. */
+static inline int
+binproto_get_s16(const unsigned char *p)
+{
+	return (short) binproto_get_u16(p);
+}
+
+/** Read a signed 32 bit number. */
+static inline int
+binproto_get_s32(const unsigned char *p)
+{
+	return (int) (((unsigned int) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+
+/** Write a 16 bit number. */
+static inline void
+binproto_put_u16(unsigned char *p, unsigned int v)
+{
+	p[0] = (v >> 8) & 0xFF;
+	p[1] = v & 0xFF;
+}
+
+/** Write a 32 bit number. */
+static inline void
+binproto_put_s32(unsigned char *p, int v)
+{
+	p[0] = ((unsigned int) v >> 24) & 0xFF;
+	p[1] = (v >> 16) & 0xFF;
+	p[2] = (v >> 8) & 0xFF;
+	p[3] = v & 0xFF;
+}
+
+/** Check whether a message is a binary frame. */
+static inline int
+binproto_is_frame(const char *msg)
+{
+	return ((unsigned char) msg[0] == BIN_FRAME_MARK);
+}
+
+/** Length of a message as received: a text line or a whole frame. */
+static inline int
+binproto_message_size(const char *msg)
+{
+	if (binproto_is_frame(msg))
+		return BIN_HEADER_SIZE + binproto_get_u16((const unsigned char *) msg + 1);
+	return strlen(msg);
+}
+
+#endif
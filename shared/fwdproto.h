@@ -0,0 +1,47 @@
+/** \file shared/fwdproto.h
+ * Wire format of frame forwarding between LCDd instances.
+ *
+ * The \c forward driver of one LCDd streams what it renders to other LCDd
+ * instances that have a ReceivePort configured. The stream is a sequence
+ * of messages over TCP, each made of a type byte, the length of the
+ * payload as a 16 bit big-endian number and the payload itself:
+ *
+ * \verbatim
+ * FWD_MSG_HELLO      version:u8 width:u8 height:u8 cellwidth:u8 cellheight:u8
+ * FWD_MSG_TEXT       offset:u16 {char:u8}...  cells from offset = y * width + x
+ * FWD_MSG_CHAR       index:u8 {row:u8}...     custom character, top row first
+ * FWD_MSG_BACKLIGHT  state:u8
+ * FWD_MSG_OUTPUT     state:s32
+ * FWD_MSG_FRAME                               show what was sent so far
+ * \endverbatim
+ *
+ * A sender starts with HELLO and the complete state, then only sends
+ * what changed. Characters below FWD_NUM_CHARS in TEXT are custom
+ * characters. Nothing is sent back.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef FWDPROTO_H
+#define FWDPROTO_H
+
+#define FWD_PROTOCOL_VERSION	1
+#define FWD_DEFAULT_PORT	13667	/**< One above the client port */
+#define FWD_HEADER_SIZE		3	/**< Type and payload length */
+#define FWD_MAX_PAYLOAD		1024	/**< Longest payload accepted */
+#define FWD_NUM_CHARS		8	/**< Number of custom characters */
+#define FWD_CELLHEIGHT		8	/**< Rows of a custom character */
+
+/** Message types */
+#define FWD_MSG_HELLO		0x01
+#define FWD_MSG_TEXT		0x02
+#define FWD_MSG_CHAR		0x03
+#define FWD_MSG_BACKLIGHT	0x04
+#define FWD_MSG_OUTPUT		0x05
+#define FWD_MSG_FRAME		0x06
+
+#endif
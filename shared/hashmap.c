@@ -0,0 +1,186 @@
+/** \file shared/hashmap.c
+ * Hash maps from strings to pointers.
+ *
+ * Collisions are resolved by linear probing. The table is kept at most
+ * half full, so a lookup usually needs one or two probes. Removal moves
+ * the following entries of the probe sequence back instead of leaving
+ * tombstones, so the table never degrades.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashmap.h"
+
+/** Number of slots allocated on the first insertion */
+#define HASHMAP_MIN_SIZE	16
+
+
+/** FNV-1a hash of a string. */
+static unsigned int
+hashmap_hash(const char *key)
+{
+	unsigned int h = 2166136261u;
+
+	while (*key != '\0') {
+		h ^= (unsigned char) *key++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/** Find the slot of a key, or the free slot where it would go. */
+static HashMapEntry *
+hashmap_slot(const HashMap *m, const char *key, unsigned int hash)
+{
+	unsigned int i = hash & (m->size - 1);
+
+	while (m->slots[i].key != NULL) {
+		if ((m->slots[i].hash == hash) && (strcmp(m->slots[i].key, key) == 0))
+			break;
+		i = (i + 1) & (m->size - 1);
+	}
+	return &m->slots[i];
+}
+
+/** Move all entries into a table of a new size. */
+static int
+hashmap_resize(HashMap *m, unsigned int size)
+{
+	HashMapEntry *old = m->slots;
+	unsigned int oldsize = m->size;
+	unsigned int i;
+
+	m->slots = calloc(size, sizeof(HashMapEntry));
+	if (m->slots == NULL) {
+		m->slots = old;
+		return -1;
+	}
+	m->size = size;
+
+	for (i = 0; i < oldsize; i++) {
+		if (old[i].key != NULL)
+			*hashmap_slot(m, old[i].key, old[i].hash) = old[i];
+	}
+	free(old);
+	return 0;
+}
+
+
+/**
+ * Initialize an empty map. No memory is allocated until a key is added.
+ *
+ * \param m  Map to initialize
+ */
+void
+hashmap_init(HashMap *m)
+{
+	m->slots = NULL;
+	m->size = 0;
+	m->count = 0;
+}
+
+/**
+ * Remove all keys and free the map's memory. Keys and values are not
+ * freed.
+ *
+ * \param m  Map to clear
+ */
+void
+hashmap_clear(HashMap *m)
+{
+	free(m->slots);
+	hashmap_init(m);
+}
+
+/**
+ * Add a key or replace its value.
+ *
+ * \param m      Map to add to
+ * \param key    The key; must stay valid while it is in the map
+ * \param value  The value
+ * \retval 0     Success
+ * \retval -1    Out of memory
+ */
+int
+hashmap_put(HashMap *m, const char *key, void *value)
+{
+	unsigned int hash = hashmap_hash(key);
+	HashMapEntry *e;
+
+	if (2 * (m->count + 1) > m->size) {
+		if (hashmap_resize(m, (m->size > 0) ? 2 * m->size : HASHMAP_MIN_SIZE) < 0)
+			return -1;
+	}
+
+	e = hashmap_slot(m, key, hash);
+	if (e->key == NULL)
+		m->count++;
+	e->key = key;
+	e->value = value;
+	e->hash = hash;
+	return 0;
+}
+
+/**
+ * Look up a key.
+ *
+ * \param m    Map to search
+ * \param key  The key
+ * \return     The value; NULL if the key is not in the map
+ */
+void *
+hashmap_get(const HashMap *m, const char *key)
+{
+	if (m->count == 0)
+		return NULL;
+	return hashmap_slot(m, key, hashmap_hash(key))->value;
+}
+
+/**
+ * Remove a key.
+ *
+ * \param m    Map to remove from
+ * \param key  The key
+ * \return     The value the key had; NULL if it was not in the map
+ */
+void *
+hashmap_remove(HashMap *m, const char *key)
+{
+	HashMapEntry *e;
+	unsigned int i, j;
+	void *value;
+
+	if (m->count == 0)
+		return NULL;
+
+	e = hashmap_slot(m, key, hashmap_hash(key));
+	if (e->key == NULL)
+		return NULL;
+	value = e->value;
+	m->count--;
+
+	/* Close the gap: move back entries that would not be found past it */
+	i = e - m->slots;
+	j = i;
+	for (;;) {
+		unsigned int home;
+
+		m->slots[i].key = NULL;
+		m->slots[i].value = NULL;
+		do {
+			j = (j + 1) & (m->size - 1);
+			if (m->slots[j].key == NULL)
+				return value;
+			home = m->slots[j].hash & (m->size - 1);
+		} while ((i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j)));
+		m->slots[i] = m->slots[j];
+		i = j;
+	}
+}
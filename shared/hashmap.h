@@ -0,0 +1,38 @@
+/** \file shared/hashmap.h
+ * Hash maps from strings to pointers.
+ *
+ * The map uses open addressing in one block of memory. Keys are not
+ * copied: a key must stay unchanged while it is in the map, which is
+ * easiest if it is a field of the value (e.g. the id of a widget).
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+/** Slot of a hash map */
+typedef struct HashMapEntry {
+	const char *key;	/**< Key; NULL if the slot is free */
+	void *value;		/**< Value */
+	unsigned int hash;	/**< Hash of the key */
+} HashMapEntry;
+
+/** Hash map from strings to pointers */
+typedef struct HashMap {
+	HashMapEntry *slots;	/**< The slots */
+	unsigned int size;	/**< Number of slots; a power of two or 0 */
+	unsigned int count;	/**< Number of keys */
+} HashMap;
+
+void hashmap_init(HashMap *m);
+void hashmap_clear(HashMap *m);
+int hashmap_put(HashMap *m, const char *key, void *value);
+void *hashmap_get(const HashMap *m, const char *key);
+void *hashmap_remove(HashMap *m, const char *key);
+
+#endif
@@ -0,0 +1,68 @@
+/** \file shared/shmscreen.h
+ * Layout of the shared-memory region through which a local client can
+ * update the widgets of one of its screens without sending commands.
+ *
+ * The client creates a POSIX shared memory object (shm_open()) of at least
+ * sizeof(ShmScreen) bytes, readable by the user LCDd runs as, fills in
+ * magic and version and attaches it to a screen with
+ * "screen_set <screen> -shm <name>". Each slot names a widget
+ * of that screen and holds its value, with the same meaning as the value of
+ * a "widget_animate -sequence" step: the text of a string, title or
+ * scroller, the length of an hbar or vbar, the promille of a pbar, the
+ * digit of a num or the name of an icon. LCDd reads the region each time
+ * it renders the screen.
+ *
+ * Updates are guarded by a sequence counter (seqlock): the writer makes
+ * seq odd before it changes slots and even again afterwards. LCDd ignores
+ * the region while seq is odd and rereads it when seq changed during the
+ * copy. shmscreen_begin() and shmscreen_end() do this for the writer.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef SHMSCREEN_LAYOUT_H
+#define SHMSCREEN_LAYOUT_H
+
+#include <stdint.h>
+
+#define SHM_SCREEN_MAGIC	0x4c434453	/**< "LCDS" */
+#define SHM_SCREEN_VERSION	1
+#define SHM_SCREEN_SLOTS	64		/**< Number of widget slots */
+#define SHM_SCREEN_IDSIZE	32		/**< Size of a widget id, including NUL */
+#define SHM_SCREEN_VALUESIZE	64		/**< Size of a value, including NUL */
+
+/** Value of one widget */
+typedef struct ShmWidgetSlot {
+	char id[SHM_SCREEN_IDSIZE];		/**< Widget id; empty slots are skipped */
+	char value[SHM_SCREEN_VALUESIZE];	/**< Value of the widget */
+} ShmWidgetSlot;
+
+/** Shared-memory region of a screen */
+typedef struct ShmScreen {
+	uint32_t magic;		/**< SHM_SCREEN_MAGIC */
+	uint32_t version;	/**< SHM_SCREEN_VERSION */
+	uint32_t seq;		/**< Odd while the writer changes the slots */
+	uint32_t count;		/**< Number of slots in use */
+	ShmWidgetSlot slots[SHM_SCREEN_SLOTS];
+} ShmScreen;
+
+/** Start changing the slots of a region. */
+static inline void
+shmscreen_begin(ShmScreen *shm)
+{
+	__atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/** Publish the slots changed since shmscreen_begin(). */
+static inline void
+shmscreen_end(ShmScreen *shm)
+{
+	__atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELEASE);
+}
+
+#endif
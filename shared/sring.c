@@ -1,7 +1,7 @@
 /** \file shared/sring.c
  * Circular buffer implementation for string processing.
  *
- * \todo Implement sring_peek() and sring_skip().
+ * \todo Implement sring_skip().
  */
 
 /*-
@@ -198,6 +198,30 @@ sring_read(sring_buffer *buf, char *dst, int dst_len)
 	return dst_len;
 }
 
+/**
+ * Copy up to dst_len bytes from the ring buffer without removing them.
+ *
+ * \param buf  Ring buffer to work on
+ * \param dst  Pointer to target buffer
+ * \param dst_len  Number of bytes to copy at most
+ * \return     The number of bytes actually copied
+ */
+int
+sring_peek(sring_buffer *buf, char *dst, int dst_len)
+{
+	unsigned int r;
+	int n;
+
+	if (buf == NULL)
+		return -1;
+
+	r = buf->r;
+	n = sring_read(buf, dst, dst_len);
+	buf->r = r;
+
+	return n;
+}
+
 /**
  * Return the next string from the ring buffer.
  * The next string is a sequence of bytes terminated by \\r, \\n or \\0. The
@@ -0,0 +1,208 @@
+/** \file shared/vector.c
+ * Growable arrays and FIFO queues of pointers.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+/** Room for this many elements is made on the first insertion */
+#define VECTOR_MIN_SIZE	8
+
+
+/**
+ * Initialize an empty vector. No memory is allocated until an element is
+ * added.
+ *
+ * \param v  Vector to initialize
+ */
+void
+vector_init(Vector *v)
+{
+	v->items = NULL;
+	v->count = 0;
+	v->size = 0;
+}
+
+/**
+ * Remove all elements and free the vector's memory. The elements
+ * themselves are not freed.
+ *
+ * \param v  Vector to clear
+ */
+void
+vector_clear(Vector *v)
+{
+	free(v->items);
+	vector_init(v);
+}
+
+/**
+ * Append an element.
+ *
+ * \param v     Vector to add to
+ * \param item  The element
+ * \retval 0    Success
+ * \retval -1   Out of memory
+ */
+int
+vector_push(Vector *v, void *item)
+{
+	if (v->count == v->size) {
+		int size = (v->size > 0) ? 2 * v->size : VECTOR_MIN_SIZE;
+		void **items = realloc(v->items, size * sizeof(void *));
+
+		if (items == NULL)
+			return -1;
+		v->items = items;
+		v->size = size;
+	}
+	v->items[v->count++] = item;
+	return 0;
+}
+
+/**
+ * Find the index of an element.
+ *
+ * \param v     Vector to search
+ * \param item  The element
+ * \return      Index of the first occurrence; -1 if not found
+ */
+int
+vector_find(const Vector *v, const void *item)
+{
+	int i;
+
+	for (i = 0; i < v->count; i++) {
+		if (v->items[i] == item)
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * Remove the element at an index. The following elements move up by
+ * one, so the order is kept.
+ *
+ * \param v      Vector to remove from
+ * \param index  Index of the element
+ * \return       The element; NULL if the index is out of range
+ */
+void *
+vector_remove_at(Vector *v, int index)
+{
+	void *item;
+
+	if ((index < 0) || (index >= v->count))
+		return NULL;
+
+	item = v->items[index];
+	v->count--;
+	memmove(v->items + index, v->items + index + 1, (v->count - index) * sizeof(void *));
+	return item;
+}
+
+/**
+ * Remove the first occurrence of an element, keeping the order of the
+ * others.
+ *
+ * \param v     Vector to remove from
+ * \param item  The element
+ * \return      Index the element had; -1 if not found
+ */
+int
+vector_remove(Vector *v, const void *item)
+{
+	int index = vector_find(v, item);
+
+	if (index >= 0)
+		vector_remove_at(v, index);
+	return index;
+}
+
+
+/**
+ * Initialize an empty queue. No memory is allocated until an element is
+ * added.
+ *
+ * \param q  Queue to initialize
+ */
+void
+queue_init(Queue *q)
+{
+	q->items = NULL;
+	q->size = 0;
+	q->head = 0;
+	q->count = 0;
+}
+
+/**
+ * Remove all elements and free the queue's memory. The elements
+ * themselves are not freed.
+ *
+ * \param q  Queue to clear
+ */
+void
+queue_clear(Queue *q)
+{
+	free(q->items);
+	queue_init(q);
+}
+
+/**
+ * Append an element.
+ *
+ * \param q     Queue to add to
+ * \param item  The element
+ * \retval 0    Success
+ * \retval -1   Out of memory
+ */
+int
+queue_put(Queue *q, void *item)
+{
+	if (q->count == q->size) {
+		unsigned int size = (q->size > 0) ? 2 * q->size : VECTOR_MIN_SIZE;
+		void **items = malloc(size * sizeof(void *));
+		unsigned int i;
+
+		if (items == NULL)
+			return -1;
+		/* Unwrap the ring into the new block */
+		for (i = 0; i < q->count; i++)
+			items[i] = q->items[(q->head + i) & (q->size - 1)];
+		free(q->items);
+		q->items = items;
+		q->size = size;
+		q->head = 0;
+	}
+	q->items[(q->head + q->count) & (q->size - 1)] = item;
+	q->count++;
+	return 0;
+}
+
+/**
+ * Remove the oldest element.
+ *
+ * \param q  Queue to remove from
+ * \return   The element; NULL if the queue is empty
+ */
+void *
+queue_get(Queue *q)
+{
+	void *item;
+
+	if (q->count == 0)
+		return NULL;
+
+	item = q->items[q->head];
+	q->head = (q->head + 1) & (q->size - 1);
+	q->count--;
+	return item;
+}
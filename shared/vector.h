@@ -0,0 +1,83 @@
+/** \file shared/vector.h
+ * Growable arrays and FIFO queues of pointers.
+ *
+ * Unlike the LinkedList of LL.h these keep their elements in one block of
+ * memory, so walking them touches few cache lines and adding an element
+ * does not allocate a node. They have no built-in cursor: a vector is
+ * walked by index, so nested loops over the same vector do not disturb
+ * each other.
+ *
+ * \code
+ * int i;
+ * Widget *w;
+ *
+ * for (i = 0; (w = vector_get(&s->widgets, i)) != NULL; i++)
+ *	...
+ * \endcode
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef VECTOR_H
+#define VECTOR_H
+
+/** Growable array of pointers */
+typedef struct Vector {
+	void **items;		/**< The elements */
+	int count;		/**< Number of elements */
+	int size;		/**< Number of elements there is room for */
+} Vector;
+
+/** FIFO queue of pointers, kept in a ring */
+typedef struct Queue {
+	void **items;		/**< Ring of elements */
+	unsigned int size;	/**< Number of slots; a power of two or 0 */
+	unsigned int head;	/**< Slot of the oldest element */
+	unsigned int count;	/**< Number of elements */
+} Queue;
+
+void vector_init(Vector *v);
+void vector_clear(Vector *v);
+int vector_push(Vector *v, void *item);
+int vector_find(const Vector *v, const void *item);
+void *vector_remove_at(Vector *v, int index);
+int vector_remove(Vector *v, const void *item);
+
+/** Get the element at an index; NULL if the index is out of range. */
+static inline void *
+vector_get(const Vector *v, int index)
+{
+	return ((index >= 0) && (index < v->count)) ? v->items[index] : NULL;
+}
+
+/** Get the number of elements. */
+static inline int
+vector_count(const Vector *v)
+{
+	return v->count;
+}
+
+void queue_init(Queue *q);
+void queue_clear(Queue *q);
+int queue_put(Queue *q, void *item);
+void *queue_get(Queue *q);
+
+/** Get the oldest element without removing it; NULL if the queue is empty. */
+static inline void *
+queue_peek(const Queue *q)
+{
+	return (q->count > 0) ? q->items[q->head] : NULL;
+}
+
+/** Get the number of elements. */
+static inline int
+queue_count(const Queue *q)
+{
+	return q->count;
+}
+
+#endif